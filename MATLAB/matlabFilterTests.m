@@ -3,6 +3,8 @@ function matlabFilterTests()
     %% ======================== UART & Global Variables =========================
     % Configure the serial port
     serialPort = serialport('COM6', 9600);
+    % Count the WALK++/RUN++ sent below instead of the on-board detections
+    writeline(serialPort, 'HOST 1');
 
     % Global lines for step detection in subplots 2 and 3
     global hLine5 hLine6
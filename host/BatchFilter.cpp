@@ -0,0 +1,408 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file BatchFilter.cpp
+ * @brief Implementation of the SoA filter bank (scalar, SSE4.1 and AVX2 kernels).
+ */
+
+#include "BatchFilter.hpp"
+#include "../inc/StepDetector.hpp"
+
+#include <cmath>
+#include <cstring>
+#include <new>
+
+#if defined(__x86_64__) || defined(__i386__)
+  #define BATCH_FILTER_X86 1
+  #include <immintrin.h>
+#else
+  #define BATCH_FILTER_X86 0
+#endif
+
+static_assert(StepDetector::HpfFilter::SECTIONS == 1 && StepDetector::BpfFilter::SECTIONS == 2,
+              "kernels are unrolled for a one-section HPF and a two-section BPF");
+
+namespace
+{
+    enum Tap { X1, X2, Y1, Y2 };
+
+    const BiquadQ29 COEFFS[3] =
+    {
+        StepDetector::HpfFilter::q29.sections[0],
+        StepDetector::BpfFilter::q29.sections[0],
+        StepDetector::BpfFilter::q29.sections[1],
+    };
+
+    constexpr int32_t MAG_LIMIT_Q12 = 32767;
+    constexpr int64_t ROUND_Q29     = 1LL << (butter::Q_COEFF - 1);
+
+    int32_t clampQ12(int32_t q15)
+    {
+        int32_t v = q15 >> 3;
+        if (v >  MAG_LIMIT_Q12) { v =  MAG_LIMIT_Q12; }
+        if (v < -MAG_LIMIT_Q12) { v = -MAG_LIMIT_Q12; }
+        return v;
+    }
+
+    int32_t magnitudeQ15(int32_t x, int32_t y, int32_t z)
+    {
+        int32_t x12 = clampQ12(x);
+        int32_t y12 = clampQ12(y);
+        int32_t z12 = clampQ12(z);
+        uint32_t sum = static_cast<uint32_t>(x12 * x12)
+                     + static_cast<uint32_t>(y12 * y12)
+                     + static_cast<uint32_t>(z12 * z12);
+        return static_cast<int32_t>(std::sqrt(static_cast<double>(sum))) << 3;
+    }
+}
+
+BatchFilter::BatchFilter(size_t streams, Kernel kernel)
+    : count(streams), padded((streams + LANES - 1) / LANES * LANES), active(kernel)
+{
+    if (!supported(kernel))
+    {
+        active = Kernel::Scalar;
+    }
+    size_t bytes = SECTIONS * 3 * TAPS * (padded ? padded : LANES) * sizeof(int32_t);
+    state.reset(static_cast<int32_t*>(std::aligned_alloc(32, bytes)));
+    if (!state)
+    {
+        throw std::bad_alloc();
+    }
+    reset();
+}
+
+BatchFilter::Kernel BatchFilter::best()
+{
+    if (supported(Kernel::Avx2))
+    {
+        return Kernel::Avx2;
+    }
+    if (supported(Kernel::Sse41))
+    {
+        return Kernel::Sse41;
+    }
+    return Kernel::Scalar;
+}
+
+bool BatchFilter::supported(Kernel kernel)
+{
+    switch (kernel)
+    {
+    case Kernel::Scalar:
+        return true;
+#if BATCH_FILTER_X86
+    case Kernel::Sse41:
+        return __builtin_cpu_supports("sse4.1");
+    case Kernel::Avx2:
+        return __builtin_cpu_supports("avx2");
+#endif
+    default:
+        return false;
+    }
+}
+
+const char* BatchFilter::name(Kernel kernel)
+{
+    static const char* const names[] = { "scalar", "sse4.1", "avx2" };
+    static_assert(sizeof(names) / sizeof(names[0]) == static_cast<size_t>(Kernel::Count), "one name per kernel");
+    return names[static_cast<size_t>(kernel)];
+}
+
+void BatchFilter::reset()
+{
+    std::memset(state.get(), 0, SECTIONS * 3 * TAPS * padded * sizeof(int32_t));
+}
+
+void BatchFilter::process(const int16_t* x, const int16_t* y, const int16_t* z,
+                          int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    const int16_t* in[3] = { x, y, z };
+    switch (active)
+    {
+    case Kernel::Avx2:  processAvx2(in, hpfMagnitude, bpfMagnitude);   break;
+    case Kernel::Sse41: processSse41(in, hpfMagnitude, bpfMagnitude);  break;
+    default:            processScalar(in, hpfMagnitude, bpfMagnitude); break;
+    }
+}
+
+/* =========================================
+ * Scalar kernel (also the tail of the SIMD kernels)
+ * =========================================
+ */
+
+int32_t BatchFilter::biquad(size_t section, size_t axis, size_t lane, int32_t x)
+{
+    const BiquadQ29& c = COEFFS[section];
+    int32_t& x1 = tap(section, axis, X1)[lane];
+    int32_t& x2 = tap(section, axis, X2)[lane];
+    int32_t& y1 = tap(section, axis, Y1)[lane];
+    int32_t& y2 = tap(section, axis, Y2)[lane];
+
+    int64_t acc = static_cast<int64_t>(c.b0) * x
+                + static_cast<int64_t>(c.b1) * x1
+                + static_cast<int64_t>(c.b2) * x2
+                - static_cast<int64_t>(c.a1) * y1
+                - static_cast<int64_t>(c.a2) * y2;
+    int32_t y = static_cast<int32_t>((acc + ROUND_Q29) >> butter::Q_COEFF);
+
+    x2 = x1;
+    x1 = x;
+    y2 = y1;
+    y1 = y;
+    return y;
+}
+
+void BatchFilter::processLane(size_t lane, const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    int32_t hpf[3];
+    int32_t bpf[3];
+    for (size_t axis = 0; axis < 3; ++axis)
+    {
+        int32_t x = in[axis][lane] * 8;     // 14-bit counts (Q12 g) -> Q15 g
+        hpf[axis] = biquad(0, axis, lane, x);
+        bpf[axis] = biquad(2, axis, lane, biquad(1, axis, lane, x));
+    }
+    hpfMagnitude[lane] = magnitudeQ15(hpf[0], hpf[1], hpf[2]);
+    bpfMagnitude[lane] = magnitudeQ15(bpf[0], bpf[1], bpf[2]);
+}
+
+void BatchFilter::processScalar(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    for (size_t lane = 0; lane < count; ++lane)
+    {
+        processLane(lane, in, hpfMagnitude, bpfMagnitude);
+    }
+}
+
+#if BATCH_FILTER_X86
+
+/* =========================================
+ * SSE4.1 kernel: 4 streams per step
+ * =========================================
+ */
+
+/* 32 x 32 -> 64 bit signed products exist for the even lanes only (pmuldq),
+ * so the odd lanes are shifted down and multiplied separately. The rounded
+ * Q29 result fits in 32 bits, so a logical 64-bit shift gives the same low
+ * half as the arithmetic one SSE/AVX2 lack. */
+__attribute__((target("sse4.1")))
+static inline __m128i mulAcc4(__m128i acc, __m128i v, __m128i c)
+{
+    return _mm_add_epi64(acc, _mm_mul_epi32(v, c));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i mulSub4(__m128i acc, __m128i v, __m128i c)
+{
+    return _mm_sub_epi64(acc, _mm_mul_epi32(v, c));
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i biquad4(const BiquadQ29& c, int32_t* x1p, int32_t* x2p, int32_t* y1p, int32_t* y2p, __m128i x)
+{
+    const __m128i b0 = _mm_set1_epi64x(c.b0), b1 = _mm_set1_epi64x(c.b1), b2 = _mm_set1_epi64x(c.b2);
+    const __m128i a1 = _mm_set1_epi64x(c.a1), a2 = _mm_set1_epi64x(c.a2);
+    const __m128i round = _mm_set1_epi64x(ROUND_Q29);
+
+    __m128i x1 = _mm_load_si128(reinterpret_cast<const __m128i*>(x1p));
+    __m128i x2 = _mm_load_si128(reinterpret_cast<const __m128i*>(x2p));
+    __m128i y1 = _mm_load_si128(reinterpret_cast<const __m128i*>(y1p));
+    __m128i y2 = _mm_load_si128(reinterpret_cast<const __m128i*>(y2p));
+
+    __m128i even = _mm_mul_epi32(x, b0);
+    even = mulAcc4(even, x1, b1);
+    even = mulAcc4(even, x2, b2);
+    even = mulSub4(even, y1, a1);
+    even = mulSub4(even, y2, a2);
+
+    __m128i odd = _mm_mul_epi32(_mm_srli_epi64(x, 32), b0);
+    odd = mulAcc4(odd, _mm_srli_epi64(x1, 32), b1);
+    odd = mulAcc4(odd, _mm_srli_epi64(x2, 32), b2);
+    odd = mulSub4(odd, _mm_srli_epi64(y1, 32), a1);
+    odd = mulSub4(odd, _mm_srli_epi64(y2, 32), a2);
+
+    even = _mm_srli_epi64(_mm_add_epi64(even, round), butter::Q_COEFF);
+    odd  = _mm_slli_epi64(_mm_srli_epi64(_mm_add_epi64(odd, round), butter::Q_COEFF), 32);
+    __m128i y = _mm_blend_epi16(even, odd, 0xCC);
+
+    _mm_store_si128(reinterpret_cast<__m128i*>(x2p), x1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(x1p), x);
+    _mm_store_si128(reinterpret_cast<__m128i*>(y2p), y1);
+    _mm_store_si128(reinterpret_cast<__m128i*>(y1p), y);
+    return y;
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i square4(__m128i q15)
+{
+    __m128i v = _mm_srai_epi32(q15, 3);
+    v = _mm_min_epi32(v, _mm_set1_epi32(MAG_LIMIT_Q12));
+    v = _mm_max_epi32(v, _mm_set1_epi32(-MAG_LIMIT_Q12));
+    return _mm_mullo_epi32(v, v);
+}
+
+__attribute__((target("sse4.1")))
+static inline __m128i magnitude4(__m128i x, __m128i y, __m128i z)
+{
+    __m128i sum = _mm_add_epi32(_mm_add_epi32(square4(x), square4(y)), square4(z));
+
+    // uint32 -> double via the signed conversion, then floor(sqrt()) per pair of lanes
+    const __m128i bias    = _mm_set1_epi32(static_cast<int32_t>(0x80000000u));
+    const __m128d biasPd  = _mm_set1_pd(2147483648.0);
+    __m128i s  = _mm_xor_si128(sum, bias);
+    __m128d lo = _mm_add_pd(_mm_cvtepi32_pd(s), biasPd);
+    __m128d hi = _mm_add_pd(_mm_cvtepi32_pd(_mm_shuffle_epi32(s, 0xEE)), biasPd);
+    __m128i r  = _mm_unpacklo_epi64(_mm_cvttpd_epi32(_mm_sqrt_pd(lo)), _mm_cvttpd_epi32(_mm_sqrt_pd(hi)));
+    return _mm_slli_epi32(r, 3);
+}
+
+__attribute__((target("sse4.1")))
+void BatchFilter::processSse41(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    size_t lane = 0;
+    for (; lane + 4 <= count; lane += 4)
+    {
+        __m128i hpf[3];
+        __m128i bpf[3];
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            __m128i raw = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(in[axis] + lane));
+            __m128i x   = _mm_slli_epi32(_mm_cvtepi16_epi32(raw), 3);
+
+            hpf[axis] = biquad4(COEFFS[0], tap(0, axis, X1) + lane, tap(0, axis, X2) + lane,
+                                tap(0, axis, Y1) + lane, tap(0, axis, Y2) + lane, x);
+            __m128i s = biquad4(COEFFS[1], tap(1, axis, X1) + lane, tap(1, axis, X2) + lane,
+                                tap(1, axis, Y1) + lane, tap(1, axis, Y2) + lane, x);
+            bpf[axis] = biquad4(COEFFS[2], tap(2, axis, X1) + lane, tap(2, axis, X2) + lane,
+                                tap(2, axis, Y1) + lane, tap(2, axis, Y2) + lane, s);
+        }
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(hpfMagnitude + lane), magnitude4(hpf[0], hpf[1], hpf[2]));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(bpfMagnitude + lane), magnitude4(bpf[0], bpf[1], bpf[2]));
+    }
+    for (; lane < count; ++lane)
+    {
+        processLane(lane, in, hpfMagnitude, bpfMagnitude);
+    }
+}
+
+/* =========================================
+ * AVX2 kernel: 8 streams per step
+ * =========================================
+ */
+
+__attribute__((target("avx2")))
+static inline __m256i mulAcc8(__m256i acc, __m256i v, __m256i c)
+{
+    return _mm256_add_epi64(acc, _mm256_mul_epi32(v, c));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i mulSub8(__m256i acc, __m256i v, __m256i c)
+{
+    return _mm256_sub_epi64(acc, _mm256_mul_epi32(v, c));
+}
+
+__attribute__((target("avx2")))
+static inline __m256i biquad8(const BiquadQ29& c, int32_t* x1p, int32_t* x2p, int32_t* y1p, int32_t* y2p, __m256i x)
+{
+    const __m256i b0 = _mm256_set1_epi64x(c.b0), b1 = _mm256_set1_epi64x(c.b1), b2 = _mm256_set1_epi64x(c.b2);
+    const __m256i a1 = _mm256_set1_epi64x(c.a1), a2 = _mm256_set1_epi64x(c.a2);
+    const __m256i round = _mm256_set1_epi64x(ROUND_Q29);
+
+    __m256i x1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(x1p));
+    __m256i x2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(x2p));
+    __m256i y1 = _mm256_load_si256(reinterpret_cast<const __m256i*>(y1p));
+    __m256i y2 = _mm256_load_si256(reinterpret_cast<const __m256i*>(y2p));
+
+    __m256i even = _mm256_mul_epi32(x, b0);
+    even = mulAcc8(even, x1, b1);
+    even = mulAcc8(even, x2, b2);
+    even = mulSub8(even, y1, a1);
+    even = mulSub8(even, y2, a2);
+
+    __m256i odd = _mm256_mul_epi32(_mm256_srli_epi64(x, 32), b0);
+    odd = mulAcc8(odd, _mm256_srli_epi64(x1, 32), b1);
+    odd = mulAcc8(odd, _mm256_srli_epi64(x2, 32), b2);
+    odd = mulSub8(odd, _mm256_srli_epi64(y1, 32), a1);
+    odd = mulSub8(odd, _mm256_srli_epi64(y2, 32), a2);
+
+    even = _mm256_srli_epi64(_mm256_add_epi64(even, round), butter::Q_COEFF);
+    odd  = _mm256_slli_epi64(_mm256_srli_epi64(_mm256_add_epi64(odd, round), butter::Q_COEFF), 32);
+    __m256i y = _mm256_blend_epi32(even, odd, 0xAA);
+
+    _mm256_store_si256(reinterpret_cast<__m256i*>(x2p), x1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(x1p), x);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(y2p), y1);
+    _mm256_store_si256(reinterpret_cast<__m256i*>(y1p), y);
+    return y;
+}
+
+__attribute__((target("avx2")))
+static inline __m256i square8(__m256i q15)
+{
+    __m256i v = _mm256_srai_epi32(q15, 3);
+    v = _mm256_min_epi32(v, _mm256_set1_epi32(MAG_LIMIT_Q12));
+    v = _mm256_max_epi32(v, _mm256_set1_epi32(-MAG_LIMIT_Q12));
+    return _mm256_mullo_epi32(v, v);
+}
+
+__attribute__((target("avx2")))
+static inline __m256i magnitude8(__m256i x, __m256i y, __m256i z)
+{
+    __m256i sum = _mm256_add_epi32(_mm256_add_epi32(square8(x), square8(y)), square8(z));
+
+    const __m256i bias   = _mm256_set1_epi32(static_cast<int32_t>(0x80000000u));
+    const __m256d biasPd = _mm256_set1_pd(2147483648.0);
+    __m256i s  = _mm256_xor_si256(sum, bias);
+    __m256d lo = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_castsi256_si128(s)), biasPd);
+    __m256d hi = _mm256_add_pd(_mm256_cvtepi32_pd(_mm256_extracti128_si256(s, 1)), biasPd);
+    __m256i r  = _mm256_set_m128i(_mm256_cvttpd_epi32(_mm256_sqrt_pd(hi)), _mm256_cvttpd_epi32(_mm256_sqrt_pd(lo)));
+    return _mm256_slli_epi32(r, 3);
+}
+
+__attribute__((target("avx2")))
+void BatchFilter::processAvx2(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    size_t lane = 0;
+    for (; lane + 8 <= count; lane += 8)
+    {
+        __m256i hpf[3];
+        __m256i bpf[3];
+        for (size_t axis = 0; axis < 3; ++axis)
+        {
+            __m128i raw = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in[axis] + lane));
+            __m256i x   = _mm256_slli_epi32(_mm256_cvtepi16_epi32(raw), 3);
+
+            hpf[axis] = biquad8(COEFFS[0], tap(0, axis, X1) + lane, tap(0, axis, X2) + lane,
+                                tap(0, axis, Y1) + lane, tap(0, axis, Y2) + lane, x);
+            __m256i s = biquad8(COEFFS[1], tap(1, axis, X1) + lane, tap(1, axis, X2) + lane,
+                                tap(1, axis, Y1) + lane, tap(1, axis, Y2) + lane, x);
+            bpf[axis] = biquad8(COEFFS[2], tap(2, axis, X1) + lane, tap(2, axis, X2) + lane,
+                                tap(2, axis, Y1) + lane, tap(2, axis, Y2) + lane, s);
+        }
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(hpfMagnitude + lane), magnitude8(hpf[0], hpf[1], hpf[2]));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(bpfMagnitude + lane), magnitude8(bpf[0], bpf[1], bpf[2]));
+    }
+    for (; lane < count; ++lane)
+    {
+        processLane(lane, in, hpfMagnitude, bpfMagnitude);
+    }
+}
+
+#else
+
+void BatchFilter::processSse41(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    processScalar(in, hpfMagnitude, bpfMagnitude);
+}
+
+void BatchFilter::processAvx2(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude)
+{
+    processScalar(in, hpfMagnitude, bpfMagnitude);
+}
+
+#endif // BATCH_FILTER_X86
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file BatchFilter.hpp
+ * @brief StepDetector's HPF/BPF and magnitude for many streams at once, SIMD on the host.
+ *
+ * The per-stream StepDetector keeps each stream's X/Y/Z delay lines together
+ * (array of structures) and filters one value at a time. BatchFilter stores
+ * the same state as structure of arrays - one contiguous array per section,
+ * axis and delay tap, indexed by stream - so one sample of 8 (AVX2) or 4
+ * (SSE4.1) streams is filtered with a handful of vector instructions.
+ *
+ * Results are bit-identical to StepDetector::lastHpfMagnitude() and
+ * lastBpfMagnitude(): the Q29 x Q15 products are accumulated in 64 bits in
+ * every kernel, and the integer square root is taken from the exact double
+ * square root (floor(sqrt(v)) is exact for v < 2^32).
+ *
+ * The kernel is chosen at run time from the CPU features (best()); the SIMD
+ * code is compiled with per-function target attributes, so the binary still
+ * runs on x86-64 CPUs without AVX2 and on other architectures (scalar only).
+ *
+ * Usage:
+ * @code
+ *   BatchFilter filter(streams);
+ *   filter.process(x, y, z, hpfMag, bpfMag);   // one sample of every stream
+ * @endcode
+ */
+
+#ifndef BATCH_FILTER_HPP
+#define BATCH_FILTER_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <memory>
+
+/**
+ * @class BatchFilter
+ * @brief Structure-of-arrays filter bank with scalar, SSE4.1 and AVX2 kernels.
+ */
+class BatchFilter
+{
+public:
+    /**
+     * @brief Implementations of process().
+     */
+    enum class Kernel : uint8_t
+    {
+        Scalar,     /**< Plain C++ over the SoA arrays. */
+        Sse41,      /**< 4 streams per step. */
+        Avx2,       /**< 8 streams per step. */
+        Count
+    };
+
+    /**
+     * @brief Creates the filter bank with all delay lines cleared.
+     * @param streams Number of independent streams.
+     * @param kernel Implementation; must be supported() on this CPU.
+     */
+    explicit BatchFilter(size_t streams, Kernel kernel = best());
+
+    /**
+     * @brief Fastest kernel the CPU supports.
+     */
+    static Kernel best();
+
+    /**
+     * @brief True if @p kernel can run on this CPU.
+     */
+    static bool supported(Kernel kernel);
+
+    /**
+     * @brief Short kernel name for reports ("scalar", "sse4.1", "avx2").
+     */
+    static const char* name(Kernel kernel);
+
+    /**
+     * @brief Clears the delay lines of all streams.
+     */
+    void reset();
+
+    /**
+     * @brief Filters one sample of every stream.
+     * @param x, y, z Raw acceleration per stream in 14-bit counts (streams() entries each).
+     * @param hpfMagnitude Receives |HPF(x, y, z)| per stream (Q15 g).
+     * @param bpfMagnitude Receives |BPF(x, y, z)| per stream (Q15 g).
+     */
+    void process(const int16_t* x, const int16_t* y, const int16_t* z,
+                 int32_t* hpfMagnitude, int32_t* bpfMagnitude);
+
+    size_t streams() const { return count; }
+
+    Kernel kernel() const { return active; }
+
+private:
+    static constexpr size_t LANES    = 8;   // padding unit, the widest kernel
+    static constexpr size_t SECTIONS = 3;   // HPF, BPF section 0, BPF section 1
+    static constexpr size_t TAPS     = 4;   // x1, x2, y1, y2
+
+    struct FreeAligned
+    {
+        void operator()(int32_t* p) const { std::free(p); }
+    };
+
+    /**
+     * @brief Delay tap array of one section and axis, indexed by stream.
+     */
+    int32_t* tap(size_t section, size_t axis, size_t which)
+    {
+        return state.get() + ((section * 3 + axis) * TAPS + which) * padded;
+    }
+
+    int32_t biquad(size_t section, size_t axis, size_t lane, int32_t x);
+    void processLane(size_t lane, const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude);
+    void processScalar(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude);
+    void processSse41(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude);
+    void processAvx2(const int16_t* in[3], int32_t* hpfMagnitude, int32_t* bpfMagnitude);
+
+    size_t count;
+    size_t padded;                                  // count rounded up to LANES
+    Kernel active;
+    std::unique_ptr<int32_t[], FreeAligned> state;  // SECTIONS x 3 axes x TAPS x padded, 32-byte aligned
+};
+
+#endif // BATCH_FILTER_HPP
@@ -0,0 +1,169 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file FlashLogBench.cpp
+ * @brief Power-loss and restore-time check of the flash counter log on the simulated FTFA.
+ *
+ * Runs the unchanged CounterLog.cpp/Flash.cpp against the simulator's flash
+ * model and, for every counter update of a run that wraps the sector ring
+ * several times, cuts the supply at each flash command the update issues,
+ * with 0 to 100 % of that command's bits changed. After each cut it boots a
+ * new CounterLog on the flash image and checks that:
+ *  - the restored counters are the ones before or after the interrupted update,
+ *  - a write after the recovery is restored again by the next boot.
+ * It reports the trials, the worst-case flash reads of restore() over all
+ * these images against a full scan, and the sector erases (wear) of the run.
+ * On the board the restore time itself is the log_restore stage of PROFILE.
+ *
+ * Usage: PEDOSIM_UART=stdio flash_log_bench [updates] [sectors]
+ */
+
+#include "CounterLog.hpp"
+#include "Simulator.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace
+{
+    bool operator==(const CounterLog::Counters& a, const CounterLog::Counters& b)
+    {
+        return a.walk == b.walk && a.run == b.run;
+    }
+
+    /**
+     * @brief Boots a new log (no rate limit) on the current flash image.
+     * @param maxReads Updated with the flash reads of restore() if more than before.
+     */
+    CounterLog boot(uint32_t base, uint8_t sectors, uint32_t& maxReads, CounterLog::Counters& restored)
+    {
+        CounterLog log(base, sectors, 0);
+        log.restore(restored);
+        if (log.stats().restoreReads > maxReads)
+        {
+            maxReads = log.stats().restoreReads;
+        }
+        return log;
+    }
+
+    /**
+     * @brief One update as the firmware does it: poll() until written, or flush() every 7th time.
+     */
+    void update(CounterLog& log, const CounterLog::Counters& counters, uint32_t index)
+    {
+        if (index % 7u == 0)
+        {
+            log.flush(counters);
+            return;
+        }
+        while (log.poll(counters, index))
+        {
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const uint8_t sectors = static_cast<uint8_t>(argc > 2 ? std::strtoul(argv[2], nullptr, 10) : 4);
+    const uint32_t updates = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10))
+                                      : 3u * sectors * CounterLog::RECORDS_PER_SECTOR + 10u;
+    if (sectors < 2 || sectors > CounterLog::MAX_SECTORS)
+    {
+        std::fprintf(stderr, "usage: flash_log_bench [updates] [sectors 2..%u]\n", CounterLog::MAX_SECTORS);
+        return 2;
+    }
+
+    // The log at the top of the flash, as in the firmware
+    static const uint16_t PERMILLE[] = { 0, 250, 500, 750, 1000 };
+    const uint32_t regionSize = sectors * flash::SECTOR_SIZE;
+    const uint32_t base = flash::SIZE - regionSize;
+    uint8_t* region = sim::flashMemory(base);
+    std::memset(region, 0xFF, regionSize);
+
+    std::vector<uint8_t> image(regionSize);
+    uint32_t maxReads = 0;
+    CounterLog::Counters expected;
+    CounterLog live = boot(base, sectors, maxReads, expected);
+
+    uint32_t trials = 0;
+    uint32_t failures = 0;
+    uint32_t kept = 0;
+    for (uint32_t i = 1; i <= updates; ++i)
+    {
+        CounterLog::Counters next = { expected.walk + 1u + i % 3u, expected.run + (i % 5u == 0) };
+
+        // Cut the supply at every command of this update
+        std::memcpy(image.data(), region, regionSize);
+        const CounterLog saved = live;
+        for (uint32_t command = 1; ; ++command)
+        {
+            bool lastCommand = false;
+            for (uint16_t permille : PERMILLE)
+            {
+                std::memcpy(region, image.data(), regionSize);
+                CounterLog attempt = saved;
+                sim::flashPowerLoss(command, permille, i * 7919u + command);
+                update(attempt, next, i);
+                if (!sim::flashPowerLost())
+                {
+                    lastCommand = true;   // the update needs fewer commands
+                    break;
+                }
+                sim::flashPowerOn();
+                ++trials;
+
+                CounterLog::Counters restored;
+                CounterLog rebooted = boot(base, sectors, maxReads, restored);
+                bool ok = restored == expected || restored == next;
+                kept += restored == expected;
+
+                // The log must keep working after the recovery
+                CounterLog::Counters after = { restored.walk + 100u, restored.run + 100u };
+                CounterLog::Counters again;
+                update(rebooted, after, i);
+                boot(base, sectors, maxReads, again);
+                ok = ok && again == after;
+                if (!ok)
+                {
+                    if (++failures <= 10)
+                    {
+                        std::printf("FAIL update %u command %u (%u permille): restored %u/%u, expected %u/%u or %u/%u\n",
+                                    i, command, permille, restored.walk, restored.run,
+                                    expected.walk, expected.run, next.walk, next.run);
+                    }
+                }
+            }
+            sim::flashPowerOn();
+            if (lastCommand)
+            {
+                break;
+            }
+        }
+
+        // The uninterrupted update, checked by a clean boot
+        std::memcpy(region, image.data(), regionSize);
+        live = saved;
+        update(live, next, i);
+        expected = next;
+        CounterLog::Counters restored;
+        boot(base, sectors, maxReads, restored);
+        if (!(restored == expected))
+        {
+            ++failures;
+            std::printf("FAIL update %u: clean boot lost the record\n", i);
+        }
+    }
+
+    const CounterLog::Stats& st = live.stats();
+    std::printf("%u updates on %u sectors (%u records per sector): %u records, %u erases, sequence %u\n",
+                updates, sectors, CounterLog::RECORDS_PER_SECTOR, st.records, st.erases, st.sequence);
+    std::printf("power loss: %u cuts, %u restored the previous counters, %u failures\n", trials, kept, failures);
+    std::printf("restore: worst case %u flash reads (full scan %u)\n", maxReads, regionSize / 4u);
+    std::printf("wear: one erase per sector every %u records\n", sectors * CounterLog::RECORDS_PER_SECTOR);
+    return failures ? 1 : 0;
+}
@@ -0,0 +1,128 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file FormatBench.cpp
+ * @brief Compares the fixed-point formatters with the sprintf/double code they replace.
+ *
+ * Part 1 checks that fixedpoint::formatCounts() gives the same text as
+ * sprintf("%1.4f", (double)counts / 4096) for every 14-bit count, and that
+ * formatUnsigned() matches "%lu". Part 2 times one sample line
+ * ("x  y  z") and one LCD counter line with both implementations.
+ *
+ * Host times only rank the two; on the Cortex-M0+ the gap is wider because
+ * doubles and divisions are software routines there.
+ *
+ * Usage: format_bench [iterations]
+ */
+
+#include "FixedPoint.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+namespace
+{
+    volatile uint32_t g_sink = 0;   // keeps the formatted text alive
+
+    void sampleLinePrintf(char* buffer, int16_t x, int16_t y, int16_t z)
+    {
+        // Same expression as the former processSample()
+        double x_ = ((double)x / 4096);
+        double y_ = ((double)y / 4096);
+        double z_ = ((double)z / 4096);
+        std::sprintf(buffer, "%1.4f  %1.4f  %1.4f", x_, y_, z_);
+    }
+
+    void sampleLineFixed(char* buffer, int16_t x, int16_t y, int16_t z)
+    {
+        char* p = fixedpoint::formatCounts(buffer, x);
+        p = fixedpoint::append(p, "  ");
+        p = fixedpoint::formatCounts(p, y);
+        p = fixedpoint::append(p, "  ");
+        fixedpoint::formatCounts(p, z);
+    }
+
+    void counterLinePrintf(char* buffer, uint32_t walk, uint32_t run)
+    {
+        std::sprintf(buffer, "Walk: %lu Run: %lu", static_cast<unsigned long>(walk), static_cast<unsigned long>(run));
+    }
+
+    void counterLineFixed(char* buffer, uint32_t walk, uint32_t run)
+    {
+        char* p = fixedpoint::append(buffer, "Walk: ");
+        p = fixedpoint::formatUnsigned(p, walk);
+        p = fixedpoint::append(p, " Run: ");
+        fixedpoint::formatUnsigned(p, run);
+    }
+
+    template <typename F>
+    double nsPerCall(unsigned iterations, F f)
+    {
+        auto start = std::chrono::steady_clock::now();
+        for (unsigned i = 0; i < iterations; ++i)
+        {
+            f(i);
+        }
+        std::chrono::duration<double, std::nano> dt = std::chrono::steady_clock::now() - start;
+        return dt.count() / iterations;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    const unsigned iterations = (argc > 1) ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 1000000u;
+
+    // 1. Equivalence
+    unsigned mismatches = 0;
+    char a[48], b[48];
+    for (int32_t c = -8192; c < 8192; ++c)
+    {
+        std::sprintf(a, "%1.4f", static_cast<double>(c) / 4096);
+        fixedpoint::formatCounts(b, static_cast<int16_t>(c));
+        if (std::strcmp(a, b) != 0)
+        {
+            if (mismatches < 5)
+            {
+                std::printf("mismatch for %d: printf \"%s\", fixed \"%s\"\n", c, a, b);
+            }
+            ++mismatches;
+        }
+    }
+    const uint32_t unsignedChecks[] = { 0u, 1u, 9u, 10u, 99u, 100u, 65535u, 999999999u, 1000000000u, 4294967295u };
+    for (uint32_t v : unsignedChecks)
+    {
+        std::sprintf(a, "%lu", static_cast<unsigned long>(v));
+        fixedpoint::formatUnsigned(b, v);
+        mismatches += std::strcmp(a, b) != 0;
+    }
+    std::printf("equivalence: 16384 counts, %zu integers, %u mismatches\n",
+                sizeof(unsignedChecks) / sizeof(unsignedChecks[0]), mismatches);
+
+    // 2. Timing
+    auto axis = [](unsigned i, unsigned k) { return static_cast<int16_t>(((i * 2654435761u) >> k) % 16384u) - 8192; };
+    double tPrintf = nsPerCall(iterations, [&](unsigned i) {
+        sampleLinePrintf(a, static_cast<int16_t>(axis(i, 3)), static_cast<int16_t>(axis(i, 7)), static_cast<int16_t>(axis(i, 11)));
+        g_sink = g_sink + static_cast<uint8_t>(a[0]);
+    });
+    double tFixed = nsPerCall(iterations, [&](unsigned i) {
+        sampleLineFixed(a, static_cast<int16_t>(axis(i, 3)), static_cast<int16_t>(axis(i, 7)), static_cast<int16_t>(axis(i, 11)));
+        g_sink = g_sink + static_cast<uint8_t>(a[0]);
+    });
+    std::printf("sample line:  sprintf %%1.4f %7.1f ns, fixedpoint %7.1f ns (x%.1f)\n", tPrintf, tFixed, tPrintf / tFixed);
+
+    tPrintf = nsPerCall(iterations, [&](unsigned i) {
+        counterLinePrintf(a, i, i / 3);
+        g_sink = g_sink + static_cast<uint8_t>(a[6]);
+    });
+    tFixed = nsPerCall(iterations, [&](unsigned i) {
+        counterLineFixed(a, i, i / 3);
+        g_sink = g_sink + static_cast<uint8_t>(a[6]);
+    });
+    std::printf("counter line: sprintf %%lu   %7.1f ns, fixedpoint %7.1f ns (x%.1f)\n", tPrintf, tFixed, tPrintf / tFixed);
+    return mismatches != 0;
+}
@@ -0,0 +1,84 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file LatencyHistogram.hpp
+ * @brief Fixed-memory latency statistics with percentiles for the host benches.
+ */
+
+#ifndef LATENCY_HISTOGRAM_HPP
+#define LATENCY_HISTOGRAM_HPP
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @brief Fixed-size latency histogram (10000 bins, 10 ns wide by default) for percentiles.
+ *
+ * Values beyond the last bin are counted there; min, max and mean stay exact.
+ */
+class LatencyHistogram
+{
+public:
+    explicit LatencyHistogram(uint64_t binNs = 10) : binNs(binNs) {}
+
+    void add(uint64_t ns)
+    {
+        size_t bin = std::min<uint64_t>(ns / binNs, BINS - 1);
+        ++bins[bin];
+        ++count;
+        total += ns;
+        minNs = std::min(minNs, ns);
+        maxNs = std::max(maxNs, ns);
+    }
+
+    uint64_t percentile(double p) const
+    {
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * static_cast<double>(count - 1));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BINS; ++i)
+        {
+            seen += bins[i];
+            if (seen > rank)
+            {
+                return std::min((i + 1) * binNs, maxNs);   // upper edge of the bin
+            }
+        }
+        return maxNs;
+    }
+
+    /**
+     * @brief Adds the samples of another histogram with the same bin width.
+     */
+    void merge(const LatencyHistogram& other)
+    {
+        for (size_t i = 0; i < BINS; ++i)
+        {
+            bins[i] += other.bins[i];
+        }
+        count += other.count;
+        total += other.total;
+        minNs = std::min(minNs, other.minNs);
+        maxNs = std::max(maxNs, other.maxNs);
+    }
+
+    double mean() const
+    {
+        return count ? static_cast<double>(total) / static_cast<double>(count) : 0.0;
+    }
+
+    uint64_t count = 0;
+    uint64_t total = 0;
+    uint64_t minNs = UINT64_MAX;
+    uint64_t maxNs = 0;
+
+private:
+    static constexpr size_t BINS = 10000;
+    uint64_t binNs;
+    uint32_t bins[BINS] = {};
+};
+
+#endif // LATENCY_HISTOGRAM_HPP
@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file LcdBench.cpp
+ * @brief Character throughput of the LCD driver on the simulated board.
+ *
+ * Runs the unchanged Lcd.cpp/BoardSupport.cpp against the simulated I2C0 bus
+ * (byte-timed from the I2C0->F divider, DELAY() loops charged at their
+ * Cortex-M0+ cost) and reports, in simulated time:
+ *  - lcd::print() characters per second for full 16-character rows,
+ *  - the duration of a framebuffer flush() of a typical counter update,
+ *  - PCF8574 bus bytes per character.
+ *
+ * Usage: PEDOSIM_FAST=1 PEDOSIM_UART=stdio lcd_bench [rows]
+ */
+
+#include "Lcd.hpp"
+#include "Simulator.hpp"
+
+#include <cstdio>
+#include <cstdlib>
+
+int main(int argc, char** argv)
+{
+    const unsigned rows = (argc > 1) ? static_cast<unsigned>(std::strtoul(argv[1], nullptr, 10)) : 200u;
+
+    lcd::init();
+
+    // 1. Direct print of full rows, alternating between the two lines
+    uint32_t bytesBefore = sim::busStats().lcdBytes;
+    uint64_t start = sim::nowNs();
+    for (unsigned i = 0; i < rows; ++i)
+    {
+        lcd::setCursor(0, static_cast<uint8_t>(i & 1u));
+        lcd::print((i & 2u) ? "0123456789ABCDEF" : "FEDCBA9876543210");
+    }
+    double seconds = (sim::nowNs() - start) * 1e-9;
+    unsigned chars = rows * lcd::COLS;
+    uint32_t bytes = sim::busStats().lcdBytes - bytesBefore;
+    std::printf("print:  %u chars in %.3f ms = %.0f chars/s, %.1f bus bytes/char\n",
+                chars, seconds * 1e3, chars / seconds, static_cast<double>(bytes) / chars);
+
+    // 2. Framebuffer update as done by the main loop after a detected step
+    lcd::writeLine(0, "S9 = RESET");
+    lcd::writeLine(1, "Walk: 0 Run: 0");
+    lcd::flush();
+    // Room for the longest counter line; writeLine() keeps the first 16 characters
+    char line[sizeof("Walk: 4294967295 Run: 4294967295")];
+    bytesBefore = sim::busStats().lcdBytes;
+    start = sim::nowNs();
+    for (unsigned i = 1; i <= rows; ++i)
+    {
+        std::snprintf(line, sizeof(line), "Walk: %u Run: %u", i, i / 3);
+        lcd::writeLine(1, line);
+        lcd::flush();
+    }
+    seconds = (sim::nowNs() - start) * 1e-9;
+    bytes = sim::busStats().lcdBytes - bytesBefore;
+    std::printf("flush:  %u counter updates, %.1f us and %.1f bus bytes each\n",
+                rows, seconds * 1e6 / rows, static_cast<double>(bytes) / rows);
+    const lcd::FlushStats& stats = lcd::flushStats();
+    std::printf("stats:  %lu flushes, %lu cells, %lu cursor moves, %lu bytes sent, %lu saved\n",
+                static_cast<unsigned long>(stats.flushes), static_cast<unsigned long>(stats.cellsWritten),
+                static_cast<unsigned long>(stats.cursorMoves), static_cast<unsigned long>(stats.bytesSent),
+                static_cast<unsigned long>(stats.bytesSaved));
+    return 0;
+}
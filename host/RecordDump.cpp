@@ -0,0 +1,193 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file RecordDump.cpp
+ * @brief Downloads the on-board sample recording (DUMP command) as "x  y  z" text lines.
+ *
+ * Sends "DUMP <rate>" to the board (or the simulator pty), waits for the
+ * "DUMP blocks <n> baud <rate>" reply, switches the port to that rate and
+ * decodes the record frames until all blocks arrived or the line stays quiet
+ * for a second, then switches back. The samples are printed in the firmware
+ * text format (in g) like telemetry_dump, so the recording can be fed to
+ * step_replay, the simulator (PEDOSIM_ACCEL) or the MATLAB script. A gap in
+ * the sample indices (blocks dropped by the ring, deep idle) is printed as a
+ * "GAP <samples>" line, which those skip.
+ *
+ * The blocks, samples, wire bytes against the raw 6 bytes per sample and the
+ * transfer time go to stderr.
+ *
+ * Usage: record_dump [--baud <rate>] [--dump-baud <rate>] <device>
+ */
+
+#include "SerialPort.hpp"
+#include "TelemetryDecoder.hpp"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <unistd.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    void usage()
+    {
+        std::fprintf(stderr, "usage: record_dump [--baud <rate>] [--dump-baud <rate>] <device>\n");
+    }
+
+    /**
+     * @brief Reads what is available within @p timeoutMs; returns the byte count, 0 on timeout, -1 on error.
+     */
+    ssize_t readSome(int fd, uint8_t* buffer, size_t size, int timeoutMs)
+    {
+        pollfd p = { fd, POLLIN, 0 };
+        int ready = ::poll(&p, 1, timeoutMs);
+        if (ready <= 0)
+        {
+            return ready;
+        }
+        return ::read(fd, buffer, size);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long        baud     = 9600;
+    long        dumpBaud = 0;      // the firmware's fastest rate
+    const char* path     = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+        {
+            baud = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--dump-baud") == 0 && i + 1 < argc)
+        {
+            dumpBaud = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (argv[i][0] != '-')
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (!path)
+    {
+        usage();
+        return 2;
+    }
+
+    int fd = serial::open(path, baud);
+    if (fd < 0)
+    {
+        return 1;
+    }
+    char command[32];
+    int length = std::snprintf(command, sizeof(command), "DUMP %ld\n", dumpBaud);
+    if (::write(fd, command, static_cast<size_t>(length)) != length)
+    {
+        std::perror("record_dump: write");
+        return 1;
+    }
+
+    // Skip the live stream up to the announcement
+    std::string line;
+    unsigned blocks = 0;
+    unsigned long rate = 0;
+    uint8_t chunk[512];
+    bool announced = false;
+    while (!announced)
+    {
+        ssize_t n = readSome(fd, chunk, 1, 3000);
+        if (n <= 0)
+        {
+            std::fprintf(stderr, "record_dump: no DUMP reply\n");
+            return 1;
+        }
+        if (chunk[0] == '\n' || chunk[0] == '\r')
+        {
+            const char* reply = std::strstr(line.c_str(), "DUMP blocks");
+            announced = reply && std::sscanf(reply, "DUMP blocks %u baud %lu", &blocks, &rate) == 2;
+            if (line.find("ERR") != std::string::npos)
+            {
+                std::fprintf(stderr, "record_dump: %s\n", line.c_str());
+                return 1;
+            }
+            line.clear();
+        }
+        else
+        {
+            line += static_cast<char>(chunk[0]);
+        }
+    }
+    if (::isatty(fd) && !serial::configure(fd, static_cast<long>(rate)))
+    {
+        return 1;
+    }
+
+    TelemetryDecoder decoder;
+    uint64_t wireBytes = 0;
+    uint64_t gaps = 0;
+    uint32_t nextSample = 0;
+    bool     first = true;
+    Clock::time_point start = Clock::now();
+    Clock::time_point last  = start;
+    while (decoder.stats().recordFrames < blocks)
+    {
+        ssize_t n = readSome(fd, chunk, sizeof(chunk), 1000);
+        if (n <= 0)
+        {
+            break;
+        }
+        wireBytes += static_cast<uint64_t>(n);
+        last = Clock::now();
+        decoder.feed(chunk, static_cast<size_t>(n), [&](const TelemetryDecoder::Frame& frame)
+        {
+            if (frame.type != telemetry::FRAME_RECORD)
+            {
+                return;
+            }
+            if (!first && frame.timestamp != nextSample)
+            {
+                std::printf("GAP %u\n", frame.timestamp - nextSample);
+                ++gaps;
+            }
+            first = false;
+            nextSample = frame.timestamp + frame.count;
+            for (uint8_t i = 0; i < frame.count; ++i)
+            {
+                const TelemetryDecoder::Sample& s = frame.samples[i];
+                std::printf("%1.4f  %1.4f  %1.4f\n", s.x / 4096.0, s.y / 4096.0, s.z / 4096.0);
+            }
+        });
+    }
+    if (::isatty(fd))
+    {
+        serial::configure(fd, baud);
+    }
+
+    const TelemetryDecoder::Stats& st = decoder.stats();
+    double seconds = std::chrono::duration<double>(last - start).count();
+    std::fprintf(stderr, "blocks %llu/%u samples %llu gaps %llu crc errors %llu\n",
+                 static_cast<unsigned long long>(st.recordFrames), blocks,
+                 static_cast<unsigned long long>(st.samples), static_cast<unsigned long long>(gaps),
+                 static_cast<unsigned long long>(st.crcErrors));
+    std::fprintf(stderr, "wire %llu bytes, raw %llu bytes (ratio %.2f), %.2f s at %lu baud\n",
+                 static_cast<unsigned long long>(wireBytes), static_cast<unsigned long long>(st.samples * 6u),
+                 wireBytes ? static_cast<double>(st.samples * 6u) / static_cast<double>(wireBytes) : 0.0,
+                 seconds, rate);
+    ::close(fd);
+    return st.recordFrames == blocks ? 0 : 1;
+}
@@ -0,0 +1,142 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SampleParser.hpp
+ * @brief Incremental parser of the firmware text sample stream ("x  y  z" in g).
+ *
+ * Bytes are consumed one at a time without a line buffer, so a parser costs a
+ * few dozen bytes per stream regardless of how the input is chunked.
+ */
+
+#ifndef SAMPLE_PARSER_HPP
+#define SAMPLE_PARSER_HPP
+
+#include <algorithm>
+#include <cstdint>
+
+/**
+ * @brief Byte-wise parser of "x  y  z" lines in g into 14-bit counts (4096 counts/g).
+ *
+ * Lines without exactly three numbers (OK, OVERRUN, report lines) are
+ * skipped, like the numel(data) < 3 check of the MATLAB script.
+ */
+class SampleParser
+{
+public:
+    /**
+     * @brief Consumes one byte; returns true when it completes a sample.
+     */
+    bool feed(char c, int16_t out[3])
+    {
+        if (c == '\n' || c == '\r')
+        {
+            finishNumber();
+            bool complete = valid && values == 3;
+            if (complete)
+            {
+                std::copy(counts, counts + 3, out);
+            }
+            restartLine();
+            return complete;
+        }
+        if (!valid)
+        {
+            return false;
+        }
+
+        if (c == ' ' || c == '\t' || c == ',')
+        {
+            finishNumber();
+        }
+        else if (c == '-' && !inNumber)
+        {
+            inNumber = true;
+            negative = true;
+        }
+        else if (c >= '0' && c <= '9')
+        {
+            inNumber  = true;
+            hasDigits = true;
+            if (!afterPoint)
+            {
+                mantissa = mantissa * 10 + (c - '0');
+                valid = mantissa < 100;   // far outside the +-8 g range
+            }
+            else if (decimals < MAX_DECIMALS)
+            {
+                mantissa = mantissa * 10 + (c - '0');
+                ++decimals;               // further digits are below one count
+            }
+        }
+        else if (c == '.' && !afterPoint)
+        {
+            inNumber = true;
+            afterPoint = true;
+        }
+        else
+        {
+            valid = false;
+        }
+        return false;
+    }
+
+private:
+    static constexpr int MAX_DECIMALS = 9;
+
+    void finishNumber()
+    {
+        if (!inNumber)
+        {
+            return;
+        }
+        if (!hasDigits || values == 3)
+        {
+            valid = false;
+        }
+        else
+        {
+            // counts = round(value * 4096), rounded half away from zero like lround()
+            int64_t scale = 1;
+            for (int i = 0; i < decimals; ++i)
+            {
+                scale *= 10;
+            }
+            int64_t scaled = (mantissa * 4096 * 2 + scale) / (scale * 2);
+            scaled = std::min<int64_t>(scaled, INT16_MAX);
+            counts[values++] = static_cast<int16_t>(negative ? -scaled : scaled);
+        }
+        inNumber   = false;
+        negative   = false;
+        afterPoint = false;
+        hasDigits  = false;
+        mantissa   = 0;
+        decimals   = 0;
+    }
+
+    void restartLine()
+    {
+        inNumber   = false;
+        negative   = false;
+        afterPoint = false;
+        hasDigits  = false;
+        mantissa   = 0;
+        decimals   = 0;
+        values     = 0;
+        valid      = true;
+    }
+
+    int16_t counts[3]  = {};
+    int64_t mantissa   = 0;
+    int     decimals   = 0;
+    int     values     = 0;
+    bool    inNumber   = false;
+    bool    negative   = false;
+    bool    afterPoint = false;
+    bool    hasDigits  = false;
+    bool    valid      = true;
+};
+
+#endif // SAMPLE_PARSER_HPP
@@ -0,0 +1,153 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SerialPort.cpp
+ * @brief Implementation of the host serial port helpers.
+ */
+
+#include "SerialPort.hpp"
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <poll.h>
+#include <string>
+#include <fcntl.h>
+#include <termios.h>
+#include <unistd.h>
+
+namespace serial
+{
+    static speed_t toSpeed(long baud)
+    {
+        switch (baud)
+        {
+        case 9600:   return B9600;
+        case 19200:  return B19200;
+        case 38400:  return B38400;
+        case 57600:  return B57600;
+        case 115200: return B115200;
+        case 230400: return B230400;
+        case 460800: return B460800;
+        default:     return B0;
+        }
+    }
+
+    int open(const char* path, long baud, bool nonBlocking)
+    {
+        int flags = O_NOCTTY | (nonBlocking ? O_NONBLOCK : 0);
+        int fd = ::open(path, O_RDWR | flags);
+        if (fd < 0 && errno == EACCES)
+        {
+            fd = ::open(path, O_RDONLY | flags);
+        }
+        if (fd < 0)
+        {
+            std::perror(path);
+            return -1;
+        }
+        if (::isatty(fd) && !configure(fd, baud))
+        {
+            ::close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    /**
+     * @brief Reads lines until one contains "BAUD " (true) or "ERR" (false), or @p timeoutMs passes.
+     */
+    static bool waitForBaudReply(int fd, int timeoutMs)
+    {
+        std::string line;
+        pollfd p = { fd, POLLIN, 0 };
+        char c;
+        while (::poll(&p, 1, timeoutMs) > 0 && ::read(fd, &c, 1) == 1)
+        {
+            if (c != '\n' && c != '\r')
+            {
+                line += c;
+                continue;
+            }
+            if (line.find("ERR") != std::string::npos || line.find("reverted") != std::string::npos)
+            {
+                return false;
+            }
+            if (line.find("BAUD ") != std::string::npos)
+            {
+                return true;
+            }
+            line.clear();
+        }
+        return false;
+    }
+
+    bool switchBaud(int fd, long baud, int timeoutMs)
+    {
+        char command[24];
+        int length = std::snprintf(command, sizeof(command), "BAUD %ld\n", baud);
+        if (::write(fd, command, static_cast<size_t>(length)) != length || !waitForBaudReply(fd, timeoutMs))
+        {
+            std::fprintf(stderr, "serial: the board did not accept %ld baud\n", baud);
+            return false;
+        }
+        if (!configure(fd, baud))
+        {
+            return false;
+        }
+        if (::write(fd, command, static_cast<size_t>(length)) != length || !waitForBaudReply(fd, timeoutMs))
+        {
+            std::fprintf(stderr, "serial: no reply at %ld baud\n", baud);
+            return false;
+        }
+        return true;
+    }
+
+    bool selectHostSteps(int fd)
+    {
+        static const char command[] = "HOST 1\n";
+        if (!::isatty(fd))
+        {
+            return true;
+        }
+        if (::write(fd, command, sizeof(command) - 1) != static_cast<ssize_t>(sizeof(command) - 1))
+        {
+            std::perror("serial: HOST");
+            return false;
+        }
+        return true;
+    }
+
+    bool configure(int fd, long baud)
+    {
+        speed_t speed = toSpeed(baud);
+        if (speed == B0)
+        {
+            std::fprintf(stderr, "serial: unsupported baud rate %ld\n", baud);
+            return false;
+        }
+        termios tio;
+        if (::tcgetattr(fd, &tio) != 0)
+        {
+            std::perror("serial: tcgetattr");
+            return false;
+        }
+        ::cfmakeraw(&tio);
+        tio.c_cflag |= CLOCAL | CREAD;
+        tio.c_cflag &= ~(CSTOPB | PARENB);
+        tio.c_cc[VMIN]  = 1;
+        tio.c_cc[VTIME] = 0;
+        ::cfsetispeed(&tio, speed);
+        ::cfsetospeed(&tio, speed);
+        if (::tcsetattr(fd, TCSANOW, &tio) != 0)
+        {
+            std::perror("serial: tcsetattr");
+            return false;
+        }
+        ::tcflush(fd, TCIFLUSH);   // drop whatever was buffered before we started
+        return true;
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SerialPort.hpp
+ * @brief Opening the board's UART (USB CDC device or simulator pty) from the host tools.
+ */
+
+#ifndef SERIAL_PORT_HPP
+#define SERIAL_PORT_HPP
+
+/**
+ * @namespace serial
+ * @brief Raw 8N1 serial ports on Linux.
+ */
+namespace serial
+{
+    /**
+     * @brief Opens @p path read/write (read-only if that is all that is allowed).
+     *
+     * Terminals are switched to raw 8N1 at @p baud with pending input dropped;
+     * other files (recordings, pipes) are returned unchanged.
+     * @param nonBlocking Open with O_NONBLOCK, for epoll loops.
+     * @return File descriptor, or -1 with the reason printed to stderr.
+     */
+    int open(const char* path, long baud, bool nonBlocking = false);
+
+    /**
+     * @brief Puts a terminal into raw 8N1 mode at @p baud; returns false on error.
+     */
+    bool configure(int fd, long baud);
+
+    /**
+     * @brief Moves the board and the terminal to @p baud with the BAUD handshake.
+     *
+     * Sends "BAUD <rate>" at the current rate, waits for the "BAUD ..." reply,
+     * switches the terminal and confirms with the same command at the new rate.
+     * Without the confirmation the board returns to its previous rate by itself.
+     * @param timeoutMs Time allowed for each reply.
+     * @return false if the board refused the rate or did not answer.
+     */
+    bool switchBaud(int fd, long baud, int timeoutMs = 2000);
+
+    /**
+     * @brief Sends "HOST 1" to a terminal, so the board counts the host's WALK++/RUN++
+     *        instead of its own detections and no step is counted twice.
+     *
+     * The "OK" reply is left in the stream, where the sample parsers skip it.
+     * Recordings and pipes are left alone.
+     * @return false if the command could not be written.
+     */
+    bool selectHostSteps(int fd);
+}
+
+#endif // SERIAL_PORT_HPP
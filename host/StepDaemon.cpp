@@ -0,0 +1,241 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepDaemon.cpp
+ * @brief Implementation of the multi-device step detection daemon.
+ */
+
+#include "StepDaemon.hpp"
+#include "SerialPort.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+namespace
+{
+    constexpr size_t READ_CHUNK     = 4096;
+    constexpr int    READS_PER_WAKE = 4;     // then let the other devices of the worker run
+    constexpr int    MAX_EVENTS     = 64;
+
+    // Counters have a single writer, so a relaxed load/store pair is enough (no locked add)
+    void bump(std::atomic<uint64_t>& counter)
+    {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+}
+
+StepDaemon::StepDaemon(const Options& options) : options(options)
+{
+}
+
+StepDaemon::~StepDaemon()
+{
+    stop();
+}
+
+void StepDaemon::add(const std::string& path)
+{
+    paths.push_back(path);
+}
+
+bool StepDaemon::start()
+{
+    if (running || paths.empty())
+    {
+        return false;
+    }
+
+    devices.reset(new Device[paths.size()]);
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        devices[i].fd = serial::open(paths[i].c_str(), options.baud, true);
+        if (devices[i].fd < 0)
+        {
+            for (size_t j = 0; j < i; ++j)
+            {
+                ::close(devices[j].fd);
+            }
+            devices.reset();
+            return false;
+        }
+        devices[i].open.store(true, std::memory_order_relaxed);
+
+        // The board counts the replies below instead of its own detections
+        if (!serial::selectHostSteps(devices[i].fd))
+        {
+            devices[i].droppedReplies.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    workerCount = std::max(1u, std::min<unsigned>(options.workers, static_cast<unsigned>(paths.size())));
+    workers.reset(new Worker[workerCount]);
+    for (unsigned w = 0; w < workerCount; ++w)
+    {
+        Worker& worker = workers[w];
+        worker.epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        worker.wakeFd  = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+        epoll_event ev = {};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = nullptr;   // the stop event
+        ::epoll_ctl(worker.epollFd, EPOLL_CTL_ADD, worker.wakeFd, &ev);
+    }
+
+    // Round-robin sharding: device i belongs to worker i % workerCount
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        epoll_event ev = {};
+        ev.events   = EPOLLIN;
+        ev.data.ptr = &devices[i];
+        if (::epoll_ctl(workers[i % workerCount].epollFd, EPOLL_CTL_ADD, devices[i].fd, &ev) != 0)
+        {
+            std::fprintf(stderr, "step_daemon: %s: %s\n", paths[i].c_str(), std::strerror(errno));
+            devices[i].open.store(false, std::memory_order_relaxed);   // e.g. a regular file
+        }
+    }
+
+    for (unsigned w = 0; w < workerCount; ++w)
+    {
+        Worker& worker = workers[w];
+        worker.thread = std::thread([this, &worker] { runWorker(worker); });
+    }
+    running = true;
+    return true;
+}
+
+void StepDaemon::stop()
+{
+    if (!running)
+    {
+        return;
+    }
+    for (unsigned w = 0; w < workerCount; ++w)
+    {
+        uint64_t one = 1;
+        if (::write(workers[w].wakeFd, &one, sizeof(one)) != sizeof(one))
+        {
+            std::perror("step_daemon: eventfd");
+        }
+    }
+    for (unsigned w = 0; w < workerCount; ++w)
+    {
+        workers[w].thread.join();
+        ::close(workers[w].wakeFd);
+        ::close(workers[w].epollFd);
+    }
+    for (size_t i = 0; i < paths.size(); ++i)
+    {
+        if (devices[i].fd >= 0)
+        {
+            ::close(devices[i].fd);
+            devices[i].fd = -1;
+        }
+    }
+    running = false;
+}
+
+StepDaemon::DeviceStats StepDaemon::stats(size_t device) const
+{
+    DeviceStats s = {};
+    if (!devices)
+    {
+        return s;
+    }
+    const Device& d = devices[device];
+    s.samples        = d.samples.load(std::memory_order_relaxed);
+    s.walk           = d.walk.load(std::memory_order_relaxed);
+    s.run            = d.run.load(std::memory_order_relaxed);
+    s.droppedReplies = d.droppedReplies.load(std::memory_order_relaxed);
+    s.open           = d.open.load(std::memory_order_relaxed);
+    return s;
+}
+
+void StepDaemon::runWorker(Worker& worker)
+{
+    epoll_event events[MAX_EVENTS];
+    for (;;)
+    {
+        int n = ::epoll_wait(worker.epollFd, events, MAX_EVENTS, -1);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            std::perror("step_daemon: epoll_wait");
+            return;
+        }
+        for (int i = 0; i < n; ++i)
+        {
+            if (events[i].data.ptr == nullptr)
+            {
+                return;   // stop()
+            }
+            onReadable(*static_cast<Device*>(events[i].data.ptr), worker.epollFd);
+        }
+    }
+}
+
+void StepDaemon::onReadable(Device& device, int epollFd)
+{
+    char chunk[READ_CHUNK];
+    for (int r = 0; r < READS_PER_WAKE; ++r)
+    {
+        ssize_t n = ::read(device.fd, chunk, sizeof(chunk));
+        if (n < 0 && (errno == EAGAIN || errno == EINTR))
+        {
+            return;
+        }
+        if (n <= 0)
+        {
+            closeDevice(device, epollFd);   // EOF, or EIO once a pty master is closed
+            return;
+        }
+
+        int16_t s[3];
+        for (ssize_t i = 0; i < n; ++i)
+        {
+            if (!device.parser.feed(chunk[i], s))
+            {
+                continue;
+            }
+            bump(device.samples);
+
+            StepDetector::Step step = device.detector.process(s[0], s[1], s[2]);
+            if (step == StepDetector::Step::None)
+            {
+                continue;
+            }
+            const bool isRun = step == StepDetector::Step::Run;
+            bump(isRun ? device.run : device.walk);
+
+            static const char walkReply[] = "WALK++\n";
+            static const char runReply[]  = "RUN++\n";
+            const char* reply  = isRun ? runReply : walkReply;
+            size_t      length = isRun ? sizeof(runReply) - 1 : sizeof(walkReply) - 1;
+            if (::write(device.fd, reply, length) != static_cast<ssize_t>(length))
+            {
+                bump(device.droppedReplies);
+            }
+        }
+
+        if (static_cast<size_t>(n) < sizeof(chunk))
+        {
+            return;   // drained
+        }
+    }
+}
+
+void StepDaemon::closeDevice(Device& device, int epollFd)
+{
+    ::epoll_ctl(epollFd, EPOLL_CTL_DEL, device.fd, nullptr);
+    device.open.store(false, std::memory_order_relaxed);
+}
@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepDaemon.hpp
+ * @brief Step detection for many boards on one gateway.
+ *
+ * Every device (serial port or pty) is owned by one worker thread, chosen
+ * round-robin, and each worker waits on its own epoll set. A device's parser,
+ * StepDetector (the HPF/BPF delay lines and peak windows of the MATLAB
+ * script) and counters sit in one cache-line aligned Device record that only
+ * its worker writes, so workers share no locks and no cache lines. Steps are
+ * answered with "WALK++"/"RUN++" on the device they came from, after "HOST 1"
+ * at start() has made each board count those instead of its own detections.
+ *
+ * Usage:
+ * @code
+ *   StepDaemon daemon({4, 9600});
+ *   daemon.add("/dev/ttyACM0");
+ *   daemon.add("/dev/ttyACM1");
+ *   daemon.start();
+ *   ...
+ *   daemon.stop();
+ * @endcode
+ */
+
+#ifndef STEP_DAEMON_HPP
+#define STEP_DAEMON_HPP
+
+#include "SampleParser.hpp"
+#include "../inc/StepDetector.hpp"
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+/**
+ * @class StepDaemon
+ * @brief epoll-based multiplexer of device streams over a pool of worker threads.
+ */
+class StepDaemon
+{
+public:
+    /**
+     * @struct Options
+     * @brief Worker count and serial settings.
+     */
+    struct Options
+    {
+        unsigned workers = 1;       /**< Worker threads (at most one per device is useful). */
+        long     baud    = 9600;    /**< Baud rate applied to real serial ports. */
+    };
+
+    /**
+     * @struct DeviceStats
+     * @brief Snapshot of one device's counters.
+     */
+    struct DeviceStats
+    {
+        uint64_t samples;           /**< Samples run through the detector. */
+        uint64_t walk;              /**< WALK++ decisions. */
+        uint64_t run;               /**< RUN++ decisions. */
+        uint64_t droppedReplies;    /**< Replies not written (device output full or gone). */
+        bool     open;              /**< False once the device hung up. */
+    };
+
+    explicit StepDaemon(const Options& options);
+    ~StepDaemon();
+
+    StepDaemon(const StepDaemon&) = delete;
+    StepDaemon& operator=(const StepDaemon&) = delete;
+
+    /**
+     * @brief Registers a device path; call before start().
+     */
+    void add(const std::string& path);
+
+    /**
+     * @brief Opens all devices and starts the workers; returns false if any device failed to open.
+     */
+    bool start();
+
+    /**
+     * @brief Wakes and joins the workers and closes the devices.
+     */
+    void stop();
+
+    size_t deviceCount() const { return paths.size(); }
+
+    const std::string& path(size_t device) const { return paths[device]; }
+
+    /**
+     * @brief Counters of one device; may be called while the workers run.
+     */
+    DeviceStats stats(size_t device) const;
+
+private:
+    /**
+     * @struct Device
+     * @brief Per-device state, written only by the owning worker.
+     */
+    struct alignas(64) Device
+    {
+        int                   fd = -1;
+        SampleParser          parser;
+        StepDetector          detector;
+        std::atomic<uint64_t> samples{0};
+        std::atomic<uint64_t> walk{0};
+        std::atomic<uint64_t> run{0};
+        std::atomic<uint64_t> droppedReplies{0};
+        std::atomic<bool>     open{false};
+    };
+    static_assert(sizeof(Device) % 64 == 0, "devices must not share cache lines");
+
+    /**
+     * @struct Worker
+     * @brief One thread with its epoll set and its stop event.
+     */
+    struct alignas(64) Worker
+    {
+        int         epollFd = -1;
+        int         wakeFd  = -1;
+        std::thread thread;
+    };
+
+    void runWorker(Worker& worker);
+    void onReadable(Device& device, int epollFd);
+    void closeDevice(Device& device, int epollFd);
+
+    Options                    options;
+    std::vector<std::string>   paths;
+    std::unique_ptr<Device[]>  devices;
+    std::unique_ptr<Worker[]>  workers;
+    unsigned                   workerCount = 0;
+    bool                       running     = false;
+};
+
+#endif // STEP_DAEMON_HPP
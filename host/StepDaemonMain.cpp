@@ -0,0 +1,130 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepDaemonMain.cpp
+ * @brief Gateway daemon: live step detection for every board attached to the host.
+ *
+ * Prints a summary line every --stats seconds and the per-device totals on
+ * Ctrl+C (SIGINT/SIGTERM).
+ *
+ * Usage: step_daemon [--workers <n>] [--baud <rate>] [--stats <s>] <device>...
+ */
+
+#include "StepDaemon.hpp"
+
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace
+{
+    volatile std::sig_atomic_t g_stop = 0;
+
+    void onSignal(int)
+    {
+        g_stop = 1;
+    }
+
+    void usage()
+    {
+        std::fprintf(stderr, "usage: step_daemon [--workers <n>] [--baud <rate>] [--stats <s>] <device>...\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    StepDaemon::Options options;
+    options.workers = std::thread::hardware_concurrency();
+    long statsSeconds = 10;
+    std::vector<const char*> paths;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--workers") == 0 && i + 1 < argc)
+        {
+            options.workers = static_cast<unsigned>(std::strtoul(argv[++i], nullptr, 10));
+        }
+        else if (std::strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+        {
+            options.baud = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--stats") == 0 && i + 1 < argc)
+        {
+            statsSeconds = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (argv[i][0] != '-')
+        {
+            paths.push_back(argv[i]);
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (paths.empty())
+    {
+        usage();
+        return 2;
+    }
+
+    StepDaemon daemon(options);
+    for (const char* path : paths)
+    {
+        daemon.add(path);
+    }
+    if (!daemon.start())
+    {
+        return 1;
+    }
+
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+
+    using Clock = std::chrono::steady_clock;
+    Clock::time_point nextReport = Clock::now() + std::chrono::seconds(statsSeconds);
+    uint64_t lastSamples = 0;
+
+    while (!g_stop)
+    {
+        std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        if (statsSeconds <= 0 || Clock::now() < nextReport)
+        {
+            continue;
+        }
+        nextReport += std::chrono::seconds(statsSeconds);
+
+        uint64_t samples = 0, walk = 0, run = 0;
+        size_t open = 0;
+        for (size_t i = 0; i < daemon.deviceCount(); ++i)
+        {
+            StepDaemon::DeviceStats s = daemon.stats(i);
+            samples += s.samples;
+            walk    += s.walk;
+            run     += s.run;
+            open    += s.open ? 1 : 0;
+        }
+        std::printf("devices %zu/%zu samples/s %.0f walk %lu run %lu\n", open, daemon.deviceCount(),
+                    static_cast<double>(samples - lastSamples) / statsSeconds,
+                    static_cast<unsigned long>(walk), static_cast<unsigned long>(run));
+        std::fflush(stdout);
+        lastSamples = samples;
+    }
+
+    daemon.stop();
+    for (size_t i = 0; i < daemon.deviceCount(); ++i)
+    {
+        StepDaemon::DeviceStats s = daemon.stats(i);
+        std::printf("%s samples %lu walk %lu run %lu dropped %lu%s\n", daemon.path(i).c_str(),
+                    static_cast<unsigned long>(s.samples), static_cast<unsigned long>(s.walk),
+                    static_cast<unsigned long>(s.run), static_cast<unsigned long>(s.droppedReplies),
+                    s.open ? "" : " (closed)");
+    }
+    return 0;
+}
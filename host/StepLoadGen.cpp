@@ -0,0 +1,384 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepLoadGen.cpp
+ * @brief Load generator for StepDaemon: hundreds of simulated boards on ptys.
+ *
+ * Creates one pty per simulated board, hands the slave ends to a StepDaemon
+ * running in the same process, and streams a walk signal (or a recording) in
+ * the firmware text format into the master ends at --rate samples per second
+ * per board, each board at a different phase. Generator threads run their own
+ * StepDetector per board, so they know which sample must be answered with a
+ * step; the time from writing that sample to reading the daemon's reply is the
+ * end-to-end latency. Missing or unexpected replies are counted.
+ *
+ * Usage: step_loadgen [--devices <n>] [--workers <n>] [--generators <n>]
+ *                     [--rate <hz>] [--seconds <s>] [recording.txt]
+ */
+
+#include "LatencyHistogram.hpp"
+#include "SampleParser.hpp"
+#include "StepDaemon.hpp"
+#include "../inc/StepDetector.hpp"
+
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    struct Line
+    {
+        std::string text;       /**< Firmware text line, "\n\r" terminated. */
+        int16_t     x, y, z;    /**< The same sample in counts, for the reference detector. */
+    };
+
+    /**
+     * @brief Simulated board: pty master, stream position and the steps awaiting a reply.
+     */
+    struct alignas(64) Board
+    {
+        static constexpr size_t MAX_PENDING = 64;
+
+        int               masterFd = -1;
+        size_t            line     = 0;     // next line of the signal
+        size_t            written  = 0;     // bytes of that line already written
+        Clock::time_point due;
+        StepDetector      reference;
+        Clock::time_point pending[MAX_PENDING];
+        size_t            pendingHead  = 0;
+        size_t            pendingCount = 0;
+        char              previous     = 0;     // last byte read, a step reply ends in "++"
+    };
+
+    struct GeneratorResult
+    {
+        LatencyHistogram latency{2000};   // 2 us bins, up to 20 ms
+        uint64_t samples    = 0;
+        uint64_t expected   = 0;
+        uint64_t unexpected = 0;
+        uint64_t stalls     = 0;          // writes refused because the pty was full
+    };
+
+    std::vector<Line> makeWalkSignal(size_t count)
+    {
+        // Same synthetic signal as telemetry_bench: 1.8 Hz gait, 0.5 g vertical swing
+        std::vector<Line> out(count);
+        char text[48];
+        for (size_t n = 0; n < count; ++n)
+        {
+            double t = n / 50.0;
+            Line& l = out[n];
+            l.x = static_cast<int16_t>(4096 * 0.05 * std::sin(2 * M_PI * 1.8 * t));
+            l.y = static_cast<int16_t>(4096 * (0.1 + 0.15 * std::sin(2 * M_PI * 1.8 * t + 1)));
+            l.z = static_cast<int16_t>(4096 * (1.0 + 0.5 * std::sin(2 * M_PI * 1.8 * t)));
+            std::snprintf(text, sizeof(text), "%1.4f  %1.4f  %1.4f\n\r", l.x / 4096.0, l.y / 4096.0, l.z / 4096.0);
+            l.text = text;
+        }
+        return out;
+    }
+
+    std::vector<Line> loadRecording(const char* path)
+    {
+        std::vector<Line> out;
+        FILE* in = std::fopen(path, "r");
+        if (!in)
+        {
+            std::perror(path);
+            return out;
+        }
+        SampleParser parser;
+        char text[128];
+        while (std::fgets(text, sizeof(text), in))
+        {
+            int16_t s[3];
+            bool complete = false;
+            for (const char* p = text; *p; ++p)
+            {
+                complete |= parser.feed(*p, s);
+            }
+            if (complete)
+            {
+                // Re-encode so every line has the firmware terminator
+                char line[48];
+                std::snprintf(line, sizeof(line), "%1.4f  %1.4f  %1.4f\n\r", s[0] / 4096.0, s[1] / 4096.0, s[2] / 4096.0);
+                out.push_back(Line{line, s[0], s[1], s[2]});
+            }
+        }
+        std::fclose(in);
+        return out;
+    }
+
+    int openPty(std::string& slavePath)
+    {
+        int master = ::posix_openpt(O_RDWR | O_NOCTTY | O_NONBLOCK);
+        if (master < 0 || ::grantpt(master) != 0 || ::unlockpt(master) != 0)
+        {
+            std::perror("step_loadgen: pty");
+            return -1;
+        }
+        slavePath = ::ptsname(master);
+        return master;
+    }
+
+    /**
+     * @brief Writes the due samples of one board, until the pty is full.
+     */
+    void feedBoard(Board& b, const std::vector<Line>& signal, Clock::duration period, Clock::time_point now,
+                   GeneratorResult& result)
+    {
+        while (b.due <= now)
+        {
+            const Line& l = signal[b.line];
+            Clock::time_point attempt = Clock::now();   // before the write: the daemon may run first
+            ssize_t n = ::write(b.masterFd, l.text.data() + b.written, l.text.size() - b.written);
+            if (n < 0)
+            {
+                ++result.stalls;
+                return;
+            }
+            b.written += static_cast<size_t>(n);
+            if (b.written < l.text.size())
+            {
+                ++result.stalls;
+                return;   // finish the line on the next round
+            }
+
+            Clock::time_point sent = attempt;
+            b.written = 0;
+            b.line    = (b.line + 1) % signal.size();
+            b.due    += period;
+            ++result.samples;
+            if (b.reference.process(l.x, l.y, l.z) != StepDetector::Step::None)
+            {
+                ++result.expected;
+                if (b.pendingCount < Board::MAX_PENDING)
+                {
+                    b.pending[(b.pendingHead + b.pendingCount) % Board::MAX_PENDING] = sent;
+                    ++b.pendingCount;
+                }
+            }
+        }
+    }
+
+    void readReplies(Board& b, GeneratorResult& result)
+    {
+        char buffer[256];
+        ssize_t n;
+        while ((n = ::read(b.masterFd, buffer, sizeof(buffer))) > 0)
+        {
+            Clock::time_point now = Clock::now();
+            for (ssize_t i = 0; i < n; ++i)
+            {
+                const char previous = b.previous;
+                b.previous = buffer[i];
+                if (buffer[i] != '\n' || previous != '+')
+                {
+                    continue;   // the "HOST 1" of the daemon, not a step reply
+                }
+                if (b.pendingCount == 0)
+                {
+                    ++result.unexpected;
+                    continue;
+                }
+                Clock::time_point sent = b.pending[b.pendingHead];
+                b.pendingHead = (b.pendingHead + 1) % Board::MAX_PENDING;
+                --b.pendingCount;
+                result.latency.add(static_cast<uint64_t>(
+                    std::chrono::duration_cast<std::chrono::nanoseconds>(now - sent).count()));
+            }
+        }
+    }
+
+    void runGenerator(std::vector<Board*> boards, const std::vector<Line>& signal, Clock::duration period,
+                      Clock::time_point stopAt, Clock::time_point drainUntil, GeneratorResult& result)
+    {
+        int epollFd = ::epoll_create1(EPOLL_CLOEXEC);
+        for (Board* b : boards)
+        {
+            epoll_event ev = {};
+            ev.events   = EPOLLIN;
+            ev.data.ptr = b;
+            ::epoll_ctl(epollFd, EPOLL_CTL_ADD, b->masterFd, &ev);
+        }
+
+        epoll_event events[64];
+        for (;;)
+        {
+            Clock::time_point now = Clock::now();
+            if (now >= drainUntil)
+            {
+                break;
+            }
+
+            Clock::time_point next = drainUntil;
+            if (now < stopAt)
+            {
+                for (Board* b : boards)
+                {
+                    feedBoard(*b, signal, period, now, result);
+                    next = std::min(next, b->due);
+                }
+                next = std::min(next, stopAt);
+            }
+
+            auto waitMs = std::chrono::duration_cast<std::chrono::milliseconds>(next - Clock::now()).count();
+            int n = ::epoll_wait(epollFd, events, 64, static_cast<int>(std::max<long long>(0, waitMs)));
+            for (int i = 0; i < n; ++i)
+            {
+                readReplies(*static_cast<Board*>(events[i].data.ptr), result);
+            }
+        }
+        ::close(epollFd);
+    }
+
+    void usage()
+    {
+        std::fprintf(stderr, "usage: step_loadgen [--devices <n>] [--workers <n>] [--generators <n>] "
+                             "[--rate <hz>] [--seconds <s>] [recording.txt]\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    unsigned    devices    = 200;
+    unsigned    generators = 2;
+    double      rate       = 50.0;
+    double      seconds    = 10.0;
+    const char* recording  = nullptr;
+    StepDaemon::Options options;
+    options.workers = 4;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        auto next = [&]() { return i + 1 < argc ? argv[++i] : "0"; };
+        if      (std::strcmp(argv[i], "--devices") == 0)    { devices    = static_cast<unsigned>(std::atoi(next())); }
+        else if (std::strcmp(argv[i], "--workers") == 0)    { options.workers = static_cast<unsigned>(std::atoi(next())); }
+        else if (std::strcmp(argv[i], "--generators") == 0) { generators = static_cast<unsigned>(std::atoi(next())); }
+        else if (std::strcmp(argv[i], "--rate") == 0)       { rate       = std::atof(next()); }
+        else if (std::strcmp(argv[i], "--seconds") == 0)    { seconds    = std::atof(next()); }
+        else if (argv[i][0] != '-')                         { recording  = argv[i]; }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (devices == 0 || generators == 0 || options.workers == 0 || rate <= 0 || seconds <= 0)
+    {
+        usage();
+        return 2;
+    }
+    generators = std::min(generators, devices);
+
+    std::vector<Line> signal = recording ? loadRecording(recording) : makeWalkSignal(3000);
+    if (signal.empty())
+    {
+        std::fprintf(stderr, "step_loadgen: no samples in %s\n", recording);
+        return 1;
+    }
+
+    // Two descriptors per board (master here, slave in the daemon)
+    rlimit limit;
+    ::getrlimit(RLIMIT_NOFILE, &limit);
+    limit.rlim_cur = limit.rlim_max;
+    ::setrlimit(RLIMIT_NOFILE, &limit);
+
+    std::unique_ptr<Board[]> boards(new Board[devices]);
+    StepDaemon daemon(options);
+    for (unsigned d = 0; d < devices; ++d)
+    {
+        std::string slave;
+        boards[d].masterFd = openPty(slave);
+        if (boards[d].masterFd < 0)
+        {
+            return 1;
+        }
+        daemon.add(slave);
+    }
+    if (!daemon.start())
+    {
+        return 1;
+    }
+
+    const Clock::duration period = std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(1.0 / rate));
+    const Clock::time_point start = Clock::now();
+    const Clock::time_point stopAt = start + std::chrono::duration_cast<Clock::duration>(std::chrono::duration<double>(seconds));
+    const Clock::time_point drainUntil = stopAt + std::chrono::milliseconds(500);
+
+    std::vector<std::vector<Board*>> shards(generators);
+    for (unsigned d = 0; d < devices; ++d)
+    {
+        Board& b = boards[d];
+        b.line = (d * 97u) % signal.size();                   // boards out of phase
+        b.due  = start + period * d / devices;                // spread the writes over one period
+        shards[d % generators].push_back(&b);
+    }
+
+    std::vector<GeneratorResult> results(generators);
+    std::vector<std::thread> threads;
+    for (unsigned g = 0; g < generators; ++g)
+    {
+        threads.emplace_back(runGenerator, shards[g], std::cref(signal), period, stopAt, drainUntil, std::ref(results[g]));
+    }
+    for (std::thread& t : threads)
+    {
+        t.join();
+    }
+    daemon.stop();
+
+    GeneratorResult total;
+    uint64_t pendingLeft = 0;
+    for (const GeneratorResult& r : results)
+    {
+        total.latency.merge(r.latency);
+        total.samples    += r.samples;
+        total.expected   += r.expected;
+        total.unexpected += r.unexpected;
+        total.stalls     += r.stalls;
+    }
+    uint64_t processed = 0, dropped = 0;
+    for (unsigned d = 0; d < devices; ++d)
+    {
+        StepDaemon::DeviceStats s = daemon.stats(d);
+        processed   += s.samples;
+        dropped     += s.droppedReplies;
+        pendingLeft += boards[d].pendingCount;
+        ::close(boards[d].masterFd);
+    }
+
+    std::printf("devices %u workers %u generators %u rate %.0f Hz/device, %.1f s\n",
+                devices, std::min(options.workers, devices), generators, rate, seconds);
+    std::printf("samples sent %lu processed %lu (%.0f samples/s offered)\n",
+                static_cast<unsigned long>(total.samples), static_cast<unsigned long>(processed),
+                devices * rate);
+    std::printf("steps expected %lu answered %lu missing %lu unexpected %lu dropped %lu\n",
+                static_cast<unsigned long>(total.expected), static_cast<unsigned long>(total.latency.count),
+                static_cast<unsigned long>(pendingLeft), static_cast<unsigned long>(total.unexpected),
+                static_cast<unsigned long>(dropped));
+    std::printf("pty stalls %lu\n", static_cast<unsigned long>(total.stalls));
+    if (total.latency.count > 0)
+    {
+        std::printf("reply latency us: min %.1f mean %.1f p50 %.1f p99 %.1f p99.9 %.1f max %.1f\n",
+                    total.latency.minNs / 1e3, total.latency.mean() / 1e3,
+                    total.latency.percentile(50) / 1e3, total.latency.percentile(99) / 1e3,
+                    total.latency.percentile(99.9) / 1e3, total.latency.maxNs / 1e3);
+    }
+    return (pendingLeft == 0 && total.unexpected == 0) ? 0 : 1;
+}
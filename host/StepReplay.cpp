@@ -0,0 +1,127 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepReplay.cpp
+ * @brief Host replay of recorded firmware output through the fixed-point StepDetector.
+ *
+ * Reads lines in the firmware UART format ("x  y  z" in g, "%1.4f") from a file or
+ * stdin and prints one line per sample:
+ *
+ *     <sampleIndex> <hpfMagnitude> <bpfMagnitude> <WALK++|RUN++|->
+ *
+ * Magnitudes are printed in g so the output can be diffed sample-for-sample
+ * against magHPF/magBPF and the WALK++/RUN++ decisions of matlabFilterTests.m.
+ *
+ * --adaptive <n> enables the adaptive thresholds (n/10 of the way from the
+ * mean to the average peak, see StepDetector.hpp) and --scale <f> multiplies
+ * the recording, to check how the detection depends on the signal amplitude,
+ * e.g. "step_replay --scale 0.3 --adaptive 5 walk.txt".
+ *
+ * --expect <walk>:<run> makes the exit status 1 unless the counts match, so
+ * the reference recordings in host/recordings can be checked after a change
+ * to the detector, e.g.
+ * "step_replay --adaptive 5 --expect 59:0 host/recordings/periodic_gait.txt",
+ * and at low amplitude with "--scale 0.3".
+ *
+ * Usage: step_replay [--adaptive n] [--scale f] [--expect walk:run] [recording.txt]
+ */
+
+#include "../inc/StepDetector.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+static int16_t toCounts(double g)
+{
+    return static_cast<int16_t>(std::lround(g * 4096.0));
+}
+
+int main(int argc, char** argv)
+{
+    StepDetector::Config cfg;
+    double scale = 1.0;
+    unsigned long expectWalk = 0;
+    unsigned long expectRun  = 0;
+    bool expect = false;
+    int arg = 1;
+    for (; arg + 1 < argc && argv[arg][0] == '-'; arg += 2)
+    {
+        if (std::strcmp(argv[arg], "--adaptive") == 0)
+        {
+            cfg.adaptiveRatio = static_cast<uint8_t>(std::atoi(argv[arg + 1]));
+        }
+        else if (std::strcmp(argv[arg], "--scale") == 0)
+        {
+            scale = std::atof(argv[arg + 1]);
+        }
+        else if (std::strcmp(argv[arg], "--expect") == 0)
+        {
+            expect = std::sscanf(argv[arg + 1], "%lu:%lu", &expectWalk, &expectRun) == 2;
+            if (!expect)
+            {
+                std::fprintf(stderr, "step_replay: --expect takes <walk>:<run>\n");
+                return 2;
+            }
+        }
+        else
+        {
+            break;
+        }
+    }
+
+    FILE* in = stdin;
+    if (arg < argc)
+    {
+        in = std::fopen(argv[arg], "r");
+        if (!in)
+        {
+            std::perror(argv[arg]);
+            return 1;
+        }
+    }
+
+    StepDetector detector(cfg);
+    char line[128];
+    uint32_t walk = 0;
+    uint32_t run  = 0;
+
+    while (std::fgets(line, sizeof(line), in))
+    {
+        double x, y, z;
+        if (std::sscanf(line, "%lf %lf %lf", &x, &y, &z) != 3)
+        {
+            continue; // same as MATLAB: skip lines with fewer than 3 values
+        }
+
+        StepDetector::Step step = detector.process(toCounts(x * scale), toCounts(y * scale), toCounts(z * scale));
+        const char* tag = "-";
+        if (step == StepDetector::Step::Run)  { tag = "RUN++";  ++run;  }
+        if (step == StepDetector::Step::Walk) { tag = "WALK++"; ++walk; }
+
+        std::printf("%lu %.4f %.4f %s\n",
+                    static_cast<unsigned long>(detector.sampleIndex()),
+                    detector.lastHpfMagnitude() / 32768.0,
+                    detector.lastBpfMagnitude() / 32768.0,
+                    tag);
+    }
+
+    std::fprintf(stderr, "Walk: %lu Run: %lu (thresholds hpf %.3f bpf %.3f g)\n",
+                 static_cast<unsigned long>(walk), static_cast<unsigned long>(run),
+                 detector.hpfThreshold() / 32768.0, detector.bpfThreshold() / 32768.0);
+
+    if (in != stdin)
+    {
+        std::fclose(in);
+    }
+    if (expect && (walk != expectWalk || run != expectRun))
+    {
+        std::fprintf(stderr, "step_replay: expected Walk: %lu Run: %lu\n", expectWalk, expectRun);
+        return 1;
+    }
+    return 0;
+}
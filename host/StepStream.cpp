@@ -0,0 +1,251 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepStream.cpp
+ * @brief Live step detection on the host, replacing the matlabFilterTests.m loop.
+ *
+ * Opens the board's serial port (or the simulator pty, PEDOSIM_PTY_LINK), runs
+ * every received sample through the fixed-point StepDetector (HPF/BPF
+ * magnitudes, local maxima, sample-distance lockouts and the walk/run merge of
+ * the MATLAB script) and answers each detected step with "WALK++" or "RUN++",
+ * as the script did with writeline(). It first sends "HOST 1", so the board
+ * counts these replies instead of its own detections; with --no-reply the
+ * board is left counting on its own. Samples are parsed byte by byte as they
+ * arrive, without a line buffer or a sample history, so memory use does not
+ * grow with the length of the session.
+ *
+ * Input is the firmware text stream ("x  y  z" in g) or, with --binary, the
+ * telemetry frames of inc/Telemetry.hpp (send BIN to the board first). Each
+ * step is printed to stdout as "<sampleIndex> WALK++|RUN++"; the totals go to
+ * stderr on end of input or Ctrl+C.
+ *
+ * --link-baud moves the board and the port to a faster rate with the BAUD
+ * handshake (see SerialPort.hpp) before streaming.
+ *
+ * --bench reports the per-sample processing latency (from the end of a sample
+ * to the written reply) and the parsing + detection throughput. A regular file
+ * or "-" may be given instead of a device; then nothing is written back.
+ *
+ * Usage: step_stream [--baud <rate>] [--link-baud <rate>] [--binary] [--no-reply] [--bench] <device|file|->
+ */
+
+#include "LatencyHistogram.hpp"
+#include "SampleParser.hpp"
+#include "SerialPort.hpp"
+#include "TelemetryDecoder.hpp"
+#include "../inc/StepDetector.hpp"
+
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace
+{
+    using Clock = std::chrono::steady_clock;
+
+    volatile std::sig_atomic_t g_stop = 0;
+
+    void onSignal(int)
+    {
+        g_stop = 1;
+    }
+
+    void usage()
+    {
+        std::fprintf(stderr, "usage: step_stream [--baud <rate>] [--link-baud <rate>] [--binary] [--no-reply] [--bench] <device|file|->\n");
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long        baud     = 9600;
+    long        linkBaud = 0;
+    bool        binary   = false;
+    bool        reply    = true;
+    bool        bench    = false;
+    const char* path     = nullptr;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        if (std::strcmp(argv[i], "--baud") == 0 && i + 1 < argc)
+        {
+            baud = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--link-baud") == 0 && i + 1 < argc)
+        {
+            linkBaud = std::strtol(argv[++i], nullptr, 10);
+        }
+        else if (std::strcmp(argv[i], "--binary") == 0)
+        {
+            binary = true;
+        }
+        else if (std::strcmp(argv[i], "--no-reply") == 0)
+        {
+            reply = false;
+        }
+        else if (std::strcmp(argv[i], "--bench") == 0)
+        {
+            bench = true;
+        }
+        else if (argv[i][0] != '-' || std::strcmp(argv[i], "-") == 0)
+        {
+            path = argv[i];
+        }
+        else
+        {
+            usage();
+            return 2;
+        }
+    }
+    if (!path)
+    {
+        usage();
+        return 2;
+    }
+
+    int fd = STDIN_FILENO;
+    if (std::strcmp(path, "-") != 0)
+    {
+        fd = serial::open(path, baud);
+        if (fd < 0)
+        {
+            return 1;
+        }
+    }
+    if (fd == STDIN_FILENO || !::isatty(fd))
+    {
+        reply = false;   // recording or pipe: nobody to answer
+    }
+    else if (linkBaud != 0 && linkBaud != baud && !serial::switchBaud(fd, linkBaud))
+    {
+        return 1;
+    }
+    if (reply && !serial::selectHostSteps(fd))
+    {
+        return 1;
+    }
+
+    struct sigaction sa = {};
+    sa.sa_handler = onSignal;   // no SA_RESTART: read() returns EINTR on Ctrl+C
+    ::sigaction(SIGINT, &sa, nullptr);
+    ::sigaction(SIGTERM, &sa, nullptr);
+
+    StepDetector     detector;
+    SampleParser     parser;
+    TelemetryDecoder decoder;
+    LatencyHistogram latency;
+    uint64_t walk = 0;
+    uint64_t run  = 0;
+    uint64_t writeErrors = 0;
+    Clock::duration busy = Clock::duration::zero();
+
+    auto onSample = [&](int16_t x, int16_t y, int16_t z)
+    {
+        Clock::time_point start = bench ? Clock::now() : Clock::time_point();
+
+        StepDetector::Step step = detector.process(x, y, z);
+        if (step != StepDetector::Step::None)
+        {
+            const bool isRun = step == StepDetector::Step::Run;
+            const char* command = isRun ? "RUN++\n" : "WALK++\n";
+            if (reply)
+            {
+                size_t length = std::strlen(command);
+                if (::write(fd, command, length) != static_cast<ssize_t>(length))
+                {
+                    ++writeErrors;
+                }
+            }
+            (isRun ? run : walk) += 1;
+            if (!bench)
+            {
+                std::printf("%lu %s", static_cast<unsigned long>(detector.sampleIndex()), command);
+                std::fflush(stdout);
+            }
+        }
+
+        if (bench)
+        {
+            latency.add(static_cast<uint64_t>(
+                std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() - start).count()));
+        }
+    };
+
+    char chunk[256];
+    while (!g_stop)
+    {
+        ssize_t n = ::read(fd, chunk, sizeof(chunk));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            break;   // end of file, or the pty/device went away
+        }
+
+        Clock::time_point start = Clock::now();
+        if (binary)
+        {
+            decoder.feed(reinterpret_cast<const uint8_t*>(chunk), static_cast<size_t>(n),
+                         [&](const TelemetryDecoder::Frame& frame)
+            {
+                for (uint8_t i = 0; i < frame.count; ++i)
+                {
+                    onSample(frame.samples[i].x, frame.samples[i].y, frame.samples[i].z);
+                }
+            });
+        }
+        else
+        {
+            int16_t s[3];
+            for (ssize_t i = 0; i < n; ++i)
+            {
+                if (parser.feed(chunk[i], s))
+                {
+                    onSample(s[0], s[1], s[2]);
+                }
+            }
+        }
+        busy += Clock::now() - start;
+    }
+
+    std::fprintf(stderr, "Walk: %lu Run: %lu\n", static_cast<unsigned long>(walk), static_cast<unsigned long>(run));
+    if (writeErrors)
+    {
+        std::fprintf(stderr, "step_stream: %lu replies could not be written\n", static_cast<unsigned long>(writeErrors));
+    }
+    if (binary)
+    {
+        const TelemetryDecoder::Stats& st = decoder.stats();
+        std::fprintf(stderr, "frames %lu crc errors %lu gaps %lu\n", static_cast<unsigned long>(st.frames),
+                     static_cast<unsigned long>(st.crcErrors), static_cast<unsigned long>(st.sequenceGaps));
+    }
+
+    if (bench && latency.count > 0)
+    {
+        double busyNs = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(busy).count());
+        std::printf("samples             %lu\n", static_cast<unsigned long>(latency.count));
+        std::printf("latency min         %lu ns\n", static_cast<unsigned long>(latency.minNs));
+        std::printf("latency mean        %.0f ns\n", latency.mean());
+        std::printf("latency p50         %lu ns\n", static_cast<unsigned long>(latency.percentile(50)));
+        std::printf("latency p99         %lu ns\n", static_cast<unsigned long>(latency.percentile(99)));
+        std::printf("latency p99.9       %lu ns\n", static_cast<unsigned long>(latency.percentile(99.9)));
+        std::printf("latency max         %lu ns\n", static_cast<unsigned long>(latency.maxNs));
+        std::printf("parse+detect        %.1f ns/sample (%.2f Msamples/s)\n",
+                    busyNs / latency.count, latency.count / busyNs * 1e3);
+    }
+
+    if (fd != STDIN_FILENO)
+    {
+        ::close(fd);
+    }
+    return 0;
+}
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file TelemetryBench.cpp
+ * @brief Throughput comparison of the "%1.4f" text stream and the binary frames.
+ *
+ * Part 1 reports the wire-limited sample rate at every supported baud rate
+ * (8N1 = 10 bits per byte) for the text format and for binary frames of
+ * several batch sizes. Part 2 measures host-side decoding throughput of both
+ * formats on the same synthetic walk signal.
+ *
+ * Usage: telemetry_bench [samples]
+ */
+
+#include "TelemetryDecoder.hpp"
+
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+namespace
+{
+    struct RawSample { int16_t x, y, z; };
+
+    std::vector<RawSample> makeSignal(size_t count)
+    {
+        std::vector<RawSample> out(count);
+        for (size_t n = 0; n < count; ++n)
+        {
+            double t = n / 10.0;
+            out[n].x = static_cast<int16_t>(4096 * 0.05 * std::sin(2 * M_PI * 1.8 * t));
+            out[n].y = static_cast<int16_t>(4096 * (0.1 + 0.15 * std::sin(2 * M_PI * 1.8 * t + 1)));
+            out[n].z = static_cast<int16_t>(4096 * (1.0 + 0.5 * std::sin(2 * M_PI * 1.8 * t)));
+        }
+        return out;
+    }
+
+    std::string encodeText(const std::vector<RawSample>& samples)
+    {
+        std::string out;
+        char line[48];
+        for (const RawSample& s : samples)
+        {
+            // Same format and terminator as main.cpp + Uart::println
+            int n = std::snprintf(line, sizeof(line), "%1.4f  %1.4f  %1.4f\n\r",
+                                  s.x / 4096.0, s.y / 4096.0, s.z / 4096.0);
+            out.append(line, static_cast<size_t>(n));
+        }
+        return out;
+    }
+
+    std::vector<uint8_t> encodeBinary(const std::vector<RawSample>& samples, uint8_t batch)
+    {
+        std::vector<uint8_t> out;
+        telemetry::FrameBuilder builder(batch, 10);
+        for (size_t n = 0; n < samples.size(); ++n)
+        {
+            if (builder.add(static_cast<uint32_t>(n), samples[n].x, samples[n].y, samples[n].z))
+            {
+                out.insert(out.end(), builder.data(), builder.data() + builder.size());
+            }
+        }
+        if (builder.flush())
+        {
+            out.insert(out.end(), builder.data(), builder.data() + builder.size());
+        }
+        return out;
+    }
+
+    double seconds(std::chrono::steady_clock::time_point since)
+    {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - since).count();
+    }
+}
+
+int main(int argc, char** argv)
+{
+    size_t count = (argc > 1) ? std::strtoul(argv[1], nullptr, 10) : 2000000;
+    std::vector<RawSample> signal = makeSignal(count);
+
+    const uint8_t batches[] = { 1, 10, 16 };
+    const uint32_t bauds[]  = { 9600, 19200, 38400, 57600, 115200, 230400, 460800 };
+
+    std::string text = encodeText(signal);
+    double textBytes = static_cast<double>(text.size()) / count;
+
+    std::printf("Wire-limited sample rate [samples/s], 8N1\n");
+    std::printf("%8s %10s", "baud", "text");
+    for (uint8_t b : batches)
+    {
+        std::printf("   bin N=%-2u", b);
+    }
+    std::printf("\n%8s %10.1f", "B/sample", textBytes);
+    for (uint8_t b : batches)
+    {
+        std::printf(" %10.2f", (telemetry::HEADER_SIZE + telemetry::CRC_SIZE + b * 6.0) / b);
+    }
+    std::printf("\n");
+    for (uint32_t baud : bauds)
+    {
+        double bytesPerSecond = baud / 10.0;
+        std::printf("%8u %10.1f", baud, bytesPerSecond / textBytes);
+        for (uint8_t b : batches)
+        {
+            double perSample = (telemetry::HEADER_SIZE + telemetry::CRC_SIZE + b * 6.0) / b;
+            std::printf(" %10.1f", bytesPerSecond / perSample);
+        }
+        std::printf("\n");
+    }
+
+    // Host decoding throughput: strtod per field (what str2double(split()) does) vs frame decoder
+    auto t0 = std::chrono::steady_clock::now();
+    size_t parsed = 0;
+    double checksum = 0;
+    for (const char* p = text.c_str(); *p; )
+    {
+        char* end;
+        std::strtod(p, &end);
+        std::strtod(end, &end);
+        double z = std::strtod(end, &end);
+        ++parsed;
+        checksum += z;
+        p = end + 2;    // "\n\r"
+    }
+    double textTime = seconds(t0);
+
+    std::vector<uint8_t> binary = encodeBinary(signal, 10);
+    TelemetryDecoder decoder;
+    size_t decoded = 0;
+    t0 = std::chrono::steady_clock::now();
+    for (size_t off = 0; off < binary.size(); off += 256)
+    {
+        size_t n = std::min<size_t>(256, binary.size() - off);
+        decoder.feed(&binary[off], n, [&](const TelemetryDecoder::Frame& f)
+        {
+            decoded += f.count;
+            checksum += f.samples[0].z;
+        });
+    }
+    double binTime = seconds(t0);
+
+    std::printf("\nHost decode of %zu samples\n", count);
+    std::printf("  text   : %8.2f Msamples/s (%zu parsed)\n", parsed / textTime / 1e6, parsed);
+    std::printf("  binary : %8.2f Msamples/s (%zu decoded, %llu crc errors)\n",
+                decoded / binTime / 1e6, decoded,
+                static_cast<unsigned long long>(decoder.stats().crcErrors));
+    std::printf("  (checksum %.1f)\n", checksum);
+
+    return (decoded == count && parsed == count) ? 0 : 1;
+}
@@ -0,0 +1,143 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file TelemetryDecoder.cpp
+ * @brief Implementation of the host-side telemetry frame decoder.
+ */
+
+#include "TelemetryDecoder.hpp"
+
+#include <cstring>
+
+static uint16_t get16(const uint8_t* p)
+{
+    return static_cast<uint16_t>(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p)
+{
+    return get16(p) | (static_cast<uint32_t>(get16(p + 2)) << 16);
+}
+
+TelemetryDecoder::Result TelemetryDecoder::step()
+{
+    using namespace telemetry;
+
+    if (buffer[0] != SYNC0)                          { return Result::Reject; }
+    if (have < 2)                                    { return Result::NeedMore; }
+    if (buffer[1] != SYNC1)                          { return Result::Reject; }
+    if (have < 4)                                    { return Result::NeedMore; }
+    if (buffer[2] != FRAME_SAMPLES && buffer[2] != FRAME_GAIT && buffer[2] != FRAME_RECORD)
+    {
+        return Result::Reject;
+    }
+    const bool gait = buffer[2] == FRAME_GAIT;
+    const bool recorded = buffer[2] == FRAME_RECORD;
+    if (buffer[3] == 0 || buffer[3] > (gait ? 1 : (recorded ? RECORD_MAX_SAMPLES : MAX_BATCH)))
+    {
+        return Result::Reject;
+    }
+
+    size_t payloadEnd = HEADER_SIZE + (gait ? GAIT_SIZE : static_cast<size_t>(buffer[3]) * SAMPLE_SIZE);
+    if (recorded)
+    {
+        if (have < HEADER_SIZE + 1u)
+        {
+            return Result::NeedMore;
+        }
+        if (buffer[HEADER_SIZE] == 0 || buffer[HEADER_SIZE] > RECORD_PAYLOAD_SIZE)
+        {
+            return Result::Reject;
+        }
+        payloadEnd = HEADER_SIZE + 1u + buffer[HEADER_SIZE];
+    }
+    if (have < payloadEnd + CRC_SIZE)
+    {
+        return Result::NeedMore;
+    }
+    if (crc16(&buffer[2], static_cast<uint32_t>(payloadEnd - 2)) != get16(&buffer[payloadEnd]))
+    {
+        ++counters.crcErrors;
+        return Result::Reject;
+    }
+
+    frame.type      = buffer[2];
+    frame.sequence  = get16(&buffer[4]);
+    frame.rateHz    = get16(&buffer[6]);
+    frame.timestamp = get32(&buffer[8]);
+    frameSize = payloadEnd + CRC_SIZE;
+    if (recorded)
+    {
+        return record();
+    }
+    ++counters.frames;
+
+    if (gait)
+    {
+        const uint8_t* p = &buffer[HEADER_SIZE];
+        frame.count = 0;
+        frame.gait  = { { get16(p), get16(p + 2) }, get16(p + 4), get16(p + 6), get16(p + 8),
+                        get32(p + 10), get32(p + 14), get16(p + 18), get16(p + 20) };
+        ++counters.gaitFrames;
+        return Result::Complete;
+    }
+
+    frame.count = buffer[3];
+    for (uint8_t i = 0; i < frame.count; ++i)
+    {
+        const uint8_t* p = &buffer[HEADER_SIZE + i * SAMPLE_SIZE];
+        frame.samples[i] = { static_cast<int16_t>(get16(p)),
+                             static_cast<int16_t>(get16(p + 2)),
+                             static_cast<int16_t>(get16(p + 4)) };
+    }
+
+    if (haveSequence && frame.sequence != nextSequence)
+    {
+        counters.sequenceGaps += static_cast<uint16_t>(frame.sequence - nextSequence);
+    }
+    haveSequence = true;
+    nextSequence = static_cast<uint16_t>(frame.sequence + 1);
+
+    counters.samples += frame.count;
+    return Result::Complete;
+}
+
+TelemetryDecoder::Result TelemetryDecoder::record()
+{
+    // The first sample raw, then the differences to the previous sample
+    const uint8_t* payload = &buffer[telemetry::HEADER_SIZE + 1u];
+    const uint8_t  size    = buffer[telemetry::HEADER_SIZE];
+    telemetry::DeltaCoder coder;
+    int16_t value[3] = { 0, 0, 0 };
+    frame.count = buffer[3];
+    for (uint8_t i = 0; i < frame.count; ++i)
+    {
+        for (uint8_t axis = 0; axis < 3; ++axis)
+        {
+            const bool ok = i == 0 ? coder.getRaw(payload, size, value[axis])
+                                   : coder.get(payload, size, axis, value[axis], value[axis]);
+            if (!ok)
+            {
+                return Result::Reject;
+            }
+        }
+        frame.samples[i] = { value[0], value[1], value[2] };
+    }
+    if ((coder.bits() + 7u) / 8u != size)
+    {
+        return Result::Reject;
+    }
+    ++counters.frames;
+    ++counters.recordFrames;
+    counters.samples += frame.count;
+    return Result::Complete;
+}
+
+void TelemetryDecoder::consume(size_t bytes)
+{
+    have -= bytes;
+    std::memmove(buffer, buffer + bytes, have);
+}
@@ -0,0 +1,126 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file TelemetryDecoder.hpp
+ * @brief Host-side streaming decoder for the binary telemetry frames (inc/Telemetry.hpp).
+ *
+ * Bytes can be fed in chunks of any size. Record frames (a sample recorder
+ * download) are expanded from their Golomb-Rice coded differences into samples. The decoder hunts for the sync word,
+ * validates type, length and CRC, and re-synchronises one byte after the start
+ * of any rejected frame, so text lines or line noise in the stream are skipped.
+ */
+
+#ifndef TELEMETRY_DECODER_HPP
+#define TELEMETRY_DECODER_HPP
+
+#include "../inc/Telemetry.hpp"
+
+#include <cstddef>
+#include <cstdint>
+
+/**
+ * @class TelemetryDecoder
+ * @brief Incremental frame parser with error and gap statistics.
+ */
+class TelemetryDecoder
+{
+public:
+    static constexpr uint8_t  MAX_SAMPLES = telemetry::RECORD_MAX_SAMPLES > telemetry::MAX_BATCH
+                                          ? telemetry::RECORD_MAX_SAMPLES : telemetry::MAX_BATCH;
+    static constexpr uint16_t MAX_SIZE    = telemetry::RECORD_FRAME_SIZE > telemetry::MAX_FRAME_SIZE
+                                          ? telemetry::RECORD_FRAME_SIZE : telemetry::MAX_FRAME_SIZE;
+
+    /**
+     * @struct Sample
+     * @brief Raw sample in 14-bit counts (4096 counts/g).
+     */
+    struct Sample
+    {
+        int16_t x;
+        int16_t y;
+        int16_t z;
+    };
+
+    /**
+     * @struct Frame
+     * @brief One decoded frame: samples, or a gait record (count 0).
+     */
+    struct Frame
+    {
+        uint8_t  type;                              /**< FRAME_SAMPLES, FRAME_GAIT or FRAME_RECORD. */
+        uint16_t sequence;                          /**< Frame counter. */
+        uint16_t rateHz;                            /**< Sample rate [Hz]. */
+        uint32_t timestamp;                         /**< Index of the first sample. */
+        uint8_t  count;                             /**< Valid entries in samples. */
+        Sample   samples[MAX_SAMPLES];              /**< Decoded samples. */
+        telemetry::Gait gait;                       /**< Decoded gait record (FRAME_GAIT). */
+    };
+
+    /**
+     * @struct Stats
+     * @brief Decoder counters.
+     */
+    struct Stats
+    {
+        uint64_t frames;        /**< Frames accepted. */
+        uint64_t samples;       /**< Samples delivered. */
+        uint64_t gaitFrames;    /**< Gait frames among the accepted frames. */
+        uint64_t recordFrames;  /**< Record frames among the accepted frames. */
+        uint64_t crcErrors;     /**< Frames rejected by the CRC check. */
+        uint64_t skippedBytes;  /**< Bytes discarded while hunting for sync. */
+        uint64_t sequenceGaps;  /**< Sample frames missing according to the sequence numbers. */
+    };
+
+    /**
+     * @brief Feeds received bytes; @p onFrame(const Frame&) is called for every valid frame.
+     */
+    template <typename OnFrame>
+    void feed(const uint8_t* data, size_t size, OnFrame&& onFrame)
+    {
+        for (size_t i = 0; i < size; ++i)
+        {
+            buffer[have++] = data[i];
+            while (have > 0)
+            {
+                Result r = step();
+                if (r == Result::NeedMore)
+                {
+                    break;
+                }
+                if (r == Result::Complete)
+                {
+                    onFrame(frame);
+                    consume(frameSize);
+                    continue;
+                }
+                consume(1);         // Result::Reject: retry one byte later
+                ++counters.skippedBytes;
+            }
+        }
+    }
+
+    /**
+     * @brief Returns the decoder counters.
+     */
+    const Stats& stats() const { return counters; }
+
+private:
+    enum class Result : uint8_t { NeedMore, Complete, Reject };
+
+    Result step();
+    Result record();
+    void   consume(size_t bytes);
+
+    uint8_t  buffer[MAX_SIZE] = {};
+    size_t   have         = 0;
+    size_t   frameSize    = 0;
+    bool     haveSequence = false;
+    uint16_t nextSequence = 0;
+    Frame    frame        = {};
+    Stats    counters     = {};
+};
+
+#endif // TELEMETRY_DECODER_HPP
@@ -0,0 +1,73 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file TelemetryDump.cpp
+ * @brief Converts a captured binary telemetry stream into "x  y  z" text lines.
+ *
+ * The output uses the firmware text format ("%1.4f  %1.4f  %1.4f", in g), so it
+ * can be fed to step_replay, the simulator (PEDOSIM_ACCEL) or the MATLAB script.
+ * Gait frames become the firmware's "GAIT ..." and "THRESH ..." text lines,
+ * which those skip.
+ *
+ * Usage: telemetry_dump [capture.bin]
+ */
+
+#include "TelemetryDecoder.hpp"
+
+#include <cstdio>
+
+int main(int argc, char** argv)
+{
+    FILE* in = stdin;
+    if (argc > 1)
+    {
+        in = std::fopen(argv[1], "rb");
+        if (!in)
+        {
+            std::perror(argv[1]);
+            return 1;
+        }
+    }
+
+    TelemetryDecoder decoder;
+    uint8_t chunk[4096];
+    size_t n;
+
+    while ((n = std::fread(chunk, 1, sizeof(chunk), in)) > 0)
+    {
+        decoder.feed(chunk, n, [](const TelemetryDecoder::Frame& frame)
+        {
+            if (frame.type == telemetry::FRAME_GAIT)
+            {
+                const telemetry::Gait& g = frame.gait;
+                std::printf("GAIT spm %u %u walk %u run %u speed %u mm/s dist %u.%03u %u.%03u m\n",
+                            g.cadence[0], g.cadence[1], g.walkCadence, g.runCadence, g.speedMmS,
+                            g.walkDistanceMm / 1000u, g.walkDistanceMm % 1000u,
+                            g.runDistanceMm / 1000u, g.runDistanceMm % 1000u);
+                std::printf("THRESH hpf %u bpf %u mg\n", g.hpfThresholdMg, g.bpfThresholdMg);
+                return;
+            }
+            for (uint8_t i = 0; i < frame.count; ++i)
+            {
+                const TelemetryDecoder::Sample& s = frame.samples[i];
+                std::printf("%1.4f  %1.4f  %1.4f\n", s.x / 4096.0, s.y / 4096.0, s.z / 4096.0);
+            }
+        });
+    }
+
+    const TelemetryDecoder::Stats& st = decoder.stats();
+    std::fprintf(stderr, "frames %llu (gait %llu), samples %llu, crc errors %llu, skipped bytes %llu, sequence gaps %llu\n",
+                 static_cast<unsigned long long>(st.frames), static_cast<unsigned long long>(st.gaitFrames),
+                 static_cast<unsigned long long>(st.samples),
+                 static_cast<unsigned long long>(st.crcErrors), static_cast<unsigned long long>(st.skippedBytes),
+                 static_cast<unsigned long long>(st.sequenceGaps));
+
+    if (in != stdin)
+    {
+        std::fclose(in);
+    }
+    return 0;
+}
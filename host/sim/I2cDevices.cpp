@@ -0,0 +1,524 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file I2cDevices.cpp
+ * @brief Simulated I2C0 slaves: scripted MMA8451Q (0x1D) and PCF8574 + HD44780 LCD (0x27).
+ */
+
+#include "Simulator.hpp"
+
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+namespace sim
+{
+    /* =========================================
+     * MMA8451Q accelerometer
+     * =========================================
+     */
+
+    /**
+     * @class Mma8451q
+     * @brief Register-file model of the MMA8451Q serving scripted samples.
+     *
+     * With the FIFO disabled a new sample is latched into OUT_X_MSB..OUT_Z_LSB
+     * whenever a read burst starts at STATUS (0x00) or OUT_X_MSB (0x01) while the
+     * device is active. With F_MODE != 0 samples enter the 32-entry FIFO at the
+     * ODR selected in CTRL_REG1, STATUS reads as F_STATUS, a burst from OUT_X_MSB
+     * wraps from OUT_Z_LSB back to OUT_X_MSB popping one sample per 6 bytes, and
+     * the FIFO watermark drives INT1 (PTA10) or INT2 per CTRL_REG5.
+     *
+     * With the FIFO disabled and the transient interrupt enabled (CTRL_REG4), samples
+     * are consumed at the ODR as well and the transient detector is modelled as the
+     * sample-to-sample change of an enabled axis exceeding TRANSIENT_THS (63 mg/LSB);
+     * the event latches TRANSIENT_SRC until it is read.
+     */
+    class Mma8451q : public I2cDevice
+    {
+    public:
+        static constexpr uint8_t ADDRESS   = 0x1D;
+        static constexpr uint8_t REG_COUNT = 0x32;
+        static constexpr uint8_t INT1_PIN  = 10;
+        static constexpr uint8_t FIFO_SIZE = 32;
+
+        void load()
+        {
+            regs[0x0D] = 0x1A;   // WHO_AM_I
+
+            if (const char* at = std::getenv("PEDOSIM_BUTTON_AT"))
+            {
+                buttonAt = static_cast<uint32_t>(std::strtoul(at, nullptr, 10));
+            }
+
+            const char* path = std::getenv("PEDOSIM_ACCEL");
+            if (!path)
+            {
+                return;
+            }
+            FILE* f = std::fopen(path, "r");
+            if (!f)
+            {
+                std::perror(path);
+                std::exit(1);
+            }
+            char line[128];
+            while (std::fgets(line, sizeof(line), f))
+            {
+                double x, y, z;
+                if (std::sscanf(line, "%lf %lf %lf", &x, &y, &z) == 3)
+                {
+                    script.push_back({ toCounts(x), toCounts(y), toCounts(z) });
+                }
+            }
+            std::fclose(f);
+            scripted = true;
+        }
+
+        uint32_t sampleIndex() const { return index; }
+
+        void start(bool read) override
+        {
+            expectRegister = !read;
+            firstRead      = read;
+        }
+
+        void write(uint8_t data) override
+        {
+            if (expectRegister)
+            {
+                pointer = data;
+                expectRegister = false;
+                return;
+            }
+            if (pointer < REG_COUNT)
+            {
+                bool wasActive = active();
+                regs[pointer] = data;
+                if (pointer == 0x2A && active() && !wasActive)
+                {
+                    nextSampleNs = nowNs() + periodNs();
+                    havePrevious = false;
+                }
+                if (pointer == 0x09 && !fifoMode())
+                {
+                    fifo.clear();
+                    overflow = false;
+                }
+            }
+            ++pointer;
+            updateInterrupt();
+        }
+
+        uint8_t read() override
+        {
+            uint8_t data = 0;
+            if (fifoMode())
+            {
+                if (pointer == 0x00)
+                {
+                    data = fifoStatus();
+                    overflow = false;
+                    pointer = 0x01;
+                    return data;
+                }
+                if (pointer == 0x01)
+                {
+                    popFifo();
+                }
+                data = (pointer < REG_COUNT) ? regs[pointer] : 0;
+                pointer = (pointer == 0x06) ? 0x01 : static_cast<uint8_t>(pointer + 1);
+                updateInterrupt();
+                return data;
+            }
+
+            if (pointer == REG_TRANSIENT_SRC)
+            {
+                data = regs[REG_TRANSIENT_SRC];
+                regs[REG_TRANSIENT_SRC] = 0;   // reading clears the event
+                ++pointer;
+                updateInterrupt();
+                return data;
+            }
+            if (firstRead && (pointer == 0x00 || pointer == 0x01) && active() && !transientMode())
+            {
+                latch(nextScripted());
+                regs[0x00] = 0x0F;   // ZYXDR | ZDR | YDR | XDR
+            }
+            firstRead = false;
+            data = (pointer < REG_COUNT) ? regs[pointer] : 0;
+            ++pointer;
+            return data;
+        }
+
+        void update(uint64_t now) override
+        {
+            if (transientMode())
+            {
+                updateTransient(now);
+                return;
+            }
+            if (!fifoMode() || !active())
+            {
+                return;
+            }
+            while (now >= nextSampleNs && !exhausted())
+            {
+                // FIFO mode ends after the last sample: the firmware still drains and sends it
+                nextSampleNs += periodNs();
+                if (fifo.size() == FIFO_SIZE)
+                {
+                    fifo.erase(fifo.begin());   // circular mode drops the oldest sample
+                    overflow = true;
+                }
+                fifo.push_back(nextScripted());
+            }
+            if (exhausted())
+            {
+                endOfScript();
+            }
+            updateInterrupt();
+        }
+
+        uint64_t nextEventNs() const override
+        {
+            return ((fifoMode() || transientMode()) && active() && !exhausted()) ? nextSampleNs : UINT64_MAX;
+        }
+
+    private:
+        struct Sample { int16_t x, y, z; };
+
+        static int16_t toCounts(double g)
+        {
+            return static_cast<int16_t>(std::lround(g * 4096.0));
+        }
+
+        bool    active()   const { return (regs[0x2A] & 0x01) != 0; }
+        bool    exhausted() const { return scripted && index >= script.size(); }
+        static constexpr uint8_t REG_TRANSIENT_CFG = 0x1D;
+        static constexpr uint8_t REG_TRANSIENT_SRC = 0x1E;
+        static constexpr uint8_t REG_TRANSIENT_THS = 0x1F;
+
+        bool    fifoMode() const { return (regs[0x09] & 0xC0) != 0; }
+        bool    transientMode() const { return !fifoMode() && active() && (regs[0x2D] & 0x20); }
+        uint8_t watermark() const { return regs[0x09] & 0x3F; }
+
+        uint64_t periodNs() const
+        {
+            static const uint64_t PERIOD_NS[8] =
+            {
+                1250000ull, 2500000ull, 5000000ull, 10000000ull,
+                20000000ull, 80000000ull, 160000000ull, 640000000ull
+            };
+            return PERIOD_NS[(regs[0x2A] >> 3) & 0x07];
+        }
+
+        uint8_t fifoStatus() const
+        {
+            uint8_t status = static_cast<uint8_t>(fifo.size());
+            if (overflow)                                  { status |= 0x80; }
+            if (watermark() && fifo.size() >= watermark()) { status |= 0x40; }
+            return status;
+        }
+
+        void endOfScript()
+        {
+            if (!finished)
+            {
+                std::fprintf(stderr, "pedometer_sim: accelerometer script finished after %u samples\n", index);
+                finished = true;
+                finish();
+            }
+        }
+
+        Sample nextScripted()
+        {
+            Sample s = { 0, 0, 4096 };
+            if (scripted)
+            {
+                if (exhausted())
+                {
+                    // Polled reads: the previous sample was sent a whole period ago, stop right here
+                    endOfScript();
+                    std::exit(0);
+                }
+                s = script[index];
+            }
+            ++index;
+            if (index == buttonAt)
+            {
+                pressButtonWhenIdle();
+            }
+            return s;
+        }
+
+        void updateTransient(uint64_t now)
+        {
+            while (now >= nextSampleNs && !exhausted())
+            {
+                nextSampleNs += periodNs();
+                Sample s = nextScripted();
+                latch(s);
+                if (havePrevious)
+                {
+                    // THS is in 63 mg steps, i.e. about 258 counts at 4096 counts/g
+                    int32_t threshold = (regs[REG_TRANSIENT_THS] & 0x7F) * 258;
+                    const int32_t delta[3] = { s.x - previous.x, s.y - previous.y, s.z - previous.z };
+                    uint8_t src = 0;
+                    for (uint8_t axis = 0; axis < 3; ++axis)
+                    {
+                        bool enabled = regs[REG_TRANSIENT_CFG] & (0x02 << axis);
+                        if (enabled && std::abs(delta[axis]) > threshold)
+                        {
+                            src |= static_cast<uint8_t>(0x02 << (2 * axis));   // XTRANSE, YTRANSE, ZTRANSE
+                        }
+                    }
+                    if (src != 0)
+                    {
+                        regs[REG_TRANSIENT_SRC] = static_cast<uint8_t>(src | 0x40);   // EA
+                    }
+                }
+                previous     = s;
+                havePrevious = true;
+            }
+            if (exhausted())
+            {
+                endOfScript();
+            }
+            updateInterrupt();
+        }
+
+        void latch(const Sample& s)
+        {
+            const int16_t axes[3] = { s.x, s.y, s.z };
+            for (uint8_t i = 0; i < 3; ++i)
+            {
+                uint16_t left = static_cast<uint16_t>(axes[i] << 2);   // 14-bit left-justified
+                regs[0x01 + 2 * i] = static_cast<uint8_t>(left >> 8);
+                regs[0x02 + 2 * i] = static_cast<uint8_t>(left & 0xFC);
+            }
+        }
+
+        void popFifo()
+        {
+            if (!fifo.empty())
+            {
+                latch(fifo.front());
+                fifo.erase(fifo.begin());
+            }
+        }
+
+        void updateInterrupt()
+        {
+            bool fifoIrq  = (regs[0x2D] & 0x40) && fifoMode() && watermark() && fifo.size() >= watermark();
+            bool transIrq = (regs[0x2D] & 0x20) && (regs[REG_TRANSIENT_SRC] & 0x40);
+            bool int1     = (fifoIrq && (regs[0x2E] & 0x40)) || (transIrq && (regs[0x2E] & 0x20));
+            bool ipol     = (regs[0x2C] & 0x02) != 0;   // 0 = active low
+            if (regs[0x2E] & 0x60)
+            {
+                setPortAPin(INT1_PIN, int1 == ipol);
+            }
+        }
+
+        uint8_t             regs[REG_COUNT] = {};
+        uint8_t             pointer         = 0;
+        bool                expectRegister  = false;
+        bool                firstRead       = false;
+        bool                scripted        = false;
+        bool                finished        = false;
+        bool                overflow        = false;
+        bool                havePrevious    = false;
+        Sample              previous        = {};
+        std::vector<Sample> script;
+        std::vector<Sample> fifo;
+        uint32_t            index           = 0;
+        uint32_t            buttonAt        = 0;
+        uint64_t            nextSampleNs    = 0;
+    };
+
+    /* =========================================
+     * PCF8574 expander driving an HD44780 LCD
+     * =========================================
+     */
+
+    /**
+     * @class Pcf8574Lcd
+     * @brief PCF8574 (P7..P4 = D7..D4, P3 = BL, P2 = EN, P0 = RS) wired to an HD44780.
+     *
+     * Nibbles are latched on the falling edge of EN. The controller starts in
+     * 8-bit mode, so the 0x33/0x32 init sequence is interpreted as on real hardware.
+     * Each instruction keeps the controller busy for its datasheet execution time
+     * (37 us, 1.52 ms for clear/home at fOSC = 270 kHz); an instruction started
+     * earlier is counted in BusStats::lcdBusyWrites.
+     */
+    class Pcf8574Lcd : public I2cDevice
+    {
+    public:
+        static constexpr uint8_t ADDRESS = 0x27;
+
+        Pcf8574Lcd()
+        {
+            std::memset(ddram, ' ', sizeof(ddram));
+        }
+
+        void start(bool) override {}
+
+        void write(uint8_t data) override
+        {
+            constexpr uint8_t EN = 0x04;
+            constexpr uint8_t RS = 0x01;
+
+            if ((port & EN) && !(data & EN))
+            {
+                nibble(static_cast<uint8_t>(port >> 4), (port & RS) != 0);
+            }
+            port = data;
+        }
+
+        uint8_t read() override { return port; }
+
+        std::string row(uint8_t r) const
+        {
+            return std::string(ddram + (r ? 0x40 : 0x00), 16);
+        }
+
+    private:
+        void nibble(uint8_t n, bool rs)
+        {
+            if (!haveHigh && nowNs() < busyUntilNs)
+            {
+                countLcdBusyWrite();
+            }
+            if (!fourBit)
+            {
+                execute(static_cast<uint8_t>(n << 4), rs);
+                return;
+            }
+            if (!haveHigh)
+            {
+                high = n;
+                haveHigh = true;
+                return;
+            }
+            haveHigh = false;
+            execute(static_cast<uint8_t>((high << 4) | n), rs);
+        }
+
+        void execute(uint8_t value, bool rs)
+        {
+            bool slow = !rs && (value == 0x01 || (value & 0xFE) == 0x02);
+            busyUntilNs = nowNs() + (slow ? 1520000u : 37000u);
+
+            if (rs)
+            {
+                ddram[address & 0x7F] = static_cast<char>(value);
+                address = static_cast<uint8_t>((address + 1) & 0x7F);
+                dumpLcd(false);
+                return;
+            }
+            if (value & 0x80)                       // set DDRAM address
+            {
+                address = value & 0x7F;
+            }
+            else if (value & 0x40)                  // set CGRAM address (not modelled)
+            {
+            }
+            else if (value & 0x20)                  // function set
+            {
+                fourBit = !(value & 0x10);
+            }
+            else if (value == 0x01)                 // clear display
+            {
+                std::memset(ddram, ' ', sizeof(ddram));
+                address = 0;
+                dumpLcd(false);
+            }
+            else if ((value & 0xFE) == 0x02)        // return home
+            {
+                address = 0;
+            }
+        }
+
+        char    ddram[0x80];
+        uint8_t port     = 0;
+        uint8_t address  = 0;
+        uint8_t high     = 0;
+        bool    haveHigh = false;
+        bool    fourBit  = false;
+        uint64_t busyUntilNs = 0;
+    };
+
+    /* =========================================
+     * Bus registry
+     * =========================================
+     */
+
+    static Mma8451q& accel()
+    {
+        static Mma8451q device;
+        return device;
+    }
+
+    static Pcf8574Lcd& lcdDevice()
+    {
+        static Pcf8574Lcd device;
+        return device;
+    }
+
+    void initI2cDevices()
+    {
+        accel().load();
+    }
+
+    void updateI2cDevices(uint64_t now)
+    {
+        accel().update(now);
+    }
+
+    uint64_t nextI2cDeviceEventNs()
+    {
+        return accel().nextEventNs();
+    }
+
+    I2cDevice* findI2cDevice(uint8_t address)
+    {
+        switch (address)
+        {
+            case Mma8451q::ADDRESS:   return &accel();
+            case Pcf8574Lcd::ADDRESS: return &lcdDevice();
+            default:                  return nullptr;
+        }
+    }
+
+    uint32_t accelSampleIndex()
+    {
+        return accel().sampleIndex();
+    }
+
+    std::string lcdRow(uint8_t row)
+    {
+        return lcdDevice().row(row);
+    }
+
+    void dumpLcd(bool toStderr)
+    {
+        static const char* path = std::getenv("PEDOSIM_LCD");
+        if (path)
+        {
+            if (FILE* f = std::fopen(path, "w"))
+            {
+                std::fprintf(f, "%s\n%s\n", lcdRow(0).c_str(), lcdRow(1).c_str());
+                std::fclose(f);
+            }
+        }
+        if (toStderr)
+        {
+            std::fprintf(stderr, "LCD |%s|\n    |%s|\n", lcdRow(0).c_str(), lcdRow(1).c_str());
+        }
+    }
+}
@@ -0,0 +1,539 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file MKL05Z4.h
+ * @brief Host (Linux) stand-in for the MKL05Z4 device header.
+ *
+ * Only the peripherals, masks and CMSIS functions used by the firmware are
+ * provided. Every register is a sim::Reg proxy: reads and writes go through
+ * hooks installed by the peripheral models in Simulator.cpp/I2cDevices.cpp,
+ * and each access is also a point where pending interrupts are delivered.
+ * This lets src/ compile unchanged as a Linux executable.
+ *
+ * The firmware includes this header inside an extern "C" block, so all C++
+ * content is wrapped in extern "C++".
+ */
+
+#ifndef MKL05Z4_SIM_H
+#define MKL05Z4_SIM_H
+
+#include <stdint.h>
+
+extern "C++" {
+
+namespace sim
+{
+    /**
+     * @brief Delivers pending interrupts; called on every register access.
+     */
+    void service();
+
+    /**
+     * @brief Advances simulated time by the cost of a busy-wait loop on the target.
+     */
+    void delayLoop(uint32_t iterations);
+
+    /**
+     * @class Reg
+     * @brief Memory-mapped register proxy with optional read/write side effects.
+     */
+    template <typename T>
+    class Reg
+    {
+    public:
+        using ReadHook  = T (*)(Reg& reg);
+        using WriteHook = void (*)(Reg& reg, T written);
+
+        T         value   = 0;          /**< Stored register contents. */
+        ReadHook  onRead  = nullptr;    /**< Called instead of a plain read if set. */
+        WriteHook onWrite = nullptr;    /**< Called instead of a plain store if set. */
+
+        /* Operands are taken at their own width, as on the real 32-bit bus */
+        operator T()                 { return read(); }
+        Reg& operator=(const Reg& o) { write(const_cast<Reg&>(o).read()); return *this; }
+        template <typename U> Reg& operator=(U v)  { write(static_cast<T>(v)); return *this; }
+        template <typename U> Reg& operator|=(U v) { write(static_cast<T>(read() | v)); return *this; }
+        template <typename U> Reg& operator&=(U v) { write(static_cast<T>(read() & v)); return *this; }
+        template <typename U> Reg& operator^=(U v) { write(static_cast<T>(read() ^ v)); return *this; }
+
+        T read()
+        {
+            service();
+            return onRead ? onRead(*this) : value;
+        }
+
+        void write(T v)
+        {
+            if (onWrite) { onWrite(*this, v); } else { value = v; }
+            service();
+        }
+    };
+}
+
+/* =========================================
+ * Core / CMSIS
+ * =========================================
+ */
+
+typedef enum IRQn
+{
+    NonMaskableInt_IRQn = -14,
+    HardFault_IRQn      = -13,
+    SVCall_IRQn         = -5,
+    PendSV_IRQn         = -2,
+    SysTick_IRQn        = -1,
+    DMA0_IRQn           = 0,
+    DMA1_IRQn           = 1,
+    DMA2_IRQn           = 2,
+    DMA3_IRQn           = 3,
+    FTFA_IRQn           = 5,
+    LVD_LVW_IRQn        = 6,
+    LLW_IRQn            = 7,
+    I2C0_IRQn           = 8,
+    SPI0_IRQn           = 10,
+    UART0_IRQn          = 12,
+    ADC0_IRQn           = 15,
+    CMP0_IRQn           = 16,
+    TPM0_IRQn           = 17,
+    TPM1_IRQn           = 18,
+    RTC_IRQn            = 20,
+    RTC_Seconds_IRQn    = 21,
+    PIT_IRQn            = 22,
+    DAC0_IRQn           = 25,
+    TSI0_IRQn           = 26,
+    MCG_IRQn            = 27,
+    LPTMR0_IRQn         = 28,
+    PORTA_IRQn          = 30,
+    PORTB_IRQn          = 31
+} IRQn_Type;
+
+extern uint32_t SystemCoreClock;
+void SystemCoreClockUpdate(void);
+
+/* The firmware's nop loop, charged at its Cortex-M0+ cost instead of the host's */
+#define DELAY(x)  sim::delayLoop((x) * 10000U)
+
+void NVIC_EnableIRQ(IRQn_Type irq);
+void NVIC_DisableIRQ(IRQn_Type irq);
+void NVIC_ClearPendingIRQ(IRQn_Type irq);
+void NVIC_SetPendingIRQ(IRQn_Type irq);
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irq);
+void NVIC_SetPriority(IRQn_Type irq, uint32_t priority);
+
+void __enable_irq(void);
+void __disable_irq(void);
+uint32_t __get_PRIMASK(void);
+void __WFI(void);
+void __NOP(void);
+
+/* =========================================
+ * SIM - System Integration Module
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> SOPT1;
+    sim::Reg<uint32_t> SOPT2;
+    sim::Reg<uint32_t> SOPT4;
+    sim::Reg<uint32_t> SOPT5;
+    sim::Reg<uint32_t> SOPT7;
+    sim::Reg<uint32_t> SDID;
+    sim::Reg<uint32_t> SCGC4;
+    sim::Reg<uint32_t> SCGC5;
+    sim::Reg<uint32_t> SCGC6;
+    sim::Reg<uint32_t> SCGC7;
+    sim::Reg<uint32_t> CLKDIV1;
+    sim::Reg<uint32_t> FCFG1;
+    sim::Reg<uint32_t> FCFG2;
+    sim::Reg<uint32_t> COPC;
+    sim::Reg<uint32_t> SRVCOP;
+} SIM_Type;
+
+#define SIM_CLKDIV1_OUTDIV4_MASK  0x70000u
+#define SIM_CLKDIV1_OUTDIV4_SHIFT 16
+#define SIM_CLKDIV1_OUTDIV4(x)    (((uint32_t)(x) << SIM_CLKDIV1_OUTDIV4_SHIFT) & SIM_CLKDIV1_OUTDIV4_MASK)
+#define SIM_SOPT2_UART0SRC_MASK  0xC000000u
+#define SIM_SOPT2_UART0SRC(x)    (((uint32_t)(x) << 26) & SIM_SOPT2_UART0SRC_MASK)
+#define SIM_SCGC4_I2C0_MASK      0x40u
+#define SIM_SCGC4_UART0_MASK     0x400u
+#define SIM_SCGC5_LPTMR_MASK     0x1u
+#define SIM_SCGC5_PORTA_MASK     0x200u
+#define SIM_SCGC5_PORTB_MASK     0x400u
+#define SIM_SCGC6_DMAMUX_MASK    0x2u
+#define SIM_SCGC6_PIT_MASK       0x800000u
+#define SIM_SCGC7_DMA_MASK       0x100u
+
+/* =========================================
+ * SysTick
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> CTRL;
+    sim::Reg<uint32_t> LOAD;
+    sim::Reg<uint32_t> VAL;
+    sim::Reg<uint32_t> CALIB;
+} SysTick_Type;
+
+#define SysTick_CTRL_ENABLE_Msk     0x1u
+#define SysTick_CTRL_TICKINT_Msk    0x2u
+#define SysTick_CTRL_CLKSOURCE_Msk  0x4u
+#define SysTick_CTRL_COUNTFLAG_Msk  0x10000u
+#define SysTick_LOAD_RELOAD_Msk     0xFFFFFFu
+#define SysTick_VAL_CURRENT_Msk     0xFFFFFFu
+
+/* =========================================
+ * SCB - System Control Block
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> CPUID;
+    sim::Reg<uint32_t> ICSR;
+    sim::Reg<uint32_t> VTOR;
+    sim::Reg<uint32_t> AIRCR;
+    sim::Reg<uint32_t> SCR;
+    sim::Reg<uint32_t> CCR;
+} SCB_Type;
+
+#define SCB_SCR_SLEEPONEXIT_Msk     0x2u
+#define SCB_SCR_SLEEPDEEP_Msk       0x4u
+
+/* =========================================
+ * SMC - System Mode Controller
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint8_t> PMPROT;
+    sim::Reg<uint8_t> PMCTRL;
+    sim::Reg<uint8_t> STOPCTRL;
+    sim::Reg<uint8_t> PMSTAT;
+} SMC_Type;
+
+#define SMC_PMPROT_AVLLS_MASK    0x2u
+#define SMC_PMPROT_AVLP_MASK     0x20u
+#define SMC_PMCTRL_STOPM_MASK    0x7u
+#define SMC_PMCTRL_STOPM(x)      (((uint8_t)(x)) & SMC_PMCTRL_STOPM_MASK)
+#define SMC_PMCTRL_STOPA_MASK    0x8u
+#define SMC_PMCTRL_RUNM_MASK     0x60u
+#define SMC_PMSTAT_PMSTAT_MASK   0x7Fu
+
+/* =========================================
+ * LPTMR - Low Power Timer
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> CSR;
+    sim::Reg<uint32_t> PSR;
+    sim::Reg<uint32_t> CMR;
+    sim::Reg<uint32_t> CNR;
+} LPTMR_Type;
+
+#define LPTMR_CSR_TEN_MASK       0x1u
+#define LPTMR_CSR_TMS_MASK       0x2u
+#define LPTMR_CSR_TFC_MASK       0x4u
+#define LPTMR_CSR_TPP_MASK       0x8u
+#define LPTMR_CSR_TIE_MASK       0x40u
+#define LPTMR_CSR_TCF_MASK       0x80u
+#define LPTMR_PSR_PCS_MASK       0x3u
+#define LPTMR_PSR_PCS(x)         (((uint32_t)(x)) & LPTMR_PSR_PCS_MASK)
+#define LPTMR_PSR_PBYP_MASK      0x4u
+#define LPTMR_PSR_PRESCALE_MASK  0x78u
+#define LPTMR_PSR_PRESCALE(x)    (((uint32_t)(x) << 3) & LPTMR_PSR_PRESCALE_MASK)
+#define LPTMR_CNR_COUNTER_MASK   0xFFFFu
+
+/* =========================================
+ * DMA / DMAMUX
+ * =========================================
+ * SAR/DAR hold host pointers (uintptr_t) so firmware can pass buffer addresses.
+ */
+
+typedef struct
+{
+    struct
+    {
+        sim::Reg<uintptr_t> SAR;
+        sim::Reg<uintptr_t> DAR;
+        sim::Reg<uint32_t>  DSR_BCR;
+        sim::Reg<uint32_t>  DCR;
+    } DMA[4];
+} DMA_Type;
+
+typedef struct
+{
+    sim::Reg<uint8_t> CHCFG[4];
+} DMAMUX_Type;
+
+#define DMA_DSR_BCR_BCR_MASK     0xFFFFFFu
+#define DMA_DSR_BCR_BCR(x)       (((uint32_t)(x)) & DMA_DSR_BCR_BCR_MASK)
+#define DMA_DSR_BCR_DONE_MASK    0x1000000u
+#define DMA_DSR_BCR_BSY_MASK     0x2000000u
+#define DMA_DSR_BCR_REQ_MASK     0x4000000u
+#define DMA_DSR_BCR_BED_MASK     0x10000000u
+#define DMA_DSR_BCR_BES_MASK     0x20000000u
+#define DMA_DSR_BCR_CE_MASK      0x40000000u
+#define DMA_DCR_D_REQ_MASK       0x80u
+#define DMA_DCR_START_MASK       0x10000u
+#define DMA_DCR_DSIZE(x)         (((uint32_t)(x) << 17) & 0x60000u)
+#define DMA_DCR_DINC_MASK        0x80000u
+#define DMA_DCR_SSIZE(x)         (((uint32_t)(x) << 20) & 0x300000u)
+#define DMA_DCR_SINC_MASK        0x400000u
+#define DMA_DCR_CS_MASK          0x20000000u
+#define DMA_DCR_ERQ_MASK         0x40000000u
+#define DMA_DCR_EINT_MASK        0x80000000u
+#define DMAMUX_CHCFG_SOURCE_MASK 0x3Fu
+#define DMAMUX_CHCFG_SOURCE(x)   (((uint8_t)(x)) & DMAMUX_CHCFG_SOURCE_MASK)
+#define DMAMUX_CHCFG_ENBL_MASK   0x80u
+
+/* =========================================
+ * PORT - Pin control and interrupts
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> PCR[32];
+    sim::Reg<uint32_t> GPCLR;
+    sim::Reg<uint32_t> GPCHR;
+    sim::Reg<uint32_t> ISFR;
+} PORT_Type;
+
+#define PORT_PCR_PS_MASK         0x1u
+#define PORT_PCR_PE_MASK         0x2u
+#define PORT_PCR_MUX_MASK        0x700u
+#define PORT_PCR_MUX(x)          (((uint32_t)(x) << 8) & PORT_PCR_MUX_MASK)
+#define PORT_PCR_IRQC_MASK       0xF0000u
+#define PORT_PCR_IRQC(x)         (((uint32_t)(x) << 16) & PORT_PCR_IRQC_MASK)
+#define PORT_PCR_ISF_MASK        0x1000000u
+
+/* =========================================
+ * GPIO
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> PDOR;
+    sim::Reg<uint32_t> PSOR;
+    sim::Reg<uint32_t> PCOR;
+    sim::Reg<uint32_t> PTOR;
+    sim::Reg<uint32_t> PDIR;
+    sim::Reg<uint32_t> PDDR;
+} GPIO_Type;
+
+/* =========================================
+ * I2C
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint8_t> A1;
+    sim::Reg<uint8_t> F;
+    sim::Reg<uint8_t> C1;
+    sim::Reg<uint8_t> S;
+    sim::Reg<uint8_t> D;
+    sim::Reg<uint8_t> C2;
+    sim::Reg<uint8_t> FLT;
+    sim::Reg<uint8_t> RA;
+    sim::Reg<uint8_t> SMB;
+    sim::Reg<uint8_t> A2;
+    sim::Reg<uint8_t> SLTH;
+    sim::Reg<uint8_t> SLTL;
+} I2C_Type;
+
+#define I2C_C1_DMAEN_MASK        0x1u
+#define I2C_C1_WUEN_MASK         0x2u
+#define I2C_C1_RSTA_MASK         0x4u
+#define I2C_C1_TXAK_MASK         0x8u
+#define I2C_C1_TX_MASK           0x10u
+#define I2C_C1_MST_MASK          0x20u
+#define I2C_C1_IICIE_MASK        0x40u
+#define I2C_C1_IICEN_MASK        0x80u
+#define I2C_S_RXAK_MASK          0x1u
+#define I2C_S_IICIF_MASK         0x2u
+#define I2C_S_SRW_MASK           0x4u
+#define I2C_S_RAM_MASK           0x8u
+#define I2C_S_ARBL_MASK          0x10u
+#define I2C_S_BUSY_MASK          0x20u
+#define I2C_S_IAAS_MASK          0x40u
+#define I2C_S_TCF_MASK           0x80u
+#define I2C_F_ICR_MASK           0x3Fu
+#define I2C_F_ICR(x)             (((uint8_t)(x)) & I2C_F_ICR_MASK)
+#define I2C_F_MULT_MASK          0xC0u
+#define I2C_F_MULT(x)            (((uint8_t)((uint8_t)(x) << 6)) & I2C_F_MULT_MASK)
+
+/* =========================================
+ * UART0 (LPSCI)
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint8_t> BDH;
+    sim::Reg<uint8_t> BDL;
+    sim::Reg<uint8_t> C1;
+    sim::Reg<uint8_t> C2;
+    sim::Reg<uint8_t> S1;
+    sim::Reg<uint8_t> S2;
+    sim::Reg<uint8_t> C3;
+    sim::Reg<uint8_t> D;
+    sim::Reg<uint8_t> MA1;
+    sim::Reg<uint8_t> MA2;
+    sim::Reg<uint8_t> C4;
+    sim::Reg<uint8_t> C5;
+} UART0_Type;
+
+#define UART0_BDH_SBR_MASK       0x1Fu
+#define UART0_BDH_SBR(x)         (((uint8_t)(x)) & UART0_BDH_SBR_MASK)
+#define UART0_BDL_SBR_MASK       0xFFu
+#define UART0_BDL_SBR(x)         (((uint8_t)(x)) & UART0_BDL_SBR_MASK)
+#define UART0_C2_SBK_MASK        0x1u
+#define UART0_C2_RWU_MASK        0x2u
+#define UART0_C2_RE_MASK         0x4u
+#define UART0_C2_TE_MASK         0x8u
+#define UART0_C2_ILIE_MASK       0x10u
+#define UART0_C2_RIE_MASK        0x20u
+#define UART0_C2_TCIE_MASK       0x40u
+#define UART0_C2_TIE_MASK        0x80u
+#define UART0_S1_PF_MASK         0x1u
+#define UART0_S1_FE_MASK         0x2u
+#define UART0_S1_NF_MASK         0x4u
+#define UART0_S1_OR_MASK         0x8u
+#define UART0_S1_IDLE_MASK       0x10u
+#define UART0_S1_RDRF_MASK       0x20u
+#define UART0_S1_TC_MASK         0x40u
+#define UART0_S1_TDRE_MASK       0x80u
+#define UART0_C4_OSR_MASK        0x1Fu
+#define UART0_C4_OSR(x)          (((uint8_t)(x)) & UART0_C4_OSR_MASK)
+#define UART0_C5_RESYNCDIS_MASK  0x1u
+#define UART0_C5_BOTHEDGE_MASK   0x2u
+#define UART0_C5_RDMAE_MASK      0x20u
+#define UART0_C5_TDMAE_MASK      0x80u
+
+/* =========================================
+ * PIT - Periodic Interrupt Timer
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint32_t> MCR;
+    sim::Reg<uint32_t> LTMR64H;
+    sim::Reg<uint32_t> LTMR64L;
+    struct
+    {
+        sim::Reg<uint32_t> LDVAL;
+        sim::Reg<uint32_t> CVAL;
+        sim::Reg<uint32_t> TCTRL;
+        sim::Reg<uint32_t> TFLG;
+    } CHANNEL[2];
+} PIT_Type;
+
+#define PIT_MCR_FRZ_MASK         0x1u
+#define PIT_MCR_MDIS_MASK        0x2u
+#define PIT_TCTRL_TEN_MASK       0x1u
+#define PIT_TCTRL_TIE_MASK       0x2u
+#define PIT_TCTRL_CHN_MASK       0x4u
+#define PIT_TFLG_TIF_MASK        0x1u
+
+/* =========================================
+ * FTFA - Flash Memory Module
+ * =========================================
+ */
+
+typedef struct
+{
+    sim::Reg<uint8_t> FSTAT;
+    sim::Reg<uint8_t> FCNFG;
+    sim::Reg<uint8_t> FSEC;
+    sim::Reg<uint8_t> FOPT;
+    sim::Reg<uint8_t> FCCOB3;
+    sim::Reg<uint8_t> FCCOB2;
+    sim::Reg<uint8_t> FCCOB1;
+    sim::Reg<uint8_t> FCCOB0;
+    sim::Reg<uint8_t> FCCOB7;
+    sim::Reg<uint8_t> FCCOB6;
+    sim::Reg<uint8_t> FCCOB5;
+    sim::Reg<uint8_t> FCCOB4;
+    sim::Reg<uint8_t> FCCOBB;
+    sim::Reg<uint8_t> FCCOBA;
+    sim::Reg<uint8_t> FCCOB9;
+    sim::Reg<uint8_t> FCCOB8;
+    sim::Reg<uint8_t> FPROT3;
+    sim::Reg<uint8_t> FPROT2;
+    sim::Reg<uint8_t> FPROT1;
+    sim::Reg<uint8_t> FPROT0;
+} FTFA_Type;
+
+#define FTFA_FSTAT_MGSTAT0_MASK  0x1u
+#define FTFA_FSTAT_FPVIOL_MASK   0x10u
+#define FTFA_FSTAT_ACCERR_MASK   0x20u
+#define FTFA_FSTAT_RDCOLERR_MASK 0x40u
+#define FTFA_FSTAT_CCIF_MASK     0x80u
+
+namespace sim
+{
+    /**
+     * @brief Byte of the simulated flash array at @p address (mapped at 0 on the target).
+     */
+    uint8_t* flashMemory(uint32_t address);
+}
+
+/* Flash reads go to the FTFA model's array instead of address 0 */
+#define FLASH_MEMORY(address)  (sim::flashMemory(address))
+#define FLASH_IMAGE_END        0u   // no linked image in the flash model
+
+/* =========================================
+ * Peripheral instances
+ * =========================================
+ */
+
+namespace sim
+{
+    extern SIM_Type   simModule;
+    extern PORT_Type  portA;
+    extern PORT_Type  portB;
+    extern GPIO_Type  gpioA;
+    extern GPIO_Type  gpioB;
+    extern I2C_Type   i2c0;
+    extern UART0_Type uart0;
+    extern PIT_Type   pit;
+    extern SysTick_Type sysTick;
+    extern DMA_Type     dma0;
+    extern DMAMUX_Type  dmamux0;
+    extern SCB_Type     scb;
+    extern SMC_Type     smc;
+    extern LPTMR_Type   lptmr0;
+    extern FTFA_Type    ftfa;
+}
+
+#define SIM    (&sim::simModule)
+#define PORTA  (&sim::portA)
+#define PORTB  (&sim::portB)
+#define PTA    (&sim::gpioA)
+#define PTB    (&sim::gpioB)
+#define I2C0   (&sim::i2c0)
+#define UART0  (&sim::uart0)
+#define PIT    (&sim::pit)
+#define SysTick (&sim::sysTick)
+#define DMA0    (&sim::dma0)
+#define DMAMUX0 (&sim::dmamux0)
+#define SCB     (&sim::scb)
+#define SMC     (&sim::smc)
+#define LPTMR0  (&sim::lptmr0)
+#define FTFA    (&sim::ftfa)
+
+} // extern "C++"
+
+#endif // MKL05Z4_SIM_H
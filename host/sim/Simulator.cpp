@@ -0,0 +1,1465 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Simulator.cpp
+ * @brief Core of the simulated FRDM-KL05Z: NVIC, SysTick, PORT, GPIO, I2C0 master (byte-timed),
+ *        UART0, PIT, LPTMR0, the FTFA flash controller, the DMA channels serving the
+ *        UART0 transmitter and the WAIT/VLPS sleep modes.
+ *
+ * Interrupts are level-evaluated and delivered synchronously from sim::service(),
+ * which runs on every register access. Handlers never nest, matching the single
+ * priority level used by the firmware.
+ */
+
+#include "MKL05Z4.h"
+#include "Simulator.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+/* Weak vector table - the firmware overrides the handlers it implements */
+extern "C" void PORTA_IRQHandler(void) __attribute__((weak));
+extern "C" void UART0_IRQHandler(void) __attribute__((weak));
+extern "C" void I2C0_IRQHandler(void)  __attribute__((weak));
+extern "C" void PIT_IRQHandler(void)   __attribute__((weak));
+extern "C" void DMA0_IRQHandler(void)  __attribute__((weak));
+extern "C" void DMA1_IRQHandler(void)  __attribute__((weak));
+extern "C" void DMA2_IRQHandler(void)  __attribute__((weak));
+extern "C" void DMA3_IRQHandler(void)  __attribute__((weak));
+extern "C" void SysTick_Handler(void)  __attribute__((weak));
+extern "C" void LPTMR0_IRQHandler(void) __attribute__((weak));
+
+uint32_t SystemCoreClock = 47972352u;   // CLOCK_SETUP 1: FEE, 32.768 kHz * 1464
+
+namespace sim
+{
+    SIM_Type   simModule;
+    PORT_Type  portA;
+    PORT_Type  portB;
+    GPIO_Type  gpioA;
+    GPIO_Type  gpioB;
+    I2C_Type   i2c0;
+    UART0_Type uart0;
+    PIT_Type   pit;
+    SysTick_Type sysTick;
+    DMA_Type     dma0;
+    DMAMUX_Type  dmamux0;
+    SCB_Type     scb;
+    SMC_Type     smc;
+    LPTMR_Type   lptmr0;
+    FTFA_Type    ftfa;
+
+    constexpr uint8_t BUTTON_PIN_POS = 11;
+    constexpr uint8_t DMA_SOURCE_UART0_TX = 3;
+
+    using Handler = void (*)(void);
+
+    static BusStats g_stats = {};
+
+    /* ---- NVIC ---- */
+    static uint32_t g_nvicEnabled = 0;
+    static uint32_t g_nvicPending = 0;
+    static bool     g_primask     = false;
+    static bool     g_inHandler   = false;
+
+    /* ---- UART0 ---- */
+    static int               g_uartRxFd = -1;
+    static int               g_uartTxFd = -1;
+    static std::deque<char>  g_uartRx;
+    static bool              g_uartRxFull = false;
+    static uint8_t           g_uartRxData = 0;
+    static bool              g_uartTxFull = false;  // byte waiting in the transmit data buffer
+    static uint8_t           g_uartTxData = 0;
+    static uint64_t          g_uartShiftEndNs = 0;  // end of the frame in the shift register
+
+    /* ---- End of the scripted run ---- */
+    static bool     g_finishing = false;
+    static uint64_t g_finishDeadlineNs = 0;
+
+    /* ---- I2C0 ---- */
+    enum class I2cState : uint8_t { Idle, Address, Transmit, Receive };
+    static I2cState   g_i2cState    = I2cState::Idle;
+    static I2cDevice* g_i2cDevice   = nullptr;
+    static uint8_t    g_i2cAddress  = 0;
+    static bool       g_i2cRxFlight = false;
+    static uint8_t    g_i2cRxData   = 0;
+    static bool       g_i2cBusy     = false;   // a byte is being shifted
+    static bool       g_i2cAck      = false;   // its acknowledge bit
+    static uint64_t   g_i2cByteEndNs = 0;
+
+    /* ---- PIT ---- */
+    struct PitChannelState
+    {
+        bool     running;
+        uint64_t reloadNs;      /**< Time of the last reload (start or expiry). */
+        uint64_t periodNs;      /**< (LDVAL + 1) bus clock cycles. */
+    };
+    static PitChannelState g_pit[2] = {};
+
+    /* ---- LPTMR0 ---- */
+    static uint64_t g_lptmrStartNs     = 0;   // time the counter was enabled
+    static uint64_t g_lptmrNextCompare = 0;   // tick count of the next TCF
+
+    /* ---- Simulated time ---- */
+    static bool     g_fast   = false;
+    static uint64_t g_warpNs = 0;
+
+    /* ---- Host signals ---- */
+    static volatile sig_atomic_t g_buttonRequest = 0;
+    static volatile sig_atomic_t g_lcdDumpRequest = 0;
+    static bool                  g_buttonWhenIdle = false;
+
+    /* ---- PORTA inputs (pulled up) ---- */
+    static uint32_t g_portAInput = 0xFFFFFFFFu;
+    static void updatePortLevels();
+
+    static Handler vectorFor(int irq)
+    {
+        switch (irq)
+        {
+            case I2C0_IRQn:  return I2C0_IRQHandler;
+            case UART0_IRQn: return UART0_IRQHandler;
+            case PIT_IRQn:   return PIT_IRQHandler;
+            case PORTA_IRQn: return PORTA_IRQHandler;
+            case LPTMR0_IRQn: return LPTMR0_IRQHandler;
+            case DMA0_IRQn:  return DMA0_IRQHandler;
+            case DMA1_IRQn:  return DMA1_IRQHandler;
+            case DMA2_IRQn:  return DMA2_IRQHandler;
+            case DMA3_IRQn:  return DMA3_IRQHandler;
+            default:         return nullptr;
+        }
+    }
+
+    uint64_t nowNs()
+    {
+        auto t = std::chrono::steady_clock::now().time_since_epoch();
+        return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(t).count())
+             + g_warpNs;
+    }
+
+    static uint32_t busClockHz()
+    {
+        uint32_t outdiv4 = (simModule.CLKDIV1.value & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT;
+        return SystemCoreClock / (outdiv4 + 1u);
+    }
+
+    /**
+     * @brief Duration of one 8N1 UART0 frame [ns] from SBR and OSR (UART0 clock = MCGFLLCLK).
+     */
+    static uint64_t uartFrameNs()
+    {
+        uint32_t sbr = ((uart0.BDH.value & UART0_BDH_SBR_MASK) << 8) | uart0.BDL.value;
+        uint32_t osr = (uart0.C4.value & UART0_C4_OSR_MASK) + 1u;
+        if (sbr == 0 || osr < 4)
+        {
+            return 0;
+        }
+        return 10ull * 1000000000ull * osr * sbr / SystemCoreClock;
+    }
+
+    static void uartEmit(uint8_t v)
+    {
+        // A full pty (nobody listening) drops the byte, like an unconnected line
+        if (g_uartTxFd >= 0 && ::write(g_uartTxFd, &v, 1) == 1)
+        {
+            ++g_stats.uartTxBytes;
+        }
+    }
+
+    /**
+     * @brief Moves the buffered byte into the shift register once the previous frame is out.
+     */
+    static void updateUartTx()
+    {
+        if (g_uartTxFull && nowNs() >= g_uartShiftEndNs)
+        {
+            g_uartTxFull = false;
+            g_uartShiftEndNs += uartFrameNs();
+            uartEmit(g_uartTxData);
+        }
+    }
+
+    /**
+     * @brief Duration of one I2C byte with its acknowledge bit [ns], from MULT and ICR of I2C0->F.
+     */
+    static uint64_t i2cByteNs()
+    {
+        static const uint16_t sclDivider[64] = {
+              20,   22,   24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
+              48,   56,   64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
+             160,  192,  224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
+             640,  768,  896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840 };
+        uint8_t  f    = i2c0.F.value;
+        uint32_t mult = 1u << ((f & I2C_F_MULT_MASK) >> 6);
+        uint64_t div  = static_cast<uint64_t>(mult) * sclDivider[f & I2C_F_ICR_MASK];
+        return 9ull * 1000000000ull * div / busClockHz();
+    }
+
+    /**
+     * @brief Raises IICIF once the byte on the bus has been shifted.
+     */
+    static void updateI2cBus()
+    {
+        if (g_i2cBusy && nowNs() >= g_i2cByteEndNs)
+        {
+            g_i2cBusy = false;
+            i2c0.S.value |= I2C_S_IICIF_MASK | I2C_S_TCF_MASK;
+            if (g_i2cAck) { i2c0.S.value &= ~I2C_S_RXAK_MASK; }
+            else          { i2c0.S.value |=  I2C_S_RXAK_MASK; }
+        }
+    }
+
+    static bool uartTdre() { return !g_uartTxFull; }
+    static bool uartTc()   { return !g_uartTxFull && nowNs() >= g_uartShiftEndNs; }
+
+    static bool pitEnabled()
+    {
+        return (simModule.SCGC6.value & SIM_SCGC6_PIT_MASK) && !(pit.MCR.value & PIT_MCR_MDIS_MASK);
+    }
+
+    /* =========================================
+     * SysTick (24-bit down counter on the core clock)
+     * =========================================
+     */
+
+    static uint64_t g_sysTickStartNs = 0;   // time VAL was last cleared
+    static uint64_t g_sysTickWraps   = 0;   // reloads already reported (COUNTFLAG / interrupt)
+
+    static bool sysTickEnabled()
+    {
+        return (sysTick.CTRL.value & SysTick_CTRL_ENABLE_Msk) != 0;
+    }
+
+    static uint64_t sysTickClockHz()
+    {
+        // CLKSOURCE = 0 selects the external reference, core clock / 16 on the KL05Z
+        return (sysTick.CTRL.value & SysTick_CTRL_CLKSOURCE_Msk) ? SystemCoreClock : SystemCoreClock / 16u;
+    }
+
+    static uint64_t sysTickElapsed()
+    {
+        return (nowNs() - g_sysTickStartNs) * sysTickClockHz() / 1000000000ull;
+    }
+
+    static uint64_t sysTickPeriod()
+    {
+        return (sysTick.LOAD.value & SysTick_LOAD_RELOAD_Msk) + 1u;
+    }
+
+    static uint32_t readSysTickVal(Reg<uint32_t>& reg)
+    {
+        if (!sysTickEnabled())
+        {
+            return reg.value;
+        }
+        uint64_t elapsed = sysTickElapsed();
+        if (elapsed == 0)
+        {
+            return reg.value;
+        }
+        // VAL reloads from LOAD on the first tick after being cleared
+        return static_cast<uint32_t>(sysTick.LOAD.value - ((elapsed - 1) % sysTickPeriod()));
+    }
+
+    static void writeSysTickVal(Reg<uint32_t>& reg, uint32_t)
+    {
+        reg.value = 0;
+        g_sysTickStartNs = nowNs();
+        g_sysTickWraps   = 0;
+    }
+
+    static uint32_t readSysTickCtrl(Reg<uint32_t>& reg)
+    {
+        uint32_t ctrl = reg.value & ~SysTick_CTRL_COUNTFLAG_Msk;
+        if (sysTickEnabled())
+        {
+            uint64_t wraps = sysTickElapsed() / sysTickPeriod();
+            if (wraps > g_sysTickWraps)
+            {
+                ctrl |= SysTick_CTRL_COUNTFLAG_Msk;
+                g_sysTickWraps = wraps;
+            }
+        }
+        return ctrl;
+    }
+
+    static void writeSysTickCtrl(Reg<uint32_t>& reg, uint32_t v)
+    {
+        if ((v & SysTick_CTRL_ENABLE_Msk) && !sysTickEnabled())
+        {
+            g_sysTickStartNs = nowNs();
+            g_sysTickWraps   = 0;
+        }
+        reg.value = v & ~SysTick_CTRL_COUNTFLAG_Msk;
+    }
+
+    /**
+     * @brief Returns true once per SysTick reload that has not been delivered yet.
+     */
+    static bool sysTickInterrupt()
+    {
+        if (!sysTickEnabled() || !(sysTick.CTRL.value & SysTick_CTRL_TICKINT_Msk))
+        {
+            return false;
+        }
+        uint64_t wraps = sysTickElapsed() / sysTickPeriod();
+        if (wraps > g_sysTickWraps)
+        {
+            g_sysTickWraps = wraps;
+            return true;
+        }
+        return false;
+    }
+
+    static uint64_t nextSysTickEventNs()
+    {
+        if (!sysTickEnabled() || !(sysTick.CTRL.value & SysTick_CTRL_TICKINT_Msk))
+        {
+            return UINT64_MAX;
+        }
+        uint64_t ticks = (g_sysTickWraps + 1) * sysTickPeriod();
+        return g_sysTickStartNs + (ticks * 1000000000ull + sysTickClockHz() - 1) / sysTickClockHz();
+    }
+
+    /* =========================================
+     * DMA channels (UART0 transmit requests only)
+     * =========================================
+     */
+
+    static void writeUartD(Reg<uint8_t>& reg, uint8_t v);
+
+    static bool uartTxDmaRequest()
+    {
+        return (uart0.C5.value & UART0_C5_TDMAE_MASK) && (uart0.C2.value & UART0_C2_TIE_MASK) && uartTdre();
+    }
+
+    static void writeDmaDsrBcr(Reg<uint32_t>& reg, uint32_t v)
+    {
+        if (v & DMA_DSR_BCR_DONE_MASK)
+        {
+            // Writing DONE clears all status flags
+            reg.value &= DMA_DSR_BCR_BCR_MASK;
+        }
+        else
+        {
+            reg.value = (reg.value & ~DMA_DSR_BCR_BCR_MASK) | (v & DMA_DSR_BCR_BCR_MASK);
+        }
+    }
+
+    static void updateDma()
+    {
+        for (uint8_t ch = 0; ch < 4; ++ch)
+        {
+            auto& channel = dma0.DMA[ch];
+            uint8_t chcfg = dmamux0.CHCFG[ch].value;
+            if (!(chcfg & DMAMUX_CHCFG_ENBL_MASK) || (chcfg & DMAMUX_CHCFG_SOURCE_MASK) != DMA_SOURCE_UART0_TX)
+            {
+                continue;
+            }
+            while ((channel.DCR.value & DMA_DCR_ERQ_MASK) && (channel.DSR_BCR.value & DMA_DSR_BCR_BCR_MASK)
+                   && uartTxDmaRequest())
+            {
+                // 8-bit transfers into UART0->D, one per TDRE request
+                uint8_t byte = *reinterpret_cast<const uint8_t*>(channel.SAR.value);
+                writeUartD(uart0.D, byte);
+                if (channel.DCR.value & DMA_DCR_SINC_MASK)
+                {
+                    channel.SAR.value += 1;
+                }
+                channel.DSR_BCR.value -= 1;
+                if ((channel.DSR_BCR.value & DMA_DSR_BCR_BCR_MASK) == 0)
+                {
+                    channel.DSR_BCR.value |= DMA_DSR_BCR_DONE_MASK;
+                    if (channel.DCR.value & DMA_DCR_D_REQ_MASK)
+                    {
+                        channel.DCR.value &= ~DMA_DCR_ERQ_MASK;
+                    }
+                }
+            }
+        }
+    }
+
+    static void updatePit()
+    {
+        if (!pitEnabled())
+        {
+            return;
+        }
+        uint64_t now = nowNs();
+        for (uint8_t ch = 0; ch < 2; ++ch)
+        {
+            PitChannelState& st = g_pit[ch];
+            while (st.running && now >= st.reloadNs + st.periodNs)
+            {
+                st.reloadNs += st.periodNs;
+                pit.CHANNEL[ch].TFLG.value |= PIT_TFLG_TIF_MASK;
+            }
+        }
+    }
+
+    /* =========================================
+     * LPTMR0 (16-bit counter on the 1 kHz LPO, runs in every power mode)
+     * =========================================
+     */
+
+    static bool lptmrEnabled()
+    {
+        return (simModule.SCGC5.value & SIM_SCGC5_LPTMR_MASK) && (lptmr0.CSR.value & LPTMR_CSR_TEN_MASK);
+    }
+
+    /**
+     * @brief Counter tick [ns]: the LPO (PCS = 1), divided by 2^(PRESCALE + 1) unless bypassed.
+     */
+    static uint64_t lptmrTickNs()
+    {
+        uint32_t psr = lptmr0.PSR.value;
+        uint64_t ns  = 1000000u;
+        if (!(psr & LPTMR_PSR_PBYP_MASK))
+        {
+            ns <<= ((psr & LPTMR_PSR_PRESCALE_MASK) >> 3) + 1u;
+        }
+        return ns;
+    }
+
+    static uint64_t lptmrTicks()
+    {
+        return (nowNs() - g_lptmrStartNs) / lptmrTickNs();
+    }
+
+    /**
+     * @brief Ticks between compare matches: the 16-bit wrap when free running (TFC), else CMR + 1.
+     */
+    static uint64_t lptmrPeriod()
+    {
+        return (lptmr0.CSR.value & LPTMR_CSR_TFC_MASK) ? 0x10000u : (lptmr0.CMR.value & 0xFFFFu) + 1u;
+    }
+
+    static void updateLptmr()
+    {
+        if (lptmrEnabled() && lptmrTicks() >= g_lptmrNextCompare)
+        {
+            lptmr0.CSR.value |= LPTMR_CSR_TCF_MASK;
+            g_lptmrNextCompare += lptmrPeriod() * ((lptmrTicks() - g_lptmrNextCompare) / lptmrPeriod() + 1u);
+        }
+    }
+
+    static void writeLptmrCsr(Reg<uint32_t>& reg, uint32_t v)
+    {
+        bool wasEnabled = reg.value & LPTMR_CSR_TEN_MASK;
+        uint32_t flags = reg.value & LPTMR_CSR_TCF_MASK;
+        if (v & LPTMR_CSR_TCF_MASK)
+        {
+            flags = 0;   // write 1 to clear
+        }
+        if (!(v & LPTMR_CSR_TEN_MASK))
+        {
+            flags = 0;   // disabling resets the counter and the flag
+        }
+        reg.value = (v & ~LPTMR_CSR_TCF_MASK) | flags;
+        if ((v & LPTMR_CSR_TEN_MASK) && !wasEnabled)
+        {
+            uint32_t cmr = lptmr0.CMR.value & 0xFFFFu;
+            g_lptmrStartNs     = nowNs();
+            g_lptmrNextCompare = cmr + 1u;   // TCF when CNR equals CMR and increments
+        }
+    }
+
+    static void writeLptmrCnr(Reg<uint32_t>& reg, uint32_t)
+    {
+        // Any write latches the counter so that it can be read
+        if (!lptmrEnabled())
+        {
+            reg.value = 0;
+            return;
+        }
+        uint64_t ticks = lptmrTicks();
+        reg.value = static_cast<uint32_t>((lptmr0.CSR.value & LPTMR_CSR_TFC_MASK) ? ticks & 0xFFFFu
+                                                                                   : ticks % lptmrPeriod());
+    }
+
+    /* =========================================
+     * FTFA (32 KB program flash, longword program and sector erase)
+     * =========================================
+     */
+
+    constexpr uint32_t FLASH_SIZE        = 32768;
+    constexpr uint32_t FLASH_SECTOR_SIZE = 1024;
+    constexpr uint64_t FLASH_PROGRAM_NS  = 65000;      // typical tpgm4
+    constexpr uint64_t FLASH_ERASE_NS    = 14000000;   // typical tersscr
+
+    alignas(4) static uint8_t g_flash[FLASH_SIZE];
+    static FlashStats g_flashStats = {};
+    static int        g_flashFd    = -1;      // PEDOSIM_FLASH backing file
+    static uint32_t   g_flashCutIn = 0;       // commands until the power loss, 0 = not armed
+    static uint16_t   g_flashCutPermille = 0;
+    static bool       g_flashLost  = false;
+    static uint32_t   g_flashNoise = 1;       // bits that flip before the power loss
+
+    uint8_t* flashMemory(uint32_t address)
+    {
+        return &g_flash[address % FLASH_SIZE];
+    }
+
+    /**
+     * @brief Moves the bytes at @p address towards @p target (programs only clear bits, erases only set them).
+     *
+     * A command cut by a power loss changes each of its bits with probability g_flashCutPermille / 1000.
+     */
+    static void flashApply(uint32_t address, const uint8_t* target, uint32_t size, bool cut)
+    {
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            uint8_t& cell = g_flash[address + i];
+            uint8_t  diff = cell ^ target[i];
+            if (cut)
+            {
+                for (uint8_t bit = 0; bit < 8; ++bit)
+                {
+                    g_flashNoise = g_flashNoise * 1103515245u + 12345u;
+                    if ((g_flashNoise >> 16) % 1000u >= g_flashCutPermille)
+                    {
+                        diff = static_cast<uint8_t>(diff & ~(1u << bit));
+                    }
+                }
+            }
+            cell ^= diff;
+        }
+        if (g_flashFd >= 0 && ::pwrite(g_flashFd, &g_flash[address], size, address) != static_cast<ssize_t>(size))
+        {
+            std::perror("pedometer_sim: flash file");
+        }
+    }
+
+    static void flashCommand()
+    {
+        uint8_t  command = ftfa.FCCOB0.value;
+        uint32_t address = (static_cast<uint32_t>(ftfa.FCCOB1.value) << 16)
+                         | (static_cast<uint32_t>(ftfa.FCCOB2.value) << 8) | ftfa.FCCOB3.value;
+
+        bool cut = false;
+        if (g_flashCutIn != 0 && --g_flashCutIn == 0)
+        {
+            cut = true;
+        }
+        if (g_flashLost)
+        {
+            return;   // no supply: the command never happened
+        }
+
+        if (command == 0x06 && address % 4u == 0 && address < FLASH_SIZE)
+        {
+            // Program longword: FCCOB4 is the byte at the highest address, bits can only be cleared
+            const uint8_t data[4] = { ftfa.FCCOB7.value, ftfa.FCCOB6.value, ftfa.FCCOB5.value, ftfa.FCCOB4.value };
+            uint8_t target[4];
+            for (uint8_t i = 0; i < 4; ++i)
+            {
+                target[i] = g_flash[address + i] & data[i];
+            }
+            flashApply(address, target, 4, cut);
+            ++g_flashStats.programs;
+            g_flashStats.busyNs += FLASH_PROGRAM_NS;
+            g_warpNs += FLASH_PROGRAM_NS;
+        }
+        else if (command == 0x09 && address < FLASH_SIZE)
+        {
+            uint8_t target[FLASH_SECTOR_SIZE];
+            std::memset(target, 0xFF, sizeof(target));
+            flashApply(address & ~(FLASH_SECTOR_SIZE - 1u), target, FLASH_SECTOR_SIZE, cut);
+            ++g_flashStats.erases;
+            g_flashStats.busyNs += FLASH_ERASE_NS;
+            g_warpNs += FLASH_ERASE_NS;
+        }
+        else
+        {
+            ftfa.FSTAT.value |= FTFA_FSTAT_ACCERR_MASK;
+            ++g_flashStats.errors;
+        }
+        g_flashLost = cut;
+    }
+
+    static void writeFtfaFstat(Reg<uint8_t>& reg, uint8_t v)
+    {
+        // ACCERR and FPVIOL are write-1-to-clear; writing 1 to CCIF launches the loaded command
+        reg.value = static_cast<uint8_t>(reg.value & ~(v & (FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK)));
+        if ((v & FTFA_FSTAT_CCIF_MASK) && (reg.value & FTFA_FSTAT_CCIF_MASK)
+            && !(reg.value & (FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK)))
+        {
+            // The core is stalled (or spinning in RAM) until CCIF returns: complete at once, time advanced
+            flashCommand();
+        }
+    }
+
+    static void openFlash()
+    {
+        std::memset(g_flash, 0xFF, sizeof(g_flash));
+        const char* path = std::getenv("PEDOSIM_FLASH");
+        if (!path)
+        {
+            return;
+        }
+        g_flashFd = ::open(path, O_RDWR | O_CREAT, 0644);
+        if (g_flashFd < 0)
+        {
+            std::perror("pedometer_sim: PEDOSIM_FLASH");
+            return;
+        }
+        // A new or short file reads as erased flash
+        ssize_t n = ::pread(g_flashFd, g_flash, sizeof(g_flash), 0);
+        if (n < static_cast<ssize_t>(sizeof(g_flash)))
+        {
+            std::memset(g_flash + (n > 0 ? n : 0), 0xFF, sizeof(g_flash) - static_cast<size_t>(n > 0 ? n : 0));
+            if (::pwrite(g_flashFd, g_flash, sizeof(g_flash), 0) != static_cast<ssize_t>(sizeof(g_flash)))
+            {
+                std::perror("pedometer_sim: PEDOSIM_FLASH");
+            }
+        }
+    }
+
+    const FlashStats& flashStats()
+    {
+        return g_flashStats;
+    }
+
+    void flashPowerLoss(uint32_t commands, uint16_t permille, uint32_t seed)
+    {
+        g_flashCutIn       = commands;
+        g_flashCutPermille = permille;
+        g_flashNoise       = seed;
+    }
+
+    bool flashPowerLost()
+    {
+        return g_flashLost;
+    }
+
+    void flashPowerOn()
+    {
+        g_flashCutIn = 0;
+        g_flashLost  = false;
+    }
+
+    /* =========================================
+     * Sleep modes
+     * =========================================
+     */
+
+    static uint32_t g_waitEntries = 0;
+    static uint32_t g_vlpsEntries = 0;
+    static uint32_t g_vlpsBusy    = 0;   // VLPS entered while a bus-clocked transfer was running
+    static uint32_t g_vlpsRxLost  = 0;   // UART bytes arriving while the receiver was stopped
+
+    /**
+     * @brief True if the next __WFI enters VLPS (SLEEPDEEP with STOPM = VLPS, allowed by PMPROT).
+     */
+    static bool vlpsRequested()
+    {
+        return (scb.SCR.value & SCB_SCR_SLEEPDEEP_Msk)
+            && (smc.PMCTRL.value & SMC_PMCTRL_STOPM_MASK) == 2u
+            && (smc.PMPROT.value & SMC_PMPROT_AVLP_MASK);
+    }
+
+    static void writeWriteOnce8(Reg<uint8_t>& reg, uint8_t v)
+    {
+        // PMPROT may only be written once after reset
+        static bool written = false;
+        if (!written)
+        {
+            reg.value = v;
+            written = true;
+        }
+    }
+
+    /**
+     * @brief Time of the next timer or device event, or UINT64_MAX if none is armed.
+     * @param stopped In VLPS only the LPTMR and external devices keep running.
+     */
+    static uint64_t nextTimerEventNs(bool stopped = false)
+    {
+        uint64_t next = nextI2cDeviceEventNs();
+        if (lptmrEnabled() && (lptmr0.CSR.value & LPTMR_CSR_TIE_MASK))
+        {
+            next = std::min(next, g_lptmrStartNs + g_lptmrNextCompare * lptmrTickNs());
+        }
+        if (g_finishing)
+        {
+            next = std::min(next, g_finishDeadlineNs);
+        }
+        if (stopped)
+        {
+            return next;
+        }
+        uint8_t c2 = uart0.C2.value;
+        if ((g_uartTxFull && (c2 & UART0_C2_TIE_MASK)) ||
+            (!uartTc() && (c2 & UART0_C2_TCIE_MASK)))
+        {
+            next = std::min(next, g_uartShiftEndNs);
+        }
+        if (g_i2cBusy && (i2c0.C1.value & I2C_C1_IICIE_MASK))
+        {
+            next = std::min(next, g_i2cByteEndNs);
+        }
+        next = std::min(next, nextSysTickEventNs());
+        if (pitEnabled())
+        {
+            for (const PitChannelState& st : g_pit)
+            {
+                if (st.running && st.reloadNs + st.periodNs < next)
+                {
+                    next = st.reloadNs + st.periodNs;
+                }
+            }
+        }
+        return next;
+    }
+
+    /* =========================================
+     * Level-sensitive interrupt sources
+     * =========================================
+     */
+
+    static uint32_t assertedLines()
+    {
+        uint32_t lines = 0;
+
+        uint8_t c2 = uart0.C2.value;
+        if ((g_uartRxFull && (c2 & UART0_C2_RIE_MASK)) ||
+            (uartTdre() && (c2 & UART0_C2_TIE_MASK) && !(uart0.C5.value & UART0_C5_TDMAE_MASK)) ||
+            (uartTc() && (c2 & UART0_C2_TCIE_MASK)))
+        {
+            lines |= 1u << UART0_IRQn;
+        }
+        if ((i2c0.S.value & I2C_S_IICIF_MASK) && (i2c0.C1.value & I2C_C1_IICIE_MASK))
+        {
+            lines |= 1u << I2C0_IRQn;
+        }
+        if (portA.ISFR.value != 0)
+        {
+            lines |= 1u << PORTA_IRQn;
+        }
+        if ((lptmr0.CSR.value & LPTMR_CSR_TCF_MASK) && (lptmr0.CSR.value & LPTMR_CSR_TIE_MASK))
+        {
+            lines |= 1u << LPTMR0_IRQn;
+        }
+        for (uint8_t ch = 0; ch < 4; ++ch)
+        {
+            if ((dma0.DMA[ch].DSR_BCR.value & DMA_DSR_BCR_DONE_MASK) && (dma0.DMA[ch].DCR.value & DMA_DCR_EINT_MASK))
+            {
+                lines |= 1u << (DMA0_IRQn + ch);
+            }
+        }
+        for (uint8_t ch = 0; ch < 2; ++ch)
+        {
+            if ((pit.CHANNEL[ch].TFLG.value & PIT_TFLG_TIF_MASK) &&
+                (pit.CHANNEL[ch].TCTRL.value & PIT_TCTRL_TIE_MASK))
+            {
+                lines |= 1u << PIT_IRQn;
+            }
+        }
+        return lines;
+    }
+
+    static void pollUartInput()
+    {
+        if (g_uartRxFd < 0)
+        {
+            return;
+        }
+        char buf[64];
+        ssize_t n = ::read(g_uartRxFd, buf, sizeof(buf));
+        for (ssize_t i = 0; i < n; ++i)
+        {
+            g_uartRx.push_back(buf[i]);
+        }
+    }
+
+    static void loadUartRx()
+    {
+        if (!g_uartRxFull && !g_uartRx.empty() && (uart0.C2.value & UART0_C2_RE_MASK))
+        {
+            g_uartRxData = static_cast<uint8_t>(g_uartRx.front());
+            g_uartRx.pop_front();
+            g_uartRxFull = true;
+            ++g_stats.uartRxBytes;
+        }
+    }
+
+    void service()
+    {
+        static uint32_t calls = 0;
+        if (g_inHandler)
+        {
+            return;
+        }
+        g_inHandler = true;
+
+        if ((++calls & 0xFFu) == 0 || g_uartRx.empty())
+        {
+            pollUartInput();
+        }
+        loadUartRx();
+        updateUartTx();
+        updateDma();
+        updatePit();
+        updateLptmr();
+        updateI2cBus();
+        updateI2cDevices(nowNs());
+        updatePortLevels();
+
+        if (g_buttonRequest)
+        {
+            g_buttonRequest = 0;
+            pressButton();
+        }
+        if (g_lcdDumpRequest)
+        {
+            g_lcdDumpRequest = 0;
+            dumpLcd(true);
+        }
+
+        while (!g_primask)
+        {
+            if (sysTickInterrupt() && SysTick_Handler)
+            {
+                SysTick_Handler();
+            }
+            g_nvicPending |= assertedLines();
+            uint32_t active = g_nvicPending & g_nvicEnabled;
+            if (active == 0)
+            {
+                break;
+            }
+            int irq = __builtin_ctz(active);
+            g_nvicPending &= ~(1u << irq);
+            if (Handler h = vectorFor(irq))
+            {
+                h();
+            }
+            loadUartRx();
+        }
+
+        g_inHandler = false;
+    }
+
+    void delayLoop(uint32_t iterations)
+    {
+        // nop, add, compare and taken branch: 5 core cycles per iteration on the Cortex-M0+
+        constexpr uint64_t CYCLES_PER_ITERATION = 5;
+        g_warpNs += static_cast<uint64_t>(iterations) * CYCLES_PER_ITERATION * 1000000000ull / SystemCoreClock;
+        service();
+    }
+
+    void finish()
+    {
+        if (!g_finishing)
+        {
+            // Give the firmware time to drain its transmit queue before exiting
+            g_finishing = true;
+            g_finishDeadlineNs = nowNs() + 5000000000ull;
+        }
+    }
+
+    void raiseIrq(int irq)
+    {
+        g_nvicPending |= 1u << irq;
+    }
+
+    void pressButton()
+    {
+        if (portA.PCR[BUTTON_PIN_POS].value & PORT_PCR_IRQC_MASK)
+        {
+            portA.ISFR.value |= 1u << BUTTON_PIN_POS;
+            portA.PCR[BUTTON_PIN_POS].value |= PORT_PCR_ISF_MASK;
+        }
+    }
+
+    static bool pinFlagFor(uint32_t irqc, bool high, bool rising, bool falling)
+    {
+        switch (irqc)
+        {
+            case 0x8: return !high;             // logic zero
+            case 0x9: return rising;
+            case 0xA: return falling;
+            case 0xB: return rising || falling;
+            case 0xC: return high;              // logic one
+            default:  return false;
+        }
+    }
+
+    void setPortAPin(uint8_t pin, bool high)
+    {
+        bool wasHigh = (g_portAInput >> pin) & 1u;
+        if (high) { g_portAInput |=  (1u << pin); }
+        else      { g_portAInput &= ~(1u << pin); }
+
+        uint32_t irqc = (portA.PCR[pin].value & PORT_PCR_IRQC_MASK) >> 16;
+        if (pinFlagFor(irqc, high, high && !wasHigh, !high && wasHigh))
+        {
+            portA.ISFR.value |= 1u << pin;
+            portA.PCR[pin].value |= PORT_PCR_ISF_MASK;
+        }
+    }
+
+    static void updatePortLevels()
+    {
+        // Level-sensitive pins keep re-flagging while the level holds
+        for (uint8_t pin = 0; pin < 32; ++pin)
+        {
+            uint32_t irqc = (portA.PCR[pin].value & PORT_PCR_IRQC_MASK) >> 16;
+            if ((irqc == 0x8 || irqc == 0xC) &&
+                pinFlagFor(irqc, (g_portAInput >> pin) & 1u, false, false))
+            {
+                portA.ISFR.value |= 1u << pin;
+            }
+        }
+    }
+
+    static uint32_t readPortAInput(Reg<uint32_t>&)
+    {
+        return g_portAInput;
+    }
+
+    void pressButtonWhenIdle()
+    {
+        g_buttonWhenIdle = true;
+    }
+
+    void uartInject(const char* text)
+    {
+        while (*text)
+        {
+            g_uartRx.push_back(*text++);
+        }
+    }
+
+    const BusStats& busStats()
+    {
+        return g_stats;
+    }
+
+    void countI2cByte(uint8_t address)
+    {
+        ++g_stats.i2cBytes;
+        if (address == 0x1D) { ++g_stats.accelBytes; }
+        if (address == 0x27 || address == 0x3F) { ++g_stats.lcdBytes; }
+    }
+
+    void countLcdBusyWrite()
+    {
+        ++g_stats.lcdBusyWrites;
+    }
+
+    /* =========================================
+     * Register hooks
+     * =========================================
+     */
+
+    static void writeW1c32(Reg<uint32_t>& reg, uint32_t v)
+    {
+        reg.value &= ~v;
+    }
+
+    static void writePcr(Reg<uint32_t>& reg, uint32_t v)
+    {
+        uint32_t isf = reg.value & PORT_PCR_ISF_MASK & ~v;
+        reg.value = (v & ~PORT_PCR_ISF_MASK) | isf;
+    }
+
+    static void writeGpioSet(Reg<uint32_t>& reg, uint32_t v)
+    {
+        GPIO_Type& gpio = (&reg == &gpioA.PSOR) ? gpioA : gpioB;
+        gpio.PDOR.value |= v;
+    }
+
+    static void writeGpioClear(Reg<uint32_t>& reg, uint32_t v)
+    {
+        GPIO_Type& gpio = (&reg == &gpioA.PCOR) ? gpioA : gpioB;
+        gpio.PDOR.value &= ~v;
+    }
+
+    static void writeGpioToggle(Reg<uint32_t>& reg, uint32_t v)
+    {
+        GPIO_Type& gpio = (&reg == &gpioA.PTOR) ? gpioA : gpioB;
+        gpio.PDOR.value ^= v;
+    }
+
+    static int pitChannelOf(const void* reg)
+    {
+        return (reg >= static_cast<const void*>(&pit.CHANNEL[1])) ? 1 : 0;
+    }
+
+    static void writePitTctrl(Reg<uint32_t>& reg, uint32_t v)
+    {
+        int ch = pitChannelOf(&reg);
+        bool wasRunning = reg.value & PIT_TCTRL_TEN_MASK;
+        reg.value = v;
+        g_pit[ch].running = (v & PIT_TCTRL_TEN_MASK) != 0;
+        if (g_pit[ch].running && !wasRunning)
+        {
+            // (LDVAL + 1) cycles of the bus clock
+            uint64_t cycles = static_cast<uint64_t>(pit.CHANNEL[ch].LDVAL.value) + 1u;
+            g_pit[ch].periodNs = cycles * 1000000000ull / busClockHz();
+            g_pit[ch].reloadNs = nowNs();
+        }
+    }
+
+    static uint32_t readPitCval(Reg<uint32_t>& reg)
+    {
+        int ch = pitChannelOf(&reg);
+        if (!g_pit[ch].running)
+        {
+            return reg.value;
+        }
+        updatePit();
+        uint64_t elapsed = (nowNs() - g_pit[ch].reloadNs) * busClockHz() / 1000000000ull;
+        uint32_t ldval   = pit.CHANNEL[ch].LDVAL.value;
+        return (elapsed > ldval) ? 0u : ldval - static_cast<uint32_t>(elapsed);
+    }
+
+    static uint8_t readUartS1(Reg<uint8_t>&)
+    {
+        updateUartTx();
+        uint8_t s1 = 0;
+        if (uartTdre())
+        {
+            s1 |= UART0_S1_TDRE_MASK;
+        }
+        if (uartTc())
+        {
+            s1 |= UART0_S1_TC_MASK;
+        }
+        if (g_uartRxFull)
+        {
+            s1 |= UART0_S1_RDRF_MASK;
+        }
+        return s1;
+    }
+
+    static uint8_t readUartD(Reg<uint8_t>&)
+    {
+        g_uartRxFull = false;
+        return g_uartRxData;
+    }
+
+    static void writeUartD(Reg<uint8_t>& reg, uint8_t v)
+    {
+        reg.value = v;
+        if (!(uart0.C2.value & UART0_C2_TE_MASK))
+        {
+            return;
+        }
+        updateUartTx();
+        uint64_t now = nowNs();
+        if (now >= g_uartShiftEndNs && !g_uartTxFull)
+        {
+            // Idle transmitter: the byte goes straight to the shift register
+            g_uartShiftEndNs = now + uartFrameNs();
+            uartEmit(v);
+        }
+        else if (!g_uartTxFull)
+        {
+            g_uartTxData = v;
+            g_uartTxFull = true;
+        }
+        // Writing D while TDRE is clear loses the byte, as on the real UART
+    }
+
+    static void i2cStart()
+    {
+        ++g_stats.i2cTransactions;
+        g_i2cState    = I2cState::Address;
+        g_i2cRxFlight = false;
+        i2c0.S.value |= I2C_S_BUSY_MASK;
+    }
+
+    static void i2cStop()
+    {
+        if (g_i2cDevice)
+        {
+            g_i2cDevice->stop();
+        }
+        g_i2cDevice = nullptr;
+        g_i2cState  = I2cState::Idle;
+        i2c0.S.value &= ~I2C_S_BUSY_MASK;
+    }
+
+    static void writeI2cC1(Reg<uint8_t>& reg, uint8_t v)
+    {
+        uint8_t old = reg.value;
+        reg.value = v & ~I2C_C1_RSTA_MASK;   // RSTA always reads as zero
+
+        if (!(v & I2C_C1_IICEN_MASK))
+        {
+            return;
+        }
+        if (!(old & I2C_C1_MST_MASK) && (v & I2C_C1_MST_MASK))
+        {
+            i2cStart();
+        }
+        else if ((old & I2C_C1_MST_MASK) && !(v & I2C_C1_MST_MASK))
+        {
+            i2cStop();
+        }
+        else if ((v & I2C_C1_RSTA_MASK) && (v & I2C_C1_MST_MASK))
+        {
+            i2cStart();
+        }
+    }
+
+    static void writeI2cS(Reg<uint8_t>& reg, uint8_t v)
+    {
+        uint8_t w1c = v & (I2C_S_IICIF_MASK | I2C_S_ARBL_MASK);
+        reg.value &= ~w1c;
+        if (w1c & I2C_S_IICIF_MASK)
+        {
+            g_i2cRxFlight = false;
+        }
+    }
+
+    static void i2cByteDone(bool ack)
+    {
+        // The byte and its acknowledge take 9 SCL periods, then IICIF is set
+        i2c0.S.value &= ~I2C_S_TCF_MASK;
+        g_i2cBusy      = true;
+        g_i2cAck       = ack;
+        g_i2cByteEndNs = nowNs() + i2cByteNs();
+    }
+
+    static uint8_t readI2cS(Reg<uint8_t>& reg)
+    {
+        updateI2cBus();
+        return reg.value;
+    }
+
+    static void writeI2cD(Reg<uint8_t>& reg, uint8_t v)
+    {
+        reg.value = v;
+        uint8_t c1 = i2c0.C1.value;
+        if (!(c1 & I2C_C1_IICEN_MASK) || !(c1 & I2C_C1_MST_MASK) || !(c1 & I2C_C1_TX_MASK))
+        {
+            return;
+        }
+
+        ++g_stats.i2cBytes;
+        if (g_i2cState == I2cState::Address)
+        {
+            g_i2cAddress = v >> 1;
+            g_i2cDevice  = findI2cDevice(g_i2cAddress);
+            --g_stats.i2cBytes;
+            countI2cByte(g_i2cAddress);
+            if (g_i2cDevice)
+            {
+                bool read = (v & 1u) != 0;
+                g_i2cDevice->start(read);
+                g_i2cState = read ? I2cState::Receive : I2cState::Transmit;
+                i2cByteDone(true);
+            }
+            else
+            {
+                g_i2cState = I2cState::Idle;
+                i2cByteDone(false);
+            }
+        }
+        else if (g_i2cState == I2cState::Transmit && g_i2cDevice)
+        {
+            --g_stats.i2cBytes;
+            countI2cByte(g_i2cAddress);
+            g_i2cDevice->write(v);
+            i2cByteDone(true);
+        }
+        else
+        {
+            i2cByteDone(false);
+        }
+    }
+
+    static uint8_t readI2cD(Reg<uint8_t>&)
+    {
+        uint8_t data = g_i2cRxData;
+        uint8_t c1   = i2c0.C1.value;
+
+        // In master receive mode a read of D starts the next byte, unless one is pending
+        if ((c1 & I2C_C1_MST_MASK) && !(c1 & I2C_C1_TX_MASK) &&
+            g_i2cState == I2cState::Receive && g_i2cDevice && !g_i2cRxFlight)
+        {
+            g_i2cRxData   = g_i2cDevice->read();
+            g_i2cRxFlight = true;
+            countI2cByte(g_i2cAddress);
+            i2cByteDone(true);
+        }
+        return data;
+    }
+
+    /* =========================================
+     * Board setup
+     * =========================================
+     */
+
+    static void onSignal(int sig)
+    {
+        if (sig == SIGUSR1) { g_buttonRequest  = 1; }
+        if (sig == SIGUSR2) { g_lcdDumpRequest = 1; }
+    }
+
+    static void openUart()
+    {
+        const char* mode = std::getenv("PEDOSIM_UART");
+        if (mode && std::strcmp(mode, "stdio") == 0)
+        {
+            g_uartRxFd = STDIN_FILENO;
+            g_uartTxFd = STDOUT_FILENO;
+            ::fcntl(g_uartRxFd, F_SETFL, ::fcntl(g_uartRxFd, F_GETFL) | O_NONBLOCK);
+            return;
+        }
+
+        int master = ::posix_openpt(O_RDWR | O_NOCTTY);
+        if (master < 0 || ::grantpt(master) != 0 || ::unlockpt(master) != 0)
+        {
+            std::perror("pedometer_sim: pty");
+            return;
+        }
+        const char* slaveName = ::ptsname(master);
+
+        // Keep the slave open in raw mode so the line discipline never echoes or cooks
+        int slave = ::open(slaveName, O_RDWR | O_NOCTTY);
+        if (slave >= 0)
+        {
+            termios tio;
+            ::tcgetattr(slave, &tio);
+            ::cfmakeraw(&tio);
+            ::tcsetattr(slave, TCSANOW, &tio);
+        }
+        ::fcntl(master, F_SETFL, ::fcntl(master, F_GETFL) | O_NONBLOCK);
+        g_uartRxFd = master;
+        g_uartTxFd = master;
+
+        std::fprintf(stderr, "pedometer_sim: UART0 on %s\n", slaveName);
+        if (const char* link = std::getenv("PEDOSIM_PTY_LINK"))
+        {
+            ::unlink(link);
+            if (::symlink(slaveName, link) != 0)
+            {
+                std::perror("pedometer_sim: symlink");
+            }
+        }
+    }
+
+    static void printSummary()
+    {
+        dumpLcd(true);
+        std::fprintf(stderr,
+                     "pedometer_sim: i2c %u transactions / %u bytes (accel %u, lcd %u), "
+                     "uart tx %u rx %u bytes\n",
+                     g_stats.i2cTransactions, g_stats.i2cBytes, g_stats.accelBytes,
+                     g_stats.lcdBytes, g_stats.uartTxBytes, g_stats.uartRxBytes);
+        if (g_waitEntries != 0 || g_vlpsEntries != 0)
+        {
+            std::fprintf(stderr, "pedometer_sim: sleep entries wait %u vlps %u", g_waitEntries, g_vlpsEntries);
+            if (g_vlpsBusy != 0 || g_vlpsRxLost != 0)
+            {
+                std::fprintf(stderr, " (VLPS with a transfer running %u, UART bytes lost %u)", g_vlpsBusy, g_vlpsRxLost);
+            }
+            std::fprintf(stderr, "\n");
+        }
+        if (g_flashStats.programs != 0 || g_flashStats.erases != 0)
+        {
+            std::fprintf(stderr, "pedometer_sim: flash %u longwords programmed, %u sectors erased (busy %llu ms)\n",
+                         g_flashStats.programs, g_flashStats.erases,
+                         static_cast<unsigned long long>(g_flashStats.busyNs / 1000000u));
+        }
+        if (g_stats.lcdBusyWrites != 0)
+        {
+            std::fprintf(stderr, "pedometer_sim: %u LCD instructions written while the HD44780 was busy\n",
+                         g_stats.lcdBusyWrites);
+        }
+    }
+
+    /**
+     * @brief Installs the peripheral models before the firmware main() runs.
+     */
+    struct BoardSetup
+    {
+        BoardSetup()
+        {
+            for (PORT_Type* port : { &portA, &portB })
+            {
+                port->ISFR.onWrite = writeW1c32;
+                for (Reg<uint32_t>& pcr : port->PCR)
+                {
+                    pcr.onWrite = writePcr;
+                }
+            }
+            gpioA.PDIR.onRead = readPortAInput;
+            for (GPIO_Type* gpio : { &gpioA, &gpioB })
+            {
+                gpio->PSOR.onWrite = writeGpioSet;
+                gpio->PCOR.onWrite = writeGpioClear;
+                gpio->PTOR.onWrite = writeGpioToggle;
+            }
+
+            i2c0.C1.onWrite = writeI2cC1;
+            i2c0.S.onRead   = readI2cS;
+            i2c0.S.onWrite  = writeI2cS;
+            i2c0.D.onWrite  = writeI2cD;
+            i2c0.D.onRead   = readI2cD;
+
+            uart0.S1.onRead = readUartS1;
+            uart0.D.onRead  = readUartD;
+            uart0.D.onWrite = writeUartD;
+
+            sysTick.CTRL.onRead  = readSysTickCtrl;
+            sysTick.CTRL.onWrite = writeSysTickCtrl;
+            sysTick.VAL.onRead   = readSysTickVal;
+            sysTick.VAL.onWrite  = writeSysTickVal;
+            for (auto& channel : dma0.DMA)
+            {
+                channel.DSR_BCR.onWrite = writeDmaDsrBcr;
+            }
+
+            for (auto& ch : pit.CHANNEL)
+            {
+                ch.TCTRL.onWrite = writePitTctrl;
+                ch.CVAL.onRead   = readPitCval;
+                ch.TFLG.onWrite  = writeW1c32;
+            }
+            pit.MCR.value = PIT_MCR_MDIS_MASK;                  // reset value
+            lptmr0.CSR.onWrite = writeLptmrCsr;
+            lptmr0.CNR.onWrite = writeLptmrCnr;
+            smc.PMPROT.onWrite = writeWriteOnce8;
+            ftfa.FSTAT.onWrite = writeFtfaFstat;
+            ftfa.FSTAT.value   = FTFA_FSTAT_CCIF_MASK;          // no command running
+            for (Reg<uint8_t>* fprot : { &ftfa.FPROT0, &ftfa.FPROT1, &ftfa.FPROT2, &ftfa.FPROT3 })
+            {
+                fprot->value = 0xFF;                            // unprotected
+            }
+            smc.PMSTAT.value   = 0x01;                          // RUN
+            simModule.CLKDIV1.value = SIM_CLKDIV1_OUTDIV4(1);   // CLOCK_SETUP 1: bus = core / 2
+
+            const char* fast = std::getenv("PEDOSIM_FAST");
+            g_fast = fast && std::strcmp(fast, "0") != 0;
+
+            openUart();
+            openFlash();
+            initI2cDevices();
+
+            std::signal(SIGUSR1, onSignal);
+            std::signal(SIGUSR2, onSignal);
+            std::atexit(printSummary);
+        }
+    };
+
+    static BoardSetup g_boardSetup;
+}
+
+/* =========================================
+ * CMSIS functions
+ * =========================================
+ */
+
+void SystemCoreClockUpdate(void)
+{
+}
+
+void NVIC_EnableIRQ(IRQn_Type irq)       { if (irq >= 0) { sim::g_nvicEnabled |=  (1u << irq); } sim::service(); }
+void NVIC_DisableIRQ(IRQn_Type irq)      { if (irq >= 0) { sim::g_nvicEnabled &= ~(1u << irq); } }
+void NVIC_ClearPendingIRQ(IRQn_Type irq) { if (irq >= 0) { sim::g_nvicPending &= ~(1u << irq); } }
+void NVIC_SetPendingIRQ(IRQn_Type irq)   { if (irq >= 0) { sim::raiseIrq(irq); } sim::service(); }
+uint32_t NVIC_GetPendingIRQ(IRQn_Type irq) { return (irq >= 0) ? ((sim::g_nvicPending >> irq) & 1u) : 0u; }
+void NVIC_SetPriority(IRQn_Type, uint32_t) {}
+
+void __enable_irq(void)  { sim::g_primask = false; sim::service(); }
+void __disable_irq(void) { sim::g_primask = true; }
+uint32_t __get_PRIMASK(void) { return sim::g_primask ? 1u : 0u; }
+void __NOP(void)         {}
+
+void __WFI(void)
+{
+    // A finished script ends the run once the core is idle and the transmitter has drained
+    if (sim::g_finishing)
+    {
+        sim::service();
+        bool idle = sim::uartTc() && !(sim::uart0.C2.value & UART0_C2_TIE_MASK) && !sim::g_i2cBusy
+                 && ((sim::g_nvicPending | sim::assertedLines()) & sim::g_nvicEnabled) == 0;
+        if (idle || sim::nowNs() >= sim::g_finishDeadlineNs)
+        {
+            std::exit(0);
+        }
+    }
+
+    // In VLPS the bus clock stops: PIT, UART0, I2C0 and DMA freeze until an
+    // asynchronous source (PORTA pin, LPTMR) wakes the core
+    bool vlps = sim::vlpsRequested();
+    if (vlps)
+    {
+        ++sim::g_vlpsEntries;
+        if (!sim::uartTc() || sim::g_i2cBusy)
+        {
+            ++sim::g_vlpsBusy;
+        }
+    }
+    else
+    {
+        ++sim::g_waitEntries;
+    }
+
+    // Sleep until the UART has input or the next timer event, then deliver whatever is pending
+    uint64_t next = sim::nextTimerEventNs(vlps);
+    uint64_t now  = sim::nowNs();
+    uint64_t timeoutNs = 1000000u;
+    if (next != UINT64_MAX)
+    {
+        timeoutNs = (next > now) ? next - now : 0;
+    }
+
+    if (sim::g_fast && next != UINT64_MAX && sim::g_uartRx.empty())
+    {
+        if (next > now)
+        {
+            sim::g_warpNs += next - now;
+        }
+        timeoutNs = 0;
+    }
+
+    // Sub-millisecond waits matter: an I2C byte takes about 10 us
+    timespec timeout = { static_cast<time_t>(timeoutNs / 1000000000u), static_cast<long>(timeoutNs % 1000000000u) };
+    if (sim::g_uartRxFd >= 0 && sim::g_uartRx.empty())
+    {
+        pollfd pfd = { sim::g_uartRxFd, POLLIN, 0 };
+        ::ppoll(&pfd, 1, &timeout, nullptr);
+    }
+    else if (timeoutNs != 0)
+    {
+        ::nanosleep(&timeout, nullptr);
+    }
+    if (vlps)
+    {
+        sim::pollUartInput();
+        sim::g_vlpsRxLost += static_cast<uint32_t>(sim::g_uartRx.size());
+        sim::g_uartRx.clear();
+
+        // The PIT channels resume where they stopped
+        uint64_t stoppedNs = sim::nowNs() - now;
+        for (sim::PitChannelState& st : sim::g_pit)
+        {
+            st.reloadNs += stoppedNs;
+        }
+    }
+    if (sim::g_buttonWhenIdle)
+    {
+        sim::g_buttonWhenIdle = false;
+        sim::pressButton();
+    }
+    sim::service();
+}
@@ -0,0 +1,194 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Simulator.hpp
+ * @brief Control and inspection API of the simulated FRDM-KL05Z board.
+ *
+ * The simulator is configured from environment variables before main() runs:
+ *  - PEDOSIM_ACCEL=<file>   scripted MMA8451Q samples, one "x y z" line (in g) per sample;
+ *                           polled reads take the next line, in FIFO mode lines are
+ *                           consumed at the configured ODR; the process exits at the end,
+ *                           once the UART transmitter is idle,
+ *  - PEDOSIM_FAST=1         skip idle time: __WFI jumps straight to the next timer event
+ *                           instead of sleeping, so scripts run faster than real time,
+ *  - PEDOSIM_UART=stdio     connect UART0 to stdin/stdout instead of a pty,
+ *  - PEDOSIM_PTY_LINK=<p>   create a symlink to the UART0 pty slave,
+ *  - PEDOSIM_LCD=<file>     rewrite <file> with the two LCD rows whenever they change,
+ *  - PEDOSIM_FLASH=<file>   keep the 32 KB program flash in <file> across runs (erased if new),
+ *  - PEDOSIM_BUTTON_AT=<n>  press the PTA11 button while the core sleeps after sample n.
+ *
+ * SIGUSR1 presses the PTA11 button (PORTA IRQ), SIGUSR2 dumps the LCD to stderr.
+ */
+
+#ifndef SIMULATOR_HPP
+#define SIMULATOR_HPP
+
+#include <cstdint>
+#include <string>
+
+namespace sim
+{
+    /**
+     * @struct BusStats
+     * @brief Traffic counters of the simulated buses.
+     */
+    struct BusStats
+    {
+        uint32_t i2cTransactions;   /**< START conditions issued (repeated starts included). */
+        uint32_t i2cBytes;          /**< Bytes shifted on the I2C bus (address bytes included). */
+        uint32_t lcdBytes;          /**< Bytes written to the PCF8574 expander. */
+        uint32_t accelBytes;        /**< Bytes exchanged with the MMA8451Q. */
+        uint32_t uartTxBytes;       /**< Bytes sent on UART0. */
+        uint32_t uartRxBytes;       /**< Bytes received on UART0. */
+        uint32_t lcdBusyWrites;     /**< LCD instructions started before the previous one finished. */
+    };
+
+    /**
+     * @struct FlashStats
+     * @brief FTFA command counters.
+     */
+    struct FlashStats
+    {
+        uint32_t programs;  /**< Longword programs. */
+        uint32_t erases;    /**< Sector erases. */
+        uint32_t errors;    /**< Commands rejected with ACCERR. */
+        uint64_t busyNs;    /**< Time the flash was busy, added to the simulated time [ns]. */
+    };
+
+    /**
+     * @brief Raises the PORTA interrupt as if the PTA11 button was pressed.
+     */
+    void pressButton();
+
+    /**
+     * @brief Presses the button the next time the core enters __WFI (between samples).
+     */
+    void pressButtonWhenIdle();
+
+    /**
+     * @brief Queues bytes on the UART0 receiver (delivered through UART0_IRQHandler).
+     */
+    void uartInject(const char* text);
+
+    /**
+     * @brief Returns the visible contents of one LCD row (16 characters).
+     */
+    std::string lcdRow(uint8_t row);
+
+    /**
+     * @brief Returns the bus traffic counters.
+     */
+    const BusStats& busStats();
+
+    /**
+     * @brief Index of the last sample served by the scripted accelerometer.
+     */
+    uint32_t accelSampleIndex();
+
+    /**
+     * @brief Simulated time in nanoseconds (host monotonic clock plus skipped idle time).
+     */
+    uint64_t nowNs();
+
+    /**
+     * @brief Ends the run once UART0 has sent everything (at most 5 s of simulated time later).
+     */
+    void finish();
+
+    /**
+     * @brief Byte of the simulated flash array at @p address (also declared in MKL05Z4.h).
+     */
+    uint8_t* flashMemory(uint32_t address);
+
+    /**
+     * @brief Returns the FTFA command counters.
+     */
+    const FlashStats& flashStats();
+
+    /**
+     * @brief Cuts the flash supply during a later FTFA command.
+     *
+     * The @p commands-th command from now changes each of its bits with probability
+     * @p permille / 1000 (a torn program or erase); it and every later command then
+     * have no effect until flashPowerOn().
+     * @param seed Seed of the bit selection.
+     */
+    void flashPowerLoss(uint32_t commands, uint16_t permille, uint32_t seed);
+
+    /**
+     * @brief True once an armed power loss has happened.
+     */
+    bool flashPowerLost();
+
+    /**
+     * @brief Restores the supply (the next boot) and disarms flashPowerLoss().
+     */
+    void flashPowerOn();
+
+    /**
+     * @brief Raises a peripheral interrupt line (used by the device models).
+     */
+    void raiseIrq(int irq);
+
+    /* ---- Hooks between Simulator.cpp and I2cDevices.cpp ---- */
+
+    /**
+     * @struct I2cDevice
+     * @brief A slave on the simulated I2C0 bus.
+     */
+    struct I2cDevice
+    {
+        virtual ~I2cDevice() = default;
+        virtual void    start(bool read) = 0;     /**< Addressed after (repeated) START. */
+        virtual void    write(uint8_t data) = 0;  /**< Data byte from the master. */
+        virtual uint8_t read() = 0;               /**< Data byte to the master. */
+        virtual void    stop() {}                 /**< STOP condition. */
+        virtual void    update(uint64_t) {}       /**< Advances the model to the given time [ns]. */
+        virtual uint64_t nextEventNs() const { return UINT64_MAX; }   /**< Next autonomous event [ns]. */
+    };
+
+    /**
+     * @brief Returns the device answering the 7-bit address, or nullptr (NACK).
+     */
+    I2cDevice* findI2cDevice(uint8_t address);
+
+    /**
+     * @brief Advances all I2C device models to the given time [ns].
+     */
+    void updateI2cDevices(uint64_t now);
+
+    /**
+     * @brief Earliest autonomous event of the I2C device models [ns], UINT64_MAX if none.
+     */
+    uint64_t nextI2cDeviceEventNs();
+
+    /**
+     * @brief Drives a PORTA input pin (external signal), raising PORTA flags per PCR IRQC.
+     */
+    void setPortAPin(uint8_t pin, bool high);
+
+    /**
+     * @brief Initializes the I2C device models from the environment.
+     */
+    void initI2cDevices();
+
+    /**
+     * @brief Counts a byte exchanged with the given I2C address.
+     */
+    void countI2cByte(uint8_t address);
+
+    /**
+     * @brief Counts an LCD instruction written while the HD44780 was still busy.
+     */
+    void countLcdBusyWrite();
+
+    /**
+     * @brief Writes the LCD contents to the PEDOSIM_LCD file and/or the stream.
+     */
+    void dumpLcd(bool toStderr);
+}
+
+#endif // SIMULATOR_HPP
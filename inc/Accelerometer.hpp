@@ -0,0 +1,185 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Accelerometer.hpp
+ * @brief MMA8451Q driver with polled and FIFO/burst acquisition modes.
+ *
+ * The sensor is configured once at start-up instead of on every sample.
+ * In FIFO mode the 32-sample FIFO runs in circular mode at the selected ODR;
+ * when the watermark is reached the sensor pulls INT1 (PTA10) low, PORTA_IRQHandler
+ * calls accel::onInterrupt(), and the main loop drains the whole FIFO with a
+ * single burst read into a sample ring.
+ *
+ * For deep idle the sensor can instead watch for motion on its own: initMotionWake()
+ * switches to the low-power oversampling mode with only the transient (high-pass
+ * filtered change) detector enabled, which pulls INT1 low when the wearer moves.
+ */
+
+#ifndef ACCELEROMETER_HPP
+#define ACCELEROMETER_HPP
+
+#include <cstdint>
+
+/**
+ * @brief PTA pin connected to the MMA8451Q INT1 output on the FRDM-KL05Z.
+ */
+#ifndef ACCEL_INT1_PIN_POS
+  #define ACCEL_INT1_PIN_POS 10
+#endif
+
+/**
+ * @namespace accel
+ * @brief Functions to configure and read the on-board MMA8451Q accelerometer.
+ */
+namespace accel
+{
+    constexpr uint8_t ADDRESS       = 0x1D;  /**< 7-bit I2C address (SA0 = 1). */
+    constexpr uint8_t FIFO_SIZE     = 32;    /**< Hardware FIFO depth in samples. */
+    constexpr uint8_t RING_CAPACITY = 32;    /**< Software sample ring depth. */
+
+    /**
+     * @brief Output data rates, encoded as CTRL_REG1 DR[2:0].
+     */
+    enum class Odr : uint8_t
+    {
+        Hz800  = 0,
+        Hz400  = 1,
+        Hz200  = 2,
+        Hz100  = 3,
+        Hz50   = 4,
+        Hz12_5 = 5,
+        Hz6_25 = 6,
+        Hz1_56 = 7
+    };
+
+    /**
+     * @brief Oversampling modes while active, encoded as CTRL_REG2 MODS[1:0].
+     *
+     * At 50 to 200 Hz, HighResolution averages the most internal samples (lowest
+     * noise, highest current) and LowPower the fewest.
+     */
+    enum class Oversampling : uint8_t
+    {
+        Normal           = 0,
+        LowNoiseLowPower = 1,
+        HighResolution   = 2,
+        LowPower         = 3
+    };
+
+    /**
+     * @struct Sample
+     * @brief One acceleration sample in 14-bit counts (4096 counts/g).
+     */
+    struct Sample
+    {
+        int16_t x;
+        int16_t y;
+        int16_t z;
+    };
+
+    /**
+     * @struct Stats
+     * @brief FIFO acquisition counters.
+     */
+    struct Stats
+    {
+        uint32_t bursts;        /**< FIFO drains (one burst read each). */
+        uint32_t samples;       /**< Samples moved from the FIFO to the ring. */
+        uint32_t fifoOverflows; /**< Drains that found the hardware FIFO overflowed. */
+        uint32_t ringDrops;     /**< Samples lost because the ring was full. */
+        uint32_t busErrors;     /**< Drains that failed on the I2C bus (their samples are skipped). */
+    };
+
+    /**
+     * @brief Selects the oversampling mode used by the next initPolled() or initFifo().
+     */
+    void setOversampling(Oversampling mode);
+
+    /**
+     * @brief Configures the sensor once for polled reads (+/-2 g, 800 Hz, active).
+     * @return 0 if successful, non-zero otherwise.
+     */
+    uint8_t initPolled();
+
+    /**
+     * @brief Reads the current X/Y/Z sample with one 6-byte block read.
+     * @param sample Destination sample.
+     * @return 0 if successful, non-zero otherwise.
+     */
+    uint8_t readSample(Sample& sample);
+
+    /**
+     * @brief Configures the FIFO in circular mode with a watermark interrupt on INT1.
+     * @param odr Output data rate.
+     * @param watermark FIFO level (1..32) that asserts INT1.
+     * @return 0 if successful, non-zero otherwise.
+     */
+    uint8_t initFifo(Odr odr, uint8_t watermark);
+
+    /**
+     * @brief Configures motion detection with a transient interrupt on INT1 (FIFO off).
+     *
+     * Restart acquisition with initFifo() or initPolled() after the wake-up.
+     * @param odr Output data rate of the detector (lower rates draw less current).
+     * @param thresholdMg Acceleration change that counts as motion [mg], 63 mg resolution.
+     * @return 0 if successful, non-zero otherwise.
+     */
+    uint8_t initMotionWake(Odr odr, uint16_t thresholdMg);
+
+    /**
+     * @brief Returns true if the transient interrupt fired since initMotionWake().
+     */
+    bool motionDetected();
+
+    /**
+     * @brief Must be called from PORTA_IRQHandler when the INT1 pin flag is set.
+     */
+    void onInterrupt();
+
+    /**
+     * @brief Returns true if the FIFO watermark interrupt is pending.
+     */
+    bool fifoReady();
+
+    /**
+     * @brief Drains the whole FIFO with one burst read into the sample ring.
+     *
+     * fifoReady() stays true while INT1 is still asserted afterwards, so a
+     * failed read is retried instead of waiting for an edge that never comes.
+     * @return 0 if successful, non-zero otherwise (no samples are added).
+     */
+    uint8_t drainFifo();
+
+    /**
+     * @brief Returns the number of samples waiting in the ring.
+     */
+    uint8_t available();
+
+    /**
+     * @brief Takes the oldest sample from the ring.
+     * @param sample Destination sample.
+     * @return True if a sample was available.
+     */
+    bool pop(Sample& sample);
+
+    /**
+     * @brief Takes @p factor samples from the ring and returns their average.
+     *
+     * Boxcar decimation from the sensor ODR to the detector rate, which also
+     * acts as a simple anti-aliasing filter.
+     * @param sample Destination (averaged) sample.
+     * @param factor Number of samples to average.
+     * @return True if enough samples were available.
+     */
+    bool popAveraged(Sample& sample, uint8_t factor);
+
+    /**
+     * @brief Returns the FIFO acquisition counters.
+     */
+    const Stats& stats();
+}
+
+#endif // ACCELEROMETER_HPP
@@ -24,6 +24,12 @@ extern "C" {
   #define DELAY(x)  for(uint32_t i = 0; i < (x * 10000U); i++) { __asm("nop"); }
 #endif
 
+/**
+ * @brief Busy-waits for at least the given time, measured with the SysTick cycle counter.
+ * @param us Microseconds.
+ */
+void delayUs(uint32_t us);
+
 /**
  * @brief Initializes the GPIO pins for the on-board RGB LED.
  */
@@ -40,14 +46,176 @@ void setLedColor(bool r, bool g, bool b);
 /**
  * @namespace I2C
  * @brief Contains I2C-related methods for communication with external peripherals.
+ *
+ * All transfers go through an interrupt-driven engine: a transfer is described by
+ * an I2C::Transfer (address, bytes to write, buffer to read into, optional
+ * completion callback) and queued with submit(); the I2C0 interrupt then runs the
+ * whole bus sequence, including the repeated start before a read and the NACK on
+ * its last byte. The register helpers below queue a transfer and sleep in __WFI
+ * until it completes, so the CPU is never busy-polling the bus.
+ *
+ * The SCL rate is chosen with setClock() (STANDARD_HZ by default) from the bus
+ * clock derived from SystemCoreClock. setDeviceClock() gives one slave address
+ * its own rate, e.g. a fast-mode sensor next to a standard-mode expander; the
+ * engine reprograms I2C0->F between transfers when the next one needs another
+ * rate. Bytes and transfers are also counted per slave address
+ * (deviceStats()), to split the bus load between the devices.
+ *
+ * Usage:
+ * @code
+ *   static uint8_t reg = 0x01, buffer[6];
+ *   static I2C::Transfer t = { 0x1D, &reg, 1, buffer, 6, onSample, nullptr };
+ *   I2C::submit(t);          // returns at once, onSample() runs in the interrupt
+ * @endcode
  */
 namespace I2C
 {
+    constexpr uint8_t QUEUE_SIZE = 8;       /**< Transfers queued at most (power of two). */
+    constexpr uint8_t MAX_DEVICES = 4;      /**< Slave addresses with their own counters or SCL rate. */
+
+    constexpr uint32_t TIMEOUT_MARGIN_US = 1000;    /**< Added to twice the bus time of a transfer to give its limit. */
+
+    constexpr uint32_t STANDARD_HZ = 100000;    /**< Standard mode SCL rate. */
+    constexpr uint32_t FAST_HZ     = 400000;    /**< Fast mode SCL rate (MMA8451Q, not the PCF8574 datasheet). */
+
+    /* Transfer status codes (0 = success, as for the other drivers) */
+    constexpr uint8_t OK          = 0;      /**< Completed, every byte acknowledged. */
+    constexpr uint8_t TIMEOUT     = 1;      /**< Bus did not become free, or the transfer exceeded its time limit. */
+    constexpr uint8_t NACK        = 2;      /**< Address or data byte not acknowledged. */
+    constexpr uint8_t ARBITRATION = 3;      /**< Arbitration lost. */
+    constexpr uint8_t PENDING     = 0xFF;   /**< Queued or on the bus. */
+
+    struct Transfer;
+
+    /**
+     * @brief Completion callback, called from the I2C0 interrupt.
+     */
+    using Callback = void (*)(Transfer& transfer);
+
+    /**
+     * @struct Transfer
+     * @brief Descriptor of one bus transaction: START, write txSize bytes, then (after a
+     *        repeated START) read rxSize bytes, STOP. Either part may be empty.
+     *
+     * The descriptor and its buffers belong to the caller and must stay valid until
+     * status leaves PENDING.
+     */
+    struct Transfer
+    {
+        uint8_t          address;   /**< 7-bit slave address. */
+        const uint8_t*   tx;        /**< Bytes to write (register address first). */
+        uint8_t          txSize;
+        uint8_t*         rx;        /**< Buffer for the bytes read. */
+        uint8_t          rxSize;
+        Callback         done;      /**< Optional, called when the transfer completes. */
+        void*            context;   /**< Free for the callback. */
+        volatile uint8_t status;    /**< PENDING, then OK or an error code. */
+    };
+
     /**
-     * @brief Initializes the I2C0 peripheral for standard mode (~100kHz).
+     * @struct Stats
+     * @brief Engine counters.
+     */
+    struct Stats
+    {
+        uint32_t transfers;     /**< Completed transfers. */
+        uint32_t errors;        /**< Transfers ended by NACK, arbitration loss or timeout. */
+        uint32_t bytes;         /**< Bytes on the bus, address bytes included. */
+        uint32_t interrupts;    /**< I2C0 interrupts served. */
+        uint8_t  peak;          /**< Highest number of queued transfers. */
+    };
+
+    /**
+     * @struct DeviceStats
+     * @brief Traffic of one slave address.
+     */
+    struct DeviceStats
+    {
+        uint8_t  address;       /**< 7-bit slave address. */
+        uint32_t transfers;     /**< Transfers started. */
+        uint32_t bytes;         /**< Bytes on the bus, address bytes included. */
+    };
+
+    /**
+     * @brief Initializes the I2C0 peripheral at the setClock() rate (standard mode by default) and its interrupt.
      */
     void init();
 
+    /**
+     * @brief Selects the fastest SCL rate that does not exceed @p sclHz at the current bus clock.
+     *
+     * Applied at once if I2C0 is initialized (call it with the bus idle) and by every init().
+     * MULT stays 1: with MULT > 1 the KL05 cannot issue the repeated START of a read (erratum e6070).
+     * @return The SCL rate obtained [Hz].
+     */
+    uint32_t setClock(uint32_t sclHz);
+
+    /**
+     * @brief Runs the transfers to one slave address at the fastest SCL rate not above @p sclHz.
+     *
+     * The other addresses keep the setClock() rate. Like setClock(), the divider
+     * follows the bus clock at every init().
+     * @return The SCL rate obtained [Hz], 0 if MAX_DEVICES addresses already have their own.
+     */
+    uint32_t setDeviceClock(uint8_t address, uint32_t sclHz);
+
+    /**
+     * @brief SCL frequency programmed in I2C0->F, in Hz.
+     */
+    uint32_t clockHz();
+
+    /**
+     * @brief SCL frequency the transfers to @p address run at, in Hz.
+     */
+    uint32_t clockHz(uint8_t address);
+
+    /**
+     * @brief Queues a transfer; it starts at once if the bus is idle.
+     * @param transfer Descriptor, its status is set to PENDING.
+     * @return 0 if queued, 1 if the queue is full.
+     */
+    uint8_t submit(Transfer& transfer);
+
+    /**
+     * @brief Sleeps until a submitted transfer completes (polls if interrupts are masked).
+     *
+     * Each transfer that reaches the bus meanwhile, this one or one queued before
+     * it, gets twice its bus time at the SCL rate plus TIMEOUT_MARGIN_US. One that
+     * takes longer (a slave holding SCL low) is ended with STOP and a module reset
+     * and completes with TIMEOUT. Since no interrupt may come from a stuck bus,
+     * SysTick interrupts are enabled while waiting, and the limit is checked at
+     * the latest one SysTick wrap (2^24 core cycles, 0.35 s at 48 MHz) after it
+     * expired.
+     * @return Final status of the transfer.
+     */
+    uint8_t wait(Transfer& transfer);
+
+    /**
+     * @brief Submits a transfer and waits for it.
+     * @return Final status of the transfer (1 if it could not be queued).
+     */
+    uint8_t transfer(Transfer& transfer);
+
+    /**
+     * @brief True if no transfer is queued or on the bus.
+     */
+    bool idle();
+
+    /**
+     * @brief Returns the engine counters.
+     */
+    const Stats& stats();
+
+    /**
+     * @brief Returns the counters of one slave address, nullptr if it was never addressed.
+     */
+    const DeviceStats* deviceStats(uint8_t address);
+
+    /**
+     * @brief Advances the transfer state machine; called by I2C0_IRQHandler.
+     */
+    void handleIRQ();
+
     /**
      * @brief Writes data to a specific register of an I2C device.
      * @param address 7-bit I2C device address.
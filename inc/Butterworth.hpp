@@ -0,0 +1,505 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Butterworth.hpp
+ * @brief Compile-time Butterworth filter design and fixed-point biquad cascades.
+ *
+ * The templates do what MATLAB's butter() does in matlabFilterTests.m, but in
+ * the compiler: analog Butterworth prototype poles, low-pass to high-/band-pass
+ * transformation, prewarped bilinear transform to z, then grouping of the
+ * poles into second-order sections (lowest pole radius first). The results are
+ * constexpr, so the Q29 coefficients are literal constants in the image and a
+ * new sample rate or cutoff only needs a recompile. Nothing here runs on the
+ * target except Cascade::process().
+ *
+ * Frequencies are template arguments in millihertz (C++17 has no floating
+ * point template parameters); butter::hz() converts from hertz.
+ *
+ *  - LowPass<Fs, Fc, N> / HighPass<Fs, Fc, N>: ceil(N/2) sections, each with
+ *    unity gain at DC / Nyquist.
+ *  - BandPass<Fs, F1, F2, N>: order 2N like butter(N, [F1 F2]/(Fs/2)), N
+ *    sections with zeros at z = +1 and z = -1 and the overall gain split
+ *    evenly between them.
+ *
+ * Usage:
+ * @code
+ *   using Hpf = butter::HighPass<butter::hz(10), butter::hz(2), 2>;
+ *   butter::Cascade<Hpf> hpf;
+ *   int32_t y = hpf.process(x);     // Q15 in, Q15 out, coefficients inlined
+ * @endcode
+ */
+
+#ifndef BUTTERWORTH_HPP
+#define BUTTERWORTH_HPP
+
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+
+/**
+ * @struct BiquadQ29
+ * @brief Direct Form I second-order section with Q29 coefficients and Q15 signal.
+ */
+struct BiquadQ29
+{
+    int32_t b0, b1, b2;     /**< Feed-forward coefficients (Q29). */
+    int32_t a1, a2;         /**< Feedback coefficients (Q29), a0 = 1 implied. */
+};
+
+/**
+ * @struct BiquadState
+ * @brief Delay line of one BiquadQ29 section.
+ */
+struct BiquadState
+{
+    int32_t x1, x2;         /**< Previous inputs (Q15). */
+    int32_t y1, y2;         /**< Previous outputs (Q15). */
+};
+
+/**
+ * @namespace butter
+ * @brief constexpr Butterworth design (butter() equivalent) and the filter kernel.
+ */
+namespace butter
+{
+    using Frequency = uint32_t;     /**< Frequency template argument [mHz]. */
+
+    constexpr uint8_t Q_COEFF = 29; /**< Fraction bits of BiquadQ29 coefficients. */
+
+    /**
+     * @brief Converts hertz to a Frequency template argument.
+     */
+    constexpr Frequency hz(double f)
+    {
+        return static_cast<Frequency>(f * 1000.0 + 0.5);
+    }
+
+    /**
+     * @struct Section
+     * @brief Second-order section in double precision, a0 = 1.
+     */
+    struct Section
+    {
+        double b0, b1, b2;
+        double a1, a2;
+    };
+
+    /**
+     * @struct Design
+     * @brief Cascade of @p N sections, applied in index order.
+     */
+    template <size_t N>
+    struct Design
+    {
+        Section sections[N];
+    };
+
+    /**
+     * @struct Polynomial
+     * @brief Coefficients of the whole cascade in powers of z^-1, as printed by MATLAB.
+     */
+    template <size_t N>
+    struct Polynomial
+    {
+        double b[2 * N + 1];
+        double a[2 * N + 1];
+    };
+
+    namespace detail
+    {
+        constexpr double PI = 3.14159265358979323846;
+
+        constexpr double abs(double x)
+        {
+            return x < 0 ? -x : x;
+        }
+
+        constexpr double sqrt(double x)
+        {
+            if (x <= 0)
+            {
+                return 0;
+            }
+            double r = x < 1 ? 1 : x;
+            for (int i = 0; i < 200; ++i)
+            {
+                double next = 0.5 * (r + x / r);
+                if (next == r)
+                {
+                    break;
+                }
+                r = next;
+            }
+            return r;
+        }
+
+        /* sin/cos by Taylor series after reduction to [-pi, pi] */
+        constexpr double sin(double x)
+        {
+            while (x >  PI) { x -= 2 * PI; }
+            while (x < -PI) { x += 2 * PI; }
+            double term = x;
+            double sum  = x;
+            for (int n = 1; n < 30; ++n)
+            {
+                term *= -x * x / ((2 * n) * (2 * n + 1));
+                sum  += term;
+            }
+            return sum;
+        }
+
+        constexpr double cos(double x)
+        {
+            return sin(x + PI / 2);
+        }
+
+        constexpr double tan(double x)
+        {
+            return sin(x) / cos(x);
+        }
+
+        /* y such that y^n = x, for x > 0 */
+        constexpr double root(double x, unsigned n)
+        {
+            double r = 1;
+            for (int i = 0; i < 200; ++i)
+            {
+                double p = 1;
+                for (unsigned k = 1; k < n; ++k)
+                {
+                    p *= r;
+                }
+                double next = r - (p * r - x) / (n * p);
+                if (next == r)
+                {
+                    break;
+                }
+                r = next;
+            }
+            return r;
+        }
+
+        struct Complex
+        {
+            double re, im;
+        };
+
+        constexpr Complex operator+(Complex a, Complex b) { return { a.re + b.re, a.im + b.im }; }
+        constexpr Complex operator-(Complex a, Complex b) { return { a.re - b.re, a.im - b.im }; }
+        constexpr Complex operator*(Complex a, Complex b)
+        {
+            return { a.re * b.re - a.im * b.im, a.re * b.im + a.im * b.re };
+        }
+        constexpr Complex operator/(Complex a, Complex b)
+        {
+            double d = b.re * b.re + b.im * b.im;
+            return { (a.re * b.re + a.im * b.im) / d, (a.im * b.re - a.re * b.im) / d };
+        }
+        constexpr Complex conj(Complex a) { return { a.re, -a.im }; }
+        constexpr double  norm(Complex a) { return a.re * a.re + a.im * a.im; }
+
+        constexpr Complex csqrt(Complex a)
+        {
+            double r  = sqrt(norm(a));
+            double re = sqrt((r + a.re) / 2);
+            double im = sqrt((r - a.re) / 2);
+            return { re, a.im < 0 ? -im : im };
+        }
+
+        /* k-th pole (k = 1..n) of the analog Butterworth prototype, unit cutoff */
+        constexpr Complex prototypePole(unsigned k, unsigned n)
+        {
+            double theta = PI * (2.0 * k + n - 1) / (2.0 * n);
+            return { cos(theta), sin(theta) };
+        }
+
+        /* Prewarped bilinear transform of an analog pole, s-plane -> z-plane */
+        constexpr Complex bilinear(Complex s, double fs)
+        {
+            Complex twoFs = { 2 * fs, 0 };
+            return (twoFs + s) / (twoFs - s);
+        }
+
+        constexpr double prewarp(double f, double fs)
+        {
+            return 2 * fs * tan(PI * f / fs);
+        }
+
+        /* Denominator of a section from two z-plane poles (a conjugate or a real pair) */
+        constexpr Section poles(Complex p1, Complex p2)
+        {
+            Section s = {};
+            s.a1 = -(p1.re + p2.re);
+            s.a2 = (p1 * p2).re;
+            return s;
+        }
+
+        /* Denominator of a first-order section stored as a biquad */
+        constexpr Section pole(Complex p)
+        {
+            Section s = {};
+            s.a1 = -p.re;
+            return s;
+        }
+
+        constexpr double radius(const Section& s)
+        {
+            return s.a2 != 0 ? s.a2 : s.a1 * s.a1;
+        }
+
+        template <size_t N>
+        constexpr Design<N> sortByPoleRadius(Design<N> d)
+        {
+            for (size_t i = 1; i < N; ++i)
+            {
+                for (size_t j = i; j > 0 && radius(d.sections[j]) < radius(d.sections[j - 1]); --j)
+                {
+                    Section t          = d.sections[j];
+                    d.sections[j]      = d.sections[j - 1];
+                    d.sections[j - 1]  = t;
+                }
+            }
+            return d;
+        }
+
+        template <size_t N>
+        constexpr Design<N> lowHighPass(double fs, double fc, unsigned order, bool highPass)
+        {
+            // The Butterworth pole set is its own reciprocal, so high-pass has the same poles
+            const double wc = prewarp(fc, fs);
+            Design<N> d = {};
+            size_t i = 0;
+            for (unsigned k = 1; k <= order / 2; ++k)
+            {
+                Complex p = bilinear(prototypePole(k, order) * Complex{ wc, 0 }, fs);
+                d.sections[i++] = poles(p, conj(p));
+            }
+            if (order % 2)
+            {
+                d.sections[i++] = pole(bilinear(Complex{ -wc, 0 }, fs));
+            }
+
+            // Zeros at z = -1 (low-pass) or z = +1 (high-pass), unity gain at DC or Nyquist
+            for (Section& s : d.sections)
+            {
+                const bool   firstOrder = s.a2 == 0;
+                const double sign       = highPass ? -1 : 1;
+                const double gain       = firstOrder ? (1 + sign * s.a1) / 2
+                                                     : (1 + sign * s.a1 + s.a2) / 4;
+                s.b0 = gain;
+                s.b1 = sign * (firstOrder ? 1 : 2) * gain;
+                s.b2 = firstOrder ? 0 : gain;
+            }
+            return sortByPoleRadius(d);
+        }
+
+        template <size_t N>
+        constexpr Design<N> bandPass(double fs, double f1, double f2, unsigned order)
+        {
+            const double w1   = prewarp(f1, fs);
+            const double w2   = prewarp(f2, fs);
+            const double bw   = w2 - w1;
+            const Complex w0sq4 = { 4 * w1 * w2, 0 };
+
+            // Each prototype pole p maps to the roots of s^2 - p*bw*s + w0^2
+            Design<N> d = {};
+            Complex analog[2 * N] = {};
+            size_t n = 0;
+            for (unsigned k = 1; k <= (order + 1) / 2; ++k)
+            {
+                Complex pb   = prototypePole(k, order) * Complex{ bw, 0 };
+                Complex disc = csqrt(pb * pb - w0sq4);
+                Complex s1   = (pb + disc) * Complex{ 0.5, 0 };
+                Complex s2   = (pb - disc) * Complex{ 0.5, 0 };
+                Complex z1   = bilinear(s1, fs);
+                Complex z2   = bilinear(s2, fs);
+                analog[n++] = s1;
+                analog[n++] = s2;
+                if (2 * k - 1 == order)
+                {
+                    d.sections[2 * k - 2] = poles(z1, z2);  // real prototype pole: one section
+                }
+                else
+                {
+                    analog[n++] = conj(s1);                 // from the conjugate prototype pole
+                    analog[n++] = conj(s2);
+                    d.sections[2 * k - 2] = poles(z1, conj(z1));
+                    d.sections[2 * k - 1] = poles(z2, conj(z2));
+                }
+            }
+
+            // Gain of butter(): bw^N * (2fs)^N / prod(2fs - p) over all 2N analog poles
+            Complex gain = { 1, 0 };
+            for (unsigned k = 1; k <= order; ++k)
+            {
+                gain = gain * Complex{ bw * 2 * fs, 0 };
+            }
+            for (size_t i = 0; i < n; ++i)
+            {
+                gain = gain / (Complex{ 2 * fs, 0 } - analog[i]);
+            }
+            const double g = root(abs(gain.re), order);
+            for (Section& s : d.sections)
+            {
+                s.b0 = g;
+                s.b1 = 0;
+                s.b2 = -g;
+            }
+            return sortByPoleRadius(d);
+        }
+
+        constexpr int32_t toQ29(double c)
+        {
+            return static_cast<int32_t>(c * (1 << Q_COEFF) + (c < 0 ? -0.5 : 0.5));
+        }
+    }
+
+    /**
+     * @brief Multiplies the sections out into one transfer function (for comparison with butter()).
+     */
+    template <size_t N>
+    constexpr Polynomial<N> expand(const Design<N>& d)
+    {
+        Polynomial<N> p = {};
+        p.b[0] = 1;
+        p.a[0] = 1;
+        for (size_t i = 0; i < N; ++i)
+        {
+            const Section& s = d.sections[i];
+            for (size_t j = 2 * i + 2; j > 0; --j)
+            {
+                p.b[j] = s.b0 * p.b[j] + s.b1 * p.b[j - 1] + (j >= 2 ? s.b2 * p.b[j - 2] : 0);
+                p.a[j] =        p.a[j] + s.a1 * p.a[j - 1] + (j >= 2 ? s.a2 * p.a[j - 2] : 0);
+            }
+            p.b[0] *= s.b0;
+        }
+        return p;
+    }
+
+    /**
+     * @brief Rounds a design to Q29 sections.
+     */
+    template <size_t N>
+    struct Quantized
+    {
+        BiquadQ29 sections[N];
+    };
+
+    template <size_t N>
+    constexpr Quantized<N> quantize(const Design<N>& d)
+    {
+        Quantized<N> q = {};
+        for (size_t i = 0; i < N; ++i)
+        {
+            const Section& s = d.sections[i];
+            q.sections[i] = { detail::toQ29(s.b0), detail::toQ29(s.b1), detail::toQ29(s.b2),
+                              detail::toQ29(s.a1), detail::toQ29(s.a2) };
+        }
+        return q;
+    }
+
+    /**
+     * @brief Low-pass of order @p Order, cutoff @p Fc (-3 dB), sample rate @p Fs.
+     */
+    template <Frequency Fs, Frequency Fc, uint8_t Order>
+    struct LowPass
+    {
+        static_assert(Order > 0 && Fc > 0 && 2 * Fc < Fs, "cutoff must lie between 0 and Fs/2");
+        static constexpr size_t          SECTIONS = (Order + 1) / 2;
+        static constexpr Design<SECTIONS> design  = detail::lowHighPass<SECTIONS>(Fs / 1000.0, Fc / 1000.0, Order, false);
+        static constexpr Quantized<SECTIONS> q29  = quantize(design);
+    };
+
+    /**
+     * @brief High-pass of order @p Order, cutoff @p Fc (-3 dB), sample rate @p Fs.
+     */
+    template <Frequency Fs, Frequency Fc, uint8_t Order>
+    struct HighPass
+    {
+        static_assert(Order > 0 && Fc > 0 && 2 * Fc < Fs, "cutoff must lie between 0 and Fs/2");
+        static constexpr size_t          SECTIONS = (Order + 1) / 2;
+        static constexpr Design<SECTIONS> design  = detail::lowHighPass<SECTIONS>(Fs / 1000.0, Fc / 1000.0, Order, true);
+        static constexpr Quantized<SECTIONS> q29  = quantize(design);
+    };
+
+    /**
+     * @brief Band-pass @p F1..@p F2 of order 2 * @p Order, as butter(Order, [F1 F2] / (Fs/2), 'bandpass').
+     */
+    template <Frequency Fs, Frequency F1, Frequency F2, uint8_t Order>
+    struct BandPass
+    {
+        static_assert(Order > 0 && F1 > 0 && F1 < F2 && 2 * F2 < Fs, "band edges must satisfy 0 < F1 < F2 < Fs/2");
+        static constexpr size_t          SECTIONS = Order;
+        static constexpr Design<SECTIONS> design  = detail::bandPass<SECTIONS>(Fs / 1000.0, F1 / 1000.0, F2 / 1000.0, Order);
+        static constexpr Quantized<SECTIONS> q29  = quantize(design);
+    };
+
+    /**
+     * @class Cascade
+     * @brief Q15 filter running the Q29 sections of @p Filter, unrolled at compile time.
+     *
+     * Every coefficient is a constant expression in process(), so zero taps
+     * (b1 of a band-pass section, b2/a2 of a first-order one) cost nothing.
+     */
+    template <typename Filter>
+    class Cascade
+    {
+    public:
+        static constexpr size_t SECTIONS = Filter::SECTIONS;
+
+        /**
+         * @brief Clears the delay lines.
+         */
+        void reset()
+        {
+            for (BiquadState& s : state)
+            {
+                s = BiquadState{};
+            }
+        }
+
+        /**
+         * @brief Filters one Q15 sample.
+         */
+        int32_t process(int32_t x)
+        {
+            return run(x, std::make_index_sequence<SECTIONS>{});
+        }
+
+    private:
+        template <size_t... I>
+        int32_t run(int32_t x, std::index_sequence<I...>)
+        {
+            ((x = section<I>(x)), ...);
+            return x;
+        }
+
+        template <size_t I>
+        int32_t section(int32_t x)
+        {
+            constexpr BiquadQ29 c = Filter::q29.sections[I];
+            BiquadState& s = state[I];
+
+            int64_t acc = static_cast<int64_t>(c.b0) * x;
+            if (c.b1 != 0) { acc += static_cast<int64_t>(c.b1) * s.x1; }
+            if (c.b2 != 0) { acc += static_cast<int64_t>(c.b2) * s.x2; }
+            if (c.a1 != 0) { acc -= static_cast<int64_t>(c.a1) * s.y1; }
+            if (c.a2 != 0) { acc -= static_cast<int64_t>(c.a2) * s.y2; }
+
+            int32_t y = static_cast<int32_t>((acc + (1LL << (Q_COEFF - 1))) >> Q_COEFF);
+
+            s.x2 = s.x1;
+            s.x1 = x;
+            s.y2 = s.y1;
+            s.y1 = y;
+            return y;
+        }
+
+        BiquadState state[SECTIONS] = {};
+    };
+}
+
+#endif // BUTTERWORTH_HPP
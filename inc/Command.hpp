@@ -0,0 +1,113 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Command.hpp
+ * @brief Incremental parser of the UART command protocol.
+ *
+ * Commands are lines of a name and up to MAX_ARGS decimal integers separated
+ * by spaces, e.g. "ACQ 1" or "HPF 650". Names are case-insensitive.
+ * The parser consumes one byte per call from the UART receive interrupt and
+ * never buffers the line: the name is hashed while it arrives, numbers are
+ * accumulated digit by digit, and at the end of the line the command is found
+ * through a perfect hash of the name, so the cost per byte stays constant
+ * however many commands the table holds.
+ *
+ * | Command         | Effect                                               |
+ * |-----------------|------------------------------------------------------|
+ * | WALK++ / RUN++  | count a step detected by the host (no reply)         |
+ * | HOST <n>        | 1: count the host's steps, 0: the on-board detector's |
+ * | RESET           | same as the reset button                             |
+ * | ACQ <n>         | acquisition profile (sensor ODR, oversampling, I2C clock) |
+ * | HPF <mg>        | HPF (run) peak threshold in milli-g                  |
+ * | BPF <mg>        | BPF (walk) peak threshold in milli-g                 |
+ * | HDIST <n>       | samples locked out after an HPF peak                 |
+ * | BDIST <n>       | samples locked out after a BPF peak                  |
+ * | ADAPT <n>       | adaptive thresholds, n/10 from mean to peak (0 = off) |
+ * | TEXT / BIN      | "%1.4f" text lines / binary telemetry frames         |
+ * | COUNT           | print the step counters                              |
+ * | STATS           | print and clear the transmit, ISR, I2C and event counters |
+ * | CONFIG          | print the rate and detection parameters              |
+ * | PROFILE         | print and clear the per-stage cycle profile          |
+ * | REC <n>         | 1: restart the sample recorder, 0: stop it           |
+ * | DUMP <baud>     | send the recording as record frames (0 = fastest rate) |
+ * | BAUD <rate>     | switch the link rate, confirmed by the next command  |
+ */
+
+#ifndef COMMAND_HPP
+#define COMMAND_HPP
+
+#include <cstdint>
+
+/**
+ * @namespace command
+ * @brief UART command protocol: table, parser and parsed command.
+ */
+namespace command
+{
+    constexpr uint8_t MAX_NAME = 8;     /**< Longest command name. */
+    constexpr uint8_t MAX_ARGS = 1;     /**< Integer arguments per command. */
+
+    /**
+     * @brief Command identifiers, in table order.
+     */
+    enum class Id : uint8_t
+    {
+        Walk,
+        Run,
+        Reset,
+        Acquisition,
+        HpfThreshold,
+        BpfThreshold,
+        HpfDistance,
+        BpfDistance,
+        Adaptive,
+        Text,
+        Binary,
+        Count,
+        Stats,
+        Config,
+        Profile,
+        Record,
+        Dump,
+        Baud,
+        Host,
+        Unknown,    /**< Name not in the table. */
+        BadArgs     /**< Wrong number of arguments or not a number. */
+    };
+
+    /**
+     * @struct Command
+     * @brief A parsed command line.
+     */
+    struct Command
+    {
+        Id      id;
+        uint8_t argc;               /**< Arguments received. */
+        int32_t arg[MAX_ARGS];      /**< Argument values. */
+    };
+
+    /**
+     * @brief Feeds one received byte to the parser (receive interrupt).
+     * @param c Received character; '\r' or '\n' ends the line.
+     * @param out Filled when a non-empty line ends.
+     * @return True if @p out holds a command (possibly Unknown or BadArgs).
+     */
+    bool feed(char c, Command& out);
+
+    /**
+     * @brief Discards a partly received line, e.g. bytes from before a link rate change.
+     *
+     * Call with the receive interrupt masked.
+     */
+    void reset();
+
+    /**
+     * @brief Returns the name of a command, "?" for Unknown/BadArgs.
+     */
+    const char* name(Id id);
+}
+
+#endif // COMMAND_HPP
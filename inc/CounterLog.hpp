@@ -0,0 +1,156 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file CounterLog.hpp
+ * @brief Wear-leveled, power-loss safe log of the step counters in internal flash.
+ *
+ * Instead of erasing and rewriting one location, records are appended to a
+ * ring of flash sectors. Each sector starts with a header carrying a sequence
+ * number that grows by one per sector used, followed by fixed-size records:
+ *
+ *   Header (16 bytes)                Record (12 bytes)
+ *   +0  sequence                     +0  walk steps
+ *   +4  ~sequence                    +4  run steps
+ *   +8  format version               +8  CRC-16 of sequence, walk, run | ~CRC << 16
+ *   +12 magic "PCLG"  (commit)
+ *
+ * The last longword of each structure is programmed last and validates the
+ * others, so a power loss in the middle of a write leaves either the old
+ * or the new state. When the active sector is full the oldest one is erased
+ * and becomes active with the next sequence number; the previous sector keeps
+ * the latest record until the new one has its first valid record. Every
+ * sector is therefore erased once per RECORDS_PER_SECTOR * sectors records.
+ *
+ * restore() reads the sector headers, binary-searches the first erased slot of
+ * the newest sector (records are written in order) and walks back over at most
+ * one torn record, i.e. O(sectors + log2(RECORDS_PER_SECTOR)) flash reads
+ * instead of scanning the whole ring.
+ *
+ * Writes are rate limited and each poll() issues at most one sector erase or
+ * one record, so the main loop schedules them after a FIFO drain.
+ *
+ * Usage:
+ * @code
+ *   CounterLog log(0x7000, 4, 60000);
+ *   CounterLog::Counters saved;
+ *   log.restore(saved);
+ *   ...
+ *   log.poll({ walk, run }, power::nowMs());   // main loop
+ * @endcode
+ */
+
+#ifndef COUNTER_LOG_HPP
+#define COUNTER_LOG_HPP
+
+#include <cstdint>
+
+#include "Flash.hpp"
+
+/**
+ * @class CounterLog
+ * @brief Appends walk/run counter records to a ring of flash sectors.
+ */
+class CounterLog
+{
+public:
+    static constexpr uint32_t HEADER_SIZE = 16;
+    static constexpr uint32_t RECORD_SIZE = 12;
+    static constexpr uint16_t RECORDS_PER_SECTOR = (flash::SECTOR_SIZE - HEADER_SIZE) / RECORD_SIZE;
+    static constexpr uint8_t  MAX_SECTORS = 16;
+
+    /**
+     * @struct Counters
+     * @brief Values kept in one record.
+     */
+    struct Counters
+    {
+        uint32_t walk;  /**< Walking steps. */
+        uint32_t run;   /**< Running steps. */
+    };
+
+    /**
+     * @struct Stats
+     * @brief Flash activity since boot.
+     */
+    struct Stats
+    {
+        uint32_t records;       /**< Records written. */
+        uint32_t erases;        /**< Sectors erased. */
+        uint32_t errors;        /**< Failed program or erase commands. */
+        uint32_t restoreReads;  /**< Longwords read by the last restore(). */
+        uint32_t sequence;      /**< Sequence number of the active sector (0 = none yet). */
+        uint16_t freeSlots;     /**< Records left in the active sector. */
+    };
+
+    /**
+     * @brief Describes the log area; nothing is read until restore().
+     * @param base Sector-aligned flash address of the first sector.
+     * @param sectors Number of sectors in the ring (2..MAX_SECTORS).
+     * @param intervalMs Minimum time between two records written by poll().
+     */
+    CounterLog(uint32_t base, uint8_t sectors, uint32_t intervalMs);
+
+    /**
+     * @brief Finds the newest valid record and prepares the next write position.
+     *
+     * Must be called once before poll() or flush().
+     * @param counters Receives the saved counters, zero if there are none.
+     * @return 0 if a record was found, 1 if the log is empty.
+     */
+    uint8_t restore(Counters& counters);
+
+    /**
+     * @brief Writes a record if the counters changed and @p intervalMs passed since the last one.
+     *
+     * Runs at most one flash operation: the record, or the erase of the next
+     * sector when the active one is full (the record follows on the next call).
+     * A failed erase is retried after @p intervalMs, not on every call.
+     * @param nowMs Millisecond time base.
+     * @return true if the flash was written or erased.
+     */
+    bool poll(const Counters& counters, uint32_t nowMs);
+
+    /**
+     * @brief Writes the counters now if they changed, erasing a sector first if needed.
+     *
+     * A full sector is rotated right away, so the next poll() does not need an erase.
+     * @return 0 if successful, 1 on a flash error.
+     */
+    uint8_t flush(const Counters& counters);
+
+    /**
+     * @brief Returns the flash activity counters.
+     */
+    const Stats& stats() const { return counters; }
+
+private:
+    uint32_t sectorAddress(uint8_t sector) const { return base + sector * flash::SECTOR_SIZE; }
+    uint32_t slotAddress(uint16_t slot) const { return sectorAddress(active) + HEADER_SIZE + slot * RECORD_SIZE; }
+
+    uint32_t read(uint32_t address);
+    bool     readHeader(uint8_t sector, uint32_t& sequence);
+    uint16_t usedSlots(uint8_t sector);
+    bool     readRecord(uint8_t sector, uint16_t slot, uint32_t sequence, Counters& out);
+    uint8_t  rotate();
+    uint8_t  append(const Counters& values);
+
+    static uint32_t check(uint32_t sequence, const Counters& values);
+
+    uint32_t base;
+    uint8_t  sectors;
+    uint32_t intervalMs;
+
+    bool     restored;
+    uint8_t  active;        // sector receiving records, valid if sequence != 0
+    uint32_t sequence;      // its sequence number, 0 if no sector has a header yet
+    uint16_t nextSlot;      // first erased record slot in the active sector
+    Counters saved;         // values of the newest record
+    uint32_t lastWriteMs;
+    uint32_t reads;
+    Stats    counters;
+};
+
+#endif // COUNTER_LOG_HPP
@@ -0,0 +1,116 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Events.hpp
+ * @brief Event queue from the interrupt handlers to the main loop.
+ *
+ * Handlers only classify what happened and post an event; the LCD, counters and
+ * formatting are handled by the main loop, which keeps every handler short and
+ * the interrupt latency of the sampling path bounded.
+ *
+ * Usage:
+ * @code
+ *   // in an ISR
+ *   events::post(events::Type::Reset);
+ *
+ *   // in the main loop
+ *   events::Event ev;
+ *   while (events::poll(ev)) { ... }
+ * @endcode
+ *
+ * All handlers run at the same NVIC priority and never preempt each other, so
+ * together they are the single producer of the lock-free SpscQueue.
+ */
+
+#ifndef EVENTS_HPP
+#define EVENTS_HPP
+
+#include <cstdint>
+
+#include "Command.hpp"
+
+/**
+ * @namespace events
+ * @brief Interrupt-to-main-loop event passing.
+ */
+namespace events
+{
+    constexpr uint8_t QUEUE_SIZE = 16;     /**< Pending events (power of two). */
+
+    /**
+     * @brief Event kinds.
+     */
+    enum class Type : uint8_t
+    {
+        Reset,      /**< Reset button pressed. */
+        Command     /**< UART command line, parsed (see Command.hpp). */
+    };
+
+    /**
+     * @struct Event
+     * @brief One queued event.
+     */
+    struct Event
+    {
+        Type             type;
+        uint8_t          epoch;     /**< Link epoch when queued (see nextEpoch()). */
+        command::Command command;   /**< Valid for Type::Command. */
+    };
+
+    /**
+     * @struct Stats
+     * @brief Queue counters.
+     */
+    struct Stats
+    {
+        uint32_t posted;    /**< Events accepted. */
+        uint32_t dropped;   /**< Events lost to a full queue. */
+        uint8_t  peak;      /**< Highest number of pending events. */
+    };
+
+    /**
+     * @brief Queues an event (interrupt context).
+     * @return 0 on success, 1 if the queue was full.
+     */
+    uint8_t post(Type type);
+
+    /**
+     * @brief Queues a parsed UART command (interrupt context).
+     * @return 0 on success, 1 if the queue was full.
+     */
+    uint8_t postCommand(const command::Command& cmd);
+
+    /**
+     * @brief Takes the oldest event (main loop).
+     * @return True if an event was returned.
+     */
+    bool poll(Event& event);
+
+    /**
+     * @brief True if no event is pending. Safe to call with interrupts masked.
+     */
+    bool empty();
+
+    /**
+     * @brief Starts a new link epoch (main loop, receive interrupt masked), e.g. at a UART rate change.
+     *
+     * Events keep the epoch they were queued in, so the main loop can tell the
+     * commands received before the change from those received after it.
+     */
+    void nextEpoch();
+
+    /**
+     * @brief Returns the current link epoch.
+     */
+    uint8_t epoch();
+
+    /**
+     * @brief Returns the queue counters.
+     */
+    Stats stats();
+}
+
+#endif // EVENTS_HPP
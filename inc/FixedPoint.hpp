@@ -0,0 +1,111 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file FixedPoint.hpp
+ * @brief Integer-only sample conversion and decimal formatting for the sampling loop.
+ *
+ * The Cortex-M0+ has no FPU and no hardware divider, so "(double)x / 4096" and
+ * sprintf("%1.4f") pull in soft-float doubles and the float printf formatter.
+ * These functions produce the same text with shifts, multiplies and
+ * subtraction of powers of ten only.
+ *
+ * Usage:
+ * @code
+ *   char line[36];
+ *   char* p = fixedpoint::formatCounts(line, sample.x);   // "-0.0430"
+ *   p = fixedpoint::formatUnsigned(p, WalkStep);
+ * @endcode
+ * Every formatter writes a terminating '\0' and returns a pointer to it, so
+ * calls can be chained to build a line.
+ */
+
+#ifndef FIXED_POINT_HPP
+#define FIXED_POINT_HPP
+
+#include <cstdint>
+
+/**
+ * @namespace fixedpoint
+ * @brief Q-format conversion of accelerometer counts and decimal formatters.
+ */
+namespace fixedpoint
+{
+    constexpr uint8_t COUNTS_FRAC_BITS  = 12;   /**< 14-bit counts are Q12 g (4096 counts/g). */
+    constexpr uint8_t MILLI_G_FRAC_BITS = 9;    /**< Fraction bits of toMilliGQ9(). */
+    constexpr uint8_t MAX_FRAC_BITS     = 16;   /**< formatFixed() limits. */
+    constexpr uint8_t MAX_DECIMALS      = 4;
+
+    /**
+     * @brief Converts counts to milli-g in Q9, exactly: counts * 1000 / 4096 = counts * 125 / 512.
+     * @param counts Acceleration in 14-bit counts.
+     * @return Milli-g with 9 fraction bits.
+     */
+    constexpr int32_t toMilliGQ9(int16_t counts)
+    {
+        return static_cast<int32_t>(counts) * 125;
+    }
+
+    /**
+     * @brief Converts counts to whole milli-g, rounded to nearest.
+     * @param counts Acceleration in 14-bit counts.
+     */
+    constexpr int32_t toMilliG(int16_t counts)
+    {
+        return (toMilliGQ9(counts) + (1 << (MILLI_G_FRAC_BITS - 1))) >> MILLI_G_FRAC_BITS;
+    }
+
+    /**
+     * @brief Writes an unsigned value in decimal ("%lu").
+     * @param out Destination, at least 11 characters.
+     * @return Pointer to the terminating '\0'.
+     */
+    char* formatUnsigned(char* out, uint32_t value);
+
+    /**
+     * @brief Writes a signed value in decimal ("%ld").
+     * @param out Destination, at least 12 characters.
+     * @return Pointer to the terminating '\0'.
+     */
+    char* formatSigned(char* out, int32_t value);
+
+    /**
+     * @brief Writes a signed fixed-point value with a fixed number of decimals ("%.<decimals>f").
+     *
+     * Rounds half to even on exact ties, like printf, so the text matches
+     * printf("%1.4f", value / 2^fracBits) for every input.
+     * @param out Destination, at least 13 + decimals characters.
+     * @param value Fixed-point value.
+     * @param fracBits Fraction bits of @p value (1..MAX_FRAC_BITS).
+     * @param decimals Digits after the decimal point (1..MAX_DECIMALS).
+     * @return Pointer to the terminating '\0'.
+     */
+    char* formatFixed(char* out, int32_t value, uint8_t fracBits, uint8_t decimals);
+
+    /**
+     * @brief Writes an unsigned decimal fixed-point value, @p value / 10^decimals ("1234", 3 -> "1.234").
+     * @param out Destination, at least 12 characters.
+     * @param decimals Digits after the decimal point (0..9); 0 is formatUnsigned().
+     * @return Pointer to the terminating '\0'.
+     */
+    char* formatDecimal(char* out, uint32_t value, uint8_t decimals);
+
+    /**
+     * @brief Writes 14-bit counts as g with four decimals, same text as "%1.4f" of counts / 4096.
+     * @return Pointer to the terminating '\0'.
+     */
+    inline char* formatCounts(char* out, int16_t counts)
+    {
+        return formatFixed(out, counts, COUNTS_FRAC_BITS, 4);
+    }
+
+    /**
+     * @brief Copies a string (without its terminator) and terminates the result.
+     * @return Pointer to the terminating '\0'.
+     */
+    char* append(char* out, const char* str);
+}
+
+#endif // FIXED_POINT_HPP
@@ -0,0 +1,64 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Flash.hpp
+ * @brief FTFA program/erase driver for the KL05Z internal flash.
+ *
+ * The 32 KB program flash is one block, so it cannot be read while a command
+ * runs: the launch-and-wait loop is executed from RAM with interrupts masked
+ * (the vector table and the handlers are in flash). A longword program takes
+ * about 65 us, a sector erase about 14 ms (up to 145 us / 114 ms worst case);
+ * callers keep both off the sampling path. The mask cannot be narrowed, so
+ * UART bytes arriving during an erase overrun the receiver and are lost; the
+ * receive interrupt clears the overrun and restarts the command parser.
+ *
+ * Programming can only clear bits: a longword must be erased (all ones)
+ * before it is written.
+ */
+
+#ifndef FLASH_HPP
+#define FLASH_HPP
+
+#include <cstdint>
+
+/**
+ * @namespace flash
+ * @brief Internal flash access.
+ */
+namespace flash
+{
+    constexpr uint32_t SIZE        = 32768;   /**< Program flash size [bytes]. */
+    constexpr uint32_t SECTOR_SIZE = 1024;    /**< Erase unit [bytes]. */
+    constexpr uint32_t ERASED      = 0xFFFFFFFFu;
+
+    /**
+     * @brief Reads one longword.
+     * @param address 4-byte aligned flash address.
+     */
+    uint32_t read(uint32_t address);
+
+    /**
+     * @brief Programs one erased longword.
+     * @param address 4-byte aligned flash address.
+     * @param value Value to store.
+     * @return 0 if successful, 1 on an access or protection error.
+     */
+    uint8_t program(uint32_t address, uint32_t value);
+
+    /**
+     * @brief Erases the sector containing @p address to all ones.
+     * @return 0 if successful, 1 on an access or protection error.
+     */
+    uint8_t eraseSector(uint32_t address);
+
+    /**
+     * @brief Returns the first flash address after the program image (code, constants
+     *        and the initial values of the RAM data), 0 if unknown (simulator).
+     */
+    uint32_t imageEnd();
+}
+
+#endif // FLASH_HPP
@@ -0,0 +1,157 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file GaitMetrics.hpp
+ * @brief Rolling cadence, speed and distance from the step events.
+ *
+ * Every step is stored as a 16-bit sample timestamp (plus a run bit) in a ring
+ * of CAPACITY entries. Each rolling window keeps its own tail index and step
+ * counts, so adding a step and expiring old ones costs O(1) per step and
+ * window; a query reads only the oldest and newest entry of each window:
+ *
+ *   cadence = 60 * rate * (steps - 1) / (newest - oldest)      [steps/min]
+ *
+ * and splits it into walk and run by their share of the window's steps.
+ * Cadence drops to zero when no step came for Config::idleSeconds.
+ *
+ * Stride length follows a linear model of the cadence per step type,
+ * stride = baseMm + mmPer100Spm * cadence / 100 (mmPer100Spm = 0 gives a
+ * fixed stride). Each step adds its stride to the distance when it is counted,
+ * and speed is cadence times stride. Everything is integer arithmetic.
+ *
+ * Timestamps are sample indices modulo 65536, so windows must stay below
+ * 32768 samples (54 min at 10 Hz), and a window holds at most CAPACITY steps
+ * (38 s at 200 steps/min).
+ *
+ * Like StepDetector, the module does not touch any peripheral.
+ */
+
+#ifndef GAIT_METRICS_HPP
+#define GAIT_METRICS_HPP
+
+#include "StepDetector.hpp"
+
+#include <cstdint>
+
+/**
+ * @class GaitMetrics
+ * @brief O(1) per-step cadence, speed and distance estimator.
+ */
+class GaitMetrics
+{
+public:
+    static constexpr uint8_t CAPACITY = 128;    /**< Step timestamps kept. */
+    static constexpr uint8_t WINDOWS  = 2;      /**< Rolling windows (short, long). */
+
+    /**
+     * @struct StrideModel
+     * @brief Stride length as a linear function of the cadence.
+     */
+    struct StrideModel
+    {
+        uint16_t baseMm;        /**< Stride at zero cadence [mm]. */
+        uint16_t mmPer100Spm;   /**< Added stride per 100 steps/min [mm], 0 = fixed stride. */
+    };
+
+    /**
+     * @struct Config
+     * @brief Window lengths and stride models.
+     */
+    struct Config
+    {
+        uint16_t    windowSeconds[WINDOWS] = { 10, 30 };  /**< Rolling window lengths [s]. */
+        uint8_t     idleSeconds = 2;                      /**< No step for this long: cadence 0 [s]. */
+        StrideModel walk = { 300, 350 };                  /**< ~0.68 m at 110 steps/min. */
+        StrideModel run  = { 200, 600 };                  /**< ~1.16 m at 160 steps/min. */
+    };
+
+    /**
+     * @struct Window
+     * @brief Results over one rolling window.
+     */
+    struct Window
+    {
+        uint16_t steps;         /**< Steps in the window. */
+        uint16_t cadence;       /**< All steps [steps/min]. */
+        uint16_t walkCadence;   /**< Walking share of the cadence [steps/min]. */
+        uint16_t runCadence;    /**< Running share of the cadence [steps/min]. */
+        uint16_t speedMmS;      /**< Cadence times stride [mm/s]. */
+    };
+
+    /**
+     * @struct Metrics
+     * @brief All results at one point in time.
+     */
+    struct Metrics
+    {
+        Window   window[WINDOWS];   /**< Per rolling window, shortest first. */
+        uint32_t walkDistanceMm;    /**< Distance walked since reset() [mm]. */
+        uint32_t runDistanceMm;     /**< Distance run since reset() [mm]. */
+    };
+
+    /**
+     * @brief Creates an estimator with the default windows and stride models.
+     * @param rateHz Sample rate of the timestamps.
+     */
+    explicit GaitMetrics(uint16_t rateHz = 10);
+
+    /**
+     * @brief Creates an estimator with a custom configuration.
+     */
+    GaitMetrics(const Config& cfg, uint16_t rateHz);
+
+    /**
+     * @brief Clears the step history and the distances.
+     */
+    void reset();
+
+    /**
+     * @brief Changes the timestamp rate; the step history is cleared, the distances are kept.
+     */
+    void setRate(uint16_t rateHz);
+
+    /**
+     * @brief Counts one step and adds its stride to the distance.
+     * @param step Walk or Run (None is ignored).
+     * @param sample Sample index of the step.
+     */
+    void addStep(StepDetector::Step step, uint32_t sample);
+
+    /**
+     * @brief Returns the results at @p sample (expires steps that left the windows).
+     */
+    Metrics metrics(uint32_t sample);
+
+    /**
+     * @brief Stride of one step type at a cadence [mm].
+     */
+    static uint16_t stride(const StrideModel& model, uint16_t cadence);
+
+    /**
+     * @brief Gives access to the configuration; window changes apply to new steps.
+     */
+    Config& config() { return cfg; }
+
+private:
+    void     expire(uint32_t sample);
+    uint16_t cadence(uint8_t window, uint32_t sample) const;
+    bool     isRun(uint8_t entry) const { return runBits[entry >> 3] & (1u << (entry & 7u)); }
+
+    Config   cfg;
+    uint16_t rate;                          /**< Timestamp rate [Hz]. */
+    uint16_t times[CAPACITY];               /**< Step sample indices modulo 65536, ring. */
+    uint8_t  runBits[CAPACITY / 8];         /**< Set for running steps. */
+    uint8_t  head;                          /**< Next entry to write. */
+    uint8_t  stored;                        /**< Valid entries (up to CAPACITY). */
+    uint8_t  tail[WINDOWS];                 /**< Oldest entry inside each window. */
+    uint8_t  count[WINDOWS];                /**< Steps inside each window. */
+    uint8_t  runCount[WINDOWS];             /**< Running steps inside each window. */
+    uint32_t lastStep;                      /**< Full sample index of the newest step. */
+    uint32_t walkDistance;                  /**< [mm] */
+    uint32_t runDistance;                   /**< [mm] */
+};
+
+#endif // GAIT_METRICS_HPP
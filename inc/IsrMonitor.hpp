@@ -0,0 +1,109 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file IsrMonitor.hpp
+ * @brief Execution-time instrumentation of the interrupt handlers.
+ *
+ * Every handler opens an isrmon::Scope on entry; its destructor adds the
+ * cycles spent in the handler to the statistics of that interrupt source.
+ * The longest handler bounds how late any other interrupt of the same
+ * priority can be served, so maxCycles is the worst-case latency it imposes.
+ *
+ * Cycles are read from SysTick, which must be free-running over its full
+ * 24-bit range (started by isrmon::init() or the Uart constructor).
+ */
+
+#ifndef ISR_MONITOR_HPP
+#define ISR_MONITOR_HPP
+
+#include <cstdint>
+
+/**
+ * @namespace isrmon
+ * @brief Per-source interrupt handler timing.
+ */
+namespace isrmon
+{
+    /**
+     * @brief Instrumented interrupt sources.
+     */
+    enum class Source : uint8_t
+    {
+        PortA,
+        Uart0,
+        Dma0,
+        Pit,
+        I2c0,
+        Lptmr,
+        Count
+    };
+
+    /**
+     * @struct Stats
+     * @brief Handler timing of one source since the last reset().
+     */
+    struct Stats
+    {
+        uint32_t count;         /**< Handler invocations. */
+        uint32_t lastCycles;    /**< Duration of the last invocation [core cycles]. */
+        uint32_t maxCycles;     /**< Longest invocation [core cycles]. */
+    };
+
+    /**
+     * @brief Starts SysTick as a free-running cycle counter unless it already runs.
+     */
+    void init();
+
+    /**
+     * @brief Returns the current SysTick value (counts down).
+     */
+    uint32_t cycleStamp();
+
+    /**
+     * @brief Returns the core cycles elapsed since @p start (up to 2^24 - 1).
+     */
+    uint32_t cyclesSince(uint32_t start);
+
+    /**
+     * @brief Adds one handler run that started at @p start to the statistics of @p source.
+     */
+    void record(Source source, uint32_t start);
+
+    /**
+     * @brief Returns the timing of one source.
+     */
+    const Stats& stats(Source source);
+
+    /**
+     * @brief Returns a short lower-case name of the source ("porta", "uart0", ...).
+     */
+    const char* name(Source source);
+
+    /**
+     * @brief Clears the statistics of all sources.
+     */
+    void reset();
+
+    /**
+     * @class Scope
+     * @brief Times the enclosing handler body.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(Source source) : source(source), start(cycleStamp()) {}
+        ~Scope() { record(source, start); }
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Source   source;
+        uint32_t start;
+    };
+}
+
+#endif // ISR_MONITOR_HPP
@@ -19,6 +19,16 @@
  *   lcd::print("Hello!");
  * @endcode
  *
+ * For frequent updates use the shadow framebuffer instead: write()/writeLine()
+ * only change a 2x16 copy in RAM (safe to call from interrupts), and flush()
+ * sends just the cells that differ from what the display shows:
+ * @code
+ *   lcd::writeLine(1, "Walk: 3 Run: 1");
+ *   lcd::flush();
+ * @endcode
+ * The direct functions (print, setCursor, clearAll) write through, so both
+ * styles can be mixed.
+ *
  * @copyright Copyright (c) 2025 YourName
  */
 
@@ -33,11 +43,32 @@
  */
 namespace lcd
 {
+    constexpr uint8_t ROWS = 2;     /**< Display rows. */
+    constexpr uint8_t COLS = 16;    /**< Visible characters per row. */
+
+    /**
+     * @struct FlushStats
+     * @brief Shadow framebuffer counters, in bytes on the I2C bus.
+     */
+    struct FlushStats
+    {
+        uint32_t flushes;       /**< flush() calls that found dirty cells. */
+        uint32_t cellsWritten;  /**< Characters sent to the display. */
+        uint32_t cursorMoves;   /**< Set DDRAM address commands sent. */
+        uint32_t bytesSent;     /**< I2C bytes used by flush(). */
+        uint32_t bytesSaved;    /**< I2C bytes saved against a full clear and redraw. */
+    };
+
     /**
      * @brief Initializes the LCD in 4-bit mode and configures basic parameters like cursor and blink.
      */
     void init();
 
+    /**
+     * @brief 7-bit I2C address of the PCF8574 found by init().
+     */
+    uint8_t address();
+
     /**
      * @brief Clears the entire display (both lines).
      */
@@ -71,6 +102,33 @@ namespace lcd
      * @brief Disables the blinking of the cursor.
      */
     void blinkOff();
+
+    /**
+     * @brief Writes text into the shadow framebuffer (clipped at the end of the row).
+     * @param col Column index (0-based).
+     * @param row Row index (0-based).
+     * @param str Pointer to a null-terminated string.
+     */
+    void write(uint8_t col, uint8_t row, const char* str);
+
+    /**
+     * @brief Replaces a whole row of the shadow framebuffer, padding with spaces.
+     * @param row Row index (0-based).
+     * @param str Pointer to a null-terminated string.
+     */
+    void writeLine(uint8_t row, const char* str);
+
+    /**
+     * @brief Sends the cells that changed since the last flush, with as few cursor moves as possible.
+     *
+     * The bytes used and saved against a full clear and redraw are added to flushStats().
+     */
+    void flush();
+
+    /**
+     * @brief Returns the shadow framebuffer counters (printed by the STATS report).
+     */
+    const FlushStats& flushStats();
 }
 
 #endif // LCD_HPP
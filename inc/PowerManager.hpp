@@ -0,0 +1,117 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file PowerManager.hpp
+ * @brief Low-power sleep between samples and time-in-state accounting.
+ *
+ * The sampling loops call power::sleep() instead of a bare __WFI. It enters
+ * WAIT (core clock gated, peripherals running) or, when the caller allows it
+ * and no bus-clocked transfer is running, VLPS (core, bus and FLL stopped;
+ * only the PORTA pin interrupts and LPTMR0 wake the core). VLPS is refused
+ * while the UART transmitter or the I2C bus is busy, since their clocks stop.
+ *
+ * Time is measured with LPTMR0 counting the 1 kHz LPO, the only clock that
+ * keeps running in VLPS, extended to 32 bits by its compare interrupt. Each
+ * state's share is accurate to 1 ms per transition on average, plenty for
+ * percentages over seconds.
+ *
+ * Usage, with the same masked-WFI pattern as before:
+ * @code
+ *   __disable_irq();
+ *   while (!ready)
+ *   {
+ *       power::sleep(power::State::Vlps);
+ *       __enable_irq();
+ *       __disable_irq();
+ *   }
+ *   __enable_irq();
+ * @endcode
+ */
+
+#ifndef POWER_MANAGER_HPP
+#define POWER_MANAGER_HPP
+
+#include <cstdint>
+
+extern "C" void LPTMR0_IRQHandler(void);
+
+/**
+ * @namespace power
+ * @brief Sleep mode selection and power state statistics.
+ */
+namespace power
+{
+    /**
+     * @brief Power states, in order of increasing depth.
+     */
+    enum class State : uint8_t
+    {
+        Run,    /**< Core executing. */
+        Wait,   /**< WAIT: core clock gated, bus clock running. */
+        Vlps,   /**< VLPS between samples, woken by the sensor FIFO interrupt. */
+        Idle,   /**< VLPS in deep idle, woken by the sensor motion interrupt. */
+        Count
+    };
+
+    /**
+     * @struct Stats
+     * @brief Time-in-state and wake-up counters since the last reset().
+     */
+    struct Stats
+    {
+        uint32_t timeMs[static_cast<uint8_t>(State::Count)];   /**< Time spent in each state [ms]. */
+        uint32_t sleeps[static_cast<uint8_t>(State::Count)];   /**< Sleeps entered in each state. */
+        uint32_t wakeups;           /**< Returns from deep idle. */
+        uint32_t wakeLatencyLastMs; /**< Motion interrupt to first processed sample, last wake-up [ms]. */
+        uint32_t wakeLatencyMaxMs;  /**< Longest wake-to-first-sample latency [ms]. */
+    };
+
+    /**
+     * @brief Allows VLPS and starts LPTMR0 as the millisecond time base.
+     */
+    void init();
+
+    /**
+     * @brief Milliseconds since init(), valid in every power mode.
+     */
+    uint32_t nowMs();
+
+    /**
+     * @brief Sleeps until the next interrupt in @p deepest, or in WAIT if VLPS is not possible now.
+     *
+     * Must be called with interrupts masked (PRIMASK set): the pending interrupt
+     * still ends the sleep and runs as soon as the caller unmasks interrupts.
+     * @param deepest Wait, Vlps or Idle.
+     */
+    void sleep(State deepest);
+
+    /**
+     * @brief Records the motion wake-up that ends deep idle.
+     */
+    void markWake();
+
+    /**
+     * @brief Records the first sample processed after markWake() (later calls are ignored).
+     */
+    void markSample();
+
+    /**
+     * @brief Returns the statistics, with the time of the current run period included.
+     */
+    const Stats& stats();
+
+    /**
+     * @brief Clears the statistics.
+     */
+    void reset();
+
+    /**
+     * @brief Short state name for reports.
+     */
+    const char* name(State state);
+}
+
+#endif // POWER_MANAGER_HPP
@@ -0,0 +1,131 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Profiler.hpp
+ * @brief Per-stage cycle profiling of the firmware pipeline.
+ *
+ * The Cortex-M0+ has no DWT cycle counter, so stages are timed with the
+ * free-running SysTick used by isrmon (24 bits, i.e. stages up to ~350 ms).
+ * Each stage keeps count, min, max and total cycles in a fixed table; the
+ * PROFILE UART command prints and clears it. The interrupt handlers are
+ * profiled through their isrmon::Scope.
+ *
+ * Profiling is enabled by defining PROFILING=1 for the whole project (Keil:
+ * Options for Target > C/C++ > Define; host: the PEDOMETER_PROFILING CMake
+ * option). Otherwise the macros expand to nothing and the table is not
+ * compiled in, so production images carry no overhead.
+ *
+ * Usage:
+ * @code
+ *   void lcd::flush()
+ *   {
+ *       PROFILE_SCOPE(LcdFlush);   // times the rest of the block
+ *       ...
+ *   }
+ * @endcode
+ */
+
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <cstdint>
+
+#ifndef PROFILING
+  #define PROFILING 0
+#endif
+
+/**
+ * @namespace profile
+ * @brief Cycle statistics of the instrumented stages.
+ */
+namespace profile
+{
+    /**
+     * @brief Instrumented stages; the Isr* entries follow isrmon::Source order.
+     */
+    enum class Stage : uint8_t
+    {
+        AccelConfig,    /**< MMA8451Q configuration writes (init*). */
+        ReadBlock,      /**< I2C::readRegBlock (FIFO burst or one sample). */
+        Detect,         /**< StepDetector::process. */
+        Format,         /**< Sample conversion and text formatting. */
+        UartPrintln,    /**< Uart::println (queueing only). */
+        LcdFlush,       /**< lcd::flush. */
+        LogRestore,     /**< CounterLog::restore at boot. */
+        LogWrite,       /**< CounterLog record or sector erase. */
+        IsrPortA,
+        IsrUart0,
+        IsrDma0,
+        IsrPit,
+        IsrI2c0,
+        IsrLptmr,
+        Count
+    };
+
+    /**
+     * @struct Stats
+     * @brief Cycle statistics of one stage since the last reset().
+     */
+    struct Stats
+    {
+        uint32_t count;         /**< Completed runs. */
+        uint32_t minCycles;     /**< Shortest run [core cycles]. */
+        uint32_t maxCycles;     /**< Longest run [core cycles]. */
+        uint64_t totalCycles;   /**< Sum of all runs, for the mean [core cycles]. */
+    };
+
+#if PROFILING
+    /**
+     * @brief Adds one run of @p cycles to a stage.
+     */
+    void record(Stage stage, uint32_t cycles);
+
+    /**
+     * @brief Returns the statistics of one stage.
+     */
+    const Stats& stats(Stage stage);
+
+    /**
+     * @brief Returns a short lower-case stage name ("detect", "isr_pit", ...).
+     */
+    const char* name(Stage stage);
+
+    /**
+     * @brief Clears all stages.
+     */
+    void reset();
+
+    /**
+     * @class Scope
+     * @brief Times the enclosing block.
+     */
+    class Scope
+    {
+    public:
+        explicit Scope(Stage stage);
+        ~Scope();
+
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        Stage    stage;
+        uint32_t start;
+    };
+#endif
+}
+
+#if PROFILING
+  #define PROFILE_CONCAT_(a, b)       a##b
+  #define PROFILE_CONCAT(a, b)        PROFILE_CONCAT_(a, b)
+  #define PROFILE_SCOPE(stage)        profile::Scope PROFILE_CONCAT(profileScope, __LINE__)(profile::Stage::stage)
+  #define PROFILE_RECORD(stage, cycles) profile::record((stage), (cycles))
+#else
+  #define PROFILE_SCOPE(stage)        do { } while (0)
+  #define PROFILE_RECORD(stage, cycles) do { } while (0)
+#endif
+
+#endif // PROFILER_HPP
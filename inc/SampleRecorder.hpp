@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SampleRecorder.hpp
+ * @brief Delta-compressed recorder of the raw X/Y/Z samples for offline download.
+ *
+ * The live stream is limited by the UART, so a whole walk cannot be captured
+ * for debugging a missed step. The recorder keeps the samples fed to the
+ * detector instead, in fixed 128-byte blocks:
+ *
+ *   +0  index of the first sample      +6  samples in the block
+ *   +4  sample rate [Hz]               +7  encoded bytes (L)
+ *   +8  L bytes of DeltaCoder bit stream (see Telemetry.hpp)
+ *
+ * Each axis is stored as the difference to the previous sample in an
+ * adaptive Golomb-Rice code, about 10 to 13 bits per axis while walking at
+ * 10 Hz and 1 to 4 while still, losslessly. The first sample of a block is
+ * stored raw and the code parameters start over, which makes every block
+ * decodable on its own: dropping the oldest blocks, or a gap in the sample
+ * indices (deep idle), starts a new block and never corrupts the others.
+ *
+ * Blocks are built in a ring of RECORDER_RAM_BLOCKS blocks in RAM. Without
+ * flash the oldest block is overwritten when the ring is full. With a flash
+ * area, poll() moves each completed block into a ring of flash sectors
+ * (BLOCKS_PER_SECTOR per sector), erasing the oldest sector as it wraps, and
+ * RAM only buffers the blocks not written yet. Like CounterLog, each poll()
+ * runs at most one block write (32 longwords, about 2 ms) or one sector
+ * erase, so the main loop calls it after the sample work. A failed write
+ * leaves a gap in the flash ring and the block goes to the next slot; a
+ * sector whose erase fails ERASE_ATTEMPTS times in a row is skipped from
+ * then on, so a worn sector costs its own blocks only. The recording
+ * restarts with start() and is not kept across resets.
+ *
+ * readBlock() returns the blocks oldest first, for a bulk download as
+ * FRAME_RECORD telemetry frames.
+ *
+ * Usage:
+ * @code
+ *   SampleRecorder recorder(0x5000, 8);
+ *   recorder.start(10);
+ *   recorder.add(index, x, y, z);          // per sample
+ *   recorder.poll();                       // main loop
+ * @endcode
+ */
+
+#ifndef SAMPLE_RECORDER_HPP
+#define SAMPLE_RECORDER_HPP
+
+#include <cstdint>
+
+#include "Flash.hpp"
+#include "Telemetry.hpp"
+
+/**
+ * @brief Blocks of 128 bytes buffered in RAM (at least 2).
+ *
+ * Two are enough with a flash area: a block takes 10 or more samples to
+ * fill (about 30 while walking), and poll() needs two calls at most (erase, then write) to move the
+ * previous one out. More only lengthen a RAM-only recording; with 4 KB of
+ * SRAM each one is 3 % of it.
+ */
+#ifndef RECORDER_RAM_BLOCKS
+  #define RECORDER_RAM_BLOCKS 2
+#endif
+
+/**
+ * @class SampleRecorder
+ * @brief Circular block store of delta + adaptive Golomb-Rice encoded samples.
+ */
+class SampleRecorder
+{
+public:
+    static constexpr uint8_t  HEADER_SIZE  = 8;
+    static constexpr uint8_t  PAYLOAD_SIZE = telemetry::RECORD_PAYLOAD_SIZE;
+    static constexpr uint16_t BLOCK_SIZE   = HEADER_SIZE + PAYLOAD_SIZE;
+    static constexpr uint8_t  BLOCKS_PER_SECTOR = flash::SECTOR_SIZE / BLOCK_SIZE;
+    static constexpr uint8_t  RAM_BLOCKS   = RECORDER_RAM_BLOCKS;
+    static constexpr uint8_t  MAX_SECTORS  = 16;
+    static constexpr uint8_t  ERASE_ATTEMPTS = 3;     /**< Failed erases before a sector is skipped for good. */
+
+    /**
+     * @struct Block
+     * @brief One recorder block, as stored in RAM and flash.
+     */
+    struct Block
+    {
+        uint32_t firstSample;               /**< Index of the first sample. */
+        uint16_t rateHz;                    /**< Sample rate [Hz]. */
+        uint8_t  samples;                   /**< Samples in the block. */
+        uint8_t  size;                      /**< Encoded bytes in payload. */
+        uint8_t  payload[PAYLOAD_SIZE];     /**< DeltaCoder bit stream. */
+    };
+
+    /**
+     * @struct Stats
+     * @brief Recording counters since start().
+     */
+    struct Stats
+    {
+        uint32_t samples;       /**< Samples encoded. */
+        uint32_t bytes;         /**< Encoded bytes (without block headers). */
+        uint32_t blocks;        /**< Blocks completed. */
+        uint32_t dropped;       /**< Blocks overwritten or erased before a download. */
+        uint32_t flashBlocks;   /**< Blocks written to flash. */
+        uint32_t errors;        /**< Failed program or erase commands. */
+        uint32_t encodeCycles;  /**< Core cycles spent in add(). */
+    };
+
+    /**
+     * @brief Describes the storage; recording starts with start().
+     * @param flashBase Sector-aligned flash address of the spill area.
+     * @param flashSectors Sectors in the spill area (0 = RAM only, up to MAX_SECTORS).
+     */
+    SampleRecorder(uint32_t flashBase, uint8_t flashSectors);
+
+    /**
+     * @brief Discards the recording and starts a new one.
+     * @param rateHz Sample rate of the following samples.
+     */
+    void start(uint16_t rateHz);
+
+    /**
+     * @brief Stops recording; the blocks are kept for a download.
+     */
+    void stop();
+
+    /**
+     * @brief Returns true between start() and stop().
+     */
+    bool recording() const { return active; }
+
+    /**
+     * @brief Encodes one sample (ignored while stopped).
+     * @param sample Sample index; a gap to the previous one starts a new block.
+     */
+    void add(uint32_t sample, int16_t x, int16_t y, int16_t z);
+
+    /**
+     * @brief Writes the oldest completed RAM block to flash, or erases the next sector.
+     * @return true if the flash was written or erased.
+     */
+    bool poll();
+
+    /**
+     * @brief Returns the number of blocks readBlock() can return, including the one being filled.
+     */
+    uint16_t blocks() const;
+
+    /**
+     * @brief Copies one block, 0 = oldest.
+     * @return 0 if successful, 1 if @p index is out of range.
+     */
+    uint8_t readBlock(uint16_t index, Block& out) const;
+
+    /**
+     * @brief Returns the recording counters.
+     */
+    const Stats& stats() const { return counters; }
+
+private:
+    void     close();
+    uint8_t  ramSlot(uint8_t age) const;
+    uint16_t flashSlot(uint16_t age) const;
+    bool     slotWritten(uint16_t slot) const;
+    void     markSlot(uint16_t slot, bool valid);
+    uint32_t flashAddress(uint16_t slot) const { return flashBase + slot * BLOCK_SIZE; }
+
+    uint32_t flashBase;
+    uint16_t flashCapacity;         // blocks in the flash ring, 0 = RAM only
+
+    bool     active;
+    uint16_t rate;
+    int16_t  previous[3];           // last sample of the open block
+    telemetry::DeltaCoder coder;    // code state of the open block
+    Block    ram[RAM_BLOCKS];       // ring; ram[head] is the open block
+    uint8_t  head;
+    uint8_t  pending;               // completed blocks before head, oldest first
+    uint16_t flashHead;             // next flash slot to write
+    uint16_t flashCount;            // slots before flashHead, oldest first (gaps included)
+    bool     headErased;            // the sector starting at flashHead is erased
+    uint8_t  eraseFailures;         // failed erases of the sector at flashHead
+    uint16_t badSectors;            // sectors skipped after ERASE_ATTEMPTS failures, bit per sector
+    uint8_t  written[MAX_SECTORS * flash::SECTOR_SIZE / BLOCK_SIZE / 8];   // slot holds a block, bit per slot
+    Stats    counters;
+};
+
+#endif // SAMPLE_RECORDER_HPP
@@ -0,0 +1,86 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SampleTimer.hpp
+ * @brief PIT-driven sample scheduler with jitter and overrun measurement.
+ *
+ * PIT channel 0 generates one tick per sampling period. The main loop calls
+ * SampleTimer::waitForTick(), which keeps the core in WAIT (__WFI) until the
+ * next tick instead of spinning in DELAY(). The time between the tick and the
+ * return from waitForTick() is the acquisition latency; its spread is the jitter.
+ * A tick that fires while the previous one has not been consumed yet is an overrun.
+ */
+
+#ifndef SAMPLE_TIMER_HPP
+#define SAMPLE_TIMER_HPP
+
+#include <cstdint>
+
+extern "C" {
+#include "MKL05Z4.h"
+}
+
+extern "C" void PIT_IRQHandler(void);
+
+/**
+ * @namespace SampleTimer
+ * @brief Periodic acquisition tick generated by PIT channel 0.
+ */
+namespace SampleTimer
+{
+    constexpr uint16_t MIN_RATE_HZ = 10;   /**< Lowest supported sample rate. */
+    constexpr uint16_t MAX_RATE_HZ = 200;  /**< Highest supported sample rate. */
+
+    /**
+     * @struct Stats
+     * @brief Timing statistics since the last resetStats().
+     */
+    struct Stats
+    {
+        uint32_t ticks;             /**< Ticks generated by the PIT. */
+        uint32_t samples;           /**< Ticks consumed by waitForTick(). */
+        uint32_t overruns;          /**< Periods missed because the loop was still busy. */
+        uint32_t latencyLastUs;     /**< Tick-to-acquisition latency of the last sample [us]. */
+        uint32_t latencyMinUs;      /**< Minimum tick-to-acquisition latency [us]. */
+        uint32_t latencyMaxUs;      /**< Maximum tick-to-acquisition latency [us]. */
+    };
+
+    /**
+     * @brief Enables the PIT and starts ticking at the given rate.
+     * @param rateHz Sample rate in Hz (MIN_RATE_HZ..MAX_RATE_HZ).
+     * @return 0 if successful, 1 if the rate is out of range.
+     */
+    uint8_t init(uint16_t rateHz);
+
+    /**
+     * @brief Changes the sample rate; the new period starts immediately.
+     * @param rateHz Sample rate in Hz (MIN_RATE_HZ..MAX_RATE_HZ).
+     * @return 0 if successful, 1 if the rate is out of range.
+     */
+    uint8_t setRate(uint16_t rateHz);
+
+    /**
+     * @brief Returns the active sample rate in Hz.
+     */
+    uint16_t rate();
+
+    /**
+     * @brief Sleeps until the next tick, then records latency and overruns.
+     */
+    void waitForTick();
+
+    /**
+     * @brief Returns the timing statistics.
+     */
+    const Stats& stats();
+
+    /**
+     * @brief Clears the timing statistics.
+     */
+    void resetStats();
+}
+
+#endif // SAMPLE_TIMER_HPP
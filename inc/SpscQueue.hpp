@@ -0,0 +1,90 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SpscQueue.hpp
+ * @brief Lock-free single-producer/single-consumer ring for passing items out of interrupts.
+ *
+ * The producer only writes head and the consumer only writes tail, so no
+ * interrupt masking is needed: on the single-core Cortex-M0+ 8-bit loads and
+ * stores are atomic, and the signal fences keep the compiler from moving the
+ * slot access across the index update.
+ */
+
+#ifndef SPSC_QUEUE_HPP
+#define SPSC_QUEUE_HPP
+
+#include <atomic>
+#include <cstdint>
+
+/**
+ * @class SpscQueue
+ * @brief Fixed-capacity FIFO with one producer context and one consumer context.
+ * @tparam T Item type (copied in and out).
+ * @tparam Capacity Number of slots, a power of two up to 128.
+ */
+template <typename T, uint8_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity >= 2 && Capacity <= 128 && (Capacity & (Capacity - 1)) == 0,
+                  "Capacity must be a power of two between 2 and 128");
+
+public:
+    /**
+     * @brief Appends an item (producer side).
+     * @return False if the queue was full; the item is dropped and counted.
+     */
+    bool push(const T& item)
+    {
+        const uint8_t h = head;
+        if (static_cast<uint8_t>(h - tail) == Capacity)
+        {
+            ++drops;
+            return false;
+        }
+        items[h & (Capacity - 1)] = item;
+        std::atomic_signal_fence(std::memory_order_release);
+        head = static_cast<uint8_t>(h + 1);
+
+        const uint8_t level = static_cast<uint8_t>(h + 1 - tail);
+        if (level > highWater)
+        {
+            highWater = level;
+        }
+        return true;
+    }
+
+    /**
+     * @brief Removes the oldest item (consumer side).
+     * @return False if the queue was empty.
+     */
+    bool pop(T& item)
+    {
+        const uint8_t t = tail;
+        if (t == head)
+        {
+            return false;
+        }
+        std::atomic_signal_fence(std::memory_order_acquire);
+        item = items[t & (Capacity - 1)];
+        std::atomic_signal_fence(std::memory_order_release);
+        tail = static_cast<uint8_t>(t + 1);
+        return true;
+    }
+
+    bool     empty() const   { return head == tail; }                          /**< Nothing queued. */
+    uint8_t  size() const    { return static_cast<uint8_t>(head - tail); }     /**< Items queued. */
+    uint8_t  peak() const    { return highWater; }                             /**< Highest fill level seen. */
+    uint32_t dropped() const { return drops; }                                 /**< Items lost to a full queue. */
+
+private:
+    T                items[Capacity];
+    volatile uint8_t head      = 0;     /**< Next slot to write (producer). */
+    volatile uint8_t tail      = 0;     /**< Next slot to read (consumer). */
+    uint8_t          highWater = 0;     /**< Producer-side statistics. */
+    uint32_t         drops     = 0;
+};
+
+#endif // SPSC_QUEUE_HPP
@@ -0,0 +1,190 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepDetector.hpp
+ * @brief Fixed-point step detection engine (port of the MATLAB HPF/BPF pipeline).
+ *
+ * The detector runs the same chain as MATLAB/matlabFilterTests.m on every sample:
+ * per-axis 2nd-order Butterworth HPF (2 Hz) and BPF (0.3-2 Hz) at Fs = 10 Hz,
+ * magnitude of the filtered vector, 3-sample local maximum peak picking with
+ * minimum sample distances, and the "RUN beats WALK within 4 samples" merge.
+ *
+ * The peak thresholds are the fixed MATLAB values by default. With
+ * Config::adaptiveRatio set, each one follows the signal instead: the
+ * detector keeps an exponentially weighted mean of each filtered magnitude
+ * (time constant 2^adaptiveShift samples, shorter right after a reset so early
+ * samples are not biased towards zero) and a running average of its local
+ * maxima above the mean (time constant 2^(adaptiveShift - 3) peaks), and puts
+ * the threshold adaptiveRatio / 10 of the way from the mean to the average
+ * peak, at least adaptiveFloor. A threshold from the standard deviation does
+ * not work here: on a regular gait the magnitude peaks are only about one
+ * standard deviation above the mean, so mean + k sigma misses every step for
+ * k above 1. The HPF threshold stays at least hpfPeakThreshold /
+ * bpfPeakThreshold times the BPF one, which keeps RUN apart from WALK when
+ * both follow the amplitude. Three words per filter, O(1) per sample. This
+ * scales with the wearer and the mounting: with ratios 3 to 7 the reference
+ * walk host/recordings/periodic_gait.txt (59 steps) gives the same steps at
+ * 0.2x to 3x amplitude, where the fixed thresholds lose every step at 0.6x.
+ * Below about 0.15x the peaks no longer reach adaptiveFloor.
+ *
+ * Limitation: the adaptive thresholds follow any periodic motion above
+ * adaptiveFloor, so shaking or vibration in the 0.3-2 Hz band is counted like
+ * walking, and the first ADAPTIVE_WARMUP samples use the fixed thresholds.
+ *
+ * All arithmetic is integer only (the Cortex-M0+ has no FPU):
+ *  - signals are Q15 values in g held in int32_t (1 g = 32768),
+ *  - filter coefficients are Q29 (range +/-4), accumulated in 64 bits. They are
+ *    designed at compile time from SAMPLE_RATE and the MATLAB cutoffs
+ *    (inc/Butterworth.hpp), so a new sample rate only needs a rebuild.
+ *
+ * The module does not touch any peripheral, so it also builds on the host
+ * (see host/StepReplay.cpp) for sample-for-sample comparison with MATLAB.
+ */
+
+#ifndef STEP_DETECTOR_HPP
+#define STEP_DETECTOR_HPP
+
+#include "Butterworth.hpp"
+
+#include <cstdint>
+
+/**
+ * @brief Converts a value in g to Q15 at compile time.
+ */
+constexpr int32_t toQ15(double g)
+{
+    return static_cast<int32_t>(g * 32768.0 + (g < 0 ? -0.5 : 0.5));
+}
+
+/**
+ * @class StepDetector
+ * @brief Incremental walk/run step detector fed with raw MMA8451Q samples.
+ */
+class StepDetector
+{
+public:
+    /** Sample rate the filters are designed for (matlabFilterTests.m: samplingRate = 10). */
+    static constexpr butter::Frequency SAMPLE_RATE = butter::hz(10);
+
+    /** butter(2, 2/(Fs/2), 'high') */
+    using HpfFilter = butter::HighPass<SAMPLE_RATE, butter::hz(2), 2>;
+
+    /** butter(2, [0.3 2]/(Fs/2), 'bandpass'), two sections */
+    using BpfFilter = butter::BandPass<SAMPLE_RATE, butter::hz(0.3), butter::hz(2), 2>;
+
+    /**
+     * @brief Result of processing a single sample.
+     */
+    enum class Step : uint8_t
+    {
+        None = 0,   /**< No step detected on this sample. */
+        Walk,       /**< BPF peak not shadowed by a recent HPF peak ("WALK++"). */
+        Run         /**< HPF peak ("RUN++"). */
+    };
+
+    /**
+     * @struct Config
+     * @brief Detection thresholds, defaults match matlabFilterTests.m.
+     */
+    struct Config
+    {
+        int32_t hpfPeakThreshold = toQ15(0.6);  /**< HPF magnitude peak threshold (Q15 g). */
+        int32_t bpfPeakThreshold = toQ15(0.4);  /**< BPF magnitude peak threshold (Q15 g). */
+        uint8_t minHPFSampleDist = 3;           /**< Lockout after an HPF peak [samples]. */
+        uint8_t minBPFSampleDist = 7;           /**< Lockout after a BPF peak [samples]. */
+        uint8_t runShadowSamples = 4;           /**< WALK suppressed this close to a RUN [samples]. */
+        uint8_t adaptiveRatio    = 0;           /**< Threshold adaptiveRatio/10 of the way from the mean to the average peak (1..9), 0 = fixed thresholds. */
+        uint8_t adaptiveShift    = 7;           /**< Statistics time constant 2^n samples (1..12). */
+        int32_t adaptiveFloor    = toQ15(0.05); /**< Lowest adaptive threshold, above the noise at rest (Q15 g). */
+    };
+
+    /**
+     * @brief Creates a detector with the MATLAB default configuration.
+     */
+    StepDetector();
+
+    /**
+     * @brief Creates a detector with a custom configuration.
+     * @param cfg Thresholds and sample distances.
+     */
+    explicit StepDetector(const Config& cfg);
+
+    /**
+     * @brief Clears all filter states and peak windows.
+     */
+    void reset();
+
+    /**
+     * @brief Processes one sample.
+     * @param x Raw X acceleration in 14-bit counts (4096 counts/g).
+     * @param y Raw Y acceleration in 14-bit counts (4096 counts/g).
+     * @param z Raw Z acceleration in 14-bit counts (4096 counts/g).
+     * @return Step detected on this sample, if any.
+     */
+    Step process(int16_t x, int16_t y, int16_t z);
+
+    /**
+     * @brief Gives access to the active configuration.
+     */
+    Config& config() { return cfg; }
+
+    /**
+     * @brief Returns the HPF magnitude of the last processed sample (Q15 g).
+     */
+    int32_t lastHpfMagnitude() const { return hpfWin[2]; }
+
+    /**
+     * @brief Returns the BPF magnitude of the last processed sample (Q15 g).
+     */
+    int32_t lastBpfMagnitude() const { return bpfWin[2]; }
+
+    /**
+     * @brief Returns the HPF threshold applied to the next sample (Q15 g).
+     */
+    int32_t hpfThreshold() const { return adaptiveReady() ? hpfStats.threshold : cfg.hpfPeakThreshold; }
+
+    /**
+     * @brief Returns the BPF threshold applied to the next sample (Q15 g).
+     */
+    int32_t bpfThreshold() const { return adaptiveReady() ? bpfStats.threshold : cfg.bpfPeakThreshold; }
+
+    /**
+     * @brief Returns the 1-based index of the last processed sample.
+     */
+    uint32_t sampleIndex() const { return index; }
+
+private:
+    /**
+     * @struct RunningStats
+     * @brief Exponentially weighted statistics of one magnitude signal.
+     */
+    struct RunningStats
+    {
+        int32_t mean;       /**< Mean (Q15 g). */
+        int32_t peak;       /**< Average of the local maxima above the mean, 0 = none yet (Q15 g). */
+        int32_t threshold;  /**< Adaptive threshold from the last update (Q15 g). */
+    };
+
+    void track(RunningStats& stats, const int32_t (&win)[3]) const;
+    bool adaptiveReady() const { return cfg.adaptiveRatio != 0 && index >= ADAPTIVE_WARMUP; }
+
+    static constexpr uint8_t ADAPTIVE_WARMUP = 8;   /**< Samples before the statistics are used. */
+    static constexpr uint8_t PEAK_SHIFT_DIFF = 3;   /**< Peaks are ~2^3 samples apart: shorter shift for their average. */
+
+    Config                     cfg;                /**< Active thresholds. */
+    butter::Cascade<HpfFilter> hpfFilter[3];       /**< HPF for X, Y, Z. */
+    butter::Cascade<BpfFilter> bpfFilter[3];       /**< BPF (two sections) for X, Y, Z. */
+    int32_t                    hpfWin[3];          /**< Last three HPF magnitudes, oldest first. */
+    int32_t                    bpfWin[3];          /**< Last three BPF magnitudes, oldest first. */
+    uint32_t                   index;              /**< 1-based index of the last sample. */
+    uint32_t                   lastHPFpeakIndex;   /**< Sample index of the last HPF peak. */
+    uint32_t                   lastBPFpeakIndex;   /**< Sample index of the last BPF peak. */
+    RunningStats               hpfStats;           /**< Statistics of the HPF magnitude. */
+    RunningStats               bpfStats;           /**< Statistics of the BPF magnitude. */
+    uint8_t                    statsShift;         /**< Averaging shift, grows to adaptiveShift from reset. */
+};
+
+#endif // STEP_DETECTOR_HPP
@@ -0,0 +1,262 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Telemetry.hpp
+ * @brief Compact binary framing of accelerometer samples for the UART stream.
+ *
+ * Frame layout (all multi-byte fields little-endian):
+ * @code
+ *   offset  size  field
+ *   0       2     sync 0xA5 0x5A
+ *   2       1     type (FRAME_SAMPLES)
+ *   3       1     N = number of samples in the frame (1..MAX_BATCH)
+ *   4       2     sequence number (frame counter)
+ *   6       2     sample rate [Hz]
+ *   8       4     timestamp of the first sample [sample periods since start]
+ *   12      6*N   samples: X, Y, Z as int16 raw 14-bit counts (4096 counts/g)
+ *   12+6N   2     CRC-16/CCITT-FALSE over bytes 2 .. 11+6N
+ * @endcode
+ *
+ * Ten samples take 74 bytes instead of about 240 bytes of "%1.4f" text.
+ *
+ * Gait frames (type FRAME_GAIT, N = 1) share the header, with their own
+ * sequence numbers and the timestamp of the sample they were computed at,
+ * followed by GAIT_SIZE bytes (see GaitMetrics.hpp) and the detector
+ * thresholds in effect (adaptive or fixed, see StepDetector.hpp):
+ * @code
+ *   12      2     cadence over the short window [steps/min]
+ *   14      2     cadence over the long window [steps/min]
+ *   16      2     walking cadence, short window [steps/min]
+ *   18      2     running cadence, short window [steps/min]
+ *   20      2     speed, short window [mm/s]
+ *   22      4     distance walked [mm]
+ *   26      4     distance run [mm]
+ *   30      2     HPF (run) peak threshold [mg]
+ *   32      2     BPF (walk) peak threshold [mg]
+ *   34      2     CRC-16/CCITT-FALSE over bytes 2 .. 33
+ * @endcode
+ * Record frames (type FRAME_RECORD) carry one block of the sample recorder
+ * (see SampleRecorder.hpp) during a bulk download. N is the number of samples
+ * in the block, the sequence number counts the blocks of the download and
+ * the timestamp is the index of the first sample:
+ * @code
+ *   12      1     L = encoded bytes (1..RECORD_PAYLOAD_SIZE)
+ *   13      L     bit stream (see DeltaCoder): the first sample X, Y, Z as
+ *                 16 raw bits each, then per sample X, Y, Z as adaptive
+ *                 Golomb-Rice codes of the difference to the previous sample
+ *   13+L    2     CRC-16/CCITT-FALSE over bytes 2 .. 12+L
+ * @endcode
+ * A difference d is zigzag-mapped to z = (d << 1) ^ (d >> 31) and sent as
+ * q = z >> k one bits, a zero bit and the k low bits of z. The parameter k
+ * follows the mean |d| of the axis in the block so far (the smallest k with
+ * count << k >= sum), the sum starting at 256 with a count of 1 and both
+ * halved when the count reaches 16, so k tracks the last 8..16 samples. A
+ * quotient of ESCAPE or more is sent as ESCAPE one bits and the raw 16-bit
+ * sample. Bits are packed most significant first and the last byte is
+ * padded with zeros. Walking at 10 Hz takes 31 to 38 bits per sample.
+ *
+ * The header is shared by the firmware encoder and the host decoder (host/).
+ */
+
+#ifndef TELEMETRY_HPP
+#define TELEMETRY_HPP
+
+#include <cstdint>
+
+/**
+ * @namespace telemetry
+ * @brief Binary sample frame encoder and protocol constants.
+ */
+namespace telemetry
+{
+    constexpr uint8_t  SYNC0          = 0xA5;
+    constexpr uint8_t  SYNC1          = 0x5A;
+    constexpr uint8_t  FRAME_SAMPLES  = 0x01;   /**< Frame type carrying X/Y/Z samples. */
+    constexpr uint8_t  FRAME_GAIT     = 0x02;   /**< Frame type carrying one gait record. */
+    constexpr uint8_t  FRAME_RECORD   = 0x03;   /**< Frame type carrying one recorder block. */
+    constexpr uint8_t  HEADER_SIZE    = 12;
+    constexpr uint8_t  CRC_SIZE       = 2;
+    constexpr uint8_t  SAMPLE_SIZE    = 6;
+    constexpr uint8_t  GAIT_SIZE      = 22;
+    constexpr uint8_t  MAX_BATCH      = 16;     /**< Samples per frame upper bound. */
+    constexpr uint16_t MAX_FRAME_SIZE = HEADER_SIZE + MAX_BATCH * SAMPLE_SIZE + CRC_SIZE;
+    constexpr uint16_t GAIT_FRAME_SIZE = HEADER_SIZE + GAIT_SIZE + CRC_SIZE;
+    constexpr uint8_t  RECORD_PAYLOAD_SIZE = 120;   /**< Encoded bytes per recorder block upper bound. */
+    constexpr uint8_t  RECORD_MAX_SAMPLES  = 255;   /**< N is one byte; a still sensor takes 3 bits per sample. */
+    constexpr uint16_t RECORD_FRAME_SIZE   = HEADER_SIZE + 1 + RECORD_PAYLOAD_SIZE + CRC_SIZE;
+
+    /**
+     * @struct Gait
+     * @brief Payload of a gait frame.
+     */
+    struct Gait
+    {
+        uint16_t cadence[2];        /**< Short and long window [steps/min]. */
+        uint16_t walkCadence;       /**< [steps/min] */
+        uint16_t runCadence;        /**< [steps/min] */
+        uint16_t speedMmS;          /**< [mm/s] */
+        uint32_t walkDistanceMm;    /**< [mm] */
+        uint32_t runDistanceMm;     /**< [mm] */
+        uint16_t hpfThresholdMg;    /**< Run peak threshold in effect [mg]. */
+        uint16_t bpfThresholdMg;    /**< Walk peak threshold in effect [mg]. */
+    };
+
+    /**
+     * @brief Computes CRC-16/CCITT-FALSE (poly 0x1021, init 0xFFFF).
+     * @param data Bytes to checksum.
+     * @param size Number of bytes.
+     * @param crc Running CRC (for incremental use).
+     * @return Updated CRC.
+     */
+    uint16_t crc16(const uint8_t* data, uint32_t size, uint16_t crc = 0xFFFF);
+
+    /**
+     * @brief Encodes one gait frame.
+     * @param out Receives GAIT_FRAME_SIZE bytes.
+     * @param sequence Gait frame counter.
+     * @param rateHz Sample rate of @p timestamp.
+     * @param timestamp Sample index the values were computed at.
+     * @return Frame length in bytes.
+     */
+    uint16_t buildGaitFrame(uint8_t* out, uint16_t sequence, uint16_t rateHz, uint32_t timestamp, const Gait& gait);
+
+    /**
+     * @brief Encodes one record frame.
+     * @param out Receives up to RECORD_FRAME_SIZE bytes.
+     * @param sequence Block number within the download.
+     * @param rateHz Sample rate of the block.
+     * @param timestamp Index of the first sample of the block.
+     * @param samples Samples encoded in @p payload (1..RECORD_MAX_SAMPLES).
+     * @param payload DeltaCoder bit stream.
+     * @param size Bytes in @p payload (1..RECORD_PAYLOAD_SIZE).
+     * @return Frame length in bytes.
+     */
+    uint16_t buildRecordFrame(uint8_t* out, uint16_t sequence, uint16_t rateHz, uint32_t timestamp,
+                              uint8_t samples, const uint8_t* payload, uint8_t size);
+
+    /**
+     * @class DeltaCoder
+     * @brief Adaptive Golomb-Rice coder of a record payload (one block).
+     *
+     * The encoder and the decoder run the same state from reset(), so the
+     * parameter needs no bits in the stream. The caller supplies the previous
+     * sample of each axis; the first sample of a block goes through
+     * putRaw()/getRaw().
+     */
+    class DeltaCoder
+    {
+    public:
+        static constexpr uint8_t  ESCAPE          = 12;     /**< Quotient sent as a raw sample instead. */
+        static constexpr uint32_t START_MAGNITUDE = 256;    /**< Initial sum of |d| (k = 8). */
+        static constexpr uint8_t  HALVE_COUNT     = 16;     /**< Count at which the sum and count halve. */
+
+        DeltaCoder() { reset(); }
+
+        /**
+         * @brief Starts a new block: bit position 0, initial parameters.
+         */
+        void reset();
+
+        /**
+         * @brief Returns the bits written or read since reset().
+         */
+        uint16_t bits() const { return position; }
+
+        /**
+         * @brief Returns the length in bits of the code put() would write.
+         */
+        uint8_t cost(uint8_t axis, int16_t previous, int16_t value) const;
+
+        /**
+         * @brief Writes @p value as the code of its difference to @p previous.
+         * @param out Payload; the byte at the bit position and the following ones are overwritten.
+         */
+        void put(uint8_t* out, uint8_t axis, int16_t previous, int16_t value);
+
+        /**
+         * @brief Writes @p value as 16 raw bits.
+         */
+        void putRaw(uint8_t* out, int16_t value);
+
+        /**
+         * @brief Reads the code written by put().
+         * @param size Bytes in @p in.
+         * @return False if the code runs past @p size.
+         */
+        bool get(const uint8_t* in, uint8_t size, uint8_t axis, int16_t previous, int16_t& value);
+
+        /**
+         * @brief Reads 16 raw bits.
+         * @return False if they run past @p size.
+         */
+        bool getRaw(const uint8_t* in, uint8_t size, int16_t& value);
+
+    private:
+        uint8_t parameter(uint8_t axis) const;
+        void    adapt(uint8_t axis, int32_t delta);
+        void    write(uint8_t* out, uint32_t value, uint8_t length);
+        bool    read(const uint8_t* in, uint8_t size, uint8_t length, uint32_t& value);
+
+        uint32_t magnitude[3];              /**< Sum of |d| per axis. */
+        uint8_t  count[3];                  /**< Differences in the sum per axis. */
+        uint16_t position;                  /**< Next bit of the payload. */
+    };
+
+    /**
+     * @class FrameBuilder
+     * @brief Accumulates samples and seals them into one binary frame.
+     */
+    class FrameBuilder
+    {
+    public:
+        /**
+         * @brief Creates a builder for frames of @p batch samples.
+         * @param batch Samples per frame (clamped to 1..MAX_BATCH).
+         * @param rateHz Sample rate written into the header.
+         */
+        FrameBuilder(uint8_t batch = 10, uint16_t rateHz = 10);
+
+        /**
+         * @brief Changes the batch size; a partially filled frame is discarded.
+         */
+        void setBatch(uint8_t batch);
+
+        /**
+         * @brief Appends one sample.
+         * @param timestamp Sample index (used if it is the first sample of the frame).
+         * @return True when the frame is complete and sealed (see data()/size()).
+         */
+        bool add(uint32_t timestamp, int16_t x, int16_t y, int16_t z);
+
+        /**
+         * @brief Seals a partially filled frame.
+         * @return True if there was at least one sample to send.
+         */
+        bool flush();
+
+        /**
+         * @brief Returns the sealed frame bytes.
+         */
+        const uint8_t* data() const { return frame; }
+
+        /**
+         * @brief Returns the sealed frame length in bytes.
+         */
+        uint16_t size() const { return sealedSize; }
+
+    private:
+        void seal();
+
+        uint8_t  frame[MAX_FRAME_SIZE];     /**< Frame under construction / sealed frame. */
+        uint8_t  batch;                     /**< Samples per frame. */
+        uint8_t  count;                     /**< Samples in the frame under construction. */
+        uint16_t sequence;                  /**< Sequence number of the next frame. */
+        uint16_t rateHz;                    /**< Sample rate written into the header. */
+        uint16_t sealedSize;                /**< Length of the last sealed frame. */
+    };
+}
+
+#endif // TELEMETRY_HPP
@@ -18,19 +18,92 @@ extern "C" {
 }
 
 extern "C" void UART0_IRQHandler(void);
+extern "C" void DMA0_IRQHandler(void);
 
 
 	
 class CommunicationModuleMCU;       // Forward declaration
 
+/**
+ * @brief Size of the transmit ring buffer in bytes (power of two).
+ */
+#ifndef UART_TX_BUFFER_SIZE
+  #define UART_TX_BUFFER_SIZE 256
+#endif
+
 /**
  * @class Uart
  * @brief Class for initializing and handling UART0 transmissions and interrupts.
+ *
+ * The transmit path is chosen per instance (TxMode):
+ *  - Blocking:  print/println/write spin on TDRE for every byte,
+ *  - Interrupt: the bytes go to a ring buffer and the TDRE interrupt in
+ *               handleIRQ() feeds UART0->D, one interrupt per byte,
+ *  - Dma:       the ring storage is split into two halves; one half is sent by
+ *               DMA channel 0 while the other is filled, with one interrupt per
+ *               buffer instead of per byte.
+ * What happens when the buffer is full is selected with setOverflowPolicy().
  */
 class Uart
 {
+public:
+    /**
+     * @brief Transmit path.
+     */
+    enum class TxMode : uint8_t
+    {
+        Blocking,   /**< Poll TDRE for every byte (no buffering). */
+        Interrupt,  /**< Ring buffer drained by the TDRE interrupt (default). */
+        Dma         /**< Double buffer drained by DMA channel 0. */
+    };
+
+    /**
+     * @brief Behaviour of print/println/write when the transmit ring is full.
+     */
+    enum class OverflowPolicy : uint8_t
+    {
+        DropNewest, /**< Discard the whole new message (default, keeps lines/frames intact). */
+        DropOldest, /**< Discard the oldest queued bytes to make room. */
+        Block       /**< Wait until the interrupt has made room (old blocking behaviour). */
+    };
+
+    /**
+     * @struct BaudDivisor
+     * @brief UART0 divider setting: baud = clock / (osr * sbr).
+     */
+    struct BaudDivisor
+    {
+        uint16_t sbr;           /**< Baud rate modulo divisor (1..8191). */
+        uint8_t  osr;           /**< Oversampling ratio (4..32). */
+        uint32_t actual;        /**< Baud rate obtained. */
+        uint32_t errorPpm;      /**< Deviation from the requested rate [ppm]. */
+    };
+
+    /**
+     * @brief Largest deviation accepted from a requested baud rate [ppm].
+     *
+     * An 8N1 receiver samples the stop bit 9.5 bits after the start edge, so
+     * both ends together must stay well within 5 %; 2 % leaves the rest to
+     * the other side and the sampling phase.
+     */
+    static constexpr uint32_t MAX_BAUD_ERROR_PPM = 20000;
+
+    /**
+     * @struct TxStats
+     * @brief Transmit ring counters.
+     */
+    struct TxStats
+    {
+        uint32_t queued;    /**< Bytes accepted into the ring. */
+        uint32_t dropped;   /**< Bytes discarded by the overflow policy. */
+        uint16_t peak;      /**< Highest ring occupancy seen [bytes]. */
+        uint32_t cycles;    /**< Core cycles spent in the transmit path (calls and interrupts). */
+        uint32_t interrupts;/**< Transmit interrupts taken (TDRE or DMA done). */
+    };
+
 private:
     uint32_t baudRate;                         /**< Baud rate for UART communication. */
+    TxMode   txMode;                           /**< Transmit path of this instance. */
     static CommunicationModuleMCU* g_commObject;/**< Pointer to the communication handler. */
 
 public:
@@ -40,11 +113,12 @@ public:
     Uart();
 
     /**
-     * @brief Parameterized constructor, sets baud rate and a communication handler.
+     * @brief Parameterized constructor, sets baud rate, a communication handler and the transmit path.
      * @param baud Desired baud rate.
      * @param obj Pointer to the communication handler.
+     * @param mode Transmit path (blocking, interrupt or DMA).
      */
-    Uart(uint32_t baud, CommunicationModuleMCU* obj = nullptr);
+    Uart(uint32_t baud, CommunicationModuleMCU* obj = nullptr, TxMode mode = TxMode::Interrupt);
 
     /**
      * @brief Copy constructor.
@@ -57,6 +131,29 @@ public:
      */
     ~Uart();
 
+    /**
+     * @brief Finds the OSR (4..32) and SBR closest to @p baud for a UART clock of @p clockHz.
+     * @param out Receives the best setting, also when it is rejected.
+     * @return 0 if the error is within MAX_BAUD_ERROR_PPM, 1 otherwise.
+     */
+    static uint8_t findBaudDivisor(uint32_t clockHz, uint32_t baud, BaudDivisor& out);
+
+    /**
+     * @brief Changes the baud rate; call flush() first, bytes in flight are corrupted.
+     *
+     * The divider is searched against SystemCoreClock (after SystemCoreClockUpdate(),
+     * UART0 runs on MCGFLLCLK); a rate that cannot be met within MAX_BAUD_ERROR_PPM
+     * leaves the previous setting in place.
+     * @param baud New baud rate.
+     * @return 0 if successful, 1 if the rate is rejected.
+     */
+    static uint8_t setBaudRate(uint32_t baud);
+
+    /**
+     * @brief Returns the divider setting in use.
+     */
+    static const BaudDivisor& baudDivisor();
+
     /**
      * @brief Sends a null-terminated string via UART (without a new line).
      * @param text Pointer to the string buffer.
@@ -69,19 +166,89 @@ public:
      */
     static void println(const char* text);
 
+    /**
+     * @brief Sends a binary buffer via UART (may contain zero bytes).
+     * @param data Pointer to the bytes to send.
+     * @param size Number of bytes.
+     */
+    static void write(const uint8_t* data, uint32_t size);
+
+    /**
+     * @brief Waits until every queued byte has left the transmitter (TC set).
+     */
+    static void flush();
+
+    /**
+     * @brief Selects what happens when the transmit ring is full.
+     * @param policy New overflow policy.
+     */
+    static void setOverflowPolicy(OverflowPolicy policy);
+
+    /**
+     * @brief Returns the number of bytes waiting in the transmit ring.
+     */
+    static uint16_t txPending();
+
+    /**
+     * @brief Returns true if nothing is queued and the last frame has left the transmitter.
+     */
+    static bool txIdle();
+
+    /**
+     * @brief Returns the transmit ring counters.
+     */
+    static const TxStats& txStats();
+
+    /**
+     * @brief Clears the transmit ring counters.
+     */
+    static void resetTxStats();
+
 private:
     /**
-     * @brief Sends a single character in a blocking manner.
-     * @param c Character to send.
+     * @brief Queues bytes (or a whole message) according to the overflow policy.
+     * @param data Bytes to send.
+     * @param size Number of bytes.
+     * @param suffix Optional bytes that must stay together with @p data (line end).
+     * @param suffixSize Number of suffix bytes.
+     */
+    static void queue(const uint8_t* data, uint32_t size,
+                      const uint8_t* suffix = nullptr, uint32_t suffixSize = 0);
+
+    /**
+     * @brief Stores one byte in the ring; the caller guarantees free space.
+     * @param c Byte to store.
      */
     static void sendChar(char c);
 
     /**
-     * @brief Handles the UART interrupt, reads the received character,
-     *        and forwards it to the communication handler if present.
+     * @brief Moves one byte from the ring to UART0->D if the transmitter is ready.
+     */
+    static void txService();
+
+    /**
+     * @brief Hands the filled half of the double buffer to DMA if the channel is idle.
+     */
+    static void dmaKick();
+
+    /**
+     * @brief Acknowledges a finished DMA transfer and starts the next buffer, if any.
+     */
+    static void dmaService();
+
+    /**
+     * @brief Handles the DMA channel 0 interrupt (transfer done).
+     */
+    static void handleDmaIRQ();
+
+    /**
+     * @brief Handles the UART interrupt: feeds the transmitter from the ring,
+     *        reads the received character and forwards it to the communication
+     *        handler if present.
      */
     static void handleIRQ();
 
     friend void ::UART0_IRQHandler(); // Allows the global IRQ handler to invoke private handleIRQ().
+    friend void ::DMA0_IRQHandler();  // Same for the DMA completion interrupt.
 };
 #endif // UART_HPP
@@ -0,0 +1,312 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Accelerometer.cpp
+ * @brief Implementation of the MMA8451Q polled and FIFO acquisition modes.
+ */
+
+#include "../inc/Accelerometer.hpp"
+#include "../inc/BoardSupport.hpp"
+#include "../inc/Profiler.hpp"
+
+/* MMA8451Q registers */
+constexpr uint8_t REG_STATUS       = 0x00;  // F_STATUS when the FIFO is enabled
+constexpr uint8_t REG_OUT_X_MSB    = 0x01;
+constexpr uint8_t REG_F_SETUP      = 0x09;
+constexpr uint8_t REG_XYZ_DATA_CFG = 0x0E;
+constexpr uint8_t REG_TRANSIENT_CFG   = 0x1D;
+constexpr uint8_t REG_TRANSIENT_SRC   = 0x1E;
+constexpr uint8_t REG_TRANSIENT_THS   = 0x1F;
+constexpr uint8_t REG_TRANSIENT_COUNT = 0x20;
+constexpr uint8_t REG_CTRL_REG1    = 0x2A;
+constexpr uint8_t REG_CTRL_REG2    = 0x2B;
+constexpr uint8_t REG_CTRL_REG3    = 0x2C;
+constexpr uint8_t REG_CTRL_REG4    = 0x2D;
+constexpr uint8_t REG_CTRL_REG5    = 0x2E;
+
+/* Register bits */
+constexpr uint8_t CTRL_REG1_ACTIVE   = 0x01;
+constexpr uint8_t CTRL_REG1_DR_SHIFT = 3;
+constexpr uint8_t F_STATUS_OVF       = 0x80;
+constexpr uint8_t F_STATUS_CNT_MASK  = 0x3F;
+constexpr uint8_t F_SETUP_CIRCULAR   = 0x40;  // F_MODE = 01
+constexpr uint8_t INT_EN_FIFO        = 0x40;
+constexpr uint8_t INT_CFG_FIFO_INT1  = 0x40;
+constexpr uint8_t INT_EN_TRANS       = 0x20;
+constexpr uint8_t INT_CFG_TRANS_INT1 = 0x20;
+constexpr uint8_t TRANSIENT_CFG_XYZ_LATCH = 0x1E;   // ELE | ZTEFE | YTEFE | XTEFE
+constexpr uint8_t CTRL_REG2_MODS_LP  = 0x03;        // low power oversampling
+constexpr uint16_t TRANSIENT_MG_PER_LSB = 63;
+
+constexpr uint8_t BYTES_PER_SAMPLE = 6;
+
+namespace accel
+{
+    static volatile bool fifoIrq   = false;
+    static volatile bool motionIrq = false;
+    static bool          motionMode = false;
+    static Oversampling  oversampling = Oversampling::Normal;   // selected mode
+    static Oversampling  written      = Oversampling::Normal;   // mode in CTRL_REG2 (reset value)
+    static Stats         counters = {};
+
+    /* Sample ring, filled by drainFifo() and emptied by pop() */
+    static Sample  ring[RING_CAPACITY];
+    static uint8_t ringHead  = 0;
+    static uint8_t ringCount = 0;
+
+    /* Raw burst buffer for a full FIFO */
+    static uint8_t burst[FIFO_SIZE * BYTES_PER_SAMPLE];
+
+    static int16_t toCounts(const uint8_t* msb)
+    {
+        // 14-bit left-justified, two's complement
+        return static_cast<int16_t>(static_cast<int16_t>((msb[0] << 8) | msb[1]) >> 2);
+    }
+
+    static uint8_t enterStandby()
+    {
+        uint8_t error = 0;
+        // Registers may only be changed in standby
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG1, 0x00);
+        error |= I2C::writeReg(ADDRESS, REG_XYZ_DATA_CFG, 0x00);   // +/-2 g, 4096 counts/g
+        if (motionMode || written != oversampling)
+        {
+            // Back to the selected oversampling after motion detection or a change
+            error |= I2C::writeReg(ADDRESS, REG_CTRL_REG2, static_cast<uint8_t>(oversampling));
+            written = oversampling;
+        }
+        if (motionMode)
+        {
+            // Transient detector off
+            error |= I2C::writeReg(ADDRESS, REG_TRANSIENT_CFG, 0x00);
+            motionMode = false;
+        }
+        return error;
+    }
+
+    void setOversampling(Oversampling mode)
+    {
+        oversampling = mode;
+    }
+
+    uint8_t initPolled()
+    {
+        PROFILE_SCOPE(AccelConfig);
+        uint8_t error = enterStandby();
+        error |= I2C::writeReg(ADDRESS, REG_F_SETUP, 0x00);
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG4, 0x00);
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG1, CTRL_REG1_ACTIVE);  // DR = 800 Hz
+        return error;
+    }
+
+    uint8_t readSample(Sample& sample)
+    {
+        uint8_t raw[BYTES_PER_SAMPLE];
+        uint8_t error = I2C::readRegBlock(ADDRESS, REG_OUT_X_MSB, BYTES_PER_SAMPLE, raw);
+        sample.x = toCounts(&raw[0]);
+        sample.y = toCounts(&raw[2]);
+        sample.z = toCounts(&raw[4]);
+        return error;
+    }
+
+    uint8_t initFifo(Odr odr, uint8_t watermark)
+    {
+        if (watermark == 0 || watermark > FIFO_SIZE)
+        {
+            return 1;
+        }
+
+        // INT1 input: GPIO with pull-up, interrupt on falling edge (INT1 is active low)
+        SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK;
+        PORTA->PCR[ACCEL_INT1_PIN_POS] = PORT_PCR_MUX(1) | PORT_PCR_PE_MASK | PORT_PCR_PS_MASK
+                                       | PORT_PCR_IRQC(0xA);
+        PTA->PDDR &= ~(1u << ACCEL_INT1_PIN_POS);
+
+        PROFILE_SCOPE(AccelConfig);
+        uint8_t error = enterStandby();
+        error |= I2C::writeReg(ADDRESS, REG_F_SETUP, static_cast<uint8_t>(F_SETUP_CIRCULAR | watermark));
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG3, 0x00);               // push-pull, active low
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG4, INT_EN_FIFO);
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG5, INT_CFG_FIFO_INT1);
+
+        fifoIrq   = false;
+        ringHead  = 0;
+        ringCount = 0;
+        counters  = Stats{};
+
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG1,
+                               static_cast<uint8_t>((static_cast<uint8_t>(odr) << CTRL_REG1_DR_SHIFT)
+                                                    | CTRL_REG1_ACTIVE));
+
+        NVIC_ClearPendingIRQ(PORTA_IRQn);
+        NVIC_EnableIRQ(PORTA_IRQn);
+        return error;
+    }
+
+    uint8_t initMotionWake(Odr odr, uint16_t thresholdMg)
+    {
+        PROFILE_SCOPE(AccelConfig);
+        uint8_t threshold = static_cast<uint8_t>((thresholdMg + TRANSIENT_MG_PER_LSB / 2) / TRANSIENT_MG_PER_LSB);
+        if (threshold == 0 || threshold > 0x7F)
+        {
+            return 1;
+        }
+
+        uint8_t error = enterStandby();
+        error |= I2C::writeReg(ADDRESS, REG_F_SETUP, 0x00);
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG2, CTRL_REG2_MODS_LP);
+        written = Oversampling::LowPower;
+        error |= I2C::writeReg(ADDRESS, REG_TRANSIENT_CFG, TRANSIENT_CFG_XYZ_LATCH);
+        error |= I2C::writeReg(ADDRESS, REG_TRANSIENT_THS, threshold);
+        error |= I2C::writeReg(ADDRESS, REG_TRANSIENT_COUNT, 0x00);
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG4, INT_EN_TRANS);
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG5, INT_CFG_TRANS_INT1);
+
+        uint8_t src = 0;
+        error |= I2C::readReg(ADDRESS, REG_TRANSIENT_SRC, &src);   // drop a stale event
+        motionMode = true;
+        motionIrq  = false;
+        fifoIrq    = false;
+
+        error |= I2C::writeReg(ADDRESS, REG_CTRL_REG1,
+                               static_cast<uint8_t>((static_cast<uint8_t>(odr) << CTRL_REG1_DR_SHIFT)
+                                                    | CTRL_REG1_ACTIVE));
+        return error;
+    }
+
+    bool motionDetected()
+    {
+        // The latched event is dropped by the next initMotionWake(); restarting
+        // acquisition disables the transient interrupt, which releases INT1
+        return motionIrq;
+    }
+
+    void onInterrupt()
+    {
+        if (motionMode)
+        {
+            motionIrq = true;
+        }
+        else
+        {
+            fifoIrq = true;
+        }
+    }
+
+    bool fifoReady()
+    {
+        return fifoIrq;
+    }
+
+    static uint8_t readFifo()
+    {
+        uint8_t status = 0;
+        uint8_t error  = I2C::readReg(ADDRESS, REG_STATUS, &status);
+        uint8_t count  = status & F_STATUS_CNT_MASK;
+        if (error != 0)
+        {
+            ++counters.busErrors;
+            return error;
+        }
+        if (count == 0)
+        {
+            return 0;
+        }
+        if (count > FIFO_SIZE)
+        {
+            count = FIFO_SIZE;
+        }
+        if (status & F_STATUS_OVF)
+        {
+            ++counters.fifoOverflows;
+        }
+
+        // In FIFO mode the OUT_X_MSB..OUT_Z_LSB burst wraps around, popping one sample per 6 bytes
+        error = I2C::readRegBlock(ADDRESS, REG_OUT_X_MSB, static_cast<uint8_t>(count * BYTES_PER_SAMPLE), burst);
+        ++counters.bursts;
+        if (error != 0)
+        {
+            // The samples the burst popped are lost; never pass stale bytes on
+            ++counters.busErrors;
+            return error;
+        }
+
+        for (uint8_t i = 0; i < count; ++i)
+        {
+            const uint8_t* raw = &burst[i * BYTES_PER_SAMPLE];
+            if (ringCount == RING_CAPACITY)
+            {
+                ++counters.ringDrops;
+                continue;
+            }
+            Sample& s = ring[(ringHead + ringCount) % RING_CAPACITY];
+            s.x = toCounts(&raw[0]);
+            s.y = toCounts(&raw[2]);
+            s.z = toCounts(&raw[4]);
+            ++ringCount;
+            ++counters.samples;
+        }
+        return 0;
+    }
+
+    uint8_t drainFifo()
+    {
+        fifoIrq = false;
+        uint8_t error = readFifo();
+
+        // INT1 is edge triggered: while it stays low (a failed read, or the
+        // FIFO refilled to the watermark meanwhile) no new edge comes, so the
+        // next pass of the loop drains again
+        if ((PTA->PDIR & (1u << ACCEL_INT1_PIN_POS)) == 0)
+        {
+            fifoIrq = true;
+        }
+        return error;
+    }
+
+    uint8_t available()
+    {
+        return ringCount;
+    }
+
+    bool pop(Sample& sample)
+    {
+        if (ringCount == 0)
+        {
+            return false;
+        }
+        sample   = ring[ringHead];
+        ringHead = static_cast<uint8_t>((ringHead + 1) % RING_CAPACITY);
+        --ringCount;
+        return true;
+    }
+
+    bool popAveraged(Sample& sample, uint8_t factor)
+    {
+        if (factor == 0 || ringCount < factor)
+        {
+            return false;
+        }
+        int32_t sx = 0, sy = 0, sz = 0;
+        Sample s;
+        for (uint8_t i = 0; i < factor; ++i)
+        {
+            pop(s);
+            sx += s.x;
+            sy += s.y;
+            sz += s.z;
+        }
+        sample.x = static_cast<int16_t>(sx / factor);
+        sample.y = static_cast<int16_t>(sy / factor);
+        sample.z = static_cast<int16_t>(sz / factor);
+        return true;
+    }
+
+    const Stats& stats()
+    {
+        return counters;
+    }
+}
@@ -5,10 +5,34 @@
 
 /**
  * @file BoardSupport.cpp
- * @brief Implementation of board-level functions for LED, I2C.
+ * @brief Implementation of board-level functions for LED and the interrupt-driven I2C0 engine.
  */
 
 #include "../inc/BoardSupport.hpp"
+#include "../inc/IsrMonitor.hpp"
+#include "../inc/Profiler.hpp"
+
+/* =========================================
+ * Timing
+ * =========================================
+ */
+
+void delayUs(uint32_t us)
+{
+    isrmon::init();
+    const uint32_t cyclesPerUs = SystemCoreClock / 1000000u;
+
+    // Chunks well inside the 24-bit SysTick range
+    while (us != 0)
+    {
+        uint32_t chunk = (us > 100000u) ? 100000u : us;
+        uint32_t start = isrmon::cycleStamp();
+        while (isrmon::cyclesSince(start) < chunk * cyclesPerUs)
+        {
+        }
+        us -= chunk;
+    }
+}
 
 /* =========================================
  * LED Functions
@@ -47,11 +71,38 @@ void setLedColor(bool r, bool g, bool b)
 
 namespace I2C
 {
-    static inline uint8_t  error   = 0;
-    static inline uint16_t timeout = 0;
+    /* Bus phase of the transfer at the head of the queue */
+    enum class Phase : uint8_t { Idle, Write, ReadAddress, Read };
+
+    static Transfer* volatile queue[QUEUE_SIZE];
+    static volatile uint8_t   queueHead = 0;    // next free slot (submit)
+    static volatile uint8_t   queueTail = 0;    // transfer on the bus (interrupt)
+    static volatile Phase     phase     = Phase::Idle;
+    static uint8_t            index     = 0;    // byte of the current phase
+    static Stats              counters  = {};
+    static DeviceStats        devices[MAX_DEVICES] = {};
+    static DeviceStats*       device    = nullptr;  // counters of the transfer on the bus
+    static uint32_t           requestedHz = STANDARD_HZ;    // last setClock() request
+    static uint8_t            defaultIcr  = 0x3F;           // its divider
+    static volatile uint32_t  started   = 0;    // transfers put on the bus, to tell them apart in wait()
+
+    /* SCL divider per ICR (KL05 reference manual, I2C divider and hold values) */
+    static const uint16_t SCL_DIVIDER[64] = {
+          20,   22,   24,   26,   28,   30,   34,   40,   28,   32,   36,   40,   44,   48,   56,   68,
+          48,   56,   64,   72,   80,   88,  104,  128,   80,   96,  112,  128,  144,  160,  192,  240,
+         160,  192,  224,  256,  288,  320,  384,  480,  320,  384,  448,  512,  576,  640,  768,  960,
+         640,  768,  896, 1024, 1152, 1280, 1536, 1920, 1280, 1536, 1792, 2048, 2304, 2560, 3072, 3840 };
+
+    /* SCL rate of one slave address (setDeviceClock) */
+    struct DeviceClock
+    {
+        uint8_t  address;
+        uint8_t  icr;
+        uint32_t requestedHz;
+    };
+    static DeviceClock      clocks[MAX_DEVICES] = {};
+    static volatile uint8_t clockCount = 0;
 
-    static void i2c_enable()   { I2C0->C1 |=  I2C_C1_IICEN_MASK; }
-    static void i2c_disable()  { I2C0->C1 &= ~I2C_C1_IICEN_MASK; }
     static void i2c_m_start()  { I2C0->C1 |=  I2C_C1_MST_MASK; }
     static void i2c_m_stop()   { I2C0->C1 &= ~I2C_C1_MST_MASK; }
     static void i2c_m_rstart() { I2C0->C1 |=  I2C_C1_RSTA_MASK; }
@@ -59,21 +110,281 @@ namespace I2C
     static void i2c_rec()      { I2C0->C1 &= ~I2C_C1_TX_MASK; }
     static void i2c_nack()     { I2C0->C1 |=  I2C_C1_TXAK_MASK; }
     static void i2c_ack()      { I2C0->C1 &= ~I2C_C1_TXAK_MASK; }
-    static void i2c_send(uint8_t d) { I2C0->D = d; }
+    static void i2c_send(uint8_t d) { I2C0->D = d; ++counters.bytes; ++device->bytes; }
     static uint8_t i2c_recv()       { return I2C0->D; }
 
-    static void i2c_wait()
+    static uint8_t queued()
+    {
+        return static_cast<uint8_t>(queueHead - queueTail);
+    }
+
+    static uint32_t busClockHz()
+    {
+        return SystemCoreClock / (((SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT) + 1u);
+    }
+
+    /**
+     * @brief Largest SCL rate not above @p sclHz: the ICR of I2C0->F, the slowest divider if none is.
+     */
+    static uint8_t findIcr(uint32_t busHz, uint32_t sclHz)
+    {
+        uint8_t  best   = 0x3F;
+        uint32_t bestHz = 0;
+        for (uint8_t icr = 0; icr < 64; ++icr)
+        {
+            uint32_t hz = busHz / SCL_DIVIDER[icr];
+            if (hz <= sclHz && hz > bestHz)
+            {
+                best   = icr;
+                bestHz = hz;
+            }
+        }
+        return best;
+    }
+
+    /**
+     * @brief ICR the transfers to @p address run at.
+     */
+    static uint8_t deviceIcr(uint8_t address)
+    {
+        for (uint8_t i = 0; i < clockCount; ++i)
+        {
+            if (clocks[i].address == address)
+            {
+                return clocks[i].icr;
+            }
+        }
+        return defaultIcr;
+    }
+
+    /**
+     * @brief Core cycles a transfer may take on the bus: twice its length at the SCL
+     *        rate (9 SCL periods per byte, address bytes included) plus TIMEOUT_MARGIN_US.
+     */
+    static uint32_t limitCycles(const Transfer& t)
+    {
+        uint32_t bytes = 1u + t.txSize + (t.rxSize != 0 ? 1u + t.rxSize : 0u);
+        uint32_t us    = static_cast<uint32_t>(static_cast<uint64_t>(bytes) * 9u * 2u * 1000000u / clockHz(t.address));
+        return (us + TIMEOUT_MARGIN_US) * (SystemCoreClock / 1000000u);
+    }
+
+    /**
+     * @brief Waits up to two SCL periods (STOP hold and bus free time) for the STOP
+     *        of the previous transfer to leave the bus.
+     *
+     * Runs in the interrupt handler when a transfer completes, so the wait is kept
+     * to what a released bus needs; a slave holding the bus costs no more than this.
+     * @return true if the bus is free.
+     */
+    static bool busFree()
+    {
+        const uint32_t limit = 2u * (SystemCoreClock / clockHz());
+        const uint32_t start = isrmon::cycleStamp();
+        while (I2C0->S & I2C_S_BUSY_MASK)
+        {
+            if (isrmon::cyclesSince(start) > limit)
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    /**
+     * @brief Disables and re-enables I2C0, which releases the bus and clears its state.
+     */
+    static void resetModule()
+    {
+        I2C0->C1 = 0;
+        I2C0->S  = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+        I2C0->C1 = I2C_C1_IICEN_MASK | I2C_C1_IICIE_MASK;
+    }
+
+    /**
+     * @brief Finds the counters of an address, taking a free entry (or the last one) for a new address.
+     */
+    static DeviceStats* deviceEntry(uint8_t address)
     {
-        timeout = 0;
-        while (!(I2C0->S & I2C_S_IICIF_MASK) && (timeout < 10000))
+        for (uint8_t i = 0; i < MAX_DEVICES; ++i)
+        {
+            if (devices[i].address == address || devices[i].transfers == 0)
+            {
+                devices[i].address = address;
+                return &devices[i];
+            }
+        }
+        return &devices[MAX_DEVICES - 1];
+    }
+
+    static void complete(uint8_t status);
+
+    /**
+     * @brief Issues START and the address byte of the transfer at the head of the queue.
+     *
+     * If the bus stays busy, and is still busy right after a module reset, the
+     * transfer fails with TIMEOUT instead of starting on it; the reset is not
+     * waited for, so each queued transfer costs the handler at most busFree(). The SCL divider is switched to the rate
+     * of the slave address first, with the bus idle.
+     */
+    static void startNext()
+    {
+        if (queued() == 0)
+        {
+            phase = Phase::Idle;
+            return;
+        }
+        Transfer& t = *queue[queueTail & (QUEUE_SIZE - 1)];
+
+        // The STOP of the previous transfer must be on the bus before the next START
+        if (!busFree())
+        {
+            resetModule();
+            if (I2C0->S & I2C_S_BUSY_MASK)
+            {
+                phase = Phase::Write;
+                complete(TIMEOUT);
+                return;
+            }
+        }
+        const uint8_t icr = deviceIcr(t.address);
+        if (I2C0->F != icr)
+        {
+            I2C0->F = icr;
+        }
+
+        index  = 0;
+        device = deviceEntry(t.address);
+        ++device->transfers;
+        ++started;
+        i2c_ack();
+        i2c_tran();
+        i2c_m_start();
+        if (t.txSize == 0 && t.rxSize != 0)
+        {
+            phase = Phase::ReadAddress;
+            i2c_send(static_cast<uint8_t>((t.address << 1) | 1u));
+        }
+        else
+        {
+            phase = Phase::Write;
+            i2c_send(static_cast<uint8_t>(t.address << 1));
+        }
+    }
+
+    /**
+     * @brief Ends the current transfer with STOP and starts the next one.
+     */
+    static void complete(uint8_t status)
+    {
+        if (I2C0->C1 & I2C_C1_MST_MASK)
+        {
+            i2c_m_stop();
+        }
+        i2c_ack();
+
+        Transfer& t = *queue[queueTail & (QUEUE_SIZE - 1)];
+        queueTail = static_cast<uint8_t>(queueTail + 1);
+        ++counters.transfers;
+        if (status != OK)
+        {
+            ++counters.errors;
+        }
+
+        t.status = status;
+        if (t.done)
+        {
+            t.done(t);
+        }
+        startNext();
+    }
+
+    void handleIRQ()
+    {
+        uint8_t s = I2C0->S;
+        I2C0->S = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;   // write 1 to clear
+        ++counters.interrupts;
+
+        if (phase == Phase::Idle)
+        {
+            return;
+        }
+        if (s & I2C_S_ARBL_MASK)
+        {
+            complete(ARBITRATION);
+            return;
+        }
+
+        Transfer& t = *queue[queueTail & (QUEUE_SIZE - 1)];
+        switch (phase)
         {
-            ++timeout;
+        case Phase::Write:
+            if (s & I2C_S_RXAK_MASK)
+            {
+                complete(NACK);
+            }
+            else if (index < t.txSize)
+            {
+                i2c_send(t.tx[index++]);
+            }
+            else if (t.rxSize != 0)
+            {
+                // Repeated START, then the address again with the read bit
+                phase = Phase::ReadAddress;
+                i2c_m_rstart();
+                i2c_send(static_cast<uint8_t>((t.address << 1) | 1u));
+            }
+            else
+            {
+                complete(OK);
+            }
+            break;
+
+        case Phase::ReadAddress:
+            if (s & I2C_S_RXAK_MASK)
+            {
+                complete(NACK);
+                break;
+            }
+            // A single-byte read is NACKed right away; the dummy read clocks in the first byte
+            phase = Phase::Read;
+            index = 0;
+            i2c_rec();
+            if (t.rxSize == 1)
+            {
+                i2c_nack();
+            }
+            (void)i2c_recv();
+            break;
+
+        case Phase::Read:
+            ++counters.bytes;
+            ++device->bytes;
+            if (index == t.rxSize - 1)
+            {
+                // STOP before reading D, otherwise the read would clock in another byte
+                i2c_m_stop();
+                t.rx[index] = i2c_recv();
+                complete(OK);
+            }
+            else
+            {
+                // NACK goes out with the byte that is clocked in next, i.e. the last one
+                if (index == t.rxSize - 2)
+                {
+                    i2c_nack();
+                }
+                t.rx[index++] = i2c_recv();
+            }
+            break;
+
+        default:
+            break;
         }
-        I2C0->S |= I2C_S_IICIF_MASK;
     }
 
     void init()
     {
+        isrmon::init();
         SIM->SCGC4 |= SIM_SCGC4_I2C0_MASK;
         SIM->SCGC5 |= SIM_SCGC5_PORTB_MASK;
 
@@ -81,83 +392,230 @@ namespace I2C
         PORTB->PCR[4] = PORT_PCR_MUX(2);
 
         I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-        I2C0->F = 0x03;
+        setClock(requestedHz);
+
+        queueHead = queueTail = 0;
+        phase = Phase::Idle;
+        I2C0->S  = I2C_S_IICIF_MASK | I2C_S_ARBL_MASK;
+        I2C0->C1 = I2C_C1_IICEN_MASK | I2C_C1_IICIE_MASK;
+
+        NVIC_ClearPendingIRQ(I2C0_IRQn);
+        NVIC_EnableIRQ(I2C0_IRQn);
+    }
+
+    uint32_t setClock(uint32_t sclHz)
+    {
+        SystemCoreClockUpdate();
+        const uint32_t busHz = busClockHz();
+        requestedHz = sclHz;
+        defaultIcr  = findIcr(busHz, sclHz);
+
+        // The per-device dividers follow the bus clock too
+        for (uint8_t i = 0; i < clockCount; ++i)
+        {
+            clocks[i].icr = findIcr(busHz, clocks[i].requestedHz);
+        }
+        if (SIM->SCGC4 & SIM_SCGC4_I2C0_MASK)
+        {
+            I2C0->F = defaultIcr;   // ICR only, MULT = 1
+        }
+        return busHz / SCL_DIVIDER[defaultIcr];
+    }
+
+    uint32_t setDeviceClock(uint8_t address, uint32_t sclHz)
+    {
+        SystemCoreClockUpdate();
+        const uint32_t busHz = busClockHz();
+        const uint8_t  icr   = findIcr(busHz, sclHz);
+        for (uint8_t i = 0; i < clockCount; ++i)
+        {
+            if (clocks[i].address == address)
+            {
+                clocks[i].requestedHz = sclHz;
+                clocks[i].icr         = icr;
+                return busHz / SCL_DIVIDER[icr];
+            }
+        }
+        if (clockCount == MAX_DEVICES)
+        {
+            return 0;
+        }
+
+        // Filled before it is counted, startNext() may read the table from the interrupt
+        clocks[clockCount] = DeviceClock{ address, icr, sclHz };
+        clockCount = static_cast<uint8_t>(clockCount + 1u);
+        return busHz / SCL_DIVIDER[icr];
+    }
+
+    uint32_t clockHz()
+    {
+        uint8_t  f    = I2C0->F;
+        uint32_t mult = 1u << ((f & I2C_F_MULT_MASK) >> 6);
+        return busClockHz() / (mult * SCL_DIVIDER[f & I2C_F_ICR_MASK]);
+    }
+
+    uint32_t clockHz(uint8_t address)
+    {
+        return busClockHz() / SCL_DIVIDER[deviceIcr(address)];
+    }
+
+    const DeviceStats* deviceStats(uint8_t address)
+    {
+        for (const DeviceStats& d : devices)
+        {
+            if (d.address == address && d.transfers != 0)
+            {
+                return &d;
+            }
+        }
+        return nullptr;
+    }
+
+    uint8_t submit(Transfer& transfer)
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        if (queued() == QUEUE_SIZE)
+        {
+            if (!primask)
+            {
+                __enable_irq();
+            }
+            return 1;
+        }
+        transfer.status = PENDING;
+        queue[queueHead & (QUEUE_SIZE - 1)] = &transfer;
+        queueHead = static_cast<uint8_t>(queueHead + 1);
+        if (queued() > counters.peak)
+        {
+            counters.peak = queued();
+        }
+        if (phase == Phase::Idle)
+        {
+            startNext();
+        }
+
+        if (!primask)
+        {
+            __enable_irq();
+        }
+        return 0;
+    }
+
+    uint8_t wait(Transfer& transfer)
+    {
+        const uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        // The SysTick wrap (2^24 cycles) wakes the WFI below even if the bus
+        // stops interrupting, so the transfer on the bus is checked against
+        // its limit at least that often
+        const uint32_t tickint = SysTick->CTRL & SysTick_CTRL_TICKINT_Msk;
+        SysTick->CTRL |= SysTick_CTRL_TICKINT_Msk;
+
+        uint32_t onBus   = started - 1u;    // no transfer timed yet
+        uint32_t elapsed = 0;
+        uint32_t limit   = 0;
+        uint32_t stamp   = isrmon::cycleStamp();
+        while (transfer.status == PENDING)
+        {
+            if (primask)
+            {
+                // Interrupts masked by the caller: run the state machine from here
+                if (I2C0->S & I2C_S_IICIF_MASK)
+                {
+                    handleIRQ();
+                }
+            }
+            else
+            {
+                // WFI wakes on a pending interrupt even with PRIMASK set, so a
+                // completion between the check and the WFI is never lost
+                __WFI();
+                __enable_irq();
+                __disable_irq();
+            }
+
+            elapsed += isrmon::cyclesSince(stamp);
+            stamp    = isrmon::cycleStamp();
+            if (phase == Phase::Idle)
+            {
+                continue;
+            }
+            if (onBus != started)
+            {
+                onBus   = started;
+                elapsed = 0;
+                limit   = limitCycles(*queue[queueTail & (QUEUE_SIZE - 1)]);
+            }
+            else if (elapsed > limit)
+            {
+                // No IICIF for too long (SCL held low): STOP, reset and drop the transfer
+                i2c_m_stop();
+                resetModule();
+                complete(TIMEOUT);
+            }
+        }
+
+        if (!tickint)
+        {
+            SysTick->CTRL &= ~SysTick_CTRL_TICKINT_Msk;
+        }
+        if (!primask)
+        {
+            __enable_irq();
+        }
+        return transfer.status;
+    }
+
+    uint8_t transfer(Transfer& transfer)
+    {
+        if (submit(transfer) != 0)
+        {
+            return 1;
+        }
+        return wait(transfer);
+    }
+
+    bool idle()
+    {
+        return phase == Phase::Idle;
+    }
+
+    const Stats& stats()
+    {
+        return counters;
     }
 
     uint8_t writeReg(uint8_t address, uint8_t reg, uint8_t data)
     {
-        error = 0;
-        i2c_enable();
-        i2c_tran();
-        i2c_m_start();
-        i2c_send(static_cast<uint8_t>(address << 1));
-        i2c_wait();
-        i2c_send(reg);
-        i2c_wait();
-        i2c_send(data);
-        i2c_wait();
-        i2c_m_stop();
-        i2c_disable();
-        return error;
+        uint8_t bytes[2] = { reg, data };
+        Transfer t = { address, bytes, 2, nullptr, 0, nullptr, nullptr, OK };
+        return transfer(t);
     }
 
     uint8_t readReg(uint8_t address, uint8_t reg, uint8_t* data)
     {
-        error = 0;
-        i2c_enable();
-        i2c_tran();
-        i2c_m_start();
-        i2c_send(static_cast<uint8_t>(address << 1));
-        i2c_wait();
-        i2c_send(reg);
-        i2c_wait();
-        i2c_m_rstart();
-        i2c_send(static_cast<uint8_t>((address << 1) | 1u));
-        i2c_wait();
-        i2c_rec();
-        i2c_nack();
-        (void)i2c_recv();
-        i2c_wait();
-        i2c_m_stop();
-        *data = i2c_recv();
-        i2c_disable();
-        return error;
+        Transfer t = { address, &reg, 1, data, 1, nullptr, nullptr, OK };
+        return transfer(t);
     }
 
     uint8_t readRegBlock(uint8_t address, uint8_t reg, uint8_t size, uint8_t* data)
     {
-        error = 0;
-        uint8_t dummy;
-        uint8_t cnt = 0;
+        PROFILE_SCOPE(ReadBlock);
+        Transfer t = { address, &reg, 1, data, size, nullptr, nullptr, OK };
+        return transfer(t);
+    }
+} // End of namespace I2C
 
-        i2c_enable();
-        i2c_tran();
-        i2c_m_start();
-        i2c_send(static_cast<uint8_t>(address << 1));
-        i2c_wait();
-        i2c_send(reg);
-        i2c_wait();
-        i2c_m_rstart();
-        i2c_send(static_cast<uint8_t>((address << 1) | 0x01));
-        i2c_wait();
-        i2c_rec();
-
-        while (cnt < (size - 1))
-        {
-            i2c_ack();
-            dummy = i2c_recv();
-            (void)dummy;
-            i2c_wait();
-            data[cnt++] = i2c_recv();
-        }
-
-        i2c_nack();
-        dummy = i2c_recv();
-        (void)dummy;
-        i2c_wait();
-        i2c_m_stop();
-        data[cnt] = i2c_recv();
-        i2c_disable();
-        return error;
-    }
-} // End of namespace I2C
\ No newline at end of file
+extern "C" void I2C0_IRQHandler(void)
+{
+    isrmon::Scope timing(isrmon::Source::I2c0);
+    I2C::handleIRQ();
+}
+
+extern "C" void SysTick_Handler(void)
+{
+    // Only wakes I2C::wait(); the cycle counter needs no service
+}
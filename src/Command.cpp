@@ -0,0 +1,271 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Command.cpp
+ * @brief Command table and incremental parser.
+ */
+
+#include "../inc/Command.hpp"
+
+namespace command
+{
+    struct Entry
+    {
+        const char* name;
+        Id          id;
+        uint8_t     args;
+    };
+
+    /* The command table; names in upper case */
+    constexpr Entry TABLE[] = {
+        { "WALK++",  Id::Walk,          0 },
+        { "RUN++",   Id::Run,           0 },
+        { "RESET",   Id::Reset,         0 },
+        { "ACQ",     Id::Acquisition,   1 },
+        { "HPF",     Id::HpfThreshold,  1 },
+        { "BPF",     Id::BpfThreshold,  1 },
+        { "HDIST",   Id::HpfDistance,   1 },
+        { "BDIST",   Id::BpfDistance,   1 },
+        { "ADAPT",   Id::Adaptive,      1 },
+        { "TEXT",    Id::Text,          0 },
+        { "BIN",     Id::Binary,        0 },
+        { "COUNT",   Id::Count,         0 },
+        { "STATS",   Id::Stats,         0 },
+        { "CONFIG",  Id::Config,        0 },
+        { "PROFILE", Id::Profile,       0 },
+        { "REC",     Id::Record,        1 },
+        { "DUMP",    Id::Dump,          1 },
+        { "BAUD",    Id::Baud,          1 },
+        { "HOST",    Id::Host,          1 },
+    };
+    constexpr uint8_t TABLE_SIZE = sizeof(TABLE) / sizeof(TABLE[0]);
+    static_assert(TABLE_SIZE == static_cast<uint8_t>(Id::Unknown), "TABLE must list every Id in order");
+
+    /* Name hash (djb2 with xor), updated one character at a time */
+    constexpr uint32_t HASH_INIT = 5381;
+    constexpr uint32_t hashStep(uint32_t h, char c)
+    {
+        return (h * 33u) ^ static_cast<uint8_t>(c);
+    }
+    constexpr uint32_t hashOf(const char* s)
+    {
+        uint32_t h = HASH_INIT;
+        while (*s)
+        {
+            h = hashStep(h, *s++);
+        }
+        return h;
+    }
+
+    /* Perfect hash: a multiply and a shift map every name to its own slot.
+     * If the static_assert below fails after adding a command, try other odd seeds. */
+    constexpr uint8_t  SLOT_BITS = 5;
+    constexpr uint32_t HASH_SEED = 44347;
+    constexpr uint8_t  SLOT_COUNT = 1u << SLOT_BITS;
+    constexpr uint8_t  NO_ENTRY = 0xFF;
+
+    constexpr uint8_t slotOf(uint32_t h)
+    {
+        return static_cast<uint8_t>((h * HASH_SEED) >> (32 - SLOT_BITS));
+    }
+
+    struct SlotTable
+    {
+        uint8_t entry[SLOT_COUNT];
+        bool    perfect;
+    };
+
+    constexpr SlotTable buildSlots()
+    {
+        SlotTable t = {};
+        for (uint8_t s = 0; s < SLOT_COUNT; ++s)
+        {
+            t.entry[s] = NO_ENTRY;
+        }
+        t.perfect = true;
+        for (uint8_t i = 0; i < TABLE_SIZE; ++i)
+        {
+            uint8_t s = slotOf(hashOf(TABLE[i].name));
+            if (t.entry[s] != NO_ENTRY)
+            {
+                t.perfect = false;
+            }
+            t.entry[s] = i;
+        }
+        return t;
+    }
+
+    constexpr SlotTable SLOTS = buildSlots();
+    static_assert(SLOTS.perfect, "command names collide in the slot table, change HASH_SEED");
+
+    /* Parser state, owned by the receive interrupt */
+    enum class Field : uint8_t { Name, Gap, Sign, Number };
+
+    static Field    field    = Field::Name;
+    static uint32_t hash     = HASH_INIT;
+    static char     nameBuf[MAX_NAME + 1];
+    static uint8_t  nameLen  = 0;
+    static bool     tooLong  = false;
+    static bool     invalid  = false;
+    static bool     negative = false;
+    static uint8_t  argc     = 0;
+    static int32_t  args[MAX_ARGS];
+
+    static void restart()
+    {
+        field   = Field::Name;
+        hash    = HASH_INIT;
+        nameLen = 0;
+        tooLong = false;
+        invalid = false;
+        argc    = 0;
+    }
+
+    static bool streq(const char* a, const char* b)
+    {
+        while (*a && *a == *b)
+        {
+            ++a;
+            ++b;
+        }
+        return *a == *b;
+    }
+
+    /**
+     * @brief Looks up the command by its hash; one comparison confirms the name.
+     */
+    static const Entry* lookup()
+    {
+        if (tooLong)
+        {
+            return nullptr;
+        }
+        nameBuf[nameLen] = '\0';
+        uint8_t index = SLOTS.entry[slotOf(hash)];
+        if (index == NO_ENTRY || !streq(TABLE[index].name, nameBuf))
+        {
+            return nullptr;
+        }
+        return &TABLE[index];
+    }
+
+    bool feed(char c, Command& out)
+    {
+        if (c == '\r' || c == '\n')
+        {
+            if (nameLen == 0 && !tooLong)
+            {
+                restart();   // empty line, or the '\n' of "\r\n"
+                return false;
+            }
+            if (field == Field::Sign)
+            {
+                invalid = true;   // a '-' without digits
+            }
+            if (field == Field::Number || field == Field::Sign)
+            {
+                ++argc;
+            }
+
+            const Entry* entry = lookup();
+            out.argc = argc;
+            for (uint8_t i = 0; i < MAX_ARGS; ++i)
+            {
+                out.arg[i] = (i < argc) ? args[i] : 0;
+            }
+            if (!entry)
+            {
+                out.id = Id::Unknown;
+            }
+            else if (invalid || argc != entry->args)
+            {
+                out.id = Id::BadArgs;
+            }
+            else
+            {
+                out.id = entry->id;
+            }
+            restart();
+            return true;
+        }
+
+        if (c == ' ' || c == '\t')
+        {
+            if (field == Field::Sign)
+            {
+                invalid = true;
+            }
+            if (field == Field::Number || field == Field::Sign)
+            {
+                ++argc;
+                field = Field::Gap;
+            }
+            else if (field == Field::Name && (nameLen != 0 || tooLong))
+            {
+                field = Field::Gap;
+            }
+            return false;
+        }
+
+        switch (field)
+        {
+        case Field::Name:
+            if (c >= 'a' && c <= 'z')
+            {
+                c = static_cast<char>(c - 'a' + 'A');
+            }
+            hash = hashStep(hash, c);
+            if (nameLen < MAX_NAME)
+            {
+                nameBuf[nameLen++] = c;
+            }
+            else
+            {
+                tooLong = true;
+            }
+            break;
+
+        case Field::Gap:
+            if (argc == MAX_ARGS)
+            {
+                invalid = true;   // too many arguments, the rest of the line is ignored
+                break;
+            }
+            field    = Field::Number;
+            negative = (c == '-');
+            args[argc] = 0;
+            if (negative)
+            {
+                field = Field::Sign;   // a digit must follow
+                break;
+            }
+            [[fallthrough]];   // first digit
+        case Field::Sign:
+            field = Field::Number;
+            [[fallthrough]];
+        case Field::Number:
+            if (c < '0' || c > '9' || args[argc] > 99999999 || args[argc] < -99999999)
+            {
+                invalid = true;
+                break;
+            }
+            args[argc] = args[argc] * 10 + (negative ? -(c - '0') : (c - '0'));
+            break;
+        }
+        return false;
+    }
+
+    void reset()
+    {
+        restart();
+    }
+
+    const char* name(Id id)
+    {
+        uint8_t index = static_cast<uint8_t>(id);
+        return (index < TABLE_SIZE) ? TABLE[index].name : "?";
+    }
+}
@@ -0,0 +1,260 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file CounterLog.cpp
+ * @brief Implementation of the flash counter log.
+ */
+
+#include "../inc/CounterLog.hpp"
+#include "../inc/Telemetry.hpp"
+#include "../inc/Profiler.hpp"
+
+#include <cstring>
+
+constexpr uint32_t LOG_MAGIC   = 0x474C4350u;   // "PCLG" in memory order
+constexpr uint32_t LOG_VERSION = 1;
+
+static bool sameCounters(const CounterLog::Counters& a, const CounterLog::Counters& b)
+{
+    return a.walk == b.walk && a.run == b.run;
+}
+
+CounterLog::CounterLog(uint32_t base, uint8_t sectors, uint32_t intervalMs)
+    : base(base),
+      sectors(sectors < 2 ? 2 : (sectors > MAX_SECTORS ? MAX_SECTORS : sectors)),
+      intervalMs(intervalMs),
+      restored(false),
+      active(0),
+      sequence(0),
+      nextSlot(0),
+      saved{0, 0},
+      lastWriteMs(0),
+      reads(0),
+      counters{}
+{
+}
+
+uint32_t CounterLog::read(uint32_t address)
+{
+    ++reads;
+    return flash::read(address);
+}
+
+uint32_t CounterLog::check(uint32_t sequence, const Counters& values)
+{
+    uint8_t bytes[12];
+    std::memcpy(bytes, &sequence, 4);
+    std::memcpy(bytes + 4, &values.walk, 4);
+    std::memcpy(bytes + 8, &values.run, 4);
+    uint32_t crc = telemetry::crc16(bytes, sizeof(bytes));
+    return crc | ((crc ^ 0xFFFFu) << 16);
+}
+
+bool CounterLog::readHeader(uint8_t sector, uint32_t& sectorSequence)
+{
+    uint32_t address = sectorAddress(sector);
+    if (read(address + 12) != LOG_MAGIC)
+    {
+        return false;   // erased, never used, or the header write was cut
+    }
+    uint32_t value = read(address);
+    if (value == 0 || value != ~read(address + 4) || read(address + 8) != LOG_VERSION)
+    {
+        return false;
+    }
+    sectorSequence = value;
+    return true;
+}
+
+uint16_t CounterLog::usedSlots(uint8_t sector)
+{
+    // Records are written in slot order and the first longword of a used slot is never erased
+    uint32_t first = sectorAddress(sector) + HEADER_SIZE;
+    uint16_t low   = 0;
+    uint16_t high  = RECORDS_PER_SECTOR;
+    while (low < high)
+    {
+        uint16_t middle = static_cast<uint16_t>((low + high) / 2u);
+        if (read(first + middle * RECORD_SIZE) != flash::ERASED)
+        {
+            low = static_cast<uint16_t>(middle + 1u);
+        }
+        else
+        {
+            high = middle;
+        }
+    }
+    return low;
+}
+
+bool CounterLog::readRecord(uint8_t sector, uint16_t slot, uint32_t sectorSequence, Counters& out)
+{
+    uint32_t address = sectorAddress(sector) + HEADER_SIZE + slot * RECORD_SIZE;
+    Counters values;
+    values.walk = read(address);
+    values.run  = read(address + 4);
+    if (read(address + 8) != check(sectorSequence, values))
+    {
+        return false;   // torn or corrupted
+    }
+    out = values;
+    return true;
+}
+
+uint8_t CounterLog::restore(Counters& out)
+{
+    PROFILE_SCOPE(LogRestore);
+    reads = 0;
+
+    uint32_t sequences[MAX_SECTORS];
+    bool     valid[MAX_SECTORS];
+    sequence = 0;
+    for (uint8_t s = 0; s < sectors; ++s)
+    {
+        valid[s] = readHeader(s, sequences[s]);
+        if (valid[s] && sequences[s] > sequence)
+        {
+            sequence = sequences[s];
+            active   = s;
+        }
+    }
+    nextSlot = sequence ? usedSlots(active) : 0;
+
+    // Newest sector first; it may hold no complete record yet if its first write was cut
+    bool     found = false;
+    uint32_t below = UINT32_MAX;
+    saved = Counters{0, 0};
+    while (!found)
+    {
+        uint8_t  sector = 0;
+        uint32_t newest = 0;
+        for (uint8_t s = 0; s < sectors; ++s)
+        {
+            if (valid[s] && sequences[s] < below && sequences[s] > newest)
+            {
+                newest = sequences[s];
+                sector = s;
+            }
+        }
+        if (newest == 0)
+        {
+            break;
+        }
+        below = newest;
+
+        uint16_t used = (newest == sequence) ? nextSlot : usedSlots(sector);
+        while (used != 0 && !found)
+        {
+            --used;
+            found = readRecord(sector, used, newest, saved);
+        }
+    }
+
+    restored               = true;
+    counters.restoreReads  = reads;
+    counters.sequence      = sequence;
+    counters.freeSlots     = sequence ? static_cast<uint16_t>(RECORDS_PER_SECTOR - nextSlot) : 0;
+    out = saved;
+    return found ? 0 : 1;
+}
+
+uint8_t CounterLog::rotate()
+{
+    PROFILE_SCOPE(LogWrite);
+
+    // The next sector in the ring holds the oldest records
+    uint8_t  next    = sequence ? static_cast<uint8_t>((active + 1u) % sectors) : 0;
+    uint32_t address = sectorAddress(next);
+    uint32_t nextSequence = sequence + 1u;
+    if (flash::eraseSector(address) != 0)
+    {
+        ++counters.errors;
+        return 1;
+    }
+    ++counters.erases;
+
+    // Magic last: a cut header leaves the sector unused and it is erased again
+    if (flash::program(address, nextSequence) != 0
+        || flash::program(address + 4, ~nextSequence) != 0
+        || flash::program(address + 8, LOG_VERSION) != 0
+        || flash::program(address + 12, LOG_MAGIC) != 0)
+    {
+        ++counters.errors;
+        return 1;
+    }
+    active   = next;
+    sequence = nextSequence;
+    nextSlot = 0;
+    counters.sequence  = sequence;
+    counters.freeSlots = RECORDS_PER_SECTOR;
+    return 0;
+}
+
+uint8_t CounterLog::append(const Counters& values)
+{
+    PROFILE_SCOPE(LogWrite);
+
+    // A slot is consumed even if its write fails: it may no longer be erased
+    uint32_t address = slotAddress(nextSlot);
+    ++nextSlot;
+    counters.freeSlots = static_cast<uint16_t>(RECORDS_PER_SECTOR - nextSlot);
+
+    // The check longword commits the record
+    if (flash::program(address, values.walk) != 0
+        || flash::program(address + 4, values.run) != 0
+        || flash::program(address + 8, check(sequence, values)) != 0)
+    {
+        ++counters.errors;
+        return 1;
+    }
+    saved = values;
+    ++counters.records;
+    return 0;
+}
+
+bool CounterLog::poll(const Counters& values, uint32_t nowMs)
+{
+    if (!restored || sameCounters(values, saved) || nowMs - lastWriteMs < intervalMs)
+    {
+        return false;
+    }
+    if (sequence == 0 || nextSlot >= RECORDS_PER_SECTOR)
+    {
+        // The record goes out on the next call; a failed erase waits a whole interval
+        if (rotate() != 0)
+        {
+            lastWriteMs = nowMs;
+        }
+        return true;
+    }
+    append(values);
+    lastWriteMs = nowMs;
+    return true;
+}
+
+uint8_t CounterLog::flush(const Counters& values)
+{
+    if (!restored)
+    {
+        return 1;
+    }
+    if (!sameCounters(values, saved))
+    {
+        if ((sequence == 0 || nextSlot >= RECORDS_PER_SECTOR) && rotate() != 0)
+        {
+            return 1;
+        }
+        if (append(values) != 0)
+        {
+            return 1;
+        }
+    }
+    if (nextSlot >= RECORDS_PER_SECTOR)
+    {
+        return rotate();
+    }
+    return 0;
+}
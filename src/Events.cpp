@@ -0,0 +1,70 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Events.cpp
+ * @brief Implementation of the interrupt-to-main-loop event queue.
+ */
+
+#include "../inc/Events.hpp"
+#include "../inc/SpscQueue.hpp"
+
+namespace events
+{
+    static SpscQueue<Event, QUEUE_SIZE> g_events;
+    static uint32_t                     g_posted = 0;
+    static volatile uint8_t             g_epoch  = 0;
+
+    static uint8_t push(Event& event)
+    {
+        event.epoch = g_epoch;
+        if (!g_events.push(event))
+        {
+            return 1;
+        }
+        ++g_posted;
+        return 0;
+    }
+
+    uint8_t post(Type type)
+    {
+        Event event = {};
+        event.type = type;
+        return push(event);
+    }
+
+    uint8_t postCommand(const command::Command& cmd)
+    {
+        Event event;
+        event.type    = Type::Command;
+        event.command = cmd;
+        return push(event);
+    }
+
+    bool poll(Event& event)
+    {
+        return g_events.pop(event);
+    }
+
+    bool empty()
+    {
+        return g_events.empty();
+    }
+
+    void nextEpoch()
+    {
+        g_epoch = static_cast<uint8_t>(g_epoch + 1u);
+    }
+
+    uint8_t epoch()
+    {
+        return g_epoch;
+    }
+
+    Stats stats()
+    {
+        return Stats{g_posted, g_events.dropped(), g_events.peak()};
+    }
+}
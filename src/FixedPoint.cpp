@@ -0,0 +1,144 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file FixedPoint.cpp
+ * @brief Implementation of the integer-only formatters.
+ *
+ * The Cortex-M0+ has no divide instruction, so digits never come from "/ 10":
+ * values below 65536 (all sample digits and usual counters) use a multiply by
+ * the reciprocal 0xCCCD / 2^19, larger ones subtract powers of ten.
+ */
+
+#include "../inc/FixedPoint.hpp"
+
+namespace fixedpoint
+{
+    static const uint32_t POWERS_OF_TEN[] = {
+        1000000000u, 100000000u, 10000000u, 1000000u, 100000u, 10000u, 1000u, 100u, 10u, 1u
+    };
+    constexpr uint8_t POWER_COUNT = sizeof(POWERS_OF_TEN) / sizeof(POWERS_OF_TEN[0]);
+
+    /**
+     * @brief Writes @p value with exactly @p digits digits (leading zeros kept).
+     */
+    static char* writeDigits(char* out, uint32_t value, uint8_t digits)
+    {
+        if (value < 65536u)
+        {
+            // value / 10 == (value * 0xCCCD) >> 19 for value < 65536, with a 32-bit product
+            char* p = out + digits;
+            *p = '\0';
+            while (p != out)
+            {
+                const uint32_t q = (value * 0xCCCDu) >> 19;
+                *--p = static_cast<char>('0' + (value - q * 10u));
+                value = q;
+            }
+            return out + digits;
+        }
+
+        for (uint8_t i = static_cast<uint8_t>(POWER_COUNT - digits); i < POWER_COUNT; ++i)
+        {
+            const uint32_t power = POWERS_OF_TEN[i];
+            char digit = '0';
+            while (value >= power)
+            {
+                value -= power;
+                ++digit;
+            }
+            *out++ = digit;
+        }
+        *out = '\0';
+        return out;
+    }
+
+    char* formatUnsigned(char* out, uint32_t value)
+    {
+        uint8_t digits = POWER_COUNT;
+        while (digits > 1 && value < POWERS_OF_TEN[POWER_COUNT - digits])
+        {
+            --digits;
+        }
+        return writeDigits(out, value, digits);
+    }
+
+    char* formatSigned(char* out, int32_t value)
+    {
+        uint32_t magnitude = static_cast<uint32_t>(value);
+        if (value < 0)
+        {
+            *out++ = '-';
+            magnitude = 0u - magnitude;
+        }
+        return formatUnsigned(out, magnitude);
+    }
+
+    char* formatFixed(char* out, int32_t value, uint8_t fracBits, uint8_t decimals)
+    {
+        uint32_t magnitude = static_cast<uint32_t>(value);
+        if (value < 0)
+        {
+            *out++ = '-';   // printf keeps the sign of values that round to zero
+            magnitude = 0u - magnitude;
+        }
+
+        const uint32_t mask  = (1u << fracBits) - 1u;
+        const uint32_t scale = POWERS_OF_TEN[POWER_COUNT - 1 - decimals];
+        uint32_t whole  = magnitude >> fracBits;
+
+        // fraction * 10^decimals < 2^16 * 10^4 fits in 32 bits
+        const uint32_t scaled = (magnitude & mask) * scale;
+        uint32_t       frac   = scaled >> fracBits;
+        const uint32_t rest   = scaled & mask;
+        const uint32_t half   = 1u << (fracBits - 1);
+        if (rest > half || (rest == half && (frac & 1u)))
+        {
+            ++frac;
+            if (frac == scale)
+            {
+                frac = 0;
+                ++whole;
+            }
+        }
+
+        out = formatUnsigned(out, whole);
+        *out++ = '.';
+        return writeDigits(out, frac, decimals);
+    }
+
+    char* formatDecimal(char* out, uint32_t value, uint8_t decimals)
+    {
+        if (decimals == 0)
+        {
+            return formatUnsigned(out, value);
+        }
+
+        // All digits with at least one before the point, then the fraction moves up by one
+        uint8_t digits = POWER_COUNT;
+        while (digits > decimals + 1u && value < POWERS_OF_TEN[POWER_COUNT - digits])
+        {
+            --digits;
+        }
+        char* end = writeDigits(out, value, digits);
+        for (char* p = end; p != end - decimals; --p)
+        {
+            *p = p[-1];
+        }
+        end[-decimals] = '.';
+        end[1] = '\0';
+        return end + 1;
+    }
+
+    char* append(char* out, const char* str)
+    {
+        while (*str)
+        {
+            *out++ = *str++;
+        }
+        *out = '\0';
+        return out;
+    }
+}
@@ -0,0 +1,119 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Flash.cpp
+ * @brief Implementation of the FTFA longword program and sector erase commands.
+ */
+
+#include "../inc/Flash.hpp"
+#include "../inc/BoardSupport.hpp"
+
+#include <cstring>
+
+/**
+ * @brief Flash array as seen by the core; the simulator maps it onto its model.
+ */
+#ifndef FLASH_MEMORY
+  #define FLASH_MEMORY(address)  (reinterpret_cast<const uint8_t*>(address))
+  #define FLASH_COMMAND_FROM_RAM 1
+#else
+  #define FLASH_COMMAND_FROM_RAM 0
+#endif
+
+/**
+ * @brief End of the image: limit of the load region in the scatter file Keil
+ *        generates from IROM1 (armlink symbol), or set by the simulator.
+ */
+#ifndef FLASH_IMAGE_END
+extern "C" const uint8_t Load$$LR$$LR_IROM1$$Limit[];
+  #define FLASH_IMAGE_END  (reinterpret_cast<uint32_t>(Load$$LR$$LR_IROM1$$Limit))
+#endif
+
+constexpr uint8_t CMD_PROGRAM_LONGWORD = 0x06;
+constexpr uint8_t CMD_ERASE_SECTOR     = 0x09;
+constexpr uint8_t FSTAT_ERRORS         = FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK | FTFA_FSTAT_MGSTAT0_MASK;
+
+namespace flash
+{
+#if FLASH_COMMAND_FROM_RAM
+    /*
+     * Thumb code run from RAM (r0 = &FTFA->FSTAT):
+     *   movs r1, #0x80 ; strb r1, [r0]          launch (write 1 to CCIF)
+     *   1: ldrb r2, [r0] ; tst r2, r1 ; beq 1b   wait for CCIF
+     *   bx lr
+     * Not const, so the linker places it in RAM with the initialized data.
+     */
+    alignas(4) static uint16_t runCommandCode[] = { 0x2180, 0x7001, 0x7802, 0x420A, 0xD0FC, 0x4770 };
+#endif
+
+    static void runCommand()
+    {
+#if FLASH_COMMAND_FROM_RAM
+        using Launch = void (*)(volatile uint8_t* fstat);
+        Launch launch = reinterpret_cast<Launch>(reinterpret_cast<uintptr_t>(runCommandCode) | 1u);
+        launch(&FTFA->FSTAT);
+#else
+        FTFA->FSTAT = FTFA_FSTAT_CCIF_MASK;
+        while (!(FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK))
+        {
+        }
+#endif
+    }
+
+    /**
+     * @brief Loads FCCOB with a command and address (plus data for programs) and runs it.
+     */
+    static uint8_t execute(uint8_t command, uint32_t address, uint32_t value)
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+
+        while (!(FTFA->FSTAT & FTFA_FSTAT_CCIF_MASK))
+        {
+        }
+        FTFA->FSTAT = FTFA_FSTAT_ACCERR_MASK | FTFA_FSTAT_FPVIOL_MASK;   // write 1 to clear
+
+        FTFA->FCCOB0 = command;
+        FTFA->FCCOB1 = static_cast<uint8_t>(address >> 16);
+        FTFA->FCCOB2 = static_cast<uint8_t>(address >> 8);
+        FTFA->FCCOB3 = static_cast<uint8_t>(address);
+        // FCCOB4 is the byte at the highest address of the longword
+        FTFA->FCCOB4 = static_cast<uint8_t>(value >> 24);
+        FTFA->FCCOB5 = static_cast<uint8_t>(value >> 16);
+        FTFA->FCCOB6 = static_cast<uint8_t>(value >> 8);
+        FTFA->FCCOB7 = static_cast<uint8_t>(value);
+        runCommand();
+
+        uint8_t status = FTFA->FSTAT;
+        if (!primask)
+        {
+            __enable_irq();
+        }
+        return (status & FSTAT_ERRORS) ? 1 : 0;
+    }
+
+    uint32_t read(uint32_t address)
+    {
+        uint32_t value;
+        std::memcpy(&value, FLASH_MEMORY(address), sizeof(value));
+        return value;
+    }
+
+    uint8_t program(uint32_t address, uint32_t value)
+    {
+        return execute(CMD_PROGRAM_LONGWORD, address, value);
+    }
+
+    uint8_t eraseSector(uint32_t address)
+    {
+        return execute(CMD_ERASE_SECTOR, address & ~(SECTOR_SIZE - 1u), 0);
+    }
+
+    uint32_t imageEnd()
+    {
+        return FLASH_IMAGE_END;
+    }
+}
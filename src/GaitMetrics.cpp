@@ -0,0 +1,192 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file GaitMetrics.cpp
+ * @brief Implementation of the rolling cadence, speed and distance estimator.
+ */
+
+#include "../inc/GaitMetrics.hpp"
+
+constexpr uint8_t  RING_MASK  = GaitMetrics::CAPACITY - 1u;
+constexpr uint32_t MAX_WINDOW = 0x7FFF;     // samples, half the 16-bit timestamp range
+
+static_assert((GaitMetrics::CAPACITY & RING_MASK) == 0, "ring capacity must be a power of two");
+
+GaitMetrics::GaitMetrics(uint16_t rateHz)
+    : GaitMetrics(Config(), rateHz)
+{
+}
+
+GaitMetrics::GaitMetrics(const Config& cfg, uint16_t rateHz)
+    : cfg(cfg), rate(rateHz ? rateHz : 1)
+{
+    reset();
+}
+
+void GaitMetrics::reset()
+{
+    setRate(rate);
+    walkDistance = 0;
+    runDistance  = 0;
+}
+
+void GaitMetrics::setRate(uint16_t rateHz)
+{
+    rate     = rateHz ? rateHz : 1;
+    head     = 0;
+    stored   = 0;
+    lastStep = 0;
+    for (uint8_t w = 0; w < WINDOWS; ++w)
+    {
+        tail[w]     = 0;
+        count[w]    = 0;
+        runCount[w] = 0;
+    }
+}
+
+uint16_t GaitMetrics::stride(const StrideModel& model, uint16_t cadence)
+{
+    return static_cast<uint16_t>(model.baseMm + (static_cast<uint32_t>(model.mmPer100Spm) * cadence + 50u) / 100u);
+}
+
+void GaitMetrics::expire(uint32_t sample)
+{
+    uint32_t longest = 0;
+    for (uint8_t w = 0; w < WINDOWS; ++w)
+    {
+        uint32_t limit = static_cast<uint32_t>(cfg.windowSeconds[w]) * rate;
+        longest = limit > longest ? limit : longest;
+    }
+    if (longest > MAX_WINDOW)
+    {
+        longest = MAX_WINDOW;
+    }
+
+    // Beyond every window the 16-bit timestamps could have wrapped: drop them all
+    if (stored != 0 && sample - lastStep >= longest)
+    {
+        for (uint8_t w = 0; w < WINDOWS; ++w)
+        {
+            count[w]    = 0;
+            runCount[w] = 0;
+        }
+        return;
+    }
+
+    // Each step leaves each window once, so this is O(1) amortized per step
+    const uint16_t now = static_cast<uint16_t>(sample);
+    for (uint8_t w = 0; w < WINDOWS; ++w)
+    {
+        uint32_t limit = static_cast<uint32_t>(cfg.windowSeconds[w]) * rate;
+        if (limit > MAX_WINDOW)
+        {
+            limit = MAX_WINDOW;
+        }
+        while (count[w] != 0 && static_cast<uint16_t>(now - times[tail[w]]) >= limit)
+        {
+            runCount[w] = static_cast<uint8_t>(runCount[w] - isRun(tail[w]));
+            --count[w];
+            tail[w] = static_cast<uint8_t>((tail[w] + 1u) & RING_MASK);
+        }
+    }
+}
+
+uint16_t GaitMetrics::cadence(uint8_t window, uint32_t sample) const
+{
+    if (count[window] < 2 || sample - lastStep >= static_cast<uint32_t>(cfg.idleSeconds) * rate)
+    {
+        return 0;
+    }
+    uint8_t  newest = static_cast<uint8_t>((head - 1u) & RING_MASK);
+    uint32_t span   = static_cast<uint16_t>(times[newest] - times[tail[window]]);
+    if (span == 0)
+    {
+        return 0;
+    }
+    // (steps - 1) intervals over span samples, in steps per minute
+    uint32_t intervals = count[window] - 1u;
+    return static_cast<uint16_t>((intervals * 60u * rate + span / 2u) / span);
+}
+
+void GaitMetrics::addStep(StepDetector::Step step, uint32_t sample)
+{
+    if (step == StepDetector::Step::None)
+    {
+        return;
+    }
+    expire(sample);
+
+    // A full ring overwrites its oldest entry, which may still be in a window
+    for (uint8_t w = 0; w < WINDOWS; ++w)
+    {
+        if (count[w] == CAPACITY)
+        {
+            runCount[w] = static_cast<uint8_t>(runCount[w] - isRun(head));
+            --count[w];
+            tail[w] = static_cast<uint8_t>((head + 1u) & RING_MASK);
+        }
+    }
+
+    const bool run = step == StepDetector::Step::Run;
+    times[head] = static_cast<uint16_t>(sample);
+    if (run)
+    {
+        runBits[head >> 3] = static_cast<uint8_t>(runBits[head >> 3] | (1u << (head & 7u)));
+    }
+    else
+    {
+        runBits[head >> 3] = static_cast<uint8_t>(runBits[head >> 3] & ~(1u << (head & 7u)));
+    }
+    for (uint8_t w = 0; w < WINDOWS; ++w)
+    {
+        if (count[w] == 0)
+        {
+            tail[w] = head;
+        }
+        ++count[w];
+        runCount[w] = static_cast<uint8_t>(runCount[w] + run);
+    }
+    head     = static_cast<uint8_t>((head + 1u) & RING_MASK);
+    stored   = static_cast<uint8_t>(stored < CAPACITY ? stored + 1u : CAPACITY);
+    lastStep = sample;
+
+    // Stride at the current cadence; a step without a cadence yet counts at 100 steps/min
+    uint16_t now = cadence(0, sample);
+    const StrideModel& model = run ? cfg.run : cfg.walk;
+    uint16_t length = stride(model, now ? now : 100);
+    if (run)
+    {
+        runDistance += length;
+    }
+    else
+    {
+        walkDistance += length;
+    }
+}
+
+GaitMetrics::Metrics GaitMetrics::metrics(uint32_t sample)
+{
+    expire(sample);
+
+    Metrics result;
+    for (uint8_t w = 0; w < WINDOWS; ++w)
+    {
+        Window& out = result.window[w];
+        out.steps   = count[w];
+        out.cadence = cadence(w, sample);
+
+        // Split by the share of each step type in the window
+        out.runCadence  = count[w] ? static_cast<uint16_t>((static_cast<uint32_t>(out.cadence) * runCount[w] + count[w] / 2u) / count[w]) : 0;
+        out.walkCadence = static_cast<uint16_t>(out.cadence - out.runCadence);
+
+        uint32_t mmPerMinute = static_cast<uint32_t>(out.walkCadence) * stride(cfg.walk, out.cadence)
+                             + static_cast<uint32_t>(out.runCadence) * stride(cfg.run, out.cadence);
+        out.speedMmS = static_cast<uint16_t>((mmPerMinute + 30u) / 60u);
+    }
+    result.walkDistanceMm = walkDistance;
+    result.runDistanceMm  = runDistance;
+    return result;
+}
@@ -0,0 +1,80 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file IsrMonitor.cpp
+ * @brief Implementation of the interrupt handler timing.
+ */
+
+#include "../inc/IsrMonitor.hpp"
+#include "../inc/Profiler.hpp"
+
+extern "C" {
+#include "MKL05Z4.h"
+}
+
+namespace isrmon
+{
+    static Stats counters[static_cast<uint8_t>(Source::Count)] = {};
+
+    static_assert(static_cast<uint8_t>(profile::Stage::Count) - static_cast<uint8_t>(profile::Stage::IsrPortA)
+                  == static_cast<uint8_t>(Source::Count), "one profile stage per interrupt source");
+
+    void init()
+    {
+        if (!(SysTick->CTRL & SysTick_CTRL_ENABLE_Msk))
+        {
+            SysTick->LOAD = SysTick_LOAD_RELOAD_Msk;
+            SysTick->VAL  = 0;
+            SysTick->CTRL = SysTick_CTRL_CLKSOURCE_Msk | SysTick_CTRL_ENABLE_Msk;
+        }
+    }
+
+    uint32_t cycleStamp()
+    {
+        return SysTick->VAL;
+    }
+
+    uint32_t cyclesSince(uint32_t start)
+    {
+        return (start - SysTick->VAL) & SysTick_VAL_CURRENT_Msk;
+    }
+
+    void record(Source source, uint32_t start)
+    {
+        // Handlers share one priority level, so this never races with another record()
+        Stats& s = counters[static_cast<uint8_t>(source)];
+        s.lastCycles = cyclesSince(start);
+        if (s.lastCycles > s.maxCycles)
+        {
+            s.maxCycles = s.lastCycles;
+        }
+        ++s.count;
+
+        PROFILE_RECORD(static_cast<profile::Stage>(static_cast<uint8_t>(profile::Stage::IsrPortA)
+                                                   + static_cast<uint8_t>(source)), s.lastCycles);
+    }
+
+    const Stats& stats(Source source)
+    {
+        return counters[static_cast<uint8_t>(source)];
+    }
+
+    const char* name(Source source)
+    {
+        static const char* const names[] = { "porta", "uart0", "dma0", "pit", "i2c0", "lptmr" };
+        static_assert(sizeof(names) / sizeof(names[0]) == static_cast<uint8_t>(Source::Count),
+                      "one name per source");
+        return names[static_cast<uint8_t>(source)];
+    }
+
+    void reset()
+    {
+        for (Stats& s : counters)
+        {
+            s = Stats{};
+        }
+    }
+}
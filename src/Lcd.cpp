@@ -8,13 +8,16 @@
  * @brief Implementation of the LCD 16x2 driver using the PCF8574 I2C expander.
  *
  * This file contains the logic to initialize and control a standard HD44780-based
- * 16x2 character LCD display via the PCF8574 I2C port expander. It re-implements
- * minimal I2C transactions (start, stop, send byte) locally because the existing
- * BoardSupport I2C library only provides register-based functions.
+ * 16x2 character LCD display via the PCF8574 I2C port expander. Every expander
+ * write is a one-byte transfer queued on the BoardSupport I2C engine; the core
+ * sleeps while it is on the bus.
  */
 
 #include "../inc/Lcd.hpp"  // NEW
 #include "../inc/BoardSupport.hpp"
+#include "../inc/Profiler.hpp"
+
+#include <cstring>
 
 /* Commands for HD44780 */
 constexpr uint8_t LCD_CLEAR_DISPLAY = 0x01;
@@ -24,6 +27,7 @@ constexpr uint8_t LCD_FULLLINE      = 0x40;  // offset for row 2
 /* PCF8574 default addresses */
 constexpr uint8_t PCF8574_ADDRESS  = 0x27;  // typical address
 constexpr uint8_t PCF8574A_ADDRESS = 0x3F;  // alternate address
+constexpr uint32_t PCF8574_SCL_HZ  = I2C::STANDARD_HZ;  // the expander is specified for 100 kHz only
 
 /* PCF8574 bit masks for LCD control */
 constexpr uint8_t PCF8574_BL = 0x08;  // Backlight
@@ -34,55 +38,43 @@ constexpr uint8_t PCF8574_RS = 0x01;  // Register select bit
 bool    g_lcdBacklight  = true;        /**< Tracks backlight state */
 uint8_t g_pcfAddress    = PCF8574_ADDRESS;
 
-/* =====================================================
- * Internal "raw" I2C helper functions - local replication
- * =====================================================
+/* Shadow framebuffer: what the application wants (g_shadow) and what the display shows (g_shown) */
+static char     g_shadow[lcd::ROWS][lcd::COLS];
+static char     g_shown[lcd::ROWS][lcd::COLS];
+static uint8_t  g_lcdCol       = 0;      // DDRAM cursor of the controller
+static uint8_t  g_lcdRow       = 0;
+static bool     g_cursorKnown  = false;
+static uint32_t g_lcdBusBytes  = 0;      // I2C bytes sent to the expander
+static lcd::FlushStats g_flushStats = {};
+
+/* HD44780 execution times at fOSC = 270 kHz (datasheet, table 6) */
+constexpr uint32_t HD44780_EXEC_US     = 37;      // most instructions and data writes
+constexpr uint32_t HD44780_CLEAR_US    = 1520;    // clear display, return home
+constexpr uint32_t HD44780_POWER_ON_US = 40000;   // after VCC rises to 2.7 V
+constexpr uint32_t HD44780_INIT1_US    = 4100;    // after the first 8-bit function set
+constexpr uint32_t HD44780_INIT2_US    = 100;     // after the second one
+
+/* Expander writes streamed after a single address phase, sent as one I2C transaction */
+constexpr uint8_t  STREAM_SIZE = 96;
+static uint8_t g_stream[STREAM_SIZE];
+static uint8_t g_streamLen = 0;
+static uint8_t g_padWrites = 0;      // idle writes after an instruction to cover its execution time
+
+/* Cost of the full redraw that flush() replaces: clear, two cursor moves and 32 characters */
+constexpr uint32_t FULL_REDRAW_LCD_BYTES = 1 + lcd::ROWS * (1 + lcd::COLS);
+
+/**
+ * @brief Expander writes per LCD byte: EN high and EN low for each nibble, then padding.
  */
-static inline void i2c_enable()
-{
-    I2C0->C1 |= I2C_C1_IICEN_MASK;
-}
-static inline void i2c_disable()
-{
-    I2C0->C1 &= ~I2C_C1_IICEN_MASK;
-}
-static inline void i2c_start()
-{
-    I2C0->C1 |= I2C_C1_MST_MASK;
-}
-static inline void i2c_stop()
-{
-    I2C0->C1 &= ~I2C_C1_MST_MASK;
-}
-static inline void i2c_tran()
+static uint32_t busBytesPerLcdByte()
 {
-    I2C0->C1 |= I2C_C1_TX_MASK;
+    return 2 * 2 + g_padWrites;
 }
-static inline void i2c_send(uint8_t data)
-{
-    I2C0->D = data;
-}
-static inline void i2c_wait(uint8_t& error)
-{
-    uint16_t timeout = 0;
-    while ((!(I2C0->S & I2C_S_IICIF_MASK)) && (timeout < 10000))
-    {
-        ++timeout;
-    }
-    I2C0->S |= I2C_S_IICIF_MASK; // clear the flag
 
-    if (timeout >= 10000)
-    {
-        // optional: set an error code if needed
-        error = 1;
-    }
-
-    // Check if no ACK
-    if (I2C0->S & I2C_S_RXAK_MASK)
-    {
-        error = 2;
-    }
-}
+/* =====================================================
+ * I2C access through the interrupt-driven engine
+ * =====================================================
+ */
 
 /**
  * @brief Writes a single byte to the given I2C address (no register).
@@ -92,27 +84,40 @@ static inline void i2c_wait(uint8_t& error)
  */
 uint8_t i2c_writeByte(uint8_t address, uint8_t data)
 {
-    uint8_t error = 0;
+    I2C::Transfer t = { address, &data, 1, nullptr, 0, nullptr, nullptr, I2C::OK };
+    uint8_t error = I2C::transfer(t);
 
-    i2c_enable();
-    i2c_tran();
-    i2c_start();
+    g_lcdBusBytes += 2;
+    return error;
+}
 
-    i2c_send(static_cast<uint8_t>(address << 1));
-    i2c_wait(error);
-    if (error != 0)
+/**
+ * @brief Sends the streamed expander writes as one transaction (the core sleeps meanwhile).
+ */
+static void streamFlush()
+{
+    if (g_streamLen == 0)
     {
-        i2c_stop();
-        i2c_disable();
-        return error;
+        return;
     }
+    I2C::Transfer t = { g_pcfAddress, g_stream, g_streamLen, nullptr, 0, nullptr, nullptr, I2C::OK };
+    I2C::transfer(t);
 
-    i2c_send(data);
-    i2c_wait(error);
-    i2c_stop();
-    i2c_disable();
+    g_lcdBusBytes += 1u + g_streamLen;   // address byte + data
+    g_streamLen = 0;
+}
 
-    return error;
+/**
+ * @brief Appends one expander write (with backlight info) to the stream.
+ * @param data Port value.
+ */
+static void streamPut(uint8_t data)
+{
+    if (g_streamLen == STREAM_SIZE)
+    {
+        streamFlush();
+    }
+    g_stream[g_streamLen++] = data | (g_lcdBacklight ? PCF8574_BL : 0x00);
 }
 
 /* =====================================================
@@ -126,9 +131,8 @@ uint8_t i2c_writeByte(uint8_t address, uint8_t data)
  */
 void PCF8574_Write(uint8_t data)
 {
-    // If backlight is on, OR with PCF8574_BL bit
-    uint8_t toSend = data | (g_lcdBacklight ? PCF8574_BL : 0x00);
-    i2c_writeByte(g_pcfAddress, toSend);
+    streamPut(data);
+    streamFlush();
 }
 
 /**
@@ -141,15 +145,17 @@ void LCD_Write4(uint8_t data, bool rs)
     uint8_t highNibble = (data << 4) & 0xF0;  // mask upper nibble
     uint8_t control = (rs ? PCF8574_RS : 0x00);
 
-    // EN = 1
-    PCF8574_Write(highNibble | control | PCF8574_EN);
-    // EN = 0
-    PCF8574_Write(highNibble | control);
-    DELAY(2);
+    // EN = 1, then EN = 0 latches the nibble. Each expander write holds the
+    // pins for a whole I2C byte, far above the 230 ns enable pulse width.
+    streamPut(highNibble | control | PCF8574_EN);
+    streamPut(highNibble | control);
 }
 
 /**
- * @brief Send a full 8-bit command or data to LCD in two steps of 4 bits.
+ * @brief Queues a full 8-bit command or data in two steps of 4 bits.
+ *
+ * The next instruction may only follow after the execution time, so idle writes
+ * (EN low) are streamed until the bus itself has spent HD44780_EXEC_US.
  * @param data Byte to send.
  * @param rs Register select (false = command, true = data).
  */
@@ -159,6 +165,36 @@ void LCD_Write8(uint8_t data, bool rs)
     LCD_Write4((data >> 4) & 0x0F, rs);
     // Then low nibble
     LCD_Write4(data & 0x0F, rs);
+
+    uint8_t idle = static_cast<uint8_t>(((data & 0x0F) << 4) | (rs ? PCF8574_RS : 0x00));
+    for (uint8_t i = 0; i < g_padWrites; ++i)
+    {
+        streamPut(idle);
+    }
+}
+
+/**
+ * @brief Sends a command that takes longer than the padding covers and waits for it.
+ * @param command Instruction byte.
+ * @param us Execution time in microseconds.
+ */
+static void LCD_Command(uint8_t command, uint32_t us)
+{
+    LCD_Write8(command, false);
+    streamFlush();
+    delayUs(us);
+}
+
+/**
+ * @brief Computes the idle writes that cover the HD44780 execution time at the current SCL rate.
+ */
+static void updatePadding()
+{
+    // One expander write is 9 SCL periods; the falling EN edge of the next
+    // instruction's first nibble already comes two writes later
+    const uint32_t sclHz  = I2C::clockHz(g_pcfAddress);
+    const uint32_t writes = (HD44780_EXEC_US * sclHz + 9u * 1000000u - 1u) / (9u * 1000000u);
+    g_padWrites = static_cast<uint8_t>((writes > 2u) ? writes - 2u : 0u);
 }
 
 /**
@@ -181,6 +217,22 @@ void checkPCFaddress()
     }
 }
 
+/**
+ * @brief Queues a Set DDRAM address command and tracks the cursor.
+ */
+static void moveCursor(uint8_t col, uint8_t row)
+{
+    if (row > 1)
+        row = 1; // for 2-line display, max row = 1
+
+    uint8_t address = static_cast<uint8_t>(LCD_SET_DDRAMADDR + col + (LCD_FULLLINE * row));
+    LCD_Write8(address, false);
+
+    g_lcdCol = col;
+    g_lcdRow = row;
+    g_cursorKnown = true;
+}
+
 
 /* =====================================================
  * Public API (namespace lcd)
@@ -191,28 +243,62 @@ namespace lcd
 
 void init()
 {
-    // Initialize the MCU I2C from BoardSupport
+    // Initialize the MCU I2C from BoardSupport; the expander stays in standard mode
+    // whatever rate the other devices use, including the address probe
+    I2C::setDeviceClock(PCF8574_ADDRESS, PCF8574_SCL_HZ);
+    I2C::setDeviceClock(PCF8574A_ADDRESS, PCF8574_SCL_HZ);
     I2C::init();
 
     // Check which PCF address is valid
     checkPCFaddress();
+    updatePadding();
+
+    // Wait >40ms after power up (HD44780 datasheet, VCC = 3.3 V)
+    delayUs(HD44780_POWER_ON_US);
+
+    // Initialization by instruction (HD44780 datasheet, figure 24): the controller
+    // starts in 8-bit mode, so these are single nibbles, each a full instruction
+    LCD_Write4(0x03, false);
+    streamFlush();
+    delayUs(HD44780_INIT1_US);
+    LCD_Write4(0x03, false);
+    streamFlush();
+    delayUs(HD44780_INIT2_US);
+    LCD_Write4(0x03, false);
+    streamFlush();
+    delayUs(HD44780_EXEC_US);
+    LCD_Write4(0x02, false);  // set to 4-bit mode
+    streamFlush();
+    delayUs(HD44780_EXEC_US);
 
-    // Wait >15ms after power up (HD44780 datasheet)
-    DELAY(42);
-
-    // Initialize in 4-bit mode
-    // Sequence recommended in many HD44780 references
-    LCD_Write8(0x33, false); // Command: 0x33
-    LCD_Write8(0x32, false); // Command: 0x32 (set to 4-bit mode)
     LCD_Write8(0x2C, false); // Function set: 4-bit, 2 lines, 5x8 font
     LCD_Write8(0x08, false); // Display off, cursor off, blink off
-    LCD_Write8(0x01, false); // Clear display
+    LCD_Command(LCD_CLEAR_DISPLAY, HD44780_CLEAR_US);
     LCD_Write8(0x0C, false); // Display on, cursor off, blink off
+    streamFlush();
+
+    std::memset(g_shadow, ' ', sizeof(g_shadow));
+    std::memset(g_shown, ' ', sizeof(g_shown));
+    g_lcdCol = 0;
+    g_lcdRow = 0;
+    g_cursorKnown = true;
+}
+
+uint8_t address()
+{
+    return g_pcfAddress;
 }
 
 void clearAll()
 {
-    LCD_Write8(LCD_CLEAR_DISPLAY, false);
+    LCD_Command(LCD_CLEAR_DISPLAY, HD44780_CLEAR_US);
+
+    // Write-through: the shadow follows the display, the cursor returns home
+    std::memset(g_shadow, ' ', sizeof(g_shadow));
+    std::memset(g_shown, ' ', sizeof(g_shown));
+    g_lcdCol = 0;
+    g_lcdRow = 0;
+    g_cursorKnown = true;
 }
 
 void print(const char* str)
@@ -223,17 +309,21 @@ void print(const char* str)
     while (*str)
     {
         LCD_Write8(static_cast<uint8_t>(*str), true); // rs=1 => data
+        if (g_cursorKnown && g_lcdCol < COLS)
+        {
+            g_shadow[g_lcdRow][g_lcdCol] = *str;
+            g_shown[g_lcdRow][g_lcdCol]  = *str;
+        }
+        ++g_lcdCol;   // the controller auto-increments the DDRAM address
         ++str;
     }
+    streamFlush();
 }
 
 void setCursor(uint8_t col, uint8_t row)
 {
-    if (row > 1)
-        row = 1; // for 2-line display, max row = 1
-
-    uint8_t address = static_cast<uint8_t>(LCD_SET_DDRAMADDR + col + (LCD_FULLLINE * row));
-    LCD_Write8(address, false);
+    moveCursor(col, row);
+    streamFlush();
 }
 
 void backlight(bool state)
@@ -247,12 +337,95 @@ void blinkOn()
 {
     // 0x0D => display on, cursor off, blink on
     LCD_Write8(0x0D, false);
+    streamFlush();
 }
 
 void blinkOff()
 {
     // 0x0C => display on, cursor off, blink off
     LCD_Write8(0x0C, false);
+    streamFlush();
+}
+
+void write(uint8_t col, uint8_t row, const char* str)
+{
+    if (!str || row >= ROWS)
+        return;
+
+    while (*str && col < COLS)
+    {
+        g_shadow[row][col++] = *str++;
+    }
+}
+
+void writeLine(uint8_t row, const char* str)
+{
+    if (!str || row >= ROWS)
+        return;
+
+    for (uint8_t col = 0; col < COLS; ++col)
+    {
+        g_shadow[row][col] = *str ? *str++ : ' ';
+    }
+}
+
+void flush()
+{
+    PROFILE_SCOPE(LcdFlush);
+    const uint32_t busBefore = g_lcdBusBytes;
+    uint32_t cells = 0;
+
+    for (uint8_t row = 0; row < ROWS; ++row)
+    {
+        for (uint8_t col = 0; col < COLS; ++col)
+        {
+            if (g_shadow[row][col] == g_shown[row][col])
+            {
+                continue;
+            }
+
+            // A single clean cell in between costs the same as a cursor move, so it is
+            // simply rewritten; larger gaps and row changes need a Set DDRAM address.
+            bool reachable = g_cursorKnown && g_lcdRow == row && g_lcdCol <= col && col - g_lcdCol <= 1;
+            if (!reachable)
+            {
+                moveCursor(col, row);
+                ++g_flushStats.cursorMoves;
+            }
+            while (g_lcdCol < col)
+            {
+                LCD_Write8(static_cast<uint8_t>(g_shown[row][g_lcdCol]), true);
+                ++g_lcdCol;
+            }
+
+            char c = g_shadow[row][col];
+            LCD_Write8(static_cast<uint8_t>(c), true);
+            g_shown[row][col] = c;
+            ++g_lcdCol;
+            ++cells;
+        }
+    }
+
+    if (cells == 0)
+    {
+        return;
+    }
+    streamFlush();
+
+    // The full redraw is costed on the same streaming path (one transaction, plus the address byte)
+    const uint32_t sent = g_lcdBusBytes - busBefore;
+    const uint32_t full = FULL_REDRAW_LCD_BYTES * busBytesPerLcdByte() + 1u;
+    const uint32_t saved = (sent < full) ? full - sent : 0;
+
+    ++g_flushStats.flushes;
+    g_flushStats.cellsWritten += cells;
+    g_flushStats.bytesSent    += sent;
+    g_flushStats.bytesSaved   += saved;
+}
+
+const FlushStats& flushStats()
+{
+    return g_flushStats;
 }
 
 } // end namespace lcd
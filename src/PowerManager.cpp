@@ -0,0 +1,161 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file PowerManager.cpp
+ * @brief Implementation of the WAIT/VLPS sleep and the LPTMR0 time base.
+ */
+
+#include "../inc/PowerManager.hpp"
+#include "../inc/BoardSupport.hpp"
+#include "../inc/IsrMonitor.hpp"
+#include "../inc/Uart.hpp"
+
+constexpr uint8_t  STOPM_VLPS   = 2;        // PMCTRL STOPM: very low power stop
+constexpr uint32_t LPTMR_PCS_LPO = 1;       // 1 kHz low power oscillator
+constexpr uint32_t COUNTER_WRAP = 0x10000u;
+
+namespace power
+{
+    static bool              initialized = false;
+    static volatile uint32_t overflows   = 0;   // LPTMR0 16-bit wraps (65.536 s each)
+    static Stats             counters    = {};
+    static uint32_t          runStartMs  = 0;   // start of the current Run period
+    static uint32_t          wakeMs      = 0;
+    static bool              wakePending = false;
+
+    static uint8_t index(State state)
+    {
+        return static_cast<uint8_t>(state);
+    }
+
+    void init()
+    {
+        // PMPROT is write-once after reset: allow VLPR/VLPW/VLPS
+        SMC->PMPROT = SMC_PMPROT_AVLP_MASK;
+        SMC->PMCTRL = SMC_PMCTRL_STOPM(STOPM_VLPS);
+
+        // Free-running counter on the LPO; TCF when CNR wraps from 0xFFFF to 0
+        SIM->SCGC5 |= SIM_SCGC5_LPTMR_MASK;
+        LPTMR0->CSR = 0;
+        LPTMR0->PSR = LPTMR_PSR_PCS(LPTMR_PCS_LPO) | LPTMR_PSR_PBYP_MASK;
+        LPTMR0->CMR = COUNTER_WRAP - 1u;
+        LPTMR0->CSR = LPTMR_CSR_TFC_MASK | LPTMR_CSR_TIE_MASK | LPTMR_CSR_TEN_MASK;
+        NVIC_ClearPendingIRQ(LPTMR0_IRQn);
+        NVIC_EnableIRQ(LPTMR0_IRQn);
+
+        overflows   = 0;
+        initialized = true;
+        reset();
+    }
+
+    uint32_t nowMs()
+    {
+        if (!initialized)
+        {
+            return 0;
+        }
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        LPTMR0->CNR = 0;   // any write latches the counter for reading
+        uint32_t count = LPTMR0->CNR & LPTMR_CNR_COUNTER_MASK;
+        uint32_t high  = overflows;
+        if ((LPTMR0->CSR & LPTMR_CSR_TCF_MASK) && count < COUNTER_WRAP / 2u)
+        {
+            ++high;   // wrapped, interrupt not taken yet
+        }
+        if (!primask)
+        {
+            __enable_irq();
+        }
+        return (high << 16) | count;
+    }
+
+    void sleep(State deepest)
+    {
+        if (!initialized)
+        {
+            __WFI();
+            return;
+        }
+
+        // The UART and I2C clocks stop in VLPS: finish their transfers in WAIT
+        State state = deepest;
+        if (state != State::Wait && !(Uart::txIdle() && I2C::idle()))
+        {
+            state = State::Wait;
+        }
+
+        uint32_t start = nowMs();
+        counters.timeMs[index(State::Run)] += start - runStartMs;
+
+        if (state == State::Wait)
+        {
+            SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+        }
+        else
+        {
+            SCB->SCR |= SCB_SCR_SLEEPDEEP_Msk;
+        }
+        __WFI();
+        SCB->SCR &= ~SCB_SCR_SLEEPDEEP_Msk;
+
+        runStartMs = nowMs();
+        counters.timeMs[index(state)] += runStartMs - start;
+        ++counters.sleeps[index(state)];
+    }
+
+    void markWake()
+    {
+        wakeMs      = nowMs();
+        wakePending = true;
+        ++counters.wakeups;
+    }
+
+    void markSample()
+    {
+        if (!wakePending)
+        {
+            return;
+        }
+        wakePending = false;
+        counters.wakeLatencyLastMs = nowMs() - wakeMs;
+        if (counters.wakeLatencyLastMs > counters.wakeLatencyMaxMs)
+        {
+            counters.wakeLatencyMaxMs = counters.wakeLatencyLastMs;
+        }
+    }
+
+    const Stats& stats()
+    {
+        uint32_t now = nowMs();
+        counters.timeMs[index(State::Run)] += now - runStartMs;
+        runStartMs = now;
+        return counters;
+    }
+
+    void reset()
+    {
+        counters   = Stats{};
+        runStartMs = nowMs();
+    }
+
+    const char* name(State state)
+    {
+        static const char* const names[] = { "run", "wait", "vlps", "idle" };
+        static_assert(sizeof(names) / sizeof(names[0]) == static_cast<uint8_t>(State::Count),
+                      "one name per state");
+        return names[index(state)];
+    }
+}
+
+extern "C" void LPTMR0_IRQHandler(void)
+{
+    isrmon::Scope timing(isrmon::Source::Lptmr);
+
+    // Writing CSR back with TCF set clears the flag, the other bits keep their value
+    LPTMR0->CSR |= LPTMR_CSR_TCF_MASK;
+    ++power::overflows;
+}
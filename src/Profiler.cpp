@@ -0,0 +1,81 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Profiler.cpp
+ * @brief Implementation of the per-stage cycle table (empty unless PROFILING=1).
+ */
+
+#include "../inc/Profiler.hpp"
+
+#if PROFILING
+
+#include "../inc/IsrMonitor.hpp"
+
+extern "C" {
+#include "MKL05Z4.h"
+}
+
+namespace profile
+{
+    static Stats table[static_cast<uint8_t>(Stage::Count)] = {};
+
+    void record(Stage stage, uint32_t cycles)
+    {
+        // Every stage is recorded from one context only (main loop or its handler)
+        Stats& s = table[static_cast<uint8_t>(stage)];
+        if (s.count == 0 || cycles < s.minCycles)
+        {
+            s.minCycles = cycles;
+        }
+        if (cycles > s.maxCycles)
+        {
+            s.maxCycles = cycles;
+        }
+        s.totalCycles += cycles;
+        ++s.count;
+    }
+
+    const Stats& stats(Stage stage)
+    {
+        return table[static_cast<uint8_t>(stage)];
+    }
+
+    const char* name(Stage stage)
+    {
+        static const char* const names[] = {
+            "accel_cfg", "read_block", "detect", "format", "println", "lcd_flush", "log_restore", "log_write",
+            "isr_porta", "isr_uart0", "isr_dma0", "isr_pit", "isr_i2c0", "isr_lptmr"
+        };
+        static_assert(sizeof(names) / sizeof(names[0]) == static_cast<uint8_t>(Stage::Count),
+                      "one name per stage");
+        return names[static_cast<uint8_t>(stage)];
+    }
+
+    void reset()
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        for (Stats& s : table)
+        {
+            s = Stats{};
+        }
+        if (!primask)
+        {
+            __enable_irq();
+        }
+    }
+
+    Scope::Scope(Stage stage) : stage(stage), start(isrmon::cycleStamp())
+    {
+    }
+
+    Scope::~Scope()
+    {
+        record(stage, isrmon::cyclesSince(start));
+    }
+}
+
+#endif // PROFILING
@@ -0,0 +1,275 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SampleRecorder.cpp
+ * @brief Implementation of the delta-compressed sample recorder.
+ */
+
+#include "../inc/SampleRecorder.hpp"
+#include "../inc/IsrMonitor.hpp"
+
+#include <cstring>
+
+static_assert(sizeof(SampleRecorder::Block) == SampleRecorder::BLOCK_SIZE, "Block must match the stored layout");
+static_assert(SampleRecorder::BLOCK_SIZE % 4u == 0 && flash::SECTOR_SIZE % SampleRecorder::BLOCK_SIZE == 0,
+              "blocks must tile the flash sectors in longwords");
+static_assert(SampleRecorder::RAM_BLOCKS >= 2, "one block is filled while another waits for flash");
+
+SampleRecorder::SampleRecorder(uint32_t flashBase, uint8_t flashSectors)
+    : flashBase(flashBase),
+      flashCapacity(static_cast<uint16_t>((flashSectors > MAX_SECTORS ? MAX_SECTORS : flashSectors) * BLOCKS_PER_SECTOR)),
+      active(false),
+      rate(10),
+      previous{0, 0, 0},
+      ram{},
+      head(0),
+      pending(0),
+      flashHead(0),
+      flashCount(0),
+      headErased(false),
+      eraseFailures(0),
+      badSectors(0),
+      written{},
+      counters{}
+{
+}
+
+void SampleRecorder::start(uint16_t rateHz)
+{
+    rate       = rateHz;
+    head       = 0;
+    pending    = 0;
+    flashHead  = 0;
+    flashCount = 0;
+    headErased = false;
+    eraseFailures = 0;
+    counters   = Stats{};
+    ram[head].samples = 0;
+    ram[head].size    = 0;
+    active = true;
+}
+
+void SampleRecorder::stop()
+{
+    active = false;
+}
+
+uint8_t SampleRecorder::ramSlot(uint8_t age) const
+{
+    // age 0 = oldest pending block, age == pending = the open block
+    return static_cast<uint8_t>((head + RAM_BLOCKS - pending + age) % RAM_BLOCKS);
+}
+
+uint16_t SampleRecorder::flashSlot(uint16_t age) const
+{
+    // age 0 = oldest slot of the flash ring
+    return static_cast<uint16_t>((flashHead + flashCapacity - flashCount + age) % flashCapacity);
+}
+
+bool SampleRecorder::slotWritten(uint16_t slot) const
+{
+    return (written[slot >> 3] & (1u << (slot & 7u))) != 0;
+}
+
+void SampleRecorder::markSlot(uint16_t slot, bool valid)
+{
+    const uint8_t bit = static_cast<uint8_t>(1u << (slot & 7u));
+    written[slot >> 3] = static_cast<uint8_t>(valid ? written[slot >> 3] | bit : written[slot >> 3] & ~bit);
+}
+
+void SampleRecorder::close()
+{
+    if (ram[head].samples == 0)
+    {
+        return;
+    }
+    ++counters.blocks;
+    if (pending == RAM_BLOCKS - 1u)
+    {
+        --pending;      // ring full: the oldest block is overwritten
+        ++counters.dropped;
+    }
+    ++pending;
+    head = static_cast<uint8_t>((head + 1u) % RAM_BLOCKS);
+    ram[head].samples = 0;
+    ram[head].size    = 0;
+}
+
+void SampleRecorder::add(uint32_t sample, int16_t x, int16_t y, int16_t z)
+{
+    if (!active)
+    {
+        return;
+    }
+    const uint32_t start = isrmon::cycleStamp();
+
+    // A block holds consecutive samples only
+    Block* block = &ram[head];
+    if (block->samples != 0 && sample != block->firstSample + block->samples)
+    {
+        close();
+        block = &ram[head];
+    }
+
+    const int16_t value[3] = { x, y, z };
+    if (block->samples != 0)
+    {
+        uint16_t bits = coder.bits();
+        for (uint8_t axis = 0; axis < 3; ++axis)
+        {
+            bits = static_cast<uint16_t>(bits + coder.cost(axis, previous[axis], value[axis]));
+        }
+        if (bits > PAYLOAD_SIZE * 8u || block->samples == telemetry::RECORD_MAX_SAMPLES)
+        {
+            close();
+            block = &ram[head];
+        }
+    }
+
+    if (block->samples == 0)
+    {
+        // The next block starts from the raw sample and the initial parameters again
+        block->firstSample = sample;
+        block->rateHz      = rate;
+        coder.reset();
+        for (uint8_t axis = 0; axis < 3; ++axis)
+        {
+            coder.putRaw(block->payload, value[axis]);
+        }
+    }
+    else
+    {
+        for (uint8_t axis = 0; axis < 3; ++axis)
+        {
+            coder.put(block->payload, axis, previous[axis], value[axis]);
+        }
+    }
+    const uint8_t size = static_cast<uint8_t>((coder.bits() + 7u) / 8u);
+    counters.bytes += static_cast<uint8_t>(size - block->size);
+    block->size = size;
+    ++block->samples;
+    previous[0] = x;
+    previous[1] = y;
+    previous[2] = z;
+
+    ++counters.samples;
+    counters.encodeCycles += isrmon::cyclesSince(start);
+}
+
+bool SampleRecorder::poll()
+{
+    const uint32_t allSectors = (1u << (flashCapacity / BLOCKS_PER_SECTOR)) - 1u;
+    if (flashCapacity == 0 || pending == 0 || badSectors == allSectors)
+    {
+        return false;
+    }
+
+    // Entering a sector: the oldest blocks are lost once the ring wrapped, then it is erased
+    if (flashHead % BLOCKS_PER_SECTOR == 0 && !headErased)
+    {
+        const uint16_t kept = static_cast<uint16_t>(flashCapacity - BLOCKS_PER_SECTOR);
+        while (flashCount > kept)
+        {
+            counters.dropped += slotWritten(flashSlot(0)) ? 1u : 0u;
+            --flashCount;
+        }
+
+        const uint16_t sector = static_cast<uint16_t>(1u << (flashHead / BLOCKS_PER_SECTOR));
+        if (!(badSectors & sector))
+        {
+            if (flash::eraseSector(flashAddress(flashHead)) == 0)
+            {
+                eraseFailures = 0;
+                headErased = true;
+                return true;
+            }
+            ++counters.errors;
+            if (++eraseFailures < ERASE_ATTEMPTS)
+            {
+                return true;    // retried on the next call
+            }
+            eraseFailures = 0;
+            badSectors = static_cast<uint16_t>(badSectors | sector);
+        }
+
+        // A bad sector is skipped; its slots stay in the ring as gaps
+        for (uint8_t i = 0; i < BLOCKS_PER_SECTOR; ++i)
+        {
+            markSlot(static_cast<uint16_t>(flashHead + i), false);
+        }
+        flashHead  = static_cast<uint16_t>((flashHead + BLOCKS_PER_SECTOR) % flashCapacity);
+        flashCount = static_cast<uint16_t>(flashCount + BLOCKS_PER_SECTOR);
+        return true;
+    }
+
+    const Block& block = ram[ramSlot(0)];
+    const uint16_t slot = flashHead;
+    const uint32_t address = flashAddress(slot);
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&block);
+    uint8_t result = 0;
+    for (uint16_t offset = 0; offset < BLOCK_SIZE && result == 0; offset = static_cast<uint16_t>(offset + 4u))
+    {
+        uint32_t word;
+        std::memcpy(&word, bytes + offset, sizeof(word));
+        result = flash::program(address + offset, word);
+    }
+    flashHead = static_cast<uint16_t>((flashHead + 1u) % flashCapacity);
+    headErased = false;
+    if (flashCount < flashCapacity)
+    {
+        ++flashCount;
+    }
+
+    // A half-written slot becomes a gap and the block goes to the next one
+    markSlot(slot, result == 0);
+    if (result != 0)
+    {
+        ++counters.errors;
+        return true;
+    }
+    --pending;
+    ++counters.flashBlocks;
+    return true;
+}
+
+uint16_t SampleRecorder::blocks() const
+{
+    uint16_t stored = 0;
+    for (uint16_t age = 0; age < flashCount; ++age)
+    {
+        stored = static_cast<uint16_t>(stored + (slotWritten(flashSlot(age)) ? 1u : 0u));
+    }
+    return static_cast<uint16_t>(stored + pending + (ram[head].samples != 0));
+}
+
+uint8_t SampleRecorder::readBlock(uint16_t index, Block& out) const
+{
+    // Flash blocks oldest first, skipping the gaps left by failed writes and bad sectors
+    uint16_t stored = 0;
+    for (uint16_t age = 0; age < flashCount; ++age)
+    {
+        const uint16_t slot = flashSlot(age);
+        if (!slotWritten(slot) || stored++ != index)
+        {
+            continue;
+        }
+        uint32_t address = flashAddress(slot);
+        uint8_t* bytes = reinterpret_cast<uint8_t*>(&out);
+        for (uint16_t offset = 0; offset < BLOCK_SIZE; offset = static_cast<uint16_t>(offset + 4u))
+        {
+            uint32_t word = flash::read(address + offset);
+            std::memcpy(bytes + offset, &word, sizeof(word));
+        }
+        return 0;
+    }
+    index = static_cast<uint16_t>(index - stored);
+    if (index > pending || (index == pending && ram[head].samples == 0))
+    {
+        return 1;
+    }
+    out = ram[ramSlot(static_cast<uint8_t>(index))];
+    return 0;
+}
@@ -0,0 +1,139 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file SampleTimer.cpp
+ * @brief Implementation of the PIT-driven sample scheduler.
+ */
+
+#include "../inc/SampleTimer.hpp"
+#include "../inc/IsrMonitor.hpp"
+#include "../inc/PowerManager.hpp"
+
+namespace SampleTimer
+{
+    static volatile uint8_t  pending  = 0;     /**< Ticks not yet consumed by the main loop. */
+    static uint16_t          rateHz   = 0;
+    static uint32_t          busClock = 0;
+    static Stats             timing   = {};
+
+    /**
+     * @brief Returns the PIT input clock (bus clock = core clock / (OUTDIV4 + 1)).
+     */
+    static uint32_t busClockHz()
+    {
+        uint32_t outdiv4 = (SIM->CLKDIV1 & SIM_CLKDIV1_OUTDIV4_MASK) >> SIM_CLKDIV1_OUTDIV4_SHIFT;
+        return SystemCoreClock / (outdiv4 + 1u);
+    }
+
+    uint8_t init(uint16_t hz)
+    {
+        SystemCoreClockUpdate();
+        busClock = busClockHz();
+
+        SIM->SCGC6 |= SIM_SCGC6_PIT_MASK;
+
+        // Enable the module, keep counting while the core is halted in debug
+        PIT->MCR = 0;
+
+        NVIC_ClearPendingIRQ(PIT_IRQn);
+        NVIC_EnableIRQ(PIT_IRQn);
+
+        return setRate(hz);
+    }
+
+    uint8_t setRate(uint16_t hz)
+    {
+        if (hz < MIN_RATE_HZ || hz > MAX_RATE_HZ)
+        {
+            return 1;
+        }
+        rateHz = hz;
+
+        // Reloading LDVAL only takes effect after the timer is restarted
+        PIT->CHANNEL[0].TCTRL = 0;
+        PIT->CHANNEL[0].LDVAL = busClock / hz - 1u;
+        PIT->CHANNEL[0].TFLG  = PIT_TFLG_TIF_MASK;
+        pending = 0;
+        PIT->CHANNEL[0].TCTRL = PIT_TCTRL_TIE_MASK | PIT_TCTRL_TEN_MASK;
+
+        resetStats();
+        return 0;
+    }
+
+    uint16_t rate()
+    {
+        return rateHz;
+    }
+
+    void waitForTick()
+    {
+        // WFI wakes on a pending interrupt even with PRIMASK set, so a tick
+        // arriving between the check and the WFI is never lost. The PIT stops
+        // in VLPS, so the core may only go to WAIT
+        __disable_irq();
+        while (pending == 0)
+        {
+            power::sleep(power::State::Wait);
+            __enable_irq();
+            __disable_irq();
+        }
+        pending = 0;
+        __enable_irq();
+
+        // Time elapsed since the tick: the channel counts down from LDVAL
+        uint32_t elapsed = PIT->CHANNEL[0].LDVAL - PIT->CHANNEL[0].CVAL;
+
+        uint32_t latencyUs = elapsed / (busClock / 1000000u);
+        timing.latencyLastUs = latencyUs;
+        if (timing.samples == 0 || latencyUs < timing.latencyMinUs)
+        {
+            timing.latencyMinUs = latencyUs;
+        }
+        if (latencyUs > timing.latencyMaxUs)
+        {
+            timing.latencyMaxUs = latencyUs;
+        }
+        ++timing.samples;
+    }
+
+    const Stats& stats()
+    {
+        return timing;
+    }
+
+    void resetStats()
+    {
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        timing = Stats{};
+        if (!primask)
+        {
+            __enable_irq();
+        }
+    }
+}
+
+extern "C" void PIT_IRQHandler(void)
+{
+    isrmon::Scope timing(isrmon::Source::Pit);
+
+    if (PIT->CHANNEL[0].TFLG & PIT_TFLG_TIF_MASK)
+    {
+        // Clear the flag by writing 1
+        PIT->CHANNEL[0].TFLG = PIT_TFLG_TIF_MASK;
+
+        ++SampleTimer::timing.ticks;
+        // Previous tick still unconsumed -> the main loop missed a period
+        if (SampleTimer::pending != 0)
+        {
+            ++SampleTimer::timing.overruns;
+        }
+        if (SampleTimer::pending < 0xFF)
+        {
+            ++SampleTimer::pending;
+        }
+    }
+}
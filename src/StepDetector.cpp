@@ -0,0 +1,233 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file StepDetector.cpp
+ * @brief Implementation of the fixed-point HPF/BPF step detector.
+ */
+
+#include "../inc/StepDetector.hpp"
+
+/* =========================================
+ * Filter design checks
+ * =========================================
+ */
+
+/* At the MATLAB sample rate the compile-time designs must reproduce butter() as
+ * printed by matlabFilterTests.m (6 decimals), and the Q29 constants that were
+ * hand-copied from it before. Other rates are checked only by the design itself. */
+constexpr bool near(double value, double matlab)
+{
+    return (value - matlab) < 5e-7 && (matlab - value) < 5e-7;
+}
+
+constexpr bool sameQ29(const BiquadQ29& c, const BiquadQ29& expected)
+{
+    return c.b0 == expected.b0 && c.b1 == expected.b1 && c.b2 == expected.b2
+        && c.a1 == expected.a1 && c.a2 == expected.a2;
+}
+
+constexpr bool MATLAB_RATE = StepDetector::SAMPLE_RATE == butter::hz(10);
+
+/* butter(2, 2/(10/2), 'high')
+ * b = [0.391336 -0.782672 0.391336], a = [1 -0.369527 0.195816] */
+constexpr butter::Polynomial<1> HPF_TF = butter::expand(StepDetector::HpfFilter::design);
+static_assert(!MATLAB_RATE || (near(HPF_TF.b[0], 0.391336) && near(HPF_TF.b[1], -0.782672) && near(HPF_TF.b[2], 0.391336)
+                               && near(HPF_TF.a[1], -0.369527) && near(HPF_TF.a[2], 0.195816)),
+              "HPF differs from MATLAB butter()");
+static_assert(!MATLAB_RATE || sameQ29(StepDetector::HpfFilter::q29.sections[0],
+                                      { 210096793, -420193586, 210096793, -198388500, 105127760 }),
+              "HPF Q29 coefficients changed");
+
+/* butter(2, [0.3 2]/(10/2), 'bandpass') split into two sections,
+ * each with zeros at z = +1 and z = -1 and half of the overall gain (sqrt(0.159988)).
+ * b = [0.159988 0 -0.319976 0 0.159988], a = [1 -2.261369 1.984496 -0.927741 0.234840] */
+constexpr butter::Polynomial<2> BPF_TF = butter::expand(StepDetector::BpfFilter::design);
+static_assert(!MATLAB_RATE || (near(BPF_TF.b[0], 0.159988) && near(BPF_TF.b[1], 0) && near(BPF_TF.b[2], -0.319976)
+                               && near(BPF_TF.b[3], 0) && near(BPF_TF.b[4], 0.159988)
+                               && near(BPF_TF.a[1], -2.261369) && near(BPF_TF.a[2], 1.984496)
+                               && near(BPF_TF.a[3], -0.927741) && near(BPF_TF.a[4], 0.234840)),
+              "BPF differs from MATLAB butter()");
+static_assert(!MATLAB_RATE || (sameQ29(StepDetector::BpfFilter::q29.sections[0],     // poles 0.2583 +/- 0.4828j
+                                       { 214740235, 0, -214740235, -277347766, 160945860 })
+                               && sameQ29(StepDetector::BpfFilter::q29.sections[1],  // poles 0.8724 +/- 0.1494j
+                                          { 214740235, 0, -214740235, -936715211, 420564786 })),
+              "BPF Q29 coefficients changed");
+
+/* Magnitude is computed in Q12, which keeps x^2 + y^2 + z^2 inside uint32_t for |v| < 8 g */
+constexpr int32_t MAG_LIMIT_Q12 = 32767;
+
+/* =========================================
+ * Local helpers
+ * =========================================
+ */
+
+static uint32_t isqrt32(uint32_t v)
+{
+    uint32_t root = 0;
+    uint32_t bit  = 1u << 30;
+
+    while (bit > v)
+    {
+        bit >>= 2;
+    }
+    while (bit != 0)
+    {
+        if (v >= root + bit)
+        {
+            v    -= root + bit;
+            root  = (root >> 1) + bit;
+        }
+        else
+        {
+            root >>= 1;
+        }
+        bit >>= 2;
+    }
+    return root;
+}
+
+static int32_t clampQ12(int32_t q15)
+{
+    int32_t v = q15 >> 3;
+    if (v >  MAG_LIMIT_Q12) { v =  MAG_LIMIT_Q12; }
+    if (v < -MAG_LIMIT_Q12) { v = -MAG_LIMIT_Q12; }
+    return v;
+}
+
+static int32_t magnitudeQ15(int32_t x, int32_t y, int32_t z)
+{
+    int32_t x12 = clampQ12(x);
+    int32_t y12 = clampQ12(y);
+    int32_t z12 = clampQ12(z);
+    uint32_t sum = static_cast<uint32_t>(x12 * x12)
+                 + static_cast<uint32_t>(y12 * y12)
+                 + static_cast<uint32_t>(z12 * z12);
+    return static_cast<int32_t>(isqrt32(sum) << 3);
+}
+
+static void pushWindow(int32_t (&win)[3], int32_t value)
+{
+    win[0] = win[1];
+    win[1] = win[2];
+    win[2] = value;
+}
+
+static bool isPeak(const int32_t (&win)[3], int32_t threshold)
+{
+    return (win[1] > win[0]) && (win[1] > win[2]) && (win[1] > threshold);
+}
+
+/* =========================================
+ * StepDetector
+ * =========================================
+ */
+
+StepDetector::StepDetector() : StepDetector(Config())
+{
+}
+
+StepDetector::StepDetector(const Config& config) : cfg(config)
+{
+    reset();
+}
+
+void StepDetector::reset()
+{
+    for (uint8_t axis = 0; axis < 3; ++axis)
+    {
+        hpfFilter[axis].reset();
+        bpfFilter[axis].reset();
+        hpfWin[axis] = 0;
+        bpfWin[axis] = 0;
+    }
+    index            = 0;
+    lastHPFpeakIndex = 0;
+    lastBPFpeakIndex = 0;
+    hpfStats         = RunningStats{ 0, 0, cfg.hpfPeakThreshold };
+    bpfStats         = RunningStats{ 0, 0, cfg.bpfPeakThreshold };
+    statsShift       = 0;
+}
+
+void StepDetector::track(RunningStats& stats, const int32_t (&win)[3]) const
+{
+    // Local maxima above the mean, the first one taken as it is
+    if (index >= 3 && win[1] > win[0] && win[1] > win[2] && win[1] > stats.mean)
+    {
+        const uint8_t peakShift = statsShift > PEAK_SHIFT_DIFF ? statsShift - PEAK_SHIFT_DIFF : 0;
+        stats.peak = stats.peak != 0 ? stats.peak + ((win[1] - stats.peak) >> peakShift) : win[1];
+    }
+
+    // mean += (x - mean) / 2^n
+    stats.mean += (win[2] - stats.mean) >> statsShift;
+
+    // adaptiveRatio tenths of the way from the mean to the average peak
+    if (cfg.adaptiveRatio != 0 && stats.peak > stats.mean)
+    {
+        int32_t threshold = stats.mean + (stats.peak - stats.mean) * cfg.adaptiveRatio / 10;
+        stats.threshold = threshold > cfg.adaptiveFloor ? threshold : cfg.adaptiveFloor;
+    }
+}
+
+StepDetector::Step StepDetector::process(int16_t x, int16_t y, int16_t z)
+{
+    // 14-bit counts (Q12 g) -> Q15 g
+    const int32_t in[3] = { x * 8, y * 8, z * 8 };
+    int32_t hpf[3];
+    int32_t bpf[3];
+
+    for (uint8_t axis = 0; axis < 3; ++axis)
+    {
+        hpf[axis] = hpfFilter[axis].process(in[axis]);
+        bpf[axis] = bpfFilter[axis].process(in[axis]);
+    }
+
+    // Thresholds from the statistics up to the previous sample, once they cover a time constant
+    const int32_t hpfThreshold = this->hpfThreshold();
+    const int32_t bpfThreshold = this->bpfThreshold();
+
+    ++index;
+    Step result = Step::None;
+
+    // HPF local maximum -> RUN, the peak itself is the previous sample
+    pushWindow(hpfWin, magnitudeQ15(hpf[0], hpf[1], hpf[2]));
+    if (index >= 3 && isPeak(hpfWin, hpfThreshold)
+        && (index - 1) - lastHPFpeakIndex > cfg.minHPFSampleDist)
+    {
+        result = Step::Run;
+        lastHPFpeakIndex = index - 1;
+    }
+
+    // BPF local maximum -> WALK, unless a RUN was reported just before
+    pushWindow(bpfWin, magnitudeQ15(bpf[0], bpf[1], bpf[2]));
+    if (index >= 3 && isPeak(bpfWin, bpfThreshold)
+        && (index - 1) - lastBPFpeakIndex > cfg.minBPFSampleDist)
+    {
+        if (index - lastHPFpeakIndex >= cfg.runShadowSamples)
+        {
+            result = Step::Walk;
+        }
+        lastBPFpeakIndex = index - 1;
+    }
+
+    // Close to a running average of all samples until 2^adaptiveShift samples were seen
+    if (statsShift < cfg.adaptiveShift && index >= (2u << statsShift))
+    {
+        ++statsShift;
+    }
+    track(hpfStats, hpfWin);
+    track(bpfStats, bpfWin);
+    if (cfg.adaptiveRatio != 0 && cfg.bpfPeakThreshold > 0)
+    {
+        // RUN needs the HPF peak above the BPF threshold in the MATLAB ratio (Q8)
+        const int32_t ratio = (cfg.hpfPeakThreshold << 8) / cfg.bpfPeakThreshold;
+        const int32_t linked = (bpfStats.threshold * ratio) >> 8;
+        if (hpfStats.threshold < linked)
+        {
+            hpfStats.threshold = linked;
+        }
+    }
+    return result;
+}
@@ -0,0 +1,295 @@
+/*
+ * Copyright (c) 2025 Miroslaw Baca
+ * AGH - Design Lab
+ */
+
+/**
+ * @file Telemetry.cpp
+ * @brief Implementation of the binary sample frame encoder.
+ */
+
+#include "../inc/Telemetry.hpp"
+
+namespace telemetry
+{
+    /* Nibble table: 32 bytes of flash, two lookups per byte */
+    static const uint16_t CRC_NIBBLE[16] =
+    {
+        0x0000, 0x1021, 0x2042, 0x3063, 0x4084, 0x50A5, 0x60C6, 0x70E7,
+        0x8108, 0x9129, 0xA14A, 0xB16B, 0xC18C, 0xD1AD, 0xE1CE, 0xF1EF
+    };
+
+    uint16_t crc16(const uint8_t* data, uint32_t size, uint16_t crc)
+    {
+        while (size--)
+        {
+            uint8_t b = *data++;
+            crc = static_cast<uint16_t>((crc << 4) ^ CRC_NIBBLE[(crc >> 12) ^ (b >> 4)]);
+            crc = static_cast<uint16_t>((crc << 4) ^ CRC_NIBBLE[(crc >> 12) ^ (b & 0x0F)]);
+        }
+        return crc;
+    }
+
+    static void put16(uint8_t* p, uint16_t v)
+    {
+        p[0] = static_cast<uint8_t>(v);
+        p[1] = static_cast<uint8_t>(v >> 8);
+    }
+
+    static void put32(uint8_t* p, uint32_t v)
+    {
+        put16(p, static_cast<uint16_t>(v));
+        put16(p + 2, static_cast<uint16_t>(v >> 16));
+    }
+
+    uint16_t buildGaitFrame(uint8_t* out, uint16_t sequence, uint16_t rateHz, uint32_t timestamp, const Gait& gait)
+    {
+        out[0] = SYNC0;
+        out[1] = SYNC1;
+        out[2] = FRAME_GAIT;
+        out[3] = 1;
+        put16(&out[4], sequence);
+        put16(&out[6], rateHz);
+        put32(&out[8], timestamp);
+
+        uint8_t* p = &out[HEADER_SIZE];
+        put16(p,      gait.cadence[0]);
+        put16(p + 2,  gait.cadence[1]);
+        put16(p + 4,  gait.walkCadence);
+        put16(p + 6,  gait.runCadence);
+        put16(p + 8,  gait.speedMmS);
+        put32(p + 10, gait.walkDistanceMm);
+        put32(p + 14, gait.runDistanceMm);
+        put16(p + 18, gait.hpfThresholdMg);
+        put16(p + 20, gait.bpfThresholdMg);
+
+        put16(&out[HEADER_SIZE + GAIT_SIZE], crc16(&out[2], HEADER_SIZE + GAIT_SIZE - 2u));
+        return GAIT_FRAME_SIZE;
+    }
+
+    uint16_t buildRecordFrame(uint8_t* out, uint16_t sequence, uint16_t rateHz, uint32_t timestamp,
+                              uint8_t samples, const uint8_t* payload, uint8_t size)
+    {
+        out[0] = SYNC0;
+        out[1] = SYNC1;
+        out[2] = FRAME_RECORD;
+        out[3] = samples;
+        put16(&out[4], sequence);
+        put16(&out[6], rateHz);
+        put32(&out[8], timestamp);
+        out[HEADER_SIZE] = size;
+        for (uint8_t i = 0; i < size; ++i)
+        {
+            out[HEADER_SIZE + 1 + i] = payload[i];
+        }
+
+        uint16_t end = static_cast<uint16_t>(HEADER_SIZE + 1u + size);
+        put16(&out[end], crc16(&out[2], end - 2u));
+        return static_cast<uint16_t>(end + CRC_SIZE);
+    }
+
+    static uint32_t zigzag(int32_t delta)
+    {
+        return (static_cast<uint32_t>(delta) << 1) ^ static_cast<uint32_t>(delta >> 31);
+    }
+
+    void DeltaCoder::reset()
+    {
+        for (uint8_t axis = 0; axis < 3; ++axis)
+        {
+            magnitude[axis] = START_MAGNITUDE;
+            count[axis]     = 1;
+        }
+        position = 0;
+    }
+
+    uint8_t DeltaCoder::parameter(uint8_t axis) const
+    {
+        // Smallest k with count * 2^k >= sum, i.e. 2^k about the mean |d| (no divide on the M0+)
+        uint8_t k = 0;
+        while ((static_cast<uint32_t>(count[axis]) << k) < magnitude[axis])
+        {
+            ++k;
+        }
+        return k;
+    }
+
+    void DeltaCoder::adapt(uint8_t axis, int32_t delta)
+    {
+        magnitude[axis] += static_cast<uint32_t>(delta < 0 ? -delta : delta);
+        if (++count[axis] >= HALVE_COUNT)
+        {
+            magnitude[axis] >>= 1;
+            count[axis] = static_cast<uint8_t>(count[axis] >> 1);
+        }
+    }
+
+    uint8_t DeltaCoder::cost(uint8_t axis, int16_t previous, int16_t value) const
+    {
+        const uint8_t  k = parameter(axis);
+        const uint32_t q = zigzag(static_cast<int32_t>(value) - previous) >> k;
+        return static_cast<uint8_t>(q < ESCAPE ? q + 1u + k : ESCAPE + 16u);
+    }
+
+    void DeltaCoder::write(uint8_t* out, uint32_t value, uint8_t length)
+    {
+        while (length--)
+        {
+            uint8_t& byte = out[position >> 3];
+            if ((position & 7u) == 0)
+            {
+                byte = 0;
+            }
+            if ((value >> length) & 1u)
+            {
+                byte = static_cast<uint8_t>(byte | (0x80u >> (position & 7u)));
+            }
+            ++position;
+        }
+    }
+
+    bool DeltaCoder::read(const uint8_t* in, uint8_t size, uint8_t length, uint32_t& value)
+    {
+        if (position + length > size * 8u)
+        {
+            return false;
+        }
+        value = 0;
+        while (length--)
+        {
+            value = (value << 1) | ((in[position >> 3] >> (7u - (position & 7u))) & 1u);
+            ++position;
+        }
+        return true;
+    }
+
+    void DeltaCoder::put(uint8_t* out, uint8_t axis, int16_t previous, int16_t value)
+    {
+        const int32_t  delta = static_cast<int32_t>(value) - previous;
+        const uint8_t  k = parameter(axis);
+        const uint32_t z = zigzag(delta);
+        const uint32_t q = z >> k;
+        if (q < ESCAPE)
+        {
+            write(out, (1u << (q + 1u)) - 2u, static_cast<uint8_t>(q + 1u));   // q ones and a zero
+            write(out, z, k);
+        }
+        else
+        {
+            write(out, (1u << ESCAPE) - 1u, ESCAPE);
+            write(out, static_cast<uint16_t>(value), 16);
+        }
+        adapt(axis, delta);
+    }
+
+    void DeltaCoder::putRaw(uint8_t* out, int16_t value)
+    {
+        write(out, static_cast<uint16_t>(value), 16);
+    }
+
+    bool DeltaCoder::get(const uint8_t* in, uint8_t size, uint8_t axis, int16_t previous, int16_t& value)
+    {
+        uint32_t q = 0;
+        uint32_t bit;
+        do
+        {
+            if (!read(in, size, 1, bit))
+            {
+                return false;
+            }
+            q += bit;
+        } while (bit != 0 && q < ESCAPE);
+
+        uint32_t low;
+        if (q == ESCAPE)
+        {
+            if (!read(in, size, 16, low))
+            {
+                return false;
+            }
+            value = static_cast<int16_t>(low);
+        }
+        else
+        {
+            const uint8_t k = parameter(axis);
+            if (!read(in, size, k, low))
+            {
+                return false;
+            }
+            const uint32_t z = (q << k) | low;
+            value = static_cast<int16_t>(previous + (static_cast<int32_t>(z >> 1) ^ -static_cast<int32_t>(z & 1u)));
+        }
+        adapt(axis, static_cast<int32_t>(value) - previous);
+        return true;
+    }
+
+    bool DeltaCoder::getRaw(const uint8_t* in, uint8_t size, int16_t& value)
+    {
+        uint32_t raw;
+        if (!read(in, size, 16, raw))
+        {
+            return false;
+        }
+        value = static_cast<int16_t>(raw);
+        return true;
+    }
+
+    FrameBuilder::FrameBuilder(uint8_t samples, uint16_t rate)
+        : batch(1), count(0), sequence(0), rateHz(rate), sealedSize(0)
+    {
+        setBatch(samples);
+    }
+
+    void FrameBuilder::setBatch(uint8_t samples)
+    {
+        if (samples < 1)         { samples = 1; }
+        if (samples > MAX_BATCH) { samples = MAX_BATCH; }
+        batch = samples;
+        count = 0;
+    }
+
+    bool FrameBuilder::add(uint32_t timestamp, int16_t x, int16_t y, int16_t z)
+    {
+        if (count == 0)
+        {
+            put32(&frame[8], timestamp);
+        }
+        uint8_t* p = &frame[HEADER_SIZE + count * SAMPLE_SIZE];
+        put16(p,     static_cast<uint16_t>(x));
+        put16(p + 2, static_cast<uint16_t>(y));
+        put16(p + 4, static_cast<uint16_t>(z));
+
+        if (++count < batch)
+        {
+            return false;
+        }
+        seal();
+        return true;
+    }
+
+    bool FrameBuilder::flush()
+    {
+        if (count == 0)
+        {
+            return false;
+        }
+        seal();
+        return true;
+    }
+
+    void FrameBuilder::seal()
+    {
+        frame[0] = SYNC0;
+        frame[1] = SYNC1;
+        frame[2] = FRAME_SAMPLES;
+        frame[3] = count;
+        put16(&frame[4], sequence++);
+        put16(&frame[6], rateHz);
+
+        uint16_t payloadEnd = static_cast<uint16_t>(HEADER_SIZE + count * SAMPLE_SIZE);
+        put16(&frame[payloadEnd], crc16(&frame[2], payloadEnd - 2u));
+
+        sealedSize = static_cast<uint16_t>(payloadEnd + CRC_SIZE);
+        count = 0;
+    }
+}
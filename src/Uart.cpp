@@ -9,27 +9,66 @@
  */
 
 #include "../inc/Uart.hpp"
-#include "../inc/Lcd.hpp"
+#include "../inc/Events.hpp"
+#include "../inc/Command.hpp"
+#include "../inc/IsrMonitor.hpp"
+#include "../inc/Profiler.hpp"
 #include <cstring>
 #include <cstdio>
 
 
 CommunicationModuleMCU* Uart::g_commObject = nullptr;
 
+static_assert((UART_TX_BUFFER_SIZE & (UART_TX_BUFFER_SIZE - 1)) == 0 && UART_TX_BUFFER_SIZE <= 32768,
+              "UART_TX_BUFFER_SIZE must be a power of two");
+
+/* Transmit buffer. In interrupt mode it is a ring: head is advanced by the producers,
+ * tail by the TDRE interrupt, both free-running so head - tail is the occupancy.
+ * In DMA mode it holds two halves: one is being sent while the other is filled. */
+static uint8_t                 txBuffer[UART_TX_BUFFER_SIZE];
+static volatile uint16_t       txHead = 0;
+static volatile uint16_t       txTail = 0;
+static Uart::TxMode            activeTxMode = Uart::TxMode::Interrupt;
+static Uart::OverflowPolicy    txPolicy = Uart::OverflowPolicy::DropNewest;
+static Uart::TxStats           txCounters = {};
+static Uart::BaudDivisor       activeDivisor = {};
+
+/* DMA double buffer */
+constexpr uint16_t DMA_HALF_SIZE          = UART_TX_BUFFER_SIZE / 2;
+constexpr uint8_t  DMA_CHANNEL            = 0;
+constexpr uint8_t  DMAMUX_SOURCE_UART0_TX = 3;
+static uint8_t           dmaFillHalf  = 0;  // half currently filled by queue()
+static uint16_t          dmaFillCount = 0;  // bytes in that half
+static volatile uint16_t dmaInFlight  = 0;  // bytes handed to the DMA channel, 0 = idle
+
+static uint16_t txCount()
+{
+    return static_cast<uint16_t>(txHead - txTail);
+}
+
+static void addCycles(uint32_t start)
+{
+    txCounters.cycles += isrmon::cyclesSince(start);
+}
+
 extern "C" void UART0_IRQHandler(void)
 {
+	isrmon::Scope timing(isrmon::Source::Uart0);
 	Uart::handleIRQ();
 }
 
-extern uint32_t WalkStep;
-extern uint32_t RunStep;
+extern "C" void DMA0_IRQHandler(void)
+{
+	isrmon::Scope timing(isrmon::Source::Dma0);
+	Uart::handleDmaIRQ();
+}
 
 
 Uart::Uart() : Uart(9600, nullptr)
 {
 }
 
-Uart::Uart(uint32_t baud, CommunicationModuleMCU* obj) : baudRate(baud)
+Uart::Uart(uint32_t baud, CommunicationModuleMCU* obj, TxMode mode) : baudRate(baud), txMode(mode)
 {
 		// Store the pointer to the communication handler object
     g_commObject = obj;
@@ -56,18 +95,12 @@ Uart::Uart(uint32_t baud, CommunicationModuleMCU* obj) : baudRate(baud)
     // Disable the UART transmitter and receiver before making changes
     UART0->C2 &= ~(UART0_C2_TE_MASK | UART0_C2_RE_MASK);
 
-    // Calculate the baud rate divisor:
-    // UART baud rate = Clock frequency / (16 * divisor)
-    uint32_t divisor = 48000000u / (16u * baudRate);
-
-    // Set the upper 5 bits of the divisor in the BDH register
-    UART0->BDH = (uint8_t)((divisor >> 8) & 0x1F);
-
-    // Set the lower 8 bits of the divisor in the BDL register
-    UART0->BDL = (uint8_t)(divisor & 0xFF);
-
-    // Set fine-tuning value for the baud rate (optional adjustment)
-    UART0->C4 = 0x0F;
+    // Divider searched against the actual clock; a rate out of tolerance falls back to 9600 baud
+    if (setBaudRate(baudRate) != 0)
+    {
+        baudRate = 9600;
+        setBaudRate(baudRate);
+    }
 
     // Enable UART receive interrupt (RIE)
     UART0->C2 |= UART0_C2_RIE_MASK;
@@ -75,11 +108,37 @@ Uart::Uart(uint32_t baud, CommunicationModuleMCU* obj) : baudRate(baud)
     // Enable the UART transmitter (TE) and receiver (RE)
     UART0->C2 |= (UART0_C2_TE_MASK | UART0_C2_RE_MASK);
 
+    // Transmit path: empty buffers, DMA channel 0 routed to the UART0 transmit request if used
+    activeTxMode = mode;
+    txHead = txTail = 0;
+    dmaFillHalf = 0;
+    dmaFillCount = 0;
+    dmaInFlight = 0;
+    if (mode == TxMode::Dma)
+    {
+        SIM->SCGC6 |= SIM_SCGC6_DMAMUX_MASK;
+        SIM->SCGC7 |= SIM_SCGC7_DMA_MASK;
+        DMAMUX0->CHCFG[DMA_CHANNEL] = 0;
+        DMA0->DMA[DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+        DMAMUX0->CHCFG[DMA_CHANNEL] = DMAMUX_CHCFG_ENBL_MASK | DMAMUX_CHCFG_SOURCE(DMAMUX_SOURCE_UART0_TX);
+        // With TDMAE set, TDRE raises DMA requests instead of interrupts
+        UART0->C5 |= UART0_C5_TDMAE_MASK;
+        NVIC_ClearPendingIRQ(DMA0_IRQn);
+        NVIC_EnableIRQ(DMA0_IRQn);
+    }
+    else
+    {
+        UART0->C5 &= ~UART0_C5_TDMAE_MASK;
+    }
+
+    // Free-running SysTick as the cycle counter for TxStats
+    isrmon::init();
+
     // Enable UART0 interrupt in the Nested Vector Interrupt Controller (NVIC)
     NVIC_EnableIRQ(UART0_IRQn);
 }
 
-Uart::Uart(const Uart& other) : Uart(other.baudRate, other.g_commObject)
+Uart::Uart(const Uart& other) : Uart(other.baudRate, other.g_commObject, other.txMode)
 {
 }
 
@@ -88,81 +147,354 @@ Uart::~Uart()
     NVIC_DisableIRQ(UART0_IRQn);
 }
 
-void Uart::print(const char* text)
+uint8_t Uart::findBaudDivisor(uint32_t clockHz, uint32_t baud, BaudDivisor& out)
+{
+    if (baud == 0)
+    {
+        return 1;
+    }
+    bool found = false;
+
+    // Highest OSR first, so a tie keeps the most samples per bit
+    for (uint8_t osr = 32; osr >= 4; --osr)
+    {
+        const uint32_t perSbr = static_cast<uint32_t>(osr) * baud;
+        const uint32_t sbr    = (clockHz + perSbr / 2u) / perSbr;
+        if (sbr < 1 || sbr > 0x1FFF)
+        {
+            continue;
+        }
+        const uint32_t actual = clockHz / (osr * sbr);
+        const uint32_t diff   = actual > baud ? actual - baud : baud - actual;
+        const uint32_t ppm    = static_cast<uint32_t>(static_cast<uint64_t>(diff) * 1000000u / baud);
+        if (!found || ppm < out.errorPpm)
+        {
+            out   = BaudDivisor{ static_cast<uint16_t>(sbr), osr, actual, ppm };
+            found = true;
+        }
+    }
+    return (found && out.errorPpm <= MAX_BAUD_ERROR_PPM) ? 0 : 1;
+}
+
+uint8_t Uart::setBaudRate(uint32_t baud)
 {
-    while (*text)
+    // UART0 is clocked from MCGFLLCLK, which is the core clock with CLOCK_SETUP 1 (FEI, OUTDIV1 = 1)
+    SystemCoreClockUpdate();
+    BaudDivisor divisor;
+    if (findBaudDivisor(SystemCoreClock, baud, divisor) != 0)
+    {
+        return 1;
+    }
+
+    // The divisor may only change with the transmitter and receiver disabled
+    const uint8_t enabled = UART0->C2 & (UART0_C2_TE_MASK | UART0_C2_RE_MASK);
+    UART0->C2 &= ~(UART0_C2_TE_MASK | UART0_C2_RE_MASK);
+
+    // SBR: upper 5 bits in BDH (keeping its interrupt and stop bit settings), lower 8 bits in BDL
+    UART0->BDH = static_cast<uint8_t>((UART0->BDH & ~UART0_BDH_SBR_MASK) | UART0_BDH_SBR(divisor.sbr >> 8));
+    UART0->BDL = static_cast<uint8_t>(divisor.sbr);
+
+    // OSR is stored minus one; below 8 the receiver must sample on both edges
+    UART0->C4 = static_cast<uint8_t>((UART0->C4 & ~UART0_C4_OSR_MASK) | UART0_C4_OSR(divisor.osr - 1u));
+    if (divisor.osr < 8)
     {
-        sendChar(*text++);
+        UART0->C5 |= UART0_C5_BOTHEDGE_MASK;
     }
+    else
+    {
+        UART0->C5 &= ~UART0_C5_BOTHEDGE_MASK;
+    }
+
+    UART0->C2 |= enabled;
+    activeDivisor = divisor;
+    return 0;
+}
+
+const Uart::BaudDivisor& Uart::baudDivisor()
+{
+    return activeDivisor;
+}
+
+void Uart::print(const char* text)
+{
+    queue(reinterpret_cast<const uint8_t*>(text), strlen(text));
 }
 
 void Uart::println(const char* text)
 {
-    print(text);
-    print("\n\r");
+    PROFILE_SCOPE(UartPrintln);
+    static const uint8_t lineEnd[2] = { '\n', '\r' };
+    queue(reinterpret_cast<const uint8_t*>(text), strlen(text), lineEnd, sizeof(lineEnd));
 }
 
-void Uart::sendChar(char c)
+void Uart::write(const uint8_t* data, uint32_t size)
+{
+    queue(data, size);
+}
+
+void Uart::flush()
 {
-    while (!(UART0->S1 & UART0_S1_TDRE_MASK))
+    while (!txIdle())
     {
-        // Wait until the transmitter is ready
+        // Poll as well, so flush() also works with interrupts masked
+        uint32_t primask = __get_PRIMASK();
+        __disable_irq();
+        if (activeTxMode == TxMode::Dma)
+        {
+            dmaService();
+        }
+        else if (activeTxMode == TxMode::Interrupt)
+        {
+            txService();
+        }
+        if (!primask)
+        {
+            __enable_irq();
+        }
     }
-    UART0->D = static_cast<uint8_t>(c);
 }
-void Uart::handleIRQ()
+
+void Uart::setOverflowPolicy(OverflowPolicy policy)
 {
-    // Static buffer to store incoming characters
-    static char rxBuffer[16];
-    static uint8_t rxIndex = 0;
-    
-    // Check if a new byte has been received
-    if (UART0->S1 & UART0_S1_RDRF_MASK)
+    txPolicy = policy;
+}
+
+uint16_t Uart::txPending()
+{
+    switch (activeTxMode)
     {
-        // Read one byte from the UART data register
-        char received = static_cast<char>(UART0->D);
-        
-        // If a newline or carriage return is received, treat it as the end of the message
-        if (received == '\n' || received == '\r')
+        case TxMode::Interrupt:
+            return txCount();
+        case TxMode::Dma:
+            return static_cast<uint16_t>(dmaFillCount
+                 + (dmaInFlight ? (DMA0->DMA[DMA_CHANNEL].DSR_BCR & DMA_DSR_BCR_BCR_MASK) : 0));
+        default:
+            return 0;
+    }
+}
+
+bool Uart::txIdle()
+{
+    return txPending() == 0 && (UART0->S1 & UART0_S1_TC_MASK);
+}
+
+const Uart::TxStats& Uart::txStats()
+{
+    return txCounters;
+}
+
+void Uart::resetTxStats()
+{
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    txCounters = TxStats{};
+    if (!primask)
+    {
+        __enable_irq();
+    }
+}
+
+void Uart::queue(const uint8_t* data, uint32_t size, const uint8_t* suffix, uint32_t suffixSize)
+{
+    const uint32_t start = isrmon::cycleStamp();
+    const uint32_t total = size + suffixSize;
+
+    if (activeTxMode == TxMode::Blocking)
+    {
+        for (uint32_t i = 0; i < total; ++i)
         {
-            rxBuffer[rxIndex] = '\0';  // Terminate the string
-            
-            // Check if the received message is "WALK++" or "RUN++"
-            if (strcmp(rxBuffer, "WALK++") == 0)
+            while (!(UART0->S1 & UART0_S1_TDRE_MASK))
             {
-								WalkStep++;
+                // Wait until the transmitter is ready
             }
-            else if (strcmp(rxBuffer, "RUN++") == 0)
-            {
-								RunStep++;
-            }
-            // Reset the buffer index for the next message
-            rxIndex = 0;
-						
-						char lcdBuffer[32];  // Buffer for LCD output
-						lcd::clearAll();
-						lcd::setCursor(0, 0);
-						lcd::print("S9 = RESET");
-						lcd::setCursor(0, 1);
-						lcd::blinkOn();
-						sprintf(lcdBuffer, "Walk: %lu Run: %lu", WalkStep, RunStep);
-						
-						//lcd::clearAll();
-						lcd::setCursor(0, 1);
-						lcd::print(lcdBuffer);
+            UART0->D = (i < size) ? data[i] : suffix[i - size];
         }
-        else
+        txCounters.queued += total;
+        addCycles(start);
+        return;
+    }
+
+    const bool dma = (activeTxMode == TxMode::Dma);
+
+    // The buffer is shared with the interrupts, so it is only touched with interrupts masked.
+    // The caller's PRIMASK is restored, which makes this safe to call from an ISR too.
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+
+    uint32_t space = dma ? (DMA_HALF_SIZE - dmaFillCount) + (dmaInFlight ? 0u : DMA_HALF_SIZE)
+                         : UART_TX_BUFFER_SIZE - txCount();
+    if (txPolicy == OverflowPolicy::DropNewest && total > space)
+    {
+        // Drop the message as a whole, a partial line or frame is useless to the host
+        txCounters.dropped += total;
+    }
+    else
+    {
+        for (uint32_t i = 0; i < total; ++i)
         {
-            // If there's still space in the buffer, store the character
-            if (rxIndex < sizeof(rxBuffer) - 1)
+            const uint8_t c = (i < size) ? data[i] : suffix[i - size];
+            if (dma)
             {
-                rxBuffer[rxIndex++] = received;
+                if (dmaFillCount == DMA_HALF_SIZE)
+                {
+                    dmaKick();
+                }
+                while (dmaFillCount == DMA_HALF_SIZE)
+                {
+                    if (txPolicy == OverflowPolicy::DropOldest)
+                    {
+                        // The half in flight cannot be recalled, discard the one waiting for it
+                        txCounters.dropped += dmaFillCount;
+                        dmaFillCount = 0;
+                    }
+                    else
+                    {
+                        dmaService();
+                        if (!primask)
+                        {
+                            __enable_irq();
+                            __disable_irq();
+                        }
+                    }
+                }
+                txBuffer[dmaFillHalf * DMA_HALF_SIZE + dmaFillCount++] = c;
+                continue;
             }
-            else
+
+            while (txCount() == UART_TX_BUFFER_SIZE)
             {
-                // If the buffer is full, reset it
-                rxIndex = 0;
+                if (txPolicy == OverflowPolicy::DropOldest)
+                {
+                    txTail = static_cast<uint16_t>(txTail + 1);
+                    ++txCounters.dropped;
+                }
+                else
+                {
+                    // Block: drive the transmitter by polling, then give pending interrupts a chance
+                    txService();
+                    if (!primask)
+                    {
+                        __enable_irq();
+                        __disable_irq();
+                    }
+                }
             }
+            sendChar(static_cast<char>(c));
+        }
+        txCounters.queued += total;
+
+        if (dma)
+        {
+            dmaKick();
+        }
+        else if (txCount() != 0)
+        {
+            UART0->C2 |= UART0_C2_TIE_MASK;
+        }
+        uint16_t pending = txPending();
+        if (pending > txCounters.peak)
+        {
+            txCounters.peak = pending;
+        }
+    }
+
+    addCycles(start);
+    if (!primask)
+    {
+        __enable_irq();
+    }
+}
+
+void Uart::sendChar(char c)
+{
+    txBuffer[txHead & (UART_TX_BUFFER_SIZE - 1)] = static_cast<uint8_t>(c);
+    txHead = static_cast<uint16_t>(txHead + 1);
+}
+
+void Uart::txService()
+{
+    if (txCount() == 0)
+    {
+        // Nothing left to send, stop the TDRE interrupt until the next queue()
+        UART0->C2 &= ~UART0_C2_TIE_MASK;
+        return;
+    }
+    if (UART0->S1 & UART0_S1_TDRE_MASK)
+    {
+        UART0->D = txBuffer[txTail & (UART_TX_BUFFER_SIZE - 1)];
+        txTail = static_cast<uint16_t>(txTail + 1);
+    }
+}
+
+void Uart::dmaKick()
+{
+    if (dmaInFlight != 0 || dmaFillCount == 0)
+    {
+        return;
+    }
+    auto& channel = DMA0->DMA[DMA_CHANNEL];
+    channel.DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+    channel.SAR     = reinterpret_cast<uintptr_t>(&txBuffer[dmaFillHalf * DMA_HALF_SIZE]);
+    channel.DAR     = reinterpret_cast<uintptr_t>(&UART0->D);
+    channel.DSR_BCR = DMA_DSR_BCR_BCR(dmaFillCount);
+    // 8-bit source to 8-bit UART data register, one transfer per request, stop at BCR = 0
+    channel.DCR     = DMA_DCR_EINT_MASK | DMA_DCR_ERQ_MASK | DMA_DCR_CS_MASK | DMA_DCR_SINC_MASK
+                    | DMA_DCR_SSIZE(1) | DMA_DCR_DSIZE(1) | DMA_DCR_D_REQ_MASK;
+
+    dmaInFlight  = dmaFillCount;
+    dmaFillHalf ^= 1u;
+    dmaFillCount = 0;
+    UART0->C2 |= UART0_C2_TIE_MASK;
+}
+
+void Uart::dmaService()
+{
+    if (dmaInFlight != 0 && (DMA0->DMA[DMA_CHANNEL].DSR_BCR & DMA_DSR_BCR_DONE_MASK))
+    {
+        DMA0->DMA[DMA_CHANNEL].DSR_BCR = DMA_DSR_BCR_DONE_MASK;
+        UART0->C2 &= ~UART0_C2_TIE_MASK;
+        dmaInFlight = 0;
+        dmaKick();
+    }
+}
+
+void Uart::handleDmaIRQ()
+{
+    const uint32_t start = isrmon::cycleStamp();
+    ++txCounters.interrupts;
+    dmaService();
+    addCycles(start);
+}
+
+void Uart::handleIRQ()
+{
+    // Transmit data register empty: feed the next byte from the ring
+    if (activeTxMode == TxMode::Interrupt
+        && (UART0->C2 & UART0_C2_TIE_MASK) && (UART0->S1 & UART0_S1_TDRE_MASK))
+    {
+        const uint32_t start = isrmon::cycleStamp();
+        ++txCounters.interrupts;
+        txService();
+        addCycles(start);
+    }
+
+    // Bytes were lost while interrupts were masked (a flash erase): OR blocks
+    // reception until cleared, and the torn line is dropped, so the rest of it
+    // is answered with an error and the next line parses cleanly
+    if (UART0->S1 & UART0_S1_OR_MASK)
+    {
+        UART0->S1 = UART0_S1_OR_MASK;   // write 1 to clear
+        command::reset();
+    }
+
+    // Check if a new byte has been received
+    if (UART0->S1 & UART0_S1_RDRF_MASK)
+    {
+        // The parser works byte by byte, a complete command line goes to the main loop
+        command::Command cmd;
+        if (command::feed(static_cast<char>(UART0->D), cmd))
+        {
+            events::postCommand(cmd);
         }
     }
 }
@@ -18,7 +18,20 @@ extern "C" {
 
 #include "../inc/BoardSupport.hpp"
 #include "../inc/Uart.hpp"
-#include "../inc/lcd.hpp"
+#include "../inc/Lcd.hpp"
+#include "../inc/StepDetector.hpp"
+#include "../inc/SampleTimer.hpp"
+#include "../inc/Accelerometer.hpp"
+#include "../inc/Telemetry.hpp"
+#include "../inc/IsrMonitor.hpp"
+#include "../inc/Events.hpp"
+#include "../inc/FixedPoint.hpp"
+#include "../inc/Command.hpp"
+#include "../inc/PowerManager.hpp"
+#include "../inc/Profiler.hpp"
+#include "../inc/CounterLog.hpp"
+#include "../inc/GaitMetrics.hpp"
+#include "../inc/SampleRecorder.hpp"
 
 /* =============== IMPORTANT NOTES ===============
  * In this project, I made the following changes in system_MKL05Z4.c file:
@@ -42,52 +55,1127 @@ extern "C" {
 
 #define BUTTON_PIN_POS 11
 
+/**
+ * @brief Accelerometer sampling rate in Hz (the MATLAB filters assume 10 Hz).
+ *
+ * The detector filters are designed at compile time for StepDetector::SAMPLE_RATE;
+ * change both together.
+ */
+#define SAMPLE_RATE_HZ 10
+static_assert(butter::hz(SAMPLE_RATE_HZ) == StepDetector::SAMPLE_RATE, "detector filters designed for another rate");
+
+/**
+ * @brief Detector peak thresholds: 0 = fixed MATLAB values (HPF/BPF commands),
+ *        n = adaptive, n/10 of the way from the mean of each filtered magnitude
+ *        to the average of its peaks (1..9).
+ *
+ * 5 counts all 59 steps of host/recordings/periodic_gait.txt at 0.2x to 3x
+ * amplitude (ADAPT command at run time); it also counts any periodic shaking.
+ */
+#define DETECTOR_ADAPTIVE_RATIO 0
+
+/**
+ * @brief Step source: 0 = the on-board detector counts, 1 = the host does (WALK++/RUN++).
+ *
+ * Only one of them counts, otherwise a step detected by both is counted twice.
+ * While the on-board detector counts, WALK++/RUN++ from the host are ignored;
+ * in host mode the on-board detections are not counted. HOST <n> switches at
+ * run time; the MATLAB script and the host/ tools send HOST 1 when they connect.
+ */
+#define STEP_SOURCE_HOST 0
+
+/**
+ * @brief Acquisition mode: 1 = MMA8451Q FIFO with watermark interrupt, 0 = PIT-timed polling.
+ *
+ * In FIFO mode the sensor runs at the ODR of the acquisition profile and every
+ * ODR / SAMPLE_RATE_HZ samples are averaged into one sample for the detector
+ * and the UART stream.
+ */
+#define ACQUISITION_FIFO      1
+#define ACCEL_FIFO_WATERMARK  10
+
+/**
+ * @brief Acquisition profiles: sensor ODR and oversampling with the I2C clock they need.
+ *
+ * ACQUISITION_PROFILE is used from start-up, the ACQ command switches at run
+ * time. At 200 Hz a FIFO drain moves four times the bytes of 50 Hz, so the
+ * faster profiles run the accelerometer transfers in fast mode. The rate is
+ * set for the accelerometer address only (I2C::setDeviceClock): the PCF8574
+ * is only specified for 100 kHz and the LCD driver keeps it there, although
+ * the boards ran the whole bus at about 920 kHz (I2C0->F = 0x03) before. The
+ * STATS report shows the share of each sample period the accelerometer and
+ * the LCD take on the bus ("BUS ..."), to check the headroom of a profile.
+ */
+struct AcquisitionProfile
+{
+    accel::Odr          odr;
+    uint16_t            odrHz;
+    accel::Oversampling oversampling;
+    uint32_t            sclHz;
+};
+constexpr AcquisitionProfile ACQUISITION_PROFILES[] = {
+    { accel::Odr::Hz50,  50,  accel::Oversampling::Normal,         I2C::STANDARD_HZ },
+    { accel::Odr::Hz100, 100, accel::Oversampling::HighResolution, I2C::FAST_HZ },
+    { accel::Odr::Hz200, 200, accel::Oversampling::HighResolution, I2C::FAST_HZ },
+};
+constexpr uint8_t ACQUISITION_PROFILE_COUNT = sizeof(ACQUISITION_PROFILES) / sizeof(ACQUISITION_PROFILES[0]);
+#define ACQUISITION_PROFILE   0
+static_assert(ACQUISITION_PROFILES[ACQUISITION_PROFILE].odrHz % SAMPLE_RATE_HZ == 0,
+              "profile ODR must be a multiple of the sample rate");
+
+/**
+ * @brief UART stream format: 0 = "%1.4f" text lines (MATLAB script), 1 = binary frames.
+ *
+ * Binary frames (see Telemetry.hpp) carry TELEMETRY_BATCH raw samples each and are
+ * decoded on the PC by the host/ telemetry decoder.
+ */
+#define TELEMETRY_BINARY      0
+#define TELEMETRY_BATCH       10
+
+/**
+ * @brief UART transmit path: Uart::TxMode::Blocking, Interrupt or Dma.
+ *
+ * Pressing the button prints the transmit counters (bytes, interrupts and core
+ * cycles spent sending) since the previous press, to compare the three modes.
+ */
+#define UART_TX_MODE          Uart::TxMode::Interrupt
+
+/**
+ * @brief UART link rate.
+ *
+ * The link starts at UART_BAUD (the MATLAB script's rate). BAUD <rate> switches
+ * it at run time to any rate up to UART_MAX_BAUD that the divider search in
+ * Uart::setBaudRate meets within 2 %: the reply "BAUD <actual> error <x.xx>%"
+ * goes out at the old rate, then the UART changes. The host follows and
+ * confirms with any valid command at the new rate (the host tools send the
+ * same BAUD again) within UART_BAUD_CONFIRM_MS, otherwise the board returns to
+ * the previous rate and reports "BAUD reverted", so a host that cannot follow
+ * never loses the link. 0 = no confirmation needed.
+ */
+#define UART_BAUD             9600
+#define UART_MAX_BAUD         460800
+#define UART_BAUD_CONFIRM_MS  2000
+
+/**
+ * @brief Power management (see PowerManager.hpp).
+ *
+ * POWER_VLPS_BETWEEN_SAMPLES selects VLPS instead of WAIT between FIFO watermarks.
+ * UART0 is clocked from MCGFLLCLK, which stops in VLPS, so bytes from the host
+ * (WALK++/RUN++ replies, commands) that arrive while the core sleeps are lost:
+ * enable it only when the on-board detector is used without the MATLAB script.
+ *
+ * After POWER_IDLE_TIMEOUT_S seconds without a step (0 = never) the sensor is put
+ * in motion detection at POWER_WAKE_ODR and the core stays in VLPS until an
+ * acceleration change above POWER_WAKE_THRESHOLD_MG or the button wakes it.
+ */
+#define POWER_VLPS_BETWEEN_SAMPLES 0
+#define POWER_IDLE_TIMEOUT_S       30
+#define POWER_WAKE_ODR             accel::Odr::Hz12_5
+#define POWER_WAKE_THRESHOLD_MG    190
+
+/**
+ * @brief Step counter persistence (see CounterLog.hpp).
+ *
+ * COUNTER_LOG_SECTORS 1 KB sectors at COUNTER_LOG_BASE hold the counter records;
+ * the linker must keep the image below FLASH_DATA_BASE (Keil: Options for
+ * Target > Target, IROM1 size 0x5000, the start of the recorder area; main()
+ * stops at start-up if the image ends above it). While the counters change, a
+ * record is written at most every COUNTER_LOG_INTERVAL_S seconds, and right
+ * away on reset and before deep idle. At 60 s and 4 sectors each sector is
+ * erased about every 5.6 hours of walking, far below the 10k cycle endurance
+ * over the life of the board.
+ */
+#define COUNTER_LOG_BASE        0x7000u
+#define COUNTER_LOG_SECTORS     4
+#define COUNTER_LOG_INTERVAL_S  60
+static_assert(COUNTER_LOG_BASE % flash::SECTOR_SIZE == 0
+              && COUNTER_LOG_BASE + COUNTER_LOG_SECTORS * flash::SECTOR_SIZE <= flash::SIZE,
+              "counter log outside the program flash");
+
+/**
+ * @brief Raw sample recorder (see SampleRecorder.hpp).
+ *
+ * REC 1 starts a recording of the samples fed to the detector (or at boot with
+ * RECORDER_AT_BOOT), REC 0 stops it. Completed blocks spill from RAM into
+ * RECORDER_FLASH_SECTORS 1 KB sectors at RECORDER_FLASH_BASE, below the counter
+ * log (0 = RAM only, about 50 samples); the image must end below it too. At
+ * 10 Hz walking takes 4 to 5 bytes per sample, so 8 sectors hold 2.3 to 2.7
+ * minutes of walking and much more of standing; each sector is then erased
+ * every 2 to 3 minutes of recording, which is why it is not on by default.
+ *
+ * DUMP <baud> replies "DUMP blocks <n> baud <rate>", waits until the line is
+ * sent plus RECORDER_DUMP_PAUSE_MS for the host to follow, sends the blocks as
+ * record frames at the new rate (0 = RECORDER_DUMP_BAUD, the fastest one
+ * within tolerance) and returns to the link rate before replying "OK".
+ */
+#define RECORDER_AT_BOOT        0
+#define RECORDER_FLASH_BASE     0x5000u
+#define RECORDER_FLASH_SECTORS  8
+#define RECORDER_DUMP_BAUD      UART_MAX_BAUD
+#define RECORDER_DUMP_PAUSE_MS  50
+static_assert(RECORDER_FLASH_BASE % flash::SECTOR_SIZE == 0
+              && RECORDER_FLASH_BASE + RECORDER_FLASH_SECTORS * flash::SECTOR_SIZE <= COUNTER_LOG_BASE,
+              "recorder area must end below the counter log");
+
+/**
+ * @brief Lowest flash address holding data; the program image must end below it.
+ */
+#define FLASH_DATA_BASE  (RECORDER_FLASH_SECTORS != 0 ? RECORDER_FLASH_BASE : COUNTER_LOG_BASE)
+
+/**
+ * @brief Gait metrics (see GaitMetrics.hpp).
+ *
+ * While the counters are on the LCD, the first line is refreshed every second
+ * and alternates every GAIT_LCD_PAGE_S seconds between cadence and speed
+ * ("112spm 4.5km/h") and the distance ("Dist 1.23 km"). Every GAIT_REPORT_S
+ * seconds (0 = never) the metrics go to the stream as a "GAIT ..." text line,
+ * followed by "THRESH ..." with the adaptive thresholds when they are on, or
+ * as a gait frame (always with the thresholds) in binary mode.
+ */
+#define GAIT_LCD_PAGE_S  3
+#define GAIT_REPORT_S    5
+
 /**
  * @brief PORTA Interrupt Service Routine.
  */
 
 uint32_t WalkStep = 0;
 uint32_t RunStep = 0;
-	
+
+/**
+ * @brief Flash copy of WalkStep/RunStep, restored at boot.
+ */
+static CounterLog g_counterLog(COUNTER_LOG_BASE, COUNTER_LOG_SECTORS, COUNTER_LOG_INTERVAL_S * 1000u);
+
+/**
+ * @brief On-board HPF/BPF step detector, fed from the sampling loop.
+ */
+static StepDetector g_stepDetector;
+
+/**
+ * @brief True while WALK++/RUN++ from the host are counted instead of the on-board detections (HOST command).
+ */
+static bool g_hostSteps = STEP_SOURCE_HOST;
+
+/**
+ * @brief Cadence, speed and distance from the counted steps, on the sample index time base.
+ */
+static GaitMetrics g_gaitMetrics(SAMPLE_RATE_HZ);
+static uint16_t    g_gaitSequence = 0;
+
+/**
+ * @brief Recording of the detector input for a bulk download (REC and DUMP commands).
+ */
+static SampleRecorder g_recorder(RECORDER_FLASH_BASE, RECORDER_FLASH_SECTORS);
+
+/**
+ * @brief Telemetry state: active format, frame under construction and sample counter.
+ */
+static bool                    g_binaryTelemetry = TELEMETRY_BINARY;
+static telemetry::FrameBuilder g_telemetryFrame(TELEMETRY_BATCH, SAMPLE_RATE_HZ);
+static uint32_t                g_sampleIndex = 0;
+
+/**
+ * @brief Active acquisition profile and, in FIFO mode, sensor samples averaged per sample (ACQ command).
+ */
+static uint8_t  g_acquisitionProfile = ACQUISITION_PROFILE;
+static uint8_t  g_decimation = ACQUISITION_PROFILES[ACQUISITION_PROFILE].odrHz / SAMPLE_RATE_HZ;
+static accel::Odr g_fifoOdr  = ACQUISITION_PROFILES[ACQUISITION_PROFILE].odr;
+
+/**
+ * @brief UART link rate in use and, until the host confirms a change, the rate to return to.
+ */
+static uint32_t g_linkBaud       = UART_BAUD;
+static uint32_t g_baudFallback   = 0;
+static uint32_t g_baudDeadlineMs = 0;
+
+/**
+ * @brief Samples processed since the last step, compared against POWER_IDLE_TIMEOUT_S.
+ */
+static uint32_t g_samplesSinceStep = 0;
+
+/**
+ * @brief True while the LCD shows the counters, so the gait line may replace the first line.
+ */
+static bool g_countersShown = false;
+
+/**
+ * @brief Converts milli-g to a Q15 threshold.
+ */
+static int32_t milliGToQ15(int32_t mg)
+{
+    return (mg * 32768 + 500) / 1000;
+}
+
+/**
+ * @brief Converts a Q15 threshold to milli-g.
+ */
+static int32_t q15ToMilliG(int32_t q15)
+{
+    return (q15 * 1000 + 16384) / 32768;
+}
+
+/**
+ * @brief Puts the step counters in the LCD framebuffer after an on-board detection.
+ */
+static void showStepCounters()
+{
+    char lcdBuffer[32];
+    char* p = fixedpoint::append(lcdBuffer, "Walk: ");
+    p = fixedpoint::formatUnsigned(p, WalkStep);
+    p = fixedpoint::append(p, " Run: ");
+    fixedpoint::formatUnsigned(p, RunStep);
+    if (!g_countersShown)
+    {
+        lcd::writeLine(0, "S9 = RESET");   // until the first gait refresh
+        g_countersShown = true;
+    }
+    lcd::writeLine(1, lcdBuffer);
+}
+
+/**
+ * @brief Counts one step in the counters, the gait metrics and the LCD.
+ */
+static void countStep(StepDetector::Step step)
+{
+    if (step == StepDetector::Step::Run)
+    {
+        RunStep++;
+    }
+    else
+    {
+        WalkStep++;
+    }
+    g_gaitMetrics.addStep(step, g_sampleIndex);
+    g_samplesSinceStep = 0;
+    showStepCounters();
+}
+
+/**
+ * @brief Once per second: gait line on the LCD and, every GAIT_REPORT_S seconds, on the stream.
+ * @param uart UART used for the sample stream.
+ */
+static void updateGait(Uart& uart)
+{
+    if (g_sampleIndex % SAMPLE_RATE_HZ != 0)
+    {
+        return;
+    }
+    const uint32_t seconds = g_sampleIndex / SAMPLE_RATE_HZ;
+    GaitMetrics::Metrics gait = g_gaitMetrics.metrics(g_sampleIndex);
+    const GaitMetrics::Window& now = gait.window[0];
+    const uint32_t distanceMm = gait.walkDistanceMm + gait.runDistanceMm;
+    char buffer[80];
+
+    if (g_countersShown)
+    {
+        char* p;
+        if ((seconds / GAIT_LCD_PAGE_S) % 2u == 0)
+        {
+            // 1 mm/s = 0.0036 km/h
+            p = fixedpoint::formatUnsigned(buffer, now.cadence);
+            p = fixedpoint::append(p, "spm ");
+            p = fixedpoint::formatDecimal(p, (now.speedMmS * 36u + 500u) / 1000u, 1);
+            fixedpoint::append(p, "km/h");
+        }
+        else
+        {
+            p = fixedpoint::append(buffer, "Dist ");
+            p = fixedpoint::formatDecimal(p, (distanceMm + 5000u) / 10000u, 2);
+            fixedpoint::append(p, " km");
+        }
+        lcd::writeLine(0, buffer);
+    }
+
+    if (GAIT_REPORT_S == 0 || seconds % GAIT_REPORT_S != 0)
+    {
+        return;
+    }
+    const uint16_t hpfMg = static_cast<uint16_t>(q15ToMilliG(g_stepDetector.hpfThreshold()));
+    const uint16_t bpfMg = static_cast<uint16_t>(q15ToMilliG(g_stepDetector.bpfThreshold()));
+    if (g_binaryTelemetry)
+    {
+        telemetry::Gait record = { { gait.window[0].cadence, gait.window[1].cadence },
+                                   now.walkCadence, now.runCadence, now.speedMmS,
+                                   gait.walkDistanceMm, gait.runDistanceMm, hpfMg, bpfMg };
+        uint8_t frame[telemetry::GAIT_FRAME_SIZE];
+        uart.write(frame, telemetry::buildGaitFrame(frame, g_gaitSequence++, SAMPLE_RATE_HZ, g_sampleIndex, record));
+    }
+    else
+    {
+        // More than three numbers, so the sample parsers skip the line
+        char* p = fixedpoint::append(buffer, "GAIT spm ");
+        p = fixedpoint::formatUnsigned(p, gait.window[0].cadence);
+        p = fixedpoint::append(p, " ");
+        p = fixedpoint::formatUnsigned(p, gait.window[1].cadence);
+        p = fixedpoint::append(p, " walk ");
+        p = fixedpoint::formatUnsigned(p, now.walkCadence);
+        p = fixedpoint::append(p, " run ");
+        p = fixedpoint::formatUnsigned(p, now.runCadence);
+        p = fixedpoint::append(p, " speed ");
+        p = fixedpoint::formatUnsigned(p, now.speedMmS);
+        p = fixedpoint::append(p, " mm/s dist ");
+        p = fixedpoint::formatDecimal(p, gait.walkDistanceMm, 3);
+        p = fixedpoint::append(p, " ");
+        p = fixedpoint::formatDecimal(p, gait.runDistanceMm, 3);
+        fixedpoint::append(p, " m");
+        uart.println(buffer);
+
+        if (g_stepDetector.config().adaptiveRatio != 0)
+        {
+            p = fixedpoint::append(buffer, "THRESH hpf ");
+            p = fixedpoint::formatUnsigned(p, hpfMg);
+            p = fixedpoint::append(p, " bpf ");
+            p = fixedpoint::formatUnsigned(p, bpfMg);
+            fixedpoint::append(p, " mg");
+            uart.println(buffer);
+        }
+    }
+}
+
+/**
+ * @brief Runs detection on one sample and streams it over UART.
+ * @param uart UART used for the sample stream.
+ * @param sample Acceleration in 14-bit counts.
+ */
+static void processSample(Uart& uart, const accel::Sample& sample)
+{
+    static char tempBuffer[36];
+
+    // On-board step detection (same pipeline as matlabFilterTests.m)
+    StepDetector::Step step;
+    {
+        PROFILE_SCOPE(Detect);
+        step = g_stepDetector.process(sample.x, sample.y, sample.z);
+    }
+    power::markSample();
+    g_recorder.add(g_sampleIndex, sample.x, sample.y, sample.z);
+    if (step == StepDetector::Step::None)
+    {
+        ++g_samplesSinceStep;
+    }
+    else if (!g_hostSteps)
+    {
+        countStep(step);
+    }
+
+    if (g_binaryTelemetry)
+    {
+        if (g_telemetryFrame.add(g_sampleIndex, sample.x, sample.y, sample.z))
+        {
+            uart.write(g_telemetryFrame.data(), g_telemetryFrame.size());
+        }
+    }
+    else
+    {
+        {
+            // Same text as "%1.4f" of counts / 4096 (default 4096 counts/g sensitivity), without soft-float
+            PROFILE_SCOPE(Format);
+            char* p = fixedpoint::formatCounts(tempBuffer, sample.x);
+            p = fixedpoint::append(p, "  ");
+            p = fixedpoint::formatCounts(p, sample.y);
+            p = fixedpoint::append(p, "  ");
+            fixedpoint::formatCounts(p, sample.z);
+        }
+        uart.println(tempBuffer);
+    }
+    ++g_sampleIndex;
+    updateGait(uart);
+}
+
+/**
+ * @brief Reports lost samples in text mode (the MATLAB parser skips non-sample lines).
+ *
+ * Binary frames carry sample timestamps, so the host detects gaps on its own.
+ * @param uart UART used for the sample stream.
+ * @param overruns Current overrun counter.
+ */
+static void reportOverruns(Uart& uart, uint32_t overruns)
+{
+    static uint32_t reported = 0;
+    if (overruns != reported && !g_binaryTelemetry)
+    {
+        char buffer[36];
+        reported = overruns;
+        fixedpoint::formatUnsigned(fixedpoint::append(buffer, "OVERRUN "), overruns);
+        uart.println(buffer);
+    }
+}
+
+/**
+ * @brief Size of the report and reply line buffers, enough for every counter at its maximum.
+ */
+constexpr uint8_t REPORT_LINE_SIZE = 128;
+
+/**
+ * @brief Bus time of the given traffic: 9 SCL periods per byte, about 2 for START and STOP [us].
+ */
+static uint32_t busTimeUs(uint32_t bytes, uint32_t transfers, uint32_t sclHz)
+{
+    return static_cast<uint32_t>((static_cast<uint64_t>(bytes) * 9u + transfers * 2u) * 1000000u / sclHz);
+}
+
+/**
+ * @brief Prints the share of the sample periods since the last report spent on accelerometer and LCD traffic.
+ *
+ * The LCD is the only other device on the bus, so it gets everything that was
+ * not addressed to the accelerometer (including the PCF8574 address probe).
+ * @param buffer Line buffer of the caller, REPORT_LINE_SIZE bytes.
+ */
+static void reportBusLoad(char* buffer)
+{
+    static uint32_t lastSample = 0;
+    static uint32_t lastBytes[2] = { 0, 0 };       // accelerometer, everything else
+    static uint32_t lastTransfers[2] = { 0, 0 };
+
+    const I2C::Stats& i2c = I2C::stats();
+    const I2C::DeviceStats* sensor = I2C::deviceStats(accel::ADDRESS);
+    uint32_t bytes[2]     = { sensor ? sensor->bytes : 0, 0 };
+    uint32_t transfers[2] = { sensor ? sensor->transfers : 0, 0 };
+    bytes[1]     = i2c.bytes - bytes[0];
+    transfers[1] = i2c.transfers - transfers[0];
+
+    const uint32_t sclHz[2] = { I2C::clockHz(accel::ADDRESS), I2C::clockHz(lcd::address()) };
+    const uint32_t periodUs = 1000000u / SAMPLE_RATE_HZ;
+    const uint32_t samples  = g_sampleIndex - lastSample;
+    uint32_t usPerSample[2];
+    uint32_t permille[2];
+    for (uint8_t i = 0; i < 2; ++i)
+    {
+        uint32_t us = busTimeUs(bytes[i] - lastBytes[i], transfers[i] - lastTransfers[i], sclHz[i]);
+        usPerSample[i] = samples ? us / samples : 0;
+        permille[i]    = samples ? static_cast<uint32_t>(static_cast<uint64_t>(us) * 1000u / (static_cast<uint64_t>(samples) * periodUs)) : 0;
+        lastBytes[i]     = bytes[i];
+        lastTransfers[i] = transfers[i];
+    }
+    lastSample = g_sampleIndex;
+
+    sprintf(buffer, "BUS scl %lu/%lu Hz period %lu us accel %lu us %lu.%lu%% lcd %lu us %lu.%lu%%",
+            static_cast<unsigned long>(sclHz[0]), static_cast<unsigned long>(sclHz[1]),
+            static_cast<unsigned long>(periodUs),
+            static_cast<unsigned long>(usPerSample[0]), static_cast<unsigned long>(permille[0] / 10u),
+            static_cast<unsigned long>(permille[0] % 10u), static_cast<unsigned long>(usPerSample[1]),
+            static_cast<unsigned long>(permille[1] / 10u), static_cast<unsigned long>(permille[1] % 10u));
+    Uart::println(buffer);
+}
+
+/**
+ * @brief Prints and clears the UART transmit counters.
+ */
+static void reportTxStats()
+{
+    // Called from the main loop, so the report may wait for room instead of being dropped
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::Block);
+
+    char buffer[REPORT_LINE_SIZE];
+    Uart::TxStats tx = Uart::txStats();
+    Uart::resetTxStats();
+    sprintf(buffer, "TX bytes %lu dropped %lu peak %u irq %lu cycles %lu",
+            static_cast<unsigned long>(tx.queued), static_cast<unsigned long>(tx.dropped), tx.peak,
+            static_cast<unsigned long>(tx.interrupts), static_cast<unsigned long>(tx.cycles));
+    Uart::println(buffer);
+
+    for (uint8_t i = 0; i < static_cast<uint8_t>(isrmon::Source::Count); ++i)
+    {
+        isrmon::Source source = static_cast<isrmon::Source>(i);
+        const isrmon::Stats& isr = isrmon::stats(source);
+        sprintf(buffer, "ISR %s count %lu max %lu cycles", isrmon::name(source),
+                static_cast<unsigned long>(isr.count), static_cast<unsigned long>(isr.maxCycles));
+        Uart::println(buffer);
+    }
+
+    const I2C::Stats& i2c = I2C::stats();
+    sprintf(buffer, "I2C transfers %lu errors %lu bytes %lu irq %lu",
+            static_cast<unsigned long>(i2c.transfers), static_cast<unsigned long>(i2c.errors),
+            static_cast<unsigned long>(i2c.bytes), static_cast<unsigned long>(i2c.interrupts));
+    Uart::println(buffer);
+    reportBusLoad(buffer);
+
+    const lcd::FlushStats& display = lcd::flushStats();
+    sprintf(buffer, "LCD flushes %lu cells %lu moves %lu bytes %lu saved %lu",
+            static_cast<unsigned long>(display.flushes), static_cast<unsigned long>(display.cellsWritten),
+            static_cast<unsigned long>(display.cursorMoves), static_cast<unsigned long>(display.bytesSent),
+            static_cast<unsigned long>(display.bytesSaved));
+    Uart::println(buffer);
+
+    events::Stats ev = events::stats();
+    sprintf(buffer, "EVENTS posted %lu dropped %lu peak %u",
+            static_cast<unsigned long>(ev.posted), static_cast<unsigned long>(ev.dropped), ev.peak);
+    Uart::println(buffer);
+
+    // Share of each power state in 0.1 %, then the deep idle wake-ups
+    const power::Stats& pw = power::stats();
+    uint32_t totalMs = 0;
+    for (uint32_t ms : pw.timeMs)
+    {
+        totalMs += ms;
+    }
+    int length = sprintf(buffer, "POWER");
+    for (uint8_t i = 0; i < static_cast<uint8_t>(power::State::Count); ++i)
+    {
+        uint32_t permille = totalMs ? static_cast<uint32_t>(static_cast<uint64_t>(pw.timeMs[i]) * 1000u / totalMs) : 0;
+        length += sprintf(buffer + length, " %s %lu.%lu%%", power::name(static_cast<power::State>(i)),
+                          static_cast<unsigned long>(permille / 10u), static_cast<unsigned long>(permille % 10u));
+    }
+    Uart::println(buffer);
+    sprintf(buffer, "WAKE count %lu latency %lu max %lu ms", static_cast<unsigned long>(pw.wakeups),
+            static_cast<unsigned long>(pw.wakeLatencyLastMs), static_cast<unsigned long>(pw.wakeLatencyMaxMs));
+    Uart::println(buffer);
+
+    const CounterLog::Stats& log = g_counterLog.stats();
+    sprintf(buffer, "LOG records %lu erases %lu errors %lu sector %lu free %u restore %lu reads",
+            static_cast<unsigned long>(log.records), static_cast<unsigned long>(log.erases),
+            static_cast<unsigned long>(log.errors), static_cast<unsigned long>(log.sequence), log.freeSlots,
+            static_cast<unsigned long>(log.restoreReads));
+    Uart::println(buffer);
+
+    // Raw size over encoded size, and the mean encoding cost
+    const SampleRecorder::Stats& rec = g_recorder.stats();
+    uint32_t ratio = rec.bytes ? static_cast<uint32_t>(static_cast<uint64_t>(rec.samples) * 600u / rec.bytes) : 0;
+    sprintf(buffer, "REC samples %lu bytes %lu ratio %lu.%02lu blocks %u dropped %lu errors %lu cycles %lu",
+            static_cast<unsigned long>(rec.samples), static_cast<unsigned long>(rec.bytes),
+            static_cast<unsigned long>(ratio / 100u), static_cast<unsigned long>(ratio % 100u), g_recorder.blocks(),
+            static_cast<unsigned long>(rec.dropped), static_cast<unsigned long>(rec.errors),
+            static_cast<unsigned long>(rec.samples ? rec.encodeCycles / rec.samples : 0));
+    Uart::println(buffer);
+
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::DropNewest);
+}
+
+#if PROFILING
+/**
+ * @brief Prints and clears the per-stage cycle profile (stages that never ran are skipped).
+ */
+static void reportProfile()
+{
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::Block);
+
+    char buffer[80];
+    for (uint8_t i = 0; i < static_cast<uint8_t>(profile::Stage::Count); ++i)
+    {
+        profile::Stage stage = static_cast<profile::Stage>(i);
+        const profile::Stats& st = profile::stats(stage);
+        if (st.count == 0)
+        {
+            continue;
+        }
+        sprintf(buffer, "PROF %s n %lu min %lu mean %lu max %lu cycles", profile::name(stage),
+                static_cast<unsigned long>(st.count), static_cast<unsigned long>(st.minCycles),
+                static_cast<unsigned long>(st.totalCycles / st.count), static_cast<unsigned long>(st.maxCycles));
+        Uart::println(buffer);
+    }
+    profile::reset();
+
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::DropNewest);
+}
+#endif
+
 extern "C" void PORTA_IRQHandler(void)
 {
+    isrmon::Scope timing(isrmon::Source::PortA);
+
+    // FIFO watermark from the accelerometer INT1 pin
+    if (PORTA->ISFR & (1 << ACCEL_INT1_PIN_POS))
+    {
+        PORTA->ISFR = (1 << ACCEL_INT1_PIN_POS);
+        accel::onInterrupt();
+    }
+
     // Check if the interrupt is indeed from our pin:
     if (PORTA->ISFR & (1 << BUTTON_PIN_POS))
     {
         // Clear the interrupt status flag by writing 1
-        PORTA->ISFR |= (1 << BUTTON_PIN_POS);
+        PORTA->ISFR = (1 << BUTTON_PIN_POS);
+
+        // The reset itself runs in the main loop (handleEvents)
+        events::post(events::Type::Reset);
+    }
+}
+
+/**
+ * @brief Samples left until the reset message is replaced by the start prompt (0 = none).
+ */
+static uint16_t g_resetMessageSamples = 0;
+
+/**
+ * @brief Clears the step counters and the detector, showing the reset message for about a second.
+ */
+static void resetSteps()
+{
+    lcd::writeLine(1, "Reseting steps..");
+    WalkStep = 0;
+    RunStep = 0;
+    g_stepDetector.reset();
+    g_gaitMetrics.reset();
+    g_countersShown = false;
+    g_samplesSinceStep = 0;
+    g_resetMessageSamples = SAMPLE_RATE_HZ;
+    g_counterLog.flush({ WalkStep, RunStep });
+}
+
+/**
+ * @brief (Re)starts acquisition after a profile change or a deep idle period.
+ *
+ * In FIFO mode the watermark is the largest multiple of @p decimation up to
+ * ACCEL_FIFO_WATERMARK, so every drain yields whole averaged samples.
+ * @return 0 if successful, non-zero otherwise.
+ */
+static uint8_t startAcquisition(accel::Odr odr, uint8_t decimation)
+{
+#if ACQUISITION_FIFO
+    uint8_t watermark = static_cast<uint8_t>((ACCEL_FIFO_WATERMARK / decimation) * decimation);
+    return accel::initFifo(odr, watermark ? watermark : decimation);
+#else
+    (void)odr;
+    (void)decimation;
+    return accel::initPolled();
+#endif
+}
+
+/**
+ * @brief Switches to another acquisition profile: I2C clock, oversampling and, in FIFO mode, ODR.
+ * @return 0 if successful, 1 if the profile does not exist or its ODR is not a multiple of the sample rate.
+ */
+static uint8_t setAcquisitionProfile(uint8_t index)
+{
+    if (index >= ACQUISITION_PROFILE_COUNT)
+    {
+        return 1;
+    }
+    const AcquisitionProfile& profile = ACQUISITION_PROFILES[index];
+#if ACQUISITION_FIFO
+    if (profile.odrHz % SAMPLE_RATE_HZ != 0)
+    {
+        return 1;
+    }
+#endif
+    // Only the accelerometer changes rate, the LCD padding stays valid
+    I2C::setDeviceClock(accel::ADDRESS, profile.sclHz);
+    accel::setOversampling(profile.oversampling);
+
+    uint8_t decimation = static_cast<uint8_t>(profile.odrHz / SAMPLE_RATE_HZ);
+    if (startAcquisition(profile.odr, decimation) != 0)
+    {
+        return 1;
+    }
+#if ACQUISITION_FIFO
+    g_fifoOdr    = profile.odr;
+    g_decimation = decimation;
+#endif
+    g_acquisitionProfile = index;
+    return 0;
+}
+
+/**
+ * @brief Sends a command reply, waiting for room in the transmit ring instead of dropping it.
+ */
+static void sendReply(const char* text)
+{
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::Block);
+    Uart::println(text);
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::DropNewest);
+}
+
+/**
+ * @brief Returns true if @p baud is in the link range and the divider meets it.
+ */
+static bool baudSupported(int32_t baud, Uart::BaudDivisor& divisor)
+{
+    return baud >= 9600 && baud <= UART_MAX_BAUD
+        && Uart::findBaudDivisor(SystemCoreClock, static_cast<uint32_t>(baud), divisor) == 0;
+}
+
+/**
+ * @brief Switches the link rate; lines received before the switch no longer confirm it.
+ */
+static void switchLinkBaud(uint32_t baud)
+{
+    Uart::flush();
+    __disable_irq();
+    Uart::setBaudRate(baud);
+    command::reset();
+    events::nextEpoch();
+    __enable_irq();
+}
+
+/**
+ * @brief BAUD command: replies at the current rate, then switches and waits for the host's confirmation.
+ */
+static void changeLinkBaud(int32_t baud)
+{
+    Uart::BaudDivisor divisor;
+    if (!baudSupported(baud, divisor))
+    {
+        sendReply("ERR range");
+        return;
+    }
+    char buffer[40];
+    sprintf(buffer, "BAUD %lu error %lu.%02lu%%", static_cast<unsigned long>(divisor.actual),
+            static_cast<unsigned long>(divisor.errorPpm / 10000u),
+            static_cast<unsigned long>((divisor.errorPpm / 100u) % 100u));
+    sendReply(buffer);
+    if (static_cast<uint32_t>(baud) == g_linkBaud)
+    {
+        return;     // already there, e.g. the host's confirmation
+    }
+
+    switchLinkBaud(static_cast<uint32_t>(baud));
+    if (UART_BAUD_CONFIRM_MS != 0)
+    {
+        g_baudFallback   = g_linkBaud;
+        g_baudDeadlineMs = power::nowMs() + UART_BAUD_CONFIRM_MS;
+    }
+    g_linkBaud = static_cast<uint32_t>(baud);
+}
+
+/**
+ * @brief Returns to the previous link rate if the host did not confirm a BAUD change in time.
+ */
+static void checkLinkBaud()
+{
+    if (g_baudFallback != 0 && static_cast<int32_t>(power::nowMs() - g_baudDeadlineMs) >= 0)
+    {
+        switchLinkBaud(g_baudFallback);
+        g_linkBaud     = g_baudFallback;
+        g_baudFallback = 0;
+        sendReply("BAUD reverted");
+    }
+}
 
-					// Inform about reset
-					lcd::setCursor(0, 1);
-					lcd::print("Reseting steps..");
-					DELAY(1000);
+/**
+ * @brief Sends the recording as record frames at @p baud, then returns to the link rate.
+ *
+ * Sampling stops meanwhile: the FIFO overflows if the download takes longer
+ * than a FIFO period, and the overflow is reported as usual.
+ */
+static void dumpRecording(uint32_t baud)
+{
+    char buffer[40];
+    const uint16_t blocks = g_recorder.blocks();
+    sprintf(buffer, "DUMP blocks %u baud %lu", blocks, static_cast<unsigned long>(baud));
+    sendReply(buffer);
+
+    // The host switches its rate once it has the line
+    Uart::flush();
+    delayUs(RECORDER_DUMP_PAUSE_MS * 1000u);
+    Uart::setBaudRate(baud);
 
-					// Reset values
-					lcd::clearAll();
-					WalkStep = 0;
-					RunStep = 0;
-					lcd::setCursor(0, 0);
-					lcd::print("Start moving");
-					lcd::setCursor(0, 1);
-					lcd::print("to count steps");
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::Block);
+    SampleRecorder::Block block;
+    uint8_t frame[telemetry::RECORD_FRAME_SIZE];
+    for (uint16_t i = 0; i < blocks && g_recorder.readBlock(i, block) == 0; ++i)
+    {
+        uint16_t size = telemetry::buildRecordFrame(frame, i, block.rateHz, block.firstSample,
+                                                    block.samples, block.payload, block.size);
+        Uart::write(frame, size);
     }
+    Uart::flush();
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::DropNewest);
+
+    delayUs(RECORDER_DUMP_PAUSE_MS * 1000u);
+    Uart::setBaudRate(g_linkBaud);
 }
 
+/**
+ * @brief Executes one UART command and replies "OK" or "ERR <reason>".
+ */
+static void handleCommand(const command::Command& cmd)
+{
+    StepDetector::Config& cfg = g_stepDetector.config();
+    const int32_t arg = cmd.arg[0];
+    const char* reply = "OK";
+    char buffer[REPORT_LINE_SIZE];
+
+    switch (cmd.id)
+    {
+    case command::Id::Walk:
+    case command::Id::Run:
+        // The host streams these, no reply; ignored while the on-board detector counts
+        if (g_hostSteps)
+        {
+            countStep(cmd.id == command::Id::Run ? StepDetector::Step::Run : StepDetector::Step::Walk);
+        }
+        return;
+
+    case command::Id::Host:
+        if (arg < 0 || arg > 1)
+        {
+            reply = "ERR range";
+        }
+        else
+        {
+            g_hostSteps = arg != 0;
+        }
+        break;
+
+    case command::Id::Reset:
+        resetSteps();
+        break;
+
+    case command::Id::HpfThreshold:
+    case command::Id::BpfThreshold:
+        if (arg < 1 || arg > 4000)
+        {
+            reply = "ERR range";
+        }
+        else if (cmd.id == command::Id::HpfThreshold)
+        {
+            cfg.hpfPeakThreshold = milliGToQ15(arg);
+        }
+        else
+        {
+            cfg.bpfPeakThreshold = milliGToQ15(arg);
+        }
+        break;
+
+    case command::Id::HpfDistance:
+    case command::Id::BpfDistance:
+        if (arg < 1 || arg > 255)
+        {
+            reply = "ERR range";
+        }
+        else if (cmd.id == command::Id::HpfDistance)
+        {
+            cfg.minHPFSampleDist = static_cast<uint8_t>(arg);
+        }
+        else
+        {
+            cfg.minBPFSampleDist = static_cast<uint8_t>(arg);
+        }
+        break;
+
+    case command::Id::Acquisition:
+        if (arg < 0 || arg > 0xFF || setAcquisitionProfile(static_cast<uint8_t>(arg)) != 0)
+        {
+            reply = "ERR range";
+        }
+        break;
+
+    case command::Id::Adaptive:
+        if (arg < 0 || arg > 9)
+        {
+            reply = "ERR range";
+        }
+        else
+        {
+            cfg.adaptiveRatio = static_cast<uint8_t>(arg);
+        }
+        break;
+
+    case command::Id::Text:
+        // Send the samples of a partial frame before the text lines start
+        if (g_binaryTelemetry && g_telemetryFrame.flush())
+        {
+            Uart::write(g_telemetryFrame.data(), g_telemetryFrame.size());
+        }
+        g_binaryTelemetry = false;
+        break;
+
+    case command::Id::Binary:
+        sendReply(reply);
+        g_binaryTelemetry = true;
+        return;
+
+    case command::Id::Count:
+    {
+        char* p = fixedpoint::append(buffer, "Walk: ");
+        p = fixedpoint::formatUnsigned(p, WalkStep);
+        p = fixedpoint::append(p, " Run: ");
+        fixedpoint::formatUnsigned(p, RunStep);
+        reply = buffer;
+        break;
+    }
+
+    case command::Id::Stats:
+        reportTxStats();
+        isrmon::reset();
+        power::reset();
+        break;
+
+    case command::Id::Profile:
+#if PROFILING
+        reportProfile();
+#else
+        reply = "ERR disabled";
+#endif
+        break;
+
+    case command::Id::Config:
+        sprintf(buffer, "CONFIG rate %u acq %u hpf %ld bpf %ld hdist %u bdist %u adapt %u host %u baud %lu", SAMPLE_RATE_HZ,
+                g_acquisitionProfile, static_cast<long>(q15ToMilliG(cfg.hpfPeakThreshold)),
+                static_cast<long>(q15ToMilliG(cfg.bpfPeakThreshold)), cfg.minHPFSampleDist, cfg.minBPFSampleDist,
+                cfg.adaptiveRatio, g_hostSteps, static_cast<unsigned long>(Uart::baudDivisor().actual));
+        reply = buffer;
+        break;
+
+    case command::Id::Record:
+        if (arg < 0 || arg > 1)
+        {
+            reply = "ERR range";
+        }
+        else if (arg)
+        {
+            g_recorder.start(SAMPLE_RATE_HZ);
+        }
+        else
+        {
+            g_recorder.stop();
+        }
+        break;
+
+    case command::Id::Dump:
+    {
+        Uart::BaudDivisor divisor;
+        if (!baudSupported(arg ? arg : RECORDER_DUMP_BAUD, divisor))
+        {
+            reply = "ERR range";
+            break;
+        }
+        dumpRecording(arg ? static_cast<uint32_t>(arg) : RECORDER_DUMP_BAUD);
+        break;
+    }
+
+    case command::Id::Baud:
+        changeLinkBaud(arg);
+        return;
 
+    case command::Id::Unknown:
+        reply = "ERR unknown";
+        break;
 
+    case command::Id::BadArgs:
+        reply = "ERR args";
+        break;
+    }
+    sendReply(reply);
+}
+
+/**
+ * @brief Handles the events posted by the interrupt handlers.
+ */
+static void handleEvents()
+{
+    events::Event event;
+    while (events::poll(event))
+    {
+        switch (event.type)
+        {
+        case events::Type::Reset:
+            // Inform about reset, the start prompt follows about a second later
+            resetSteps();
+            if (!g_binaryTelemetry)
+            {
+                reportTxStats();
+            }
+            isrmon::reset();
+            power::reset();
+            break;
+
+        case events::Type::Command:
+            // A command understood at the new rate confirms a BAUD change; one queued
+            // before the switch (an older epoch) was sent at the old rate
+            if (event.epoch == events::epoch()
+                && event.command.id != command::Id::Unknown && event.command.id != command::Id::BadArgs)
+            {
+                g_baudFallback = 0;
+            }
+            handleCommand(event.command);
+            break;
+        }
+    }
+}
+
+/**
+ * @brief Counts down the reset message, called once per processed sample.
+ */
+static void updateResetMessage()
+{
+    if (g_resetMessageSamples != 0 && --g_resetMessageSamples == 0)
+    {
+        lcd::writeLine(0, "Start moving");
+        lcd::writeLine(1, "to count steps");
+    }
+}
+
+
+
+
+/**
+ * @brief Deep idle: the sensor watches for motion while the core stays in VLPS.
+ *
+ * Returns on motion or on an event (button), with acquisition restarted.
+ */
+static void sleepUntilMotion()
+{
+    g_countersShown = false;
+    lcd::writeLine(0, "Idle: move to");
+    lcd::writeLine(1, "resume counting");
+    lcd::flush();
+    setLedColor(false, false, false);
+
+    // Save the counters while idle; the transmitter stops in VLPS, send what is queued first
+    g_counterLog.flush({ WalkStep, RunStep });
+    Uart::flush();
+    accel::initMotionWake(POWER_WAKE_ODR, POWER_WAKE_THRESHOLD_MG);
+
+    __disable_irq();
+    while (!accel::motionDetected() && events::empty())
+    {
+        power::sleep(power::State::Idle);
+        __enable_irq();
+        __disable_irq();
+    }
+    __enable_irq();
+
+    power::markWake();
+    startAcquisition(g_fifoOdr, g_decimation);
+    setLedColor(false, true, false);
+    showStepCounters();
+    g_samplesSinceStep = 0;
+}
+
+/**
+ * @brief Returns true once no step was seen for POWER_IDLE_TIMEOUT_S seconds.
+ */
+static bool idleTimeoutExpired()
+{
+    return POWER_IDLE_TIMEOUT_S != 0
+        && g_samplesSinceStep >= static_cast<uint32_t>(POWER_IDLE_TIMEOUT_S) * SAMPLE_RATE_HZ;
+}
 
 int main()
 {
+    // Time base for the power state statistics, VLPS allowed
+    power::init();
+
     // UART initialization for debug/print
-    Uart start(9600);
+    Uart start(UART_BAUD, nullptr, UART_TX_MODE);
+    // Never stall the sampling loop on a slow link: a line that does not fit is dropped whole
+    Uart::setOverflowPolicy(Uart::OverflowPolicy::DropNewest);
 
-    // Board peripherals initialization
+    // Board peripherals initialization, the accelerometer at the bus speed of the acquisition profile
+    I2C::setDeviceClock(accel::ADDRESS, ACQUISITION_PROFILES[ACQUISITION_PROFILE].sclHz);
+    accel::setOversampling(ACQUISITION_PROFILES[ACQUISITION_PROFILE].oversampling);
     I2C::init();
     LED_init();
 
     // Green LED on)
     setLedColor(false, true, false);
 
+    // An image grown into the data areas would erase its own code: red LED, no start
+    if (flash::imageEnd() > FLASH_DATA_BASE)
+    {
+        char line[REPORT_LINE_SIZE];
+        sprintf(line, "ERR image ends at 0x%lx, flash data starts at 0x%lx",
+                static_cast<unsigned long>(flash::imageEnd()), static_cast<unsigned long>(FLASH_DATA_BASE));
+        Uart::println(line);
+        setLedColor(true, false, false);
+        while (true)
+        {
+            __WFI();
+        }
+    }
+
     // === BUTTON CONFIGURATION ON PORTA ===
     // Enable clock on PORTA
     SIM->SCGC5 |= SIM_SCGC5_PORTA_MASK;
@@ -107,15 +1195,33 @@ int main()
     NVIC_ClearPendingIRQ(PORTA_IRQn);
     NVIC_EnableIRQ(PORTA_IRQn);
 
+    g_stepDetector.config().adaptiveRatio = DETECTOR_ADAPTIVE_RATIO;
+    if (RECORDER_AT_BOOT)
+    {
+        g_recorder.start(SAMPLE_RATE_HZ);
+    }
+
+    // === STEP COUNTERS saved before the last reset or power loss ===
+    CounterLog::Counters saved;
+    bool resumed = g_counterLog.restore(saved) == 0 && (saved.walk != 0 || saved.run != 0);
+    WalkStep = saved.walk;
+    RunStep  = saved.run;
+
     // === LCD INITIALIZATION ===
     lcd::init();
     lcd::clearAll();
 
-    // Display initial messages
-    lcd::setCursor(0, 0);
-    lcd::print("Start moving");
-    lcd::setCursor(0, 1);
-    lcd::print("to count steps");
+    // Display initial messages, or the counters carried over
+    if (resumed)
+    {
+        showStepCounters();
+    }
+    else
+    {
+        lcd::writeLine(0, "Start moving");
+        lcd::writeLine(1, "to count steps");
+    }
+    lcd::flush();
 
 
 		// === UART RX Interrupt Configuration ===
@@ -123,27 +1229,80 @@ int main()
     UART0->C2 |= UART0_C2_RIE_MASK;
     NVIC_ClearPendingIRQ(UART0_IRQn);
     NVIC_EnableIRQ(UART0_IRQn);
-		
+
+#if ACQUISITION_FIFO
+    // === ACCELEROMETER FIFO, drained on the watermark interrupt ===
+    startAcquisition(g_fifoOdr, g_decimation);
+#else
+    // === ACCELEROMETER configured once, sampled on the PIT tick ===
+    accel::initPolled();
+    SampleTimer::init(SAMPLE_RATE_HZ);
+#endif
 
     while (true)
     {
-			// Accelerometer config & reading
-			I2C::writeReg(0x1D, 0x2A, 1);
-			I2C::writeReg(0x1D, 0x0E, 0x00);
+			accel::Sample sample;
 
-			static char tempBuffer[36];
-			static uint8_t arrayXYZ[6];
-			I2C::readRegBlock(0x1D, 0x01, 6, arrayXYZ);
-			
-			double x_=((double)((int16_t)((arrayXYZ[0]<<8)|arrayXYZ[1])>>2)/4096);
-			double y_=((double)((int16_t)((arrayXYZ[2]<<8)|arrayXYZ[3])>>2)/4096);
-			double z_=((double)((int16_t)((arrayXYZ[4]<<8)|arrayXYZ[5])>>2)/4096);
-			sprintf(tempBuffer,"%1.4f  %1.4f  %1.4f", x_, y_, z_); // default 4096 counts/g sensitivity
-			start.println(tempBuffer);
+#if ACQUISITION_FIFO
+			// Sleep until the FIFO watermark is reached or an interrupt posted an event
+			__disable_irq();
+			while (!accel::fifoReady() && events::empty())
+			{
+				power::sleep(POWER_VLPS_BETWEEN_SAMPLES ? power::State::Vlps : power::State::Wait);
+				__enable_irq();
+				__disable_irq();
+			}
+			__enable_irq();
+
+			handleEvents();
+
+			if (accel::fifoReady())
+			{
+				accel::drainFifo();
+				while (accel::popAveraged(sample, g_decimation))
+				{
+					processSample(start, sample);
+					updateResetMessage();
+				}
+				reportOverruns(start, accel::stats().fifoOverflows);
+			}
+			lcd::flush();
 
+			// At most one record or sector erase, after the sample work
+			if (!g_counterLog.poll({ WalkStep, RunStep }, power::nowMs()))
+			{
+				g_recorder.poll();
+			}
+			checkLinkBaud();
 
-			// 10 Hz
-			DELAY(98); // Assuming a 2ms delay due to code processing
+			if (idleTimeoutExpired() && events::empty())
+			{
+				sleepUntilMotion();
+			}
+#else
+			// Sleep until the next sampling period starts
+			SampleTimer::waitForTick();
+
+			handleEvents();
+
+			accel::readSample(sample);
+			processSample(start, sample);
+			updateResetMessage();
+			reportOverruns(start, SampleTimer::stats().overruns);
+			lcd::flush();
+
+			// At most one record or sector erase, after the sample work
+			if (!g_counterLog.poll({ WalkStep, RunStep }, power::nowMs()))
+			{
+				g_recorder.poll();
+			}
+			checkLinkBaud();
+
+			if (idleTimeoutExpired() && events::empty())
+			{
+				sleepUntilMotion();
+			}
+#endif
     }
 			
     return 0;